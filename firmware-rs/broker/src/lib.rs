@@ -0,0 +1,105 @@
+use std::{
+    collections::HashMap,
+    net::{SocketAddr, TcpStream},
+    thread,
+    time::{Duration, Instant},
+};
+
+use rumqttd::{Broker, Config, ConnectionSettings, RouterConfig, ServerSettings};
+use thiserror::Error;
+use tracing::{info, warn};
+
+// Generous enough for the load generator's default fleet plus the observer.
+const MAX_CONNECTIONS: usize = 10_010;
+// Matches the largest payload we publish (full schedule JSON) with headroom.
+const MAX_PAYLOAD_SIZE: usize = 256 * 1024;
+const READY_TIMEOUT: Duration = Duration::from_secs(5);
+
+#[derive(Debug, Error)]
+pub enum BrokerError {
+    #[error("failed to spawn broker thread: {0}")]
+    Spawn(#[from] std::io::Error),
+    #[error("broker did not accept connections on {0} within {READY_TIMEOUT:?}")]
+    NotReady(SocketAddr),
+}
+
+// An MQTT 3.1.1 broker running on its own thread inside this process. The
+// router has no shutdown hook, so the broker lives until the process exits;
+// dropping the handle only forgets it.
+//
+// With credentials every client must log in with that username and password;
+// without them any client that can reach `listen` may publish commands.
+#[derive(Debug)]
+pub struct EmbeddedBroker {
+    addr: SocketAddr,
+}
+
+impl EmbeddedBroker {
+    // Returns once the listener accepts TCP connections, so clients created
+    // right after never race the bind.
+    pub fn start(
+        listen: SocketAddr,
+        credentials: Option<(String, String)>,
+    ) -> Result<Self, BrokerError> {
+        let mut broker = Broker::new(broker_config(listen, credentials));
+        thread::Builder::new()
+            .name("mqtt-broker".to_string())
+            .spawn(move || {
+                if let Err(err) = broker.start() {
+                    warn!("embedded mqtt broker stopped: {err}");
+                }
+            })?;
+
+        let connect_addr = if listen.ip().is_unspecified() {
+            SocketAddr::from(([127, 0, 0, 1], listen.port()))
+        } else {
+            listen
+        };
+        let deadline = Instant::now() + READY_TIMEOUT;
+        while TcpStream::connect_timeout(&connect_addr, Duration::from_millis(100)).is_err() {
+            if Instant::now() >= deadline {
+                return Err(BrokerError::NotReady(listen));
+            }
+            thread::sleep(Duration::from_millis(20));
+        }
+
+        info!("embedded mqtt broker listening on {listen}");
+        Ok(Self { addr: connect_addr })
+    }
+
+    // Address clients should connect to (loopback when listening on all
+    // interfaces).
+    pub fn addr(&self) -> SocketAddr {
+        self.addr
+    }
+}
+
+fn broker_config(listen: SocketAddr, credentials: Option<(String, String)>) -> Config {
+    let server = ServerSettings {
+        name: "v4".to_string(),
+        listen,
+        tls: None,
+        next_connection_delay_ms: 1,
+        connections: ConnectionSettings {
+            connection_timeout_ms: 60_000,
+            max_payload_size: MAX_PAYLOAD_SIZE,
+            max_inflight_count: 100,
+            auth: credentials.map(|(user, pass)| HashMap::from([(user, pass)])),
+            external_auth: None,
+            dynamic_filters: true,
+        },
+    };
+
+    Config {
+        id: 0,
+        router: RouterConfig {
+            max_connections: MAX_CONNECTIONS,
+            max_outgoing_packet_count: 200,
+            max_segment_size: 100 * 1024 * 1024,
+            max_segment_count: 10,
+            ..RouterConfig::default()
+        },
+        v4: Some(HashMap::from([("v4".to_string(), server)])),
+        ..Config::default()
+    }
+}
@@ -0,0 +1,253 @@
+use chrono::{Duration, FixedOffset, TimeZone};
+use criterion::{
+    black_box, criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput,
+};
+use thermostat_common::{
+    history::{HISTORY_STORE_CAPACITY, SENSOR_BUFFER_CAPACITY},
+    DayOfWeek, DeciDegrees, HistoryStore, PersistedSettings, ReadingBuffer, Schedule,
+    ScheduleEntry, ThermostatConfig, ThermostatEngine, ThermostatMode, ThermostatState,
+};
+
+// Engine time for every tick below. Holding it fixed keeps each engine in the
+// state it was driven to, so an iteration measures one steady-state tick.
+const NOW_MS: u64 = 60_000;
+
+// 4 is a single day, 28 a typical week, 512 the compact transfer limit.
+const SCHEDULE_SIZES: [usize; 4] = [4, 28, 128, 512];
+
+fn heat_settings() -> PersistedSettings {
+    PersistedSettings {
+        mode: ThermostatMode::Heat,
+        ..PersistedSettings::default()
+    }
+}
+
+fn engine_in(state: ThermostatState) -> ThermostatEngine {
+    let mut config = ThermostatConfig::default();
+    if state == ThermostatState::Cooldown {
+        config.max_runtime_ms = 1_000;
+    }
+    let mut engine = ThermostatEngine::new(config, heat_settings());
+    match state {
+        ThermostatState::Idle => {
+            engine.set_mode(ThermostatMode::Off);
+            engine.update_sensor_data(DeciDegrees::from_degrees(66), 40.0, NOW_MS);
+        }
+        ThermostatState::Heating => {
+            engine.update_sensor_data(DeciDegrees::from_degrees(64), 40.0, NOW_MS);
+        }
+        ThermostatState::Satisfied => {
+            engine.update_sensor_data(DeciDegrees::from_degrees(71), 40.0, NOW_MS);
+        }
+        ThermostatState::Hold => {
+            engine.update_sensor_data(DeciDegrees::from_degrees(66), 40.0, NOW_MS);
+            engine.enter_hold(None, NOW_MS);
+        }
+        ThermostatState::Cooldown => {
+            // Turn on, then let the shortened runtime limit trip.
+            engine.update_sensor_data(DeciDegrees::from_degrees(64), 40.0, 0);
+            engine.tick(0);
+            engine.update_sensor_data(DeciDegrees::from_degrees(64), 40.0, NOW_MS);
+        }
+    }
+    engine.tick(NOW_MS);
+    assert_eq!(engine.state(), state);
+    engine
+}
+
+fn schedule(entries: usize) -> Schedule {
+    // Spread entries evenly over the week, then emit them out of order so
+    // normalize has real sorting to do.
+    let per_day = entries.div_ceil(7);
+    let mut entries: Vec<_> = (0..entries)
+        .map(|index| ScheduleEntry {
+            day: DayOfWeek::from_index(index % 7),
+            start_minutes: ((index / 7) * (24 * 60) / per_day) as u16,
+            mode: ThermostatMode::Heat,
+            target_temp_f: DeciDegrees::from_degrees(62 + (index % 10) as i16),
+        })
+        .collect();
+    entries.reverse();
+    Schedule {
+        enabled: true,
+        entries,
+    }
+}
+
+fn bench_tick(c: &mut Criterion) {
+    let mut group = c.benchmark_group("engine_tick");
+    group.throughput(Throughput::Elements(1));
+    for state in [
+        ThermostatState::Idle,
+        ThermostatState::Heating,
+        ThermostatState::Satisfied,
+        ThermostatState::Hold,
+        ThermostatState::Cooldown,
+    ] {
+        group.bench_function(state.as_str().to_lowercase(), |b| {
+            let mut engine = engine_in(state);
+            b.iter(|| engine.tick(black_box(NOW_MS)).len())
+        });
+    }
+    group.finish();
+}
+
+fn bench_schedule(c: &mut Criterion) {
+    // Monday 07:00 local, so lookups scan back past the day's first entry.
+    let now = FixedOffset::west_opt(8 * 3600)
+        .unwrap()
+        .with_ymd_and_hms(2024, 1, 1, 7, 0, 0)
+        .unwrap();
+
+    let mut group = c.benchmark_group("schedule");
+    for size in SCHEDULE_SIZES {
+        let unsorted = schedule(size);
+        let mut sorted = unsorted.clone();
+        sorted.normalize();
+
+        group.throughput(Throughput::Elements(size as u64));
+        group.bench_with_input(
+            BenchmarkId::new("normalize", size),
+            &unsorted,
+            |b, input| {
+                b.iter_batched(
+                    || input.clone(),
+                    |mut schedule| {
+                        schedule.normalize();
+                        schedule
+                    },
+                    BatchSize::SmallInput,
+                )
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("current_action", size),
+            &sorted,
+            |b, schedule| b.iter(|| schedule.current_action(black_box(now))),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("next_event_epoch", size),
+            &sorted,
+            |b, schedule| {
+                let mut minutes = 0_i64;
+                b.iter(|| {
+                    // Walk through the week so every day's entries get hit.
+                    minutes = (minutes + 17) % (7 * 24 * 60);
+                    schedule.next_event_epoch(black_box(now + Duration::minutes(minutes)))
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn bench_serialize(c: &mut Criterion) {
+    let engine = engine_in(ThermostatState::Heating);
+    let status = |now_ms| engine.status(now_ms, true, Some(1_704_121_200), true, "UTC");
+    let mut buf = Vec::with_capacity(1024);
+    println!(
+        "status {} bytes, state payload {} bytes",
+        serde_json::to_vec(&status(NOW_MS)).unwrap().len(),
+        serde_json::to_vec(&engine.state_payload(NOW_MS))
+            .unwrap()
+            .len()
+    );
+
+    let mut group = c.benchmark_group("engine_serialize");
+    group.throughput(Throughput::Elements(1));
+    group.bench_function("status", |b| {
+        b.iter(|| {
+            buf.clear();
+            serde_json::to_writer(&mut buf, &status(black_box(NOW_MS))).unwrap();
+            buf.len()
+        })
+    });
+    group.bench_function("state_payload", |b| {
+        b.iter(|| {
+            buf.clear();
+            serde_json::to_writer(&mut buf, &engine.state_payload(black_box(NOW_MS))).unwrap();
+            buf.len()
+        })
+    });
+    group.finish();
+}
+
+fn bench_sanitize(c: &mut Criterion) {
+    let inputs = [
+        ("in_range", heat_settings()),
+        (
+            "out_of_range",
+            PersistedSettings {
+                target_temp_f: DeciDegrees::from_degrees(91),
+                hysteresis_f: DeciDegrees::from_tenths(1),
+                mode: ThermostatMode::Heat,
+                fireplace_offset_f: 7,
+            },
+        ),
+    ];
+
+    let mut group = c.benchmark_group("settings_sanitize");
+    group.throughput(Throughput::Elements(1));
+    for (name, settings) in inputs {
+        group.bench_with_input(name, &settings, |b, settings| {
+            b.iter(|| {
+                let mut settings = black_box(settings.clone());
+                settings.sanitize();
+                settings
+            })
+        });
+    }
+    group.finish();
+}
+
+fn bench_history(c: &mut Criterion) {
+    let temp = Some(DeciDegrees::from_tenths(685));
+    // Both buffers start full, so every push also evicts the oldest entry.
+    let mut store = HistoryStore::default();
+    let mut buffer = ReadingBuffer::default();
+    for step in 0..HISTORY_STORE_CAPACITY as u64 {
+        store.record_live(step * 30_000, temp, Some(40.0));
+    }
+    for step in 0..SENSOR_BUFFER_CAPACITY as u64 {
+        buffer.push(step * 30_000, temp, Some(40.0));
+    }
+
+    let mut group = c.benchmark_group("history");
+    group.throughput(Throughput::Elements(1));
+    group.bench_function("record_live", |b| {
+        let mut now_ms = HISTORY_STORE_CAPACITY as u64 * 30_000;
+        b.iter(|| {
+            now_ms += 30_000;
+            store.record_live(black_box(now_ms), temp, Some(40.0));
+        })
+    });
+    group.bench_function("buffer_push", |b| {
+        let mut now_ms = SENSOR_BUFFER_CAPACITY as u64 * 30_000;
+        b.iter(|| {
+            now_ms += 30_000;
+            buffer.push(black_box(now_ms), temp, Some(40.0));
+        })
+    });
+    group.throughput(Throughput::Elements(HISTORY_STORE_CAPACITY as u64));
+    group.bench_function("serialize", |b| {
+        let mut buf = Vec::with_capacity(64 * 1024);
+        b.iter(|| {
+            buf.clear();
+            for point in store.points() {
+                serde_json::to_writer(&mut buf, &point).unwrap();
+            }
+            buf.len()
+        })
+    });
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_tick,
+    bench_schedule,
+    bench_serialize,
+    bench_sanitize,
+    bench_history
+);
+criterion_main!(benches);
@@ -0,0 +1,73 @@
+use criterion::{black_box, criterion_group, criterion_main, Criterion, Throughput};
+use thermostat_common::{
+    DeciDegrees, FleetEngine, PersistedSettings, ThermostatConfig, ThermostatEngine, ThermostatMode,
+};
+
+const ZONES: usize = 10_000;
+
+fn settings(zone: usize) -> PersistedSettings {
+    PersistedSettings {
+        target_temp_f: DeciDegrees::from_degrees(64 + (zone % 16) as i16),
+        mode: ThermostatMode::Heat,
+        ..PersistedSettings::default()
+    }
+}
+
+fn reading(zone: usize, step: u64) -> DeciDegrees {
+    DeciDegrees::from_tenths(600 + ((zone as u64 * 7 + step) % 200) as i16)
+}
+
+fn bench_tick(c: &mut Criterion) {
+    let config = ThermostatConfig::default();
+    let threads = std::thread::available_parallelism().map_or(1, |n| n.get());
+
+    let mut group = c.benchmark_group("fleet_tick");
+    group.throughput(Throughput::Elements(ZONES as u64));
+
+    group.bench_function("scalar", |b| {
+        let mut engines: Vec<ThermostatEngine> = (0..ZONES)
+            .map(|zone| ThermostatEngine::new(config.clone(), settings(zone)))
+            .collect();
+        let mut step = 0_u64;
+        b.iter(|| {
+            step += 1;
+            let now_ms = step * 1_000;
+            let mut transitions = 0;
+            for (zone, engine) in engines.iter_mut().enumerate() {
+                engine.update_sensor_data(reading(zone, step), 40.0, now_ms);
+                transitions += engine.tick(black_box(now_ms)).len();
+            }
+            transitions
+        })
+    });
+
+    let mut fleet = FleetEngine::new(config.clone());
+    for zone in 0..ZONES {
+        fleet.add_zone(&settings(zone));
+    }
+    let mut step = 0_u64;
+    let mut advance = |fleet: &mut FleetEngine| {
+        step += 1;
+        for zone in 0..ZONES {
+            fleet.update_temperature(zone, reading(zone, step), step * 1_000);
+        }
+        step * 1_000
+    };
+
+    group.bench_function("batch", |b| {
+        b.iter(|| {
+            let now_ms = advance(&mut fleet);
+            fleet.tick(black_box(now_ms))
+        })
+    });
+    group.bench_function(format!("batch_parallel_{threads}"), |b| {
+        b.iter(|| {
+            let now_ms = advance(&mut fleet);
+            fleet.tick_parallel(black_box(now_ms), threads)
+        })
+    });
+    group.finish();
+}
+
+criterion_group!(benches, bench_tick);
+criterion_main!(benches);
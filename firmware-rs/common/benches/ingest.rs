@@ -0,0 +1,90 @@
+use std::thread;
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion, Throughput};
+use thermostat_common::{
+    decode_fleet_message, ingest::shard_for, wire, ControllerStatePayload, DeciDegrees, FleetStore,
+    ThermostatMode, ThermostatState,
+};
+
+const DEVICES: usize = 512;
+const MESSAGES: usize = 20_000;
+
+// Mix seen from a fleet of controllers and sensors: JSON state, compact
+// binary state from aggregation-enabled controllers, and plain readings.
+fn messages() -> Vec<(String, Vec<u8>)> {
+    (0..MESSAGES)
+        .map(|index| {
+            let device = format!("thermostat-{:04}", index % DEVICES);
+            let state = ControllerStatePayload {
+                temp: DeciDegrees::from_tenths(600 + (index % 150) as i16),
+                humidity: 40.0,
+                target: DeciDegrees::from_degrees(70),
+                mode: ThermostatMode::Heat,
+                state: ThermostatState::Heating,
+                fireplace: index % 3 == 0,
+                hold_active: false,
+                hold_remaining_min: 0,
+                in_cooldown: false,
+                cooldown_remaining_min: 0,
+                runtime_min: (index % 240) as u64,
+            };
+            match index % 5 {
+                0 | 1 => (
+                    format!("{device}/controller/state"),
+                    serde_json::to_vec(&state).unwrap(),
+                ),
+                2 => {
+                    let mut body = Vec::new();
+                    wire::encode_state(&state, &mut body);
+                    (format!("{device}/controller/state/bin"), body)
+                }
+                _ => (
+                    format!("{device}/sensor/temperature"),
+                    format!("{:.1}", state.temp).into_bytes(),
+                ),
+            }
+        })
+        .collect()
+}
+
+fn ingest(store: &FleetStore, messages: &[(String, Vec<u8>)]) -> usize {
+    messages
+        .iter()
+        .filter_map(|(topic, payload)| decode_fleet_message(topic, payload).ok())
+        .map(|(device, update)| store.apply(device, update, 0))
+        .count()
+}
+
+fn bench_ingest(c: &mut Criterion) {
+    let messages = messages();
+    let workers = thread::available_parallelism().map_or(1, |n| n.get());
+    // The ingest service routes by device id, so each worker only sees the
+    // devices of its own shard.
+    let mut partitions = vec![Vec::new(); workers];
+    for message in &messages {
+        let device = message.0.split('/').next().unwrap();
+        partitions[shard_for(device, workers)].push(message.clone());
+    }
+
+    let mut group = c.benchmark_group("fleet_ingest");
+    group.throughput(Throughput::Elements(MESSAGES as u64));
+    group.bench_function("single_worker", |b| {
+        let store = FleetStore::new(1);
+        b.iter(|| ingest(&store, black_box(&messages)))
+    });
+    group.bench_function(format!("{workers}_workers"), |b| {
+        let store = FleetStore::new(workers);
+        b.iter(|| {
+            thread::scope(|scope| {
+                for partition in &partitions {
+                    let store = &store;
+                    scope.spawn(move || ingest(store, black_box(partition)));
+                }
+            })
+        })
+    });
+    group.finish();
+}
+
+criterion_group!(benches, bench_ingest);
+criterion_main!(benches);
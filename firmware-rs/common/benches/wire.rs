@@ -0,0 +1,110 @@
+use criterion::{black_box, criterion_group, criterion_main, Criterion, Throughput};
+use thermostat_common::{
+    wire, ControllerStatePayload, DayOfWeek, DeciDegrees, Schedule, ScheduleEntry, ThermostatMode,
+    ThermostatState,
+};
+
+fn sample_state() -> ControllerStatePayload {
+    ControllerStatePayload {
+        temp: DeciDegrees::from_tenths(684),
+        humidity: 41.0,
+        target: DeciDegrees::from_degrees(70),
+        mode: ThermostatMode::Heat,
+        state: ThermostatState::Heating,
+        fireplace: true,
+        hold_active: false,
+        hold_remaining_min: 0,
+        in_cooldown: false,
+        cooldown_remaining_min: 0,
+        runtime_min: 187,
+    }
+}
+
+fn weekly_schedule() -> Schedule {
+    let entries = (0..7)
+        .flat_map(|day| {
+            [(6 * 60, 71), (9 * 60, 64), (17 * 60, 72), (22 * 60, 62)]
+                .into_iter()
+                .map(move |(start_minutes, degrees)| ScheduleEntry {
+                    day: DayOfWeek::from_index(day),
+                    start_minutes,
+                    mode: ThermostatMode::Heat,
+                    target_temp_f: DeciDegrees::from_degrees(degrees),
+                })
+        })
+        .collect();
+    Schedule {
+        enabled: true,
+        entries,
+    }
+}
+
+fn bench_state(c: &mut Criterion) {
+    let state = sample_state();
+    let json = serde_json::to_vec(&state).unwrap();
+    let mut binary = Vec::new();
+    wire::encode_state(&state, &mut binary);
+    println!(
+        "state payload: json {} bytes, binary {} bytes",
+        json.len(),
+        binary.len()
+    );
+
+    let mut group = c.benchmark_group("state_payload");
+    group.throughput(Throughput::Elements(1));
+    group.bench_function("json_encode", |b| {
+        b.iter(|| serde_json::to_vec(black_box(&state)).unwrap())
+    });
+    group.bench_function("binary_encode", |b| {
+        let mut out = Vec::with_capacity(32);
+        b.iter(|| {
+            out.clear();
+            wire::encode_state(black_box(&state), &mut out);
+            out.len()
+        })
+    });
+    group.bench_function("json_decode", |b| {
+        b.iter(|| serde_json::from_slice::<ControllerStatePayload>(black_box(&json)).unwrap())
+    });
+    group.bench_function("binary_decode", |b| {
+        b.iter(|| wire::decode_state(black_box(&binary)).unwrap())
+    });
+    group.finish();
+}
+
+fn bench_schedule(c: &mut Criterion) {
+    let schedule = weekly_schedule();
+    let json = serde_json::to_vec(&schedule).unwrap();
+    let mut binary = Vec::new();
+    wire::encode_schedule(&schedule, &mut binary);
+    println!(
+        "schedule ({} entries): json {} bytes, binary {} bytes",
+        schedule.entries.len(),
+        json.len(),
+        binary.len()
+    );
+
+    let mut group = c.benchmark_group("schedule");
+    group.throughput(Throughput::Elements(schedule.entries.len() as u64));
+    group.bench_function("json_encode", |b| {
+        b.iter(|| serde_json::to_vec(black_box(&schedule)).unwrap())
+    });
+    group.bench_function("binary_encode", |b| {
+        let mut out = Vec::with_capacity(binary.len());
+        b.iter(|| {
+            out.clear();
+            wire::encode_schedule(black_box(&schedule), &mut out);
+            out.len()
+        })
+    });
+    group.bench_function("json_decode", |b| {
+        b.iter(|| serde_json::from_slice::<Schedule>(black_box(&json)).unwrap())
+    });
+    group.bench_function("binary_decode", |b| {
+        b.iter(|| wire::decode_schedule(black_box(&binary)).unwrap())
+    });
+    group.finish();
+}
+
+criterion_group!(benches, bench_state, bench_schedule);
+criterion_main!(benches);
@@ -0,0 +1,121 @@
+use std::{alloc::System, mem::size_of};
+
+use chrono::{Duration, FixedOffset, TimeZone};
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use thermostat_common::{
+    memory_report, CountingAllocator, DayOfWeek, DeciDegrees, MemoryPlatform, PersistedSettings,
+    Schedule, ScheduleEntry, ThermostatConfig, ThermostatMode, Zone, ZoneConfig, ZoneRegistry,
+};
+
+// Counts live heap bytes so the footprint below is measured, not estimated.
+struct BenchMemory;
+
+impl MemoryPlatform for BenchMemory {
+    fn thread_key(&self) -> usize {
+        thread_local! {
+            static ANCHOR: u8 = const { 0 };
+        }
+        ANCHOR.with(|anchor| anchor as *const u8 as usize)
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator::new(System, &BenchMemory);
+
+fn weekly_schedule() -> Schedule {
+    let entries = (0..7)
+        .flat_map(|day| {
+            [(6 * 60, 71), (9 * 60, 64), (17 * 60, 72), (22 * 60, 62)]
+                .into_iter()
+                .map(move |(start_minutes, degrees)| ScheduleEntry {
+                    day: DayOfWeek::from_index(day),
+                    start_minutes,
+                    mode: ThermostatMode::Heat,
+                    target_temp_f: DeciDegrees::from_degrees(degrees),
+                })
+        })
+        .collect();
+    Schedule {
+        enabled: true,
+        entries,
+    }
+}
+
+// The default zone counts as the first of `zones`.
+fn registry(zones: usize) -> ZoneRegistry {
+    let mut registry = ZoneRegistry::with_default_zone(
+        ThermostatConfig::default(),
+        PersistedSettings::default(),
+        weekly_schedule(),
+    );
+    registry
+        .default_zone_mut()
+        .engine
+        .update_sensor_data(DeciDegrees::from_degrees(66), 40.0, 0);
+    for index in 1..zones {
+        let zone = registry
+            .add(ZoneConfig {
+                id: format!("zone-{index}"),
+                ir_channel: (index % 8) as u8,
+                schedule: weekly_schedule(),
+                ..ZoneConfig::default()
+            })
+            .unwrap();
+        zone.engine
+            .update_sensor_data(DeciDegrees::from_degrees(66 + (index % 6) as i16), 40.0, 0);
+    }
+    registry
+}
+
+// Heap bytes still held once a registry of `zones` zones is built.
+fn live_heap_bytes(zones: usize) -> u64 {
+    let before = memory_report(&BenchMemory).allocator.live_bytes;
+    let registry = registry(zones);
+    let after = memory_report(&BenchMemory).allocator.live_bytes;
+    drop(registry);
+    after.saturating_sub(before)
+}
+
+fn bench_tick(c: &mut Criterion) {
+    // Averaged over 32 added zones, so the registry's own growth is shared
+    // out the way a full registry pays for it. Zones live in the registry's
+    // Vec, so the heap figure includes the Zone itself.
+    let added_heap = live_heap_bytes(33).saturating_sub(live_heap_bytes(1));
+    println!(
+        "per-zone heap: {} bytes, including the {}-byte Zone and a 28-entry schedule",
+        added_heap / 32,
+        size_of::<Zone>()
+    );
+
+    let start = FixedOffset::west_opt(8 * 3600)
+        .unwrap()
+        .with_ymd_and_hms(2024, 1, 1, 7, 0, 0)
+        .unwrap();
+    let mut group = c.benchmark_group("zones_tick");
+    for zones in [1_usize, 8, 32] {
+        group.throughput(Throughput::Elements(zones as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(zones), &zones, |b, &zones| {
+            let mut registry = registry(zones);
+            let mut seconds = 0_i64;
+            b.iter(|| {
+                // The shared scheduler ticks once a second.
+                seconds += 1;
+                let now = start + Duration::seconds(seconds);
+                registry
+                    .tick_all(black_box(seconds as u64 * 1_000), Some(now))
+                    .len()
+            })
+        });
+    }
+    group.finish();
+}
+
+fn bench_add(c: &mut Criterion) {
+    let mut group = c.benchmark_group("zones_add");
+    group.throughput(Throughput::Elements(32));
+    group.bench_function("32", |b| b.iter(|| registry(black_box(32)).len()));
+    group.finish();
+}
+
+criterion_group!(benches, bench_tick, bench_add);
+criterion_main!(benches);
@@ -0,0 +1,805 @@
+use std::fmt::{self, Debug};
+
+use serde::{Deserialize, Serialize};
+
+// A probe that keeps failing is probably gone or was swapped; only then is
+// the (slow) one-wire search worth repeating.
+const RESCAN_AFTER_FAILURES: u8 = 3;
+// Cached addresses skip the search at boot, so a periodic search is what
+// picks up probes added later.
+const PROBE_RESCAN_INTERVAL_MS: u64 = 600_000;
+pub const MAX_PROBES: usize = 8;
+// A DS18B20 that browned out since the last Convert T hands back this
+// power-on scratchpad value as if it were a reading.
+const POWER_ON_RESET_C: f32 = 85.0;
+// The reset value is only believed when the probe's previous conversion was
+// already this close to it.
+const POWER_ON_RESET_CONFIRM_C: f32 = 2.0;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub enum ProbeResolution {
+    Bits9,
+    Bits10,
+    Bits11,
+    Bits12,
+}
+
+impl ProbeResolution {
+    pub fn from_bits(bits: u8) -> Self {
+        match bits {
+            0..=9 => Self::Bits9,
+            10 => Self::Bits10,
+            11 => Self::Bits11,
+            _ => Self::Bits12,
+        }
+    }
+
+    pub fn bits(self) -> u8 {
+        match self {
+            Self::Bits9 => 9,
+            Self::Bits10 => 10,
+            Self::Bits11 => 11,
+            Self::Bits12 => 12,
+        }
+    }
+
+    // Worst-case DS18B20 conversion time from the datasheet.
+    pub fn conversion_time_ms(self) -> u64 {
+        match self {
+            Self::Bits9 => 94,
+            Self::Bits10 => 188,
+            Self::Bits11 => 375,
+            Self::Bits12 => 750,
+        }
+    }
+}
+
+// 64-bit one-wire ROM code: family code in the low byte, then the 48-bit
+// serial, then the CRC.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, Serialize, Deserialize)]
+pub struct ProbeAddress(pub u64);
+
+impl ProbeAddress {
+    pub fn family_code(self) -> u8 {
+        (self.0 & 0xff) as u8
+    }
+
+    pub fn serial(self) -> u64 {
+        (self.0 >> 8) & 0xffff_ffff_ffff
+    }
+}
+
+// Same `28-0316a2793dff` form the Linux w1 driver uses, so probe topics match
+// what people see when testing a probe on a Pi.
+impl fmt::Display for ProbeAddress {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "{:02x}-{:012x}", self.family_code(), self.serial())
+    }
+}
+
+// Hardware boundary for one acquisition cycle. The ESP sensor implements it
+// over the one-wire and DHT11 drivers; `MockSensorBus` drives it on host.
+pub trait SensorBus {
+    type Error: Debug;
+
+    fn now_ms(&mut self) -> u64;
+    fn delay_ms(&mut self, ms: u64);
+    // Runs the one-wire search and returns every DS18B20 found, in bus order.
+    fn scan_probes(&mut self) -> Result<Vec<ProbeAddress>, Self::Error>;
+    fn set_resolution(
+        &mut self,
+        probe: ProbeAddress,
+        resolution: ProbeResolution,
+    ) -> Result<(), Self::Error>;
+    // One Skip ROM + Convert T: every probe on the bus converts at once.
+    fn start_conversion(&mut self) -> Result<(), Self::Error>;
+    fn read_temperature_c(&mut self, probe: ProbeAddress) -> Result<f32, Self::Error>;
+    fn read_humidity(&mut self) -> Result<f32, Self::Error>;
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct ProbeReading {
+    pub address: ProbeAddress,
+    pub temperature_f: Option<f32>,
+}
+
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct SensorReadings {
+    // The pinned primary probe's reading; this is what the controller's
+    // single-temperature topic carries. None when that probe missed the
+    // cycle, never another probe's reading.
+    pub temperature_f: Option<f32>,
+    pub humidity: Option<f32>,
+    pub probes: Vec<ProbeReading>,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct CycleTiming {
+    #[serde(rename = "totalMs")]
+    pub total_ms: u64,
+    #[serde(rename = "humidityMs")]
+    pub humidity_ms: u64,
+    #[serde(rename = "overlapMs")]
+    pub overlap_ms: u64,
+    // Time spent idle waiting for the conversion after the overlapped work.
+    #[serde(rename = "conversionWaitMs")]
+    pub conversion_wait_ms: u64,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct AcquisitionStats {
+    pub cycles: u64,
+    pub probes: usize,
+    // Counted per probe read that failed after its retry.
+    #[serde(rename = "temperatureFailures")]
+    pub temperature_failures: u64,
+    #[serde(rename = "humidityFailures")]
+    pub humidity_failures: u64,
+    pub rescans: u64,
+    #[serde(rename = "resolutionBits")]
+    pub resolution_bits: u8,
+    pub last: CycleTiming,
+    #[serde(rename = "maxTotalMs")]
+    pub max_total_ms: u64,
+}
+
+#[derive(Debug, Clone, Copy)]
+struct ProbeState {
+    address: ProbeAddress,
+    consecutive_failures: u8,
+    // Last value read from the scratchpad, kept even when it was rejected.
+    last_read_c: Option<f32>,
+}
+
+impl ProbeState {
+    fn is_power_on_reset(&self, temp_c: f32) -> bool {
+        temp_c == POWER_ON_RESET_C
+            && !self
+                .last_read_c
+                .is_some_and(|last| (last - POWER_ON_RESET_C).abs() <= POWER_ON_RESET_CONFIRM_C)
+    }
+}
+
+// Runs one pipelined cycle: the DS18B20 conversion is started first, and the
+// DHT11 read plus any caller work happen inside its conversion window.
+pub struct Acquisition<B> {
+    bus: B,
+    resolution: ProbeResolution,
+    applied_resolution: Option<ProbeResolution>,
+    probes: Vec<ProbeState>,
+    // Feeds `temperature_f`. Pinned to the first probe ever found (or the
+    // first cached one), so a later search that finds probes in a different
+    // order cannot move control to another room.
+    primary: Option<ProbeAddress>,
+    // None means search on the next cycle.
+    next_scan_ms: Option<u64>,
+    probes_changed: bool,
+    last_error: Option<String>,
+    stats: AcquisitionStats,
+}
+
+impl<B: SensorBus> Acquisition<B> {
+    pub fn new(bus: B, resolution: ProbeResolution) -> Self {
+        Self {
+            bus,
+            resolution,
+            applied_resolution: None,
+            probes: Vec::new(),
+            primary: None,
+            next_scan_ms: None,
+            probes_changed: false,
+            last_error: None,
+            stats: AcquisitionStats {
+                resolution_bits: resolution.bits(),
+                ..AcquisitionStats::default()
+            },
+        }
+    }
+
+    // Starts from addresses persisted by a previous boot instead of running
+    // the search; a probe that stops answering still triggers one. The first
+    // address is the primary probe, as `take_probe_change` orders it.
+    pub fn with_cached_probes(mut self, addresses: &[ProbeAddress]) -> Self {
+        self.set_probes(addresses);
+        if !self.probes.is_empty() {
+            self.next_scan_ms = Some(self.bus.now_ms() + PROBE_RESCAN_INTERVAL_MS);
+        }
+        self
+    }
+
+    pub fn bus_mut(&mut self) -> &mut B {
+        &mut self.bus
+    }
+
+    pub fn stats(&self) -> AcquisitionStats {
+        self.stats
+    }
+
+    pub fn probes(&self) -> impl Iterator<Item = ProbeAddress> + '_ {
+        self.probes.iter().map(|probe| probe.address)
+    }
+
+    pub fn primary_probe(&self) -> Option<ProbeAddress> {
+        self.primary
+    }
+
+    // Returns the probe list once after a search changed it, so the caller
+    // can refresh its persisted cache. The primary probe comes first, so it
+    // stays pinned across reboots.
+    pub fn take_probe_change(&mut self) -> Option<Vec<ProbeAddress>> {
+        if !std::mem::take(&mut self.probes_changed) {
+            return None;
+        }
+        let mut probes: Vec<_> = self.probes().collect();
+        if let Some(index) = probes.iter().position(|&probe| Some(probe) == self.primary) {
+            probes[..=index].rotate_right(1);
+        }
+        Some(probes)
+    }
+
+    // Most recent bus error, for the caller to log; common has no logger.
+    pub fn take_error(&mut self) -> Option<String> {
+        self.last_error.take()
+    }
+
+    pub fn set_resolution(&mut self, resolution: ProbeResolution) {
+        self.resolution = resolution;
+        self.stats.resolution_bits = resolution.bits();
+    }
+
+    pub fn acquire(&mut self, overlap: impl FnOnce()) -> SensorReadings {
+        let started_ms = self.bus.now_ms();
+        let converting = self.start_conversion(started_ms);
+        let conversion_started_ms = self.bus.now_ms();
+
+        let humidity = match self.bus.read_humidity() {
+            Ok(humidity) => Some(humidity),
+            Err(err) => {
+                self.record_failure("DHT11 read", &err);
+                self.stats.humidity_failures += 1;
+                None
+            }
+        };
+        let humidity_done_ms = self.bus.now_ms();
+
+        overlap();
+        let overlap_done_ms = self.bus.now_ms();
+
+        let mut conversion_wait_ms = 0;
+        let mut probes = Vec::with_capacity(self.probes.len());
+        if converting {
+            let elapsed = overlap_done_ms.saturating_sub(conversion_started_ms);
+            conversion_wait_ms = self.resolution.conversion_time_ms().saturating_sub(elapsed);
+            if conversion_wait_ms > 0 {
+                self.bus.delay_ms(conversion_wait_ms);
+            }
+        }
+        // Without a conversion every known probe counts as failed, so a bus
+        // that stopped answering still ends up rescanned.
+        for index in 0..self.probes.len() {
+            probes.push(self.read_probe(index, converting));
+        }
+
+        let timing = CycleTiming {
+            total_ms: self.bus.now_ms().saturating_sub(started_ms),
+            humidity_ms: humidity_done_ms.saturating_sub(conversion_started_ms),
+            overlap_ms: overlap_done_ms.saturating_sub(humidity_done_ms),
+            conversion_wait_ms,
+        };
+        self.stats.cycles += 1;
+        self.stats.last = timing;
+        self.stats.max_total_ms = self.stats.max_total_ms.max(timing.total_ms);
+
+        SensorReadings {
+            temperature_f: probes
+                .iter()
+                .find(|probe| Some(probe.address) == self.primary)
+                .and_then(|probe| probe.temperature_f),
+            humidity,
+            probes,
+        }
+    }
+
+    fn start_conversion(&mut self, now_ms: u64) -> bool {
+        if self.next_scan_ms.map_or(true, |due_ms| now_ms >= due_ms) {
+            self.scan(now_ms);
+        }
+        if self.probes.is_empty() {
+            return false;
+        }
+
+        if self.applied_resolution != Some(self.resolution) {
+            let mut applied = true;
+            for index in 0..self.probes.len() {
+                let address = self.probes[index].address;
+                if let Err(err) = self.bus.set_resolution(address, self.resolution) {
+                    // Keep converting at whatever the probe is set to; the
+                    // wait may then be too short, so retry next cycle.
+                    self.record_failure("DS18B20 resolution update", &err);
+                    applied = false;
+                }
+            }
+            if applied {
+                self.applied_resolution = Some(self.resolution);
+            }
+        }
+
+        match self.bus.start_conversion() {
+            Ok(()) => true,
+            Err(err) => {
+                self.record_failure("DS18B20 conversion start", &err);
+                false
+            }
+        }
+    }
+
+    fn scan(&mut self, now_ms: u64) {
+        self.stats.rescans += 1;
+        match self.bus.scan_probes() {
+            Ok(mut found) => {
+                found.truncate(MAX_PROBES);
+                if !found.iter().copied().eq(self.probes()) {
+                    self.probes_changed = true;
+                }
+                // A lone probe that is not the pinned one replaced it. With
+                // several on the bus it is unclear which took its place, so
+                // the primary reading stays empty until the old one returns.
+                if let [only] = found[..] {
+                    if self.primary.is_some_and(|primary| primary != only) {
+                        self.primary = Some(only);
+                        self.probes_changed = true;
+                    }
+                } else if let Some(primary) =
+                    self.primary.filter(|primary| !found.contains(primary))
+                {
+                    self.record_failure(
+                        "primary probe lookup",
+                        &format_args!("{primary} not on the bus"),
+                    );
+                }
+                self.set_probes(&found);
+            }
+            Err(err) => {
+                self.record_failure("one-wire scan", &err);
+                self.set_probes(&[]);
+            }
+        }
+        // An empty bus is searched again every cycle, which is cheap: no
+        // device answers the reset pulse.
+        self.next_scan_ms =
+            (!self.probes.is_empty()).then(|| now_ms.saturating_add(PROBE_RESCAN_INTERVAL_MS));
+    }
+
+    fn set_probes(&mut self, addresses: &[ProbeAddress]) {
+        self.probes = addresses
+            .iter()
+            .take(MAX_PROBES)
+            .map(|&address| ProbeState {
+                address,
+                consecutive_failures: 0,
+                last_read_c: None,
+            })
+            .collect();
+        if self.primary.is_none() {
+            self.primary = self.probes.first().map(|probe| probe.address);
+        }
+        self.applied_resolution = None;
+        self.stats.probes = self.probes.len();
+    }
+
+    fn record_failure(&mut self, operation: &str, err: &dyn Debug) {
+        self.last_error = Some(format!("{operation} failed: {err:?}"));
+    }
+
+    fn read_probe(&mut self, index: usize, converted: bool) -> ProbeReading {
+        let address = self.probes[index].address;
+        let mut temperature_f = None;
+        // A CRC failure on the scratchpad is line noise; the converted value
+        // is still there, so re-read it instead of converting again.
+        let attempts = if converted { 2 } else { 0 };
+        for _ in 0..attempts {
+            match self.bus.read_temperature_c(address) {
+                Ok(temp_c) => {
+                    let reset = self.probes[index].is_power_on_reset(temp_c);
+                    self.probes[index].last_read_c = Some(temp_c);
+                    if reset {
+                        // Re-reading returns the same scratchpad; the next
+                        // conversion confirms or replaces it. The reset also
+                        // restored the probe's stored resolution.
+                        self.record_failure("DS18B20 read", &"power-on reset value");
+                        self.applied_resolution = None;
+                    } else {
+                        temperature_f = Some(celsius_to_fahrenheit(temp_c));
+                    }
+                    break;
+                }
+                Err(err) => self.record_failure("DS18B20 read", &err),
+            }
+        }
+
+        let probe = &mut self.probes[index];
+        if temperature_f.is_some() {
+            probe.consecutive_failures = 0;
+        } else {
+            self.stats.temperature_failures += 1;
+            probe.consecutive_failures = probe.consecutive_failures.saturating_add(1);
+            if probe.consecutive_failures >= RESCAN_AFTER_FAILURES {
+                self.next_scan_ms = None;
+            }
+        }
+        ProbeReading {
+            address,
+            temperature_f,
+        }
+    }
+}
+
+pub fn celsius_to_fahrenheit(temp_c: f32) -> f32 {
+    temp_c * 9.0 / 5.0 + 32.0
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum MockBusError {
+    NoResponse,
+    Crc,
+}
+
+#[derive(Debug, Clone)]
+pub struct MockProbe {
+    pub address: ProbeAddress,
+    pub temperature_c: f32,
+    pub present: bool,
+    pub fail_reads: u32,
+    pub resolution: ProbeResolution,
+}
+
+// Simulated bus with a virtual clock: every operation advances time by its
+// typical cost, and failures can be scripted per operation.
+#[derive(Debug, Clone)]
+pub struct MockSensorBus {
+    pub clock_ms: u64,
+    pub probes: Vec<MockProbe>,
+    pub humidity: f32,
+    pub fail_humidity_reads: u32,
+    pub scans: u32,
+    pub conversions: u32,
+    conversion_started_ms: Option<u64>,
+}
+
+impl MockSensorBus {
+    pub const SCAN_MS: u64 = 30;
+    pub const HUMIDITY_READ_MS: u64 = 25;
+    pub const SCRATCHPAD_READ_MS: u64 = 12;
+
+    pub fn new(temperature_c: f32, humidity: f32) -> Self {
+        Self::with_probes(&[temperature_c], humidity)
+    }
+
+    pub fn with_probes(temperatures_c: &[f32], humidity: f32) -> Self {
+        let probes = temperatures_c
+            .iter()
+            .enumerate()
+            .map(|(index, &temperature_c)| MockProbe {
+                address: Self::probe_address(index),
+                temperature_c,
+                present: true,
+                fail_reads: 0,
+                resolution: ProbeResolution::Bits12,
+            })
+            .collect();
+        Self {
+            clock_ms: 0,
+            probes,
+            humidity,
+            fail_humidity_reads: 0,
+            scans: 0,
+            conversions: 0,
+            conversion_started_ms: None,
+        }
+    }
+
+    pub fn probe_address(index: usize) -> ProbeAddress {
+        ProbeAddress(0x28 | ((0x0316_a279_3d00 + index as u64) << 8))
+    }
+
+    fn probe_mut(&mut self, address: ProbeAddress) -> Result<&mut MockProbe, MockBusError> {
+        self.probes
+            .iter_mut()
+            .find(|probe| probe.present && probe.address == address)
+            .ok_or(MockBusError::NoResponse)
+    }
+}
+
+impl SensorBus for MockSensorBus {
+    type Error = MockBusError;
+
+    fn now_ms(&mut self) -> u64 {
+        self.clock_ms
+    }
+
+    fn delay_ms(&mut self, ms: u64) {
+        self.clock_ms += ms;
+    }
+
+    fn scan_probes(&mut self) -> Result<Vec<ProbeAddress>, Self::Error> {
+        let found: Vec<_> = self
+            .probes
+            .iter()
+            .filter(|probe| probe.present)
+            .map(|probe| probe.address)
+            .collect();
+        self.clock_ms += Self::SCAN_MS * found.len().max(1) as u64;
+        self.scans += 1;
+        Ok(found)
+    }
+
+    fn set_resolution(
+        &mut self,
+        probe: ProbeAddress,
+        resolution: ProbeResolution,
+    ) -> Result<(), Self::Error> {
+        self.probe_mut(probe)?.resolution = resolution;
+        Ok(())
+    }
+
+    fn start_conversion(&mut self) -> Result<(), Self::Error> {
+        if !self.probes.iter().any(|probe| probe.present) {
+            return Err(MockBusError::NoResponse);
+        }
+        self.conversions += 1;
+        self.conversion_started_ms = Some(self.clock_ms);
+        Ok(())
+    }
+
+    fn read_temperature_c(&mut self, probe: ProbeAddress) -> Result<f32, Self::Error> {
+        self.clock_ms += Self::SCRATCHPAD_READ_MS;
+        let clock_ms = self.clock_ms;
+        let started_ms = self.conversion_started_ms;
+        let probe = self.probe_mut(probe)?;
+        if probe.fail_reads > 0 {
+            probe.fail_reads -= 1;
+            return Err(MockBusError::Crc);
+        }
+        match started_ms {
+            // Reading before the conversion finished returns the power-on
+            // value, which the real driver would also hand back.
+            Some(started_ms) if clock_ms >= started_ms + probe.resolution.conversion_time_ms() => {
+                Ok(probe.temperature_c)
+            }
+            _ => Ok(85.0),
+        }
+    }
+
+    fn read_humidity(&mut self) -> Result<f32, Self::Error> {
+        self.clock_ms += Self::HUMIDITY_READ_MS;
+        if self.fail_humidity_reads > 0 {
+            self.fail_humidity_reads -= 1;
+            return Err(MockBusError::NoResponse);
+        }
+        Ok(self.humidity)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn humidity_and_overlap_run_inside_the_conversion_window() {
+        let mut acquisition =
+            Acquisition::new(MockSensorBus::new(20.0, 41.0), ProbeResolution::Bits12);
+        // First cycle pays for the bus scan once.
+        acquisition.acquire(|| {});
+        let clock_ms = acquisition.bus_mut().clock_ms;
+
+        let mut overlapped = false;
+        let readings = acquisition.acquire(|| overlapped = true);
+
+        assert!(overlapped);
+        assert_eq!(readings.temperature_f, Some(68.0));
+        assert_eq!(readings.humidity, Some(41.0));
+
+        let stats = acquisition.stats();
+        assert_eq!(stats.rescans, 1);
+        // Sequential reads would cost conversion + humidity + scratchpad.
+        let sequential = 750 + MockSensorBus::HUMIDITY_READ_MS + MockSensorBus::SCRATCHPAD_READ_MS;
+        assert_eq!(stats.last.total_ms, 750 + MockSensorBus::SCRATCHPAD_READ_MS);
+        assert!(stats.last.total_ms < sequential);
+        assert_eq!(
+            acquisition.bus_mut().clock_ms - clock_ms,
+            stats.last.total_ms
+        );
+    }
+
+    #[test]
+    fn lower_resolution_shortens_the_cycle() {
+        let mut acquisition = Acquisition::new(
+            MockSensorBus::with_probes(&[21.5, 19.0], 40.0),
+            ProbeResolution::Bits12,
+        );
+        acquisition.acquire(|| {});
+        let full = acquisition.stats().last.total_ms;
+
+        acquisition.set_resolution(ProbeResolution::Bits9);
+        let readings = acquisition.acquire(|| {});
+
+        assert!(acquisition
+            .bus_mut()
+            .probes
+            .iter()
+            .all(|probe| probe.resolution == ProbeResolution::Bits9));
+        assert!(readings
+            .probes
+            .iter()
+            .all(|probe| probe.temperature_f.is_some()));
+        assert!(acquisition.stats().last.total_ms + 600 < full);
+    }
+
+    #[test]
+    fn transient_crc_error_is_retried_without_rescanning() {
+        let mut acquisition =
+            Acquisition::new(MockSensorBus::new(20.0, 41.0), ProbeResolution::Bits12);
+        acquisition.acquire(|| {});
+
+        acquisition.bus_mut().probes[0].fail_reads = 1;
+        acquisition.bus_mut().fail_humidity_reads = 1;
+        let readings = acquisition.acquire(|| {});
+
+        assert_eq!(readings.temperature_f, Some(68.0));
+        assert_eq!(readings.humidity, None);
+        let stats = acquisition.stats();
+        assert_eq!(
+            (stats.temperature_failures, stats.humidity_failures),
+            (0, 1)
+        );
+        assert_eq!(acquisition.bus_mut().scans, 1);
+    }
+
+    #[test]
+    fn missing_probe_is_rescanned_only_after_repeated_failures() {
+        let mut acquisition =
+            Acquisition::new(MockSensorBus::new(20.0, 41.0), ProbeResolution::Bits12);
+        acquisition.acquire(|| {});
+
+        acquisition.bus_mut().probes[0].present = false;
+        for _ in 0..RESCAN_AFTER_FAILURES {
+            let readings = acquisition.acquire(|| {});
+            assert_eq!(readings.temperature_f, None);
+            // Humidity keeps flowing while the probe is missing.
+            assert_eq!(readings.humidity, Some(41.0));
+        }
+        assert_eq!(acquisition.bus_mut().scans, 1);
+
+        acquisition.bus_mut().probes[0].present = true;
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(readings.temperature_f, Some(68.0));
+        assert_eq!(acquisition.bus_mut().scans, 2);
+        assert_eq!(acquisition.stats().temperature_failures, 3);
+    }
+
+    #[test]
+    fn every_probe_is_read_after_one_shared_conversion() {
+        let mut acquisition = Acquisition::new(
+            MockSensorBus::with_probes(&[20.0, 25.0, 15.0], 41.0),
+            ProbeResolution::Bits12,
+        );
+        acquisition.acquire(|| {});
+        let readings = acquisition.acquire(|| {});
+
+        assert_eq!(acquisition.bus_mut().conversions, 2);
+        let temps: Vec<_> = readings
+            .probes
+            .iter()
+            .map(|probe| probe.temperature_f)
+            .collect();
+        assert_eq!(temps, vec![Some(68.0), Some(77.0), Some(59.0)]);
+        // Extra probes only add their scratchpad reads to the cycle.
+        assert_eq!(
+            acquisition.stats().last.total_ms,
+            750 + 3 * MockSensorBus::SCRATCHPAD_READ_MS
+        );
+        assert_eq!(readings.probes[0].address.to_string(), "28-0316a2793d00");
+
+        // The primary reading never falls through to another probe.
+        acquisition.bus_mut().probes[0].fail_reads = 2;
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(readings.probes[0].temperature_f, None);
+        assert_eq!(readings.probes[1].temperature_f, Some(77.0));
+        assert_eq!(readings.temperature_f, None);
+    }
+
+    #[test]
+    fn primary_probe_stays_pinned_across_searches() {
+        let mut acquisition = Acquisition::new(
+            MockSensorBus::with_probes(&[20.0, 25.0], 41.0),
+            ProbeResolution::Bits12,
+        );
+        acquisition.acquire(|| {});
+        let primary = MockSensorBus::probe_address(0);
+        assert_eq!(acquisition.primary_probe(), Some(primary));
+        acquisition.take_probe_change();
+
+        // A probe added later that sorts first in the search does not take
+        // over, and the cache keeps the primary first.
+        let mut added = acquisition.bus_mut().probes[1].clone();
+        added.address = ProbeAddress(0x28 | (0x0316_a279_3c00 << 8));
+        added.temperature_c = 15.0;
+        acquisition.bus_mut().probes.insert(0, added.clone());
+        acquisition.bus_mut().delay_ms(PROBE_RESCAN_INTERVAL_MS);
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(readings.probes[0].address, added.address);
+        assert_eq!(readings.temperature_f, Some(68.0));
+        assert_eq!(
+            acquisition.take_probe_change(),
+            Some(vec![
+                primary,
+                added.address,
+                MockSensorBus::probe_address(1)
+            ])
+        );
+
+        // A lone replacement probe is pinned in the old one's place.
+        acquisition.bus_mut().probes.truncate(1);
+        acquisition.bus_mut().delay_ms(PROBE_RESCAN_INTERVAL_MS);
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(acquisition.primary_probe(), Some(added.address));
+        assert_eq!(readings.temperature_f, Some(59.0));
+    }
+
+    #[test]
+    fn power_on_reset_value_needs_a_second_conversion() {
+        let mut acquisition =
+            Acquisition::new(MockSensorBus::new(20.0, 41.0), ProbeResolution::Bits11);
+        acquisition.acquire(|| {});
+
+        // A brown-out resets the scratchpad and the resolution.
+        acquisition.bus_mut().probes[0].temperature_c = 85.0;
+        acquisition.bus_mut().probes[0].resolution = ProbeResolution::Bits12;
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(readings.temperature_f, None);
+        assert_eq!(acquisition.stats().temperature_failures, 1);
+
+        acquisition.bus_mut().probes[0].temperature_c = 20.0;
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(readings.temperature_f, Some(68.0));
+        assert_eq!(
+            acquisition.bus_mut().probes[0].resolution,
+            ProbeResolution::Bits11
+        );
+
+        // A real 85 °C is reached gradually, or repeats on the next cycle.
+        acquisition.bus_mut().probes[0].temperature_c = 84.0;
+        acquisition.acquire(|| {});
+        acquisition.bus_mut().probes[0].temperature_c = 85.0;
+        assert_eq!(acquisition.acquire(|| {}).temperature_f, Some(185.0));
+    }
+
+    #[test]
+    fn cached_probes_skip_the_boot_search_until_it_is_due() {
+        let mut bus = MockSensorBus::with_probes(&[20.0, 22.0], 41.0);
+        let cached = vec![bus.probes[0].address];
+        bus.probes[1].present = false;
+        let mut acquisition =
+            Acquisition::new(bus, ProbeResolution::Bits12).with_cached_probes(&cached);
+
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(readings.temperature_f, Some(68.0));
+        assert_eq!(acquisition.bus_mut().scans, 0);
+        assert_eq!(acquisition.take_probe_change(), None);
+
+        // A probe plugged in later shows up at the periodic search.
+        acquisition.bus_mut().probes[1].present = true;
+        acquisition.bus_mut().delay_ms(PROBE_RESCAN_INTERVAL_MS);
+        let readings = acquisition.acquire(|| {});
+        assert_eq!(readings.probes.len(), 2);
+        assert_eq!(acquisition.bus_mut().scans, 1);
+        assert_eq!(
+            acquisition.take_probe_change(),
+            Some(vec![
+                MockSensorBus::probe_address(0),
+                MockSensorBus::probe_address(1)
+            ])
+        );
+        assert_eq!(acquisition.take_probe_change(), None);
+    }
+}
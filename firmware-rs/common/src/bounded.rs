@@ -0,0 +1,80 @@
+// Collections used by the engine and the schedule evaluator. With the default
+// `std` feature they are the standard heap types and the capacity is ignored;
+// the `no_std` feature maps them onto fixed-capacity `heapless` types, so the
+// same code runs from static memory. Capacities are the limits the engine
+// already enforces, so a std build behaves the same either way.
+#[cfg(not(feature = "std"))]
+pub use heapless::{Deque as BoundedDeque, String as BoundedString, Vec as BoundedVec};
+
+#[cfg(feature = "std")]
+pub type BoundedVec<T, const N: usize> = std::vec::Vec<T>;
+#[cfg(feature = "std")]
+pub type BoundedDeque<T, const N: usize> = std::collections::VecDeque<T>;
+#[cfg(feature = "std")]
+pub type BoundedString<const N: usize> = std::string::String;
+
+// `heapless` pushes fail when full where the std ones grow. Returns false and
+// drops `value` when a fixed-capacity list is full.
+pub trait BoundedPush<T> {
+    fn push_bounded(&mut self, value: T) -> bool;
+}
+
+#[cfg(feature = "std")]
+impl<T> BoundedPush<T> for std::vec::Vec<T> {
+    fn push_bounded(&mut self, value: T) -> bool {
+        self.push(value);
+        true
+    }
+}
+
+#[cfg(feature = "std")]
+impl<T> BoundedPush<T> for std::collections::VecDeque<T> {
+    fn push_bounded(&mut self, value: T) -> bool {
+        self.push_back(value);
+        true
+    }
+}
+
+#[cfg(not(feature = "std"))]
+impl<T, const N: usize> BoundedPush<T> for heapless::Vec<T, N> {
+    fn push_bounded(&mut self, value: T) -> bool {
+        self.push(value).is_ok()
+    }
+}
+
+#[cfg(not(feature = "std"))]
+impl<T, const N: usize> BoundedPush<T> for heapless::Deque<T, N> {
+    fn push_bounded(&mut self, value: T) -> bool {
+        self.push_back(value).is_ok()
+    }
+}
+
+// None when `value` does not fit, so distinct names never collapse into one.
+#[cfg(feature = "std")]
+pub fn copy_str<const N: usize>(value: &str) -> Option<BoundedString<N>> {
+    Some(value.to_owned())
+}
+
+#[cfg(not(feature = "std"))]
+pub fn copy_str<const N: usize>(value: &str) -> Option<BoundedString<N>> {
+    let mut copy = BoundedString::new();
+    copy.push_str(value).ok()?;
+    Some(copy)
+}
+
+// For display-only text: cut at a char boundary when `value` does not fit.
+#[cfg(feature = "std")]
+pub fn truncate_str<const N: usize>(value: &str) -> BoundedString<N> {
+    value.to_owned()
+}
+
+#[cfg(not(feature = "std"))]
+pub fn truncate_str<const N: usize>(value: &str) -> BoundedString<N> {
+    let mut end = value.len().min(N);
+    while !value.is_char_boundary(end) {
+        end -= 1;
+    }
+    let mut copy = BoundedString::new();
+    let _ = copy.push_str(&value[..end]);
+    copy
+}
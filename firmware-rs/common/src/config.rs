@@ -1,45 +1,69 @@
 use serde::{Deserialize, Serialize};
 
-use crate::types::ThermostatMode;
+use crate::{temperature::DeciDegrees, types::ThermostatMode};
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
 #[serde(default)]
 pub struct ThermostatConfig {
     pub min_cycle_ms: u64,
     pub sensor_stale_timeout_ms: u64,
-    pub state_publish_interval_ms: u64,
+    pub state_heartbeat_interval_ms: u64,
+    pub state_min_publish_interval_ms: u64,
+    pub state_delta_enabled: bool,
+    pub state_binary_enabled: bool,
     pub trend_sample_interval_ms: u64,
     pub trend_rising_threshold_f: f32,
     pub trend_falling_threshold_f: f32,
     pub trend_samples_required: u8,
+    pub trend_window_ms: u64,
+    pub trend_min_span_ms: u64,
+    pub burst_sample_interval_ms: u64,
+    pub burst_duration_ms: u64,
     pub max_runtime_ms: u64,
     pub cooldown_duration_ms: u64,
     pub hold_duration_ms: u64,
     pub settings_save_debounce_ms: u64,
-    pub min_valid_temp_f: f32,
-    pub max_valid_temp_f: f32,
+    pub min_valid_temp_f: DeciDegrees,
+    pub max_valid_temp_f: DeciDegrees,
     pub max_hold_minutes: u16,
-    pub absolute_max_temp_f: f32,
+    pub absolute_max_temp_f: DeciDegrees,
+    // Sensor fusion rejects a source further than this many MAD-derived
+    // sigmas from the median, but never closer than the floor.
+    pub fusion_outlier_mad_k: f32,
+    pub fusion_outlier_floor_f: f32,
+}
+
+impl ThermostatConfig {
+    pub const DEFAULT_SENSOR_STALE_TIMEOUT_MS: u64 = 300_000;
 }
 
 impl Default for ThermostatConfig {
     fn default() -> Self {
         Self {
             min_cycle_ms: 300_000,
-            sensor_stale_timeout_ms: 300_000,
-            state_publish_interval_ms: 10_000,
+            sensor_stale_timeout_ms: Self::DEFAULT_SENSOR_STALE_TIMEOUT_MS,
+            state_heartbeat_interval_ms: 60_000,
+            state_min_publish_interval_ms: 1_000,
+            state_delta_enabled: false,
+            state_binary_enabled: false,
             trend_sample_interval_ms: 30_000,
             trend_rising_threshold_f: 0.3,
             trend_falling_threshold_f: -0.2,
             trend_samples_required: 3,
+            trend_window_ms: 90_000,
+            trend_min_span_ms: 30_000,
+            burst_sample_interval_ms: 5_000,
+            burst_duration_ms: 300_000,
             max_runtime_ms: 14_400_000,
             cooldown_duration_ms: 1_800_000,
             hold_duration_ms: 1_800_000,
             settings_save_debounce_ms: 5_000,
-            min_valid_temp_f: -40.0,
-            max_valid_temp_f: 150.0,
+            min_valid_temp_f: DeciDegrees::from_degrees(-40),
+            max_valid_temp_f: DeciDegrees::from_degrees(150),
             max_hold_minutes: 1_440,
-            absolute_max_temp_f: 95.0,
+            absolute_max_temp_f: DeciDegrees::from_degrees(95),
+            fusion_outlier_mad_k: 3.0,
+            fusion_outlier_floor_f: 3.0,
         }
     }
 }
@@ -47,8 +71,8 @@ impl Default for ThermostatConfig {
 #[derive(Debug, Clone, Serialize, Deserialize)]
 #[serde(default)]
 pub struct PersistedSettings {
-    pub target_temp_f: f32,
-    pub hysteresis_f: f32,
+    pub target_temp_f: DeciDegrees,
+    pub hysteresis_f: DeciDegrees,
     pub mode: ThermostatMode,
     pub fireplace_offset_f: i32,
 }
@@ -56,14 +80,42 @@ pub struct PersistedSettings {
 impl Default for PersistedSettings {
     fn default() -> Self {
         Self {
-            target_temp_f: 70.0,
-            hysteresis_f: 2.0,
+            target_temp_f: DeciDegrees::from_degrees(70),
+            hysteresis_f: DeciDegrees::from_degrees(2),
             mode: ThermostatMode::Off,
             fireplace_offset_f: 4,
         }
     }
 }
 
+// One request's worth of setting changes; absent fields are left as they are.
+// Field names match `ControllerStatus`.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Serialize, Deserialize)]
+#[serde(deny_unknown_fields)]
+pub struct SettingsUpdate {
+    #[serde(
+        rename = "targetTemp",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub target_temp_f: Option<DeciDegrees>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub mode: Option<ThermostatMode>,
+    #[serde(
+        rename = "hysteresis",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub hysteresis_f: Option<DeciDegrees>,
+    #[serde(
+        rename = "fireplaceOffset",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub fireplace_offset_f: Option<i32>,
+}
+
+#[cfg(feature = "std")]
 #[derive(Debug, Clone, Serialize, Deserialize)]
 #[serde(default)]
 pub struct NetworkConfig {
@@ -81,6 +133,7 @@ pub struct NetworkConfig {
     pub dns: Option<[u8; 4]>,
 }
 
+#[cfg(feature = "std")]
 impl Default for NetworkConfig {
     fn default() -> Self {
         Self {
@@ -117,6 +170,40 @@ impl Default for IrHardwareConfig {
     }
 }
 
+#[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
+#[serde(default)]
+pub struct SensorPublishPolicy {
+    pub sample_interval_ms: u64,
+    pub deadband_f: f32,
+    // 0 disables the rate-of-change trigger.
+    pub rate_f_per_min: f32,
+    pub humidity_deadband: f32,
+    pub min_interval_ms: u64,
+    pub heartbeat_ms: u64,
+    // DS18B20 resolution, 9..=12 bits. Lower resolutions convert faster at
+    // the cost of precision (0.5 F at 9 bits versus 0.1 F at 12).
+    pub resolution_bits: u8,
+    // Appends ";seq=N;ts=EPOCH_MS" to temperature readings for latency
+    // tracing. Off by default: older controllers only parse plain numbers.
+    pub trace_readings: bool,
+}
+
+impl Default for SensorPublishPolicy {
+    fn default() -> Self {
+        Self {
+            sample_interval_ms: 5_000,
+            deadband_f: 0.2,
+            rate_f_per_min: 0.5,
+            humidity_deadband: 2.0,
+            min_interval_ms: 2_000,
+            heartbeat_ms: 120_000,
+            resolution_bits: 12,
+            trace_readings: false,
+        }
+    }
+}
+
+#[cfg(feature = "std")]
 #[derive(Debug, Clone, Serialize, Deserialize)]
 #[serde(default)]
 pub struct RuntimeConfig {
@@ -126,8 +213,11 @@ pub struct RuntimeConfig {
     pub network: NetworkConfig,
     #[serde(default)]
     pub ir: IrHardwareConfig,
+    #[serde(default)]
+    pub sensor_policy: SensorPublishPolicy,
 }
 
+#[cfg(feature = "std")]
 impl Default for RuntimeConfig {
     fn default() -> Self {
         Self {
@@ -136,14 +226,22 @@ impl Default for RuntimeConfig {
             timezone: "America/Los_Angeles".to_string(),
             network: NetworkConfig::default(),
             ir: IrHardwareConfig::default(),
+            sensor_policy: SensorPublishPolicy::default(),
         }
     }
 }
 
 impl PersistedSettings {
+    pub const TARGET_MIN: DeciDegrees = DeciDegrees::from_degrees(60);
+    pub const TARGET_MAX: DeciDegrees = DeciDegrees::from_degrees(84);
+    pub const HYSTERESIS_MIN: DeciDegrees = DeciDegrees::from_tenths(5);
+    pub const HYSTERESIS_MAX: DeciDegrees = DeciDegrees::from_degrees(5);
+
     pub fn sanitize(&mut self) {
-        self.target_temp_f = self.target_temp_f.clamp(60.0, 84.0);
-        self.hysteresis_f = self.hysteresis_f.clamp(0.5, 5.0);
+        self.target_temp_f = self.target_temp_f.clamp(Self::TARGET_MIN, Self::TARGET_MAX);
+        self.hysteresis_f = self
+            .hysteresis_f
+            .clamp(Self::HYSTERESIS_MIN, Self::HYSTERESIS_MAX);
 
         let clamped = self.fireplace_offset_f.clamp(2, 10);
         self.fireplace_offset_f = if clamped % 2 == 0 {
@@ -157,6 +255,49 @@ impl PersistedSettings {
     }
 }
 
+impl SettingsUpdate {
+    pub fn is_empty(&self) -> bool {
+        *self == Self::default()
+    }
+
+    // The target is clamped like `/api/target`; the other fields are rejected
+    // when out of range, with the messages of their single-field endpoints.
+    pub fn validate(&self) -> Result<(), &'static str> {
+        if self.is_empty() {
+            return Err("No settings to update");
+        }
+        if let Some(hysteresis) = self.hysteresis_f {
+            let range = PersistedSettings::HYSTERESIS_MIN..=PersistedSettings::HYSTERESIS_MAX;
+            if !range.contains(&hysteresis) {
+                return Err("Invalid hysteresis value (0.5-5.0)");
+            }
+        }
+        if let Some(offset) = self.fireplace_offset_f {
+            if !(2..=10).contains(&offset) || offset % 2 != 0 {
+                return Err("Invalid offset value (2-10, even only)");
+            }
+        }
+        Ok(())
+    }
+}
+
+impl SensorPublishPolicy {
+    // The heartbeat must stay below the controller's sensor stale timeout, or
+    // a steady room would read as a dead sensor; 80% leaves room for one
+    // late or lost report.
+    pub const HEARTBEAT_MAX_MS: u64 = ThermostatConfig::DEFAULT_SENSOR_STALE_TIMEOUT_MS / 5 * 4;
+
+    pub fn sanitize(&mut self) {
+        self.sample_interval_ms = self.sample_interval_ms.clamp(1_000, 60_000);
+        self.deadband_f = self.deadband_f.clamp(0.05, 5.0);
+        self.rate_f_per_min = self.rate_f_per_min.clamp(0.0, 10.0);
+        self.humidity_deadband = self.humidity_deadband.clamp(0.5, 20.0);
+        self.heartbeat_ms = self.heartbeat_ms.clamp(10_000, Self::HEARTBEAT_MAX_MS);
+        self.min_interval_ms = self.min_interval_ms.min(self.heartbeat_ms);
+        self.resolution_bits = self.resolution_bits.clamp(9, 12);
+    }
+}
+
 impl IrHardwareConfig {
     pub fn sanitize(&mut self) {
         if self.tx_pin < 0 {
@@ -0,0 +1,550 @@
+use std::thread;
+
+use crate::{
+    config::{PersistedSettings, ThermostatConfig},
+    temperature::DeciDegrees,
+    types::{ThermostatMode, ThermostatState},
+};
+
+// Timestamp columns use this in place of `None`.
+const NEVER: u64 = u64::MAX;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+#[repr(u8)]
+pub enum FleetCommand {
+    #[default]
+    None,
+    PowerOn,
+    PowerOff,
+}
+
+// Batch counterpart of `ThermostatEngine` for gateways running thousands of
+// zones. State is stored column-wise and `tick` walks the columns in one
+// pass that mirrors `ThermostatEngine::tick`: hold expiry, cooldown
+// completion, runtime limit, then `evaluate_state`. Each zone has a single
+// temperature source, and external-remote trend detection is left to the
+// scalar engine. Commands only carry the power transition; callers expand
+// PowerOn into the IR sequence themselves.
+#[derive(Debug, Clone)]
+pub struct FleetEngine {
+    config: ThermostatConfig,
+
+    temp_f: Vec<DeciDegrees>,
+    updated_ms: Vec<u64>,
+    target_f: Vec<DeciDegrees>,
+    hysteresis_f: Vec<DeciDegrees>,
+    heat_mode: Vec<bool>,
+
+    fireplace_on: Vec<bool>,
+    state: Vec<ThermostatState>,
+    last_change_ms: Vec<u64>,
+    heating_start_ms: Vec<u64>,
+    in_cooldown: Vec<bool>,
+    cooldown_start_ms: Vec<u64>,
+    hold_active: Vec<bool>,
+    hold_start_ms: Vec<u64>,
+    hold_duration_ms: Vec<u64>,
+
+    commands: Vec<FleetCommand>,
+}
+
+#[derive(Debug, Clone, Copy)]
+struct TickParams {
+    now_ms: u64,
+    stale_timeout_ms: u64,
+    min_cycle_ms: u64,
+    max_runtime_ms: u64,
+    cooldown_duration_ms: u64,
+    absolute_max_temp_f: DeciDegrees,
+}
+
+// Disjoint per-thread slices of every column.
+struct Columns<'a> {
+    temp_f: &'a [DeciDegrees],
+    updated_ms: &'a [u64],
+    target_f: &'a [DeciDegrees],
+    hysteresis_f: &'a [DeciDegrees],
+    heat_mode: &'a [bool],
+    fireplace_on: &'a mut [bool],
+    state: &'a mut [ThermostatState],
+    last_change_ms: &'a mut [u64],
+    heating_start_ms: &'a mut [u64],
+    in_cooldown: &'a mut [bool],
+    cooldown_start_ms: &'a mut [u64],
+    hold_active: &'a mut [bool],
+    hold_start_ms: &'a [u64],
+    hold_duration_ms: &'a [u64],
+    commands: &'a mut [FleetCommand],
+}
+
+impl<'a> Columns<'a> {
+    fn split_at(self, mid: usize) -> (Self, Self) {
+        let (temp_f_a, temp_f_b) = self.temp_f.split_at(mid);
+        let (updated_a, updated_b) = self.updated_ms.split_at(mid);
+        let (target_a, target_b) = self.target_f.split_at(mid);
+        let (hysteresis_a, hysteresis_b) = self.hysteresis_f.split_at(mid);
+        let (heat_a, heat_b) = self.heat_mode.split_at(mid);
+        let (on_a, on_b) = self.fireplace_on.split_at_mut(mid);
+        let (state_a, state_b) = self.state.split_at_mut(mid);
+        let (last_a, last_b) = self.last_change_ms.split_at_mut(mid);
+        let (heating_a, heating_b) = self.heating_start_ms.split_at_mut(mid);
+        let (cooldown_a, cooldown_b) = self.in_cooldown.split_at_mut(mid);
+        let (cooldown_start_a, cooldown_start_b) = self.cooldown_start_ms.split_at_mut(mid);
+        let (hold_a, hold_b) = self.hold_active.split_at_mut(mid);
+        let (hold_start_a, hold_start_b) = self.hold_start_ms.split_at(mid);
+        let (hold_duration_a, hold_duration_b) = self.hold_duration_ms.split_at(mid);
+        let (commands_a, commands_b) = self.commands.split_at_mut(mid);
+        (
+            Columns {
+                temp_f: temp_f_a,
+                updated_ms: updated_a,
+                target_f: target_a,
+                hysteresis_f: hysteresis_a,
+                heat_mode: heat_a,
+                fireplace_on: on_a,
+                state: state_a,
+                last_change_ms: last_a,
+                heating_start_ms: heating_a,
+                in_cooldown: cooldown_a,
+                cooldown_start_ms: cooldown_start_a,
+                hold_active: hold_a,
+                hold_start_ms: hold_start_a,
+                hold_duration_ms: hold_duration_a,
+                commands: commands_a,
+            },
+            Columns {
+                temp_f: temp_f_b,
+                updated_ms: updated_b,
+                target_f: target_b,
+                hysteresis_f: hysteresis_b,
+                heat_mode: heat_b,
+                fireplace_on: on_b,
+                state: state_b,
+                last_change_ms: last_b,
+                heating_start_ms: heating_b,
+                in_cooldown: cooldown_b,
+                cooldown_start_ms: cooldown_start_b,
+                hold_active: hold_b,
+                hold_start_ms: hold_start_b,
+                hold_duration_ms: hold_duration_b,
+                commands: commands_b,
+            },
+        )
+    }
+
+    fn evaluate(self, params: TickParams) -> usize {
+        let now_ms = params.now_ms;
+        let len = self.commands.len();
+        // Re-slicing every column to the same length lets the compiler drop
+        // the bounds checks inside the loop.
+        let temp_f = &self.temp_f[..len];
+        let updated_ms = &self.updated_ms[..len];
+        let target_f = &self.target_f[..len];
+        let hysteresis_f = &self.hysteresis_f[..len];
+        let heat_mode = &self.heat_mode[..len];
+        let fireplace_on = &mut self.fireplace_on[..len];
+        let state = &mut self.state[..len];
+        let last_change_ms = &mut self.last_change_ms[..len];
+        let heating_start_ms = &mut self.heating_start_ms[..len];
+        let in_cooldown = &mut self.in_cooldown[..len];
+        let cooldown_start_ms = &mut self.cooldown_start_ms[..len];
+        let hold_active = &mut self.hold_active[..len];
+        let hold_start_ms = &self.hold_start_ms[..len];
+        let hold_duration_ms = &self.hold_duration_ms[..len];
+        let commands = &mut self.commands[..len];
+
+        let mut transitions = 0;
+        for i in 0..len {
+            let elapsed = |since_ms: u64| now_ms.saturating_sub(since_ms);
+
+            if hold_active[i] && elapsed(hold_start_ms[i]) >= hold_duration_ms[i] {
+                hold_active[i] = false;
+            }
+
+            let cooling = in_cooldown[i]
+                && cooldown_start_ms[i] != NEVER
+                && elapsed(cooldown_start_ms[i]) < params.cooldown_duration_ms;
+            if !cooling {
+                in_cooldown[i] = false;
+                cooldown_start_ms[i] = NEVER;
+            }
+
+            let mut command = FleetCommand::None;
+            if fireplace_on[i]
+                && heating_start_ms[i] != NEVER
+                && elapsed(heating_start_ms[i]) >= params.max_runtime_ms
+            {
+                command = FleetCommand::PowerOff;
+                fireplace_on[i] = false;
+                in_cooldown[i] = true;
+                cooldown_start_ms[i] = now_ms;
+                heating_start_ms[i] = NEVER;
+                state[i] = ThermostatState::Cooldown;
+            }
+
+            let on = fireplace_on[i];
+            let temp = temp_f[i];
+            let fresh = updated_ms[i] != NEVER && elapsed(updated_ms[i]) < params.stale_timeout_ms;
+            let can_change =
+                last_change_ms[i] == NEVER || elapsed(last_change_ms[i]) >= params.min_cycle_ms;
+            let lower_bound = target_f[i].saturating_sub(hysteresis_f[i]);
+            let upper_bound = target_f[i].saturating_add(hysteresis_f[i]);
+
+            let (next_on, next_state) = if on && temp >= params.absolute_max_temp_f {
+                (false, ThermostatState::Idle)
+            } else if !heat_mode[i] {
+                (false, ThermostatState::Idle)
+            } else if in_cooldown[i] {
+                (on, ThermostatState::Cooldown)
+            } else if hold_active[i] {
+                (on, ThermostatState::Hold)
+            } else if !fresh {
+                (false, ThermostatState::Idle)
+            } else if !on {
+                if temp >= lower_bound {
+                    (false, ThermostatState::Satisfied)
+                } else if can_change {
+                    (true, ThermostatState::Heating)
+                } else {
+                    (false, state[i])
+                }
+            } else if temp <= upper_bound {
+                (true, ThermostatState::Heating)
+            } else if can_change {
+                (false, ThermostatState::Satisfied)
+            } else {
+                (true, state[i])
+            };
+
+            if next_on != on {
+                command = if next_on {
+                    FleetCommand::PowerOn
+                } else {
+                    FleetCommand::PowerOff
+                };
+                fireplace_on[i] = next_on;
+                heating_start_ms[i] = if next_on { now_ms } else { NEVER };
+                last_change_ms[i] = now_ms;
+            }
+            state[i] = next_state;
+            commands[i] = command;
+            transitions += usize::from(command != FleetCommand::None);
+        }
+        transitions
+    }
+}
+
+impl FleetEngine {
+    pub fn new(config: ThermostatConfig) -> Self {
+        Self {
+            config,
+            temp_f: Vec::new(),
+            updated_ms: Vec::new(),
+            target_f: Vec::new(),
+            hysteresis_f: Vec::new(),
+            heat_mode: Vec::new(),
+            fireplace_on: Vec::new(),
+            state: Vec::new(),
+            last_change_ms: Vec::new(),
+            heating_start_ms: Vec::new(),
+            in_cooldown: Vec::new(),
+            cooldown_start_ms: Vec::new(),
+            hold_active: Vec::new(),
+            hold_start_ms: Vec::new(),
+            hold_duration_ms: Vec::new(),
+            commands: Vec::new(),
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.commands.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.commands.is_empty()
+    }
+
+    // Returns the new zone's index.
+    pub fn add_zone(&mut self, settings: &PersistedSettings) -> usize {
+        let mut settings = settings.clone();
+        settings.sanitize();
+        self.temp_f.push(DeciDegrees::default());
+        self.updated_ms.push(NEVER);
+        self.target_f.push(settings.target_temp_f);
+        self.hysteresis_f.push(settings.hysteresis_f);
+        self.heat_mode.push(settings.mode == ThermostatMode::Heat);
+        self.fireplace_on.push(false);
+        self.state.push(ThermostatState::Idle);
+        self.last_change_ms.push(NEVER);
+        self.heating_start_ms.push(NEVER);
+        self.in_cooldown.push(false);
+        self.cooldown_start_ms.push(NEVER);
+        self.hold_active.push(false);
+        self.hold_start_ms.push(0);
+        self.hold_duration_ms.push(0);
+        self.commands.push(FleetCommand::None);
+        self.commands.len() - 1
+    }
+
+    pub fn update_temperature(&mut self, zone: usize, temp_f: DeciDegrees, now_ms: u64) {
+        self.temp_f[zone] = temp_f;
+        self.updated_ms[zone] = now_ms;
+    }
+
+    pub fn set_target_temp(&mut self, zone: usize, temp_f: DeciDegrees) -> bool {
+        let clamped = temp_f.clamp(PersistedSettings::TARGET_MIN, PersistedSettings::TARGET_MAX);
+        let changed = self.target_f[zone] != clamped;
+        if changed {
+            self.target_f[zone] = clamped;
+        }
+        changed
+    }
+
+    pub fn set_hysteresis(&mut self, zone: usize, hysteresis_f: DeciDegrees) -> bool {
+        let clamped = hysteresis_f.clamp(
+            PersistedSettings::HYSTERESIS_MIN,
+            PersistedSettings::HYSTERESIS_MAX,
+        );
+        let changed = self.hysteresis_f[zone] != clamped;
+        if changed {
+            self.hysteresis_f[zone] = clamped;
+        }
+        changed
+    }
+
+    // Matches `ThermostatEngine::set_mode_with_actions`: switching off clears
+    // the hold and shuts a running fireplace down immediately.
+    pub fn set_mode(&mut self, zone: usize, mode: ThermostatMode, now_ms: u64) -> FleetCommand {
+        let heat = mode == ThermostatMode::Heat;
+        if self.heat_mode[zone] == heat {
+            return FleetCommand::None;
+        }
+        self.heat_mode[zone] = heat;
+        if heat {
+            return FleetCommand::None;
+        }
+
+        self.hold_active[zone] = false;
+        if !self.fireplace_on[zone] {
+            return FleetCommand::None;
+        }
+        self.fireplace_on[zone] = false;
+        self.heating_start_ms[zone] = NEVER;
+        self.last_change_ms[zone] = now_ms;
+        self.state[zone] = ThermostatState::Idle;
+        FleetCommand::PowerOff
+    }
+
+    pub fn enter_hold(&mut self, zone: usize, duration_ms: Option<u64>, now_ms: u64) {
+        self.hold_active[zone] = true;
+        self.hold_start_ms[zone] = now_ms;
+        self.hold_duration_ms[zone] = duration_ms.unwrap_or(self.config.hold_duration_ms);
+    }
+
+    pub fn exit_hold(&mut self, zone: usize) {
+        self.hold_active[zone] = false;
+    }
+
+    pub fn is_fireplace_on(&self, zone: usize) -> bool {
+        self.fireplace_on[zone]
+    }
+
+    pub fn state(&self, zone: usize) -> ThermostatState {
+        self.state[zone]
+    }
+
+    // Commands produced by the last tick, indexed by zone.
+    pub fn commands(&self) -> &[FleetCommand] {
+        &self.commands
+    }
+
+    // Returns the number of zones that switched the fireplace.
+    pub fn tick(&mut self, now_ms: u64) -> usize {
+        let params = self.tick_params(now_ms);
+        self.columns().evaluate(params)
+    }
+
+    // Same as `tick`, with the zones split into contiguous chunks evaluated
+    // on up to `threads` scoped threads. Zones are independent, so the
+    // result does not depend on the split.
+    pub fn tick_parallel(&mut self, now_ms: u64, threads: usize) -> usize {
+        let params = self.tick_params(now_ms);
+        let chunk = self.len().div_ceil(threads.max(1)).max(1);
+        let mut rest = self.columns();
+        thread::scope(|scope| {
+            let mut handles = Vec::new();
+            while rest.commands.len() > chunk {
+                let (head, tail) = rest.split_at(chunk);
+                handles.push(scope.spawn(move || head.evaluate(params)));
+                rest = tail;
+            }
+            let local = rest.evaluate(params);
+            local
+                + handles
+                    .into_iter()
+                    .map(|handle| handle.join().expect("fleet tick worker panicked"))
+                    .sum::<usize>()
+        })
+    }
+
+    fn tick_params(&self, now_ms: u64) -> TickParams {
+        TickParams {
+            now_ms,
+            stale_timeout_ms: self.config.sensor_stale_timeout_ms,
+            min_cycle_ms: self.config.min_cycle_ms,
+            max_runtime_ms: self.config.max_runtime_ms,
+            cooldown_duration_ms: self.config.cooldown_duration_ms,
+            absolute_max_temp_f: self.config.absolute_max_temp_f,
+        }
+    }
+
+    fn columns(&mut self) -> Columns<'_> {
+        Columns {
+            temp_f: &self.temp_f,
+            updated_ms: &self.updated_ms,
+            target_f: &self.target_f,
+            hysteresis_f: &self.hysteresis_f,
+            heat_mode: &self.heat_mode,
+            fireplace_on: &mut self.fireplace_on,
+            state: &mut self.state,
+            last_change_ms: &mut self.last_change_ms,
+            heating_start_ms: &mut self.heating_start_ms,
+            in_cooldown: &mut self.in_cooldown,
+            cooldown_start_ms: &mut self.cooldown_start_ms,
+            hold_active: &mut self.hold_active,
+            hold_start_ms: &self.hold_start_ms,
+            hold_duration_ms: &self.hold_duration_ms,
+            commands: &mut self.commands,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::thermostat::{EngineAction, ThermostatEngine};
+
+    // Small deterministic generator so the scenario is reproducible.
+    struct Lcg(u64);
+
+    impl Lcg {
+        fn next(&mut self) -> u32 {
+            self.0 = self
+                .0
+                .wrapping_mul(6_364_136_223_846_793_005)
+                .wrapping_add(1_442_695_040_888_963_407);
+            (self.0 >> 33) as u32
+        }
+
+        fn below(&mut self, bound: u32) -> u32 {
+            self.next() % bound
+        }
+    }
+
+    fn first_power_action(actions: &[EngineAction]) -> FleetCommand {
+        match actions.first() {
+            Some(EngineAction::PowerOn) => FleetCommand::PowerOn,
+            Some(EngineAction::PowerOff) => FleetCommand::PowerOff,
+            _ => FleetCommand::None,
+        }
+    }
+
+    #[test]
+    fn batch_tick_matches_scalar_engine() {
+        let config = ThermostatConfig {
+            min_cycle_ms: 120_000,
+            max_runtime_ms: 1_800_000,
+            cooldown_duration_ms: 600_000,
+            hold_duration_ms: 300_000,
+            // The batch engine leaves remote detection to the scalar engine;
+            // more samples than it keeps disables it here.
+            trend_samples_required: u8::MAX,
+            ..ThermostatConfig::default()
+        };
+        let mut rng = Lcg(0x5eed);
+        let mut fleet = FleetEngine::new(config.clone());
+        let mut scalar = Vec::new();
+        let mut temps = Vec::new();
+        for _ in 0..97 {
+            let settings = PersistedSettings {
+                target_temp_f: DeciDegrees::from_degrees(64 + rng.below(16) as i16),
+                hysteresis_f: DeciDegrees::from_tenths(5 + rng.below(4) as i16 * 5),
+                mode: if rng.below(4) == 0 {
+                    ThermostatMode::Off
+                } else {
+                    ThermostatMode::Heat
+                },
+                ..PersistedSettings::default()
+            };
+            fleet.add_zone(&settings);
+            scalar.push(ThermostatEngine::new(config.clone(), settings));
+            temps.push(60.0 + rng.below(200) as f32 / 10.0);
+        }
+
+        let mut now_ms = 0_u64;
+        let mut transitions = 0;
+        for step in 0..2_000 {
+            now_ms += 5_000 + u64::from(rng.below(60_000));
+            for zone in 0..scalar.len() {
+                match rng.below(100) {
+                    // Sensors stay quiet about one time in five.
+                    0..=59 => {
+                        temps[zone] += (rng.below(21) as f32 - 9.0) / 10.0;
+                        temps[zone] = temps[zone].clamp(50.0, 100.0);
+                        let temp = DeciDegrees::from_f32(temps[zone]);
+                        scalar[zone].update_sensor_data(temp, 40.0, now_ms);
+                        fleet.update_temperature(zone, temp, now_ms);
+                    }
+                    60..=79 => {}
+                    80..=84 => {
+                        let mode = if rng.below(3) == 0 {
+                            ThermostatMode::Off
+                        } else {
+                            ThermostatMode::Heat
+                        };
+                        let (_, actions) = scalar[zone].set_mode_with_actions(mode, now_ms);
+                        let command = fleet.set_mode(zone, mode, now_ms);
+                        assert_eq!(command, first_power_action(&actions));
+                    }
+                    85..=89 => {
+                        let target = DeciDegrees::from_degrees(60 + rng.below(26) as i16);
+                        assert_eq!(
+                            fleet.set_target_temp(zone, target),
+                            scalar[zone].set_target_temp(target)
+                        );
+                    }
+                    90..=91 => {
+                        let duration = u64::from(rng.below(600_000));
+                        scalar[zone].enter_hold(Some(duration), now_ms);
+                        fleet.enter_hold(zone, Some(duration), now_ms);
+                    }
+                    92 => {
+                        scalar[zone].exit_hold();
+                        fleet.exit_hold(zone);
+                    }
+                    _ => {}
+                }
+            }
+
+            let fleet_transitions = if step % 2 == 0 {
+                fleet.tick(now_ms)
+            } else {
+                fleet.tick_parallel(now_ms, 4)
+            };
+            transitions += fleet_transitions;
+
+            for (zone, engine) in scalar.iter_mut().enumerate() {
+                let actions = engine.tick(now_ms);
+                assert_eq!(
+                    fleet.commands()[zone],
+                    first_power_action(&actions),
+                    "zone {zone} step {step}"
+                );
+                assert_eq!(fleet.is_fireplace_on(zone), engine.is_fireplace_on());
+                assert_eq!(fleet.state(zone), engine.state(), "zone {zone} step {step}");
+            }
+        }
+        // The scenario has to exercise the transitions it compares.
+        assert!(transitions > 200, "only {transitions} transitions");
+    }
+}
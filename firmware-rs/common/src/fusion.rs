@@ -0,0 +1,470 @@
+#[cfg(feature = "std")]
+use std::collections::HashMap;
+
+use serde::Serialize;
+
+use crate::bounded::{copy_str, BoundedPush, BoundedString, BoundedVec};
+
+pub const MAX_SENSOR_SOURCES: usize = 16;
+// DS18B20 ROM ids ("28-0316a2793dff") take 15 bytes. Without std a longer
+// name is refused like a source beyond the table size.
+pub const MAX_SOURCE_NAME_LEN: usize = 32;
+pub type SourceName = BoundedString<MAX_SOURCE_NAME_LEN>;
+// The single-temperature topic every sensor firmware publishes. Newer sensors
+// also publish per-probe topics, which then take precedence over it.
+pub const DEFAULT_SENSOR_SOURCE: &str = "sensor";
+
+// Median and MAD need at least three sources to tell which one is wrong.
+const MIN_SOURCES_FOR_REJECTION: usize = 3;
+// Scales the MAD to a standard deviation for normally distributed noise.
+const MAD_TO_SIGMA: f32 = 1.4826;
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct SourceConfig {
+    pub weight: f32,
+    pub stale_timeout_ms: u64,
+    // Fallback sources only count while no regular source contributes.
+    pub fallback: bool,
+}
+
+// What `SensorFusion::update` did with a reading.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SourceUpdate {
+    Accepted,
+    // Too far from the median of the fresh sources, or not a number.
+    Outlier,
+    // A new source found every slot held by a fresh or configured source,
+    // or (without std) its name did not fit.
+    TableFull,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct SourceStatus {
+    pub name: SourceName,
+    #[serde(rename = "tempF")]
+    pub temp_f: f32,
+    #[serde(rename = "ageMs")]
+    pub age_ms: u64,
+    pub fresh: bool,
+    pub rejected: bool,
+    pub weight: f32,
+    pub fallback: bool,
+}
+
+#[derive(Debug, Clone)]
+struct Source {
+    name: SourceName,
+    config: SourceConfig,
+    temp_f: f32,
+    updated_ms: Option<u64>,
+    contributing: bool,
+    rejected: bool,
+    // Set by `configure_source`; such a source keeps its slot even when
+    // stale, so its config survives.
+    configured: bool,
+}
+
+impl Source {
+    fn is_fresh(&self, now_ms: u64) -> bool {
+        self.updated_ms
+            .is_some_and(|updated| now_ms.saturating_sub(updated) < self.config.stale_timeout_ms)
+    }
+}
+
+// f64 so repeated add/remove of the same reading does not drift; `refresh`
+// rebuilds it from scratch anyway.
+#[derive(Debug, Clone, Copy, Default)]
+struct WeightedSum {
+    sum: f64,
+    weight: f64,
+}
+
+impl WeightedSum {
+    fn add(&mut self, temp_f: f32, weight: f32) {
+        self.sum += f64::from(temp_f) * f64::from(weight);
+        self.weight += f64::from(weight);
+    }
+
+    fn remove(&mut self, temp_f: f32, weight: f32) {
+        self.sum -= f64::from(temp_f) * f64::from(weight);
+        self.weight -= f64::from(weight);
+    }
+
+    fn mean(&self) -> Option<f32> {
+        (self.weight > 1e-6).then(|| (self.sum / self.weight) as f32)
+    }
+}
+
+// Fuses temperatures from several named sources. An update only adjusts the
+// running weighted sums and checks the reading against the median and MAD
+// cached by the last `refresh`, so it costs O(1). `refresh` recomputes those
+// statistics and expires stale sources; the engine calls it once per tick.
+#[derive(Debug, Clone)]
+pub struct SensorFusion {
+    sources: BoundedVec<Source, MAX_SENSOR_SOURCES>,
+    #[cfg(feature = "std")]
+    index: HashMap<String, usize>,
+    regular: WeightedSum,
+    fallback: WeightedSum,
+    median_f: Option<f32>,
+    reject_beyond_f: f32,
+    default_stale_timeout_ms: u64,
+    mad_k: f32,
+    floor_f: f32,
+    rejected_total: u64,
+}
+
+impl SensorFusion {
+    // `floor_f` keeps tightly agreeing sources from rejecting every reading
+    // that differs by a few tenths.
+    pub fn new(default_stale_timeout_ms: u64, mad_k: f32, floor_f: f32) -> Self {
+        Self {
+            sources: BoundedVec::new(),
+            #[cfg(feature = "std")]
+            index: HashMap::new(),
+            regular: WeightedSum::default(),
+            fallback: WeightedSum::default(),
+            median_f: None,
+            reject_beyond_f: f32::INFINITY,
+            default_stale_timeout_ms,
+            mad_k,
+            floor_f,
+            rejected_total: 0,
+        }
+    }
+
+    pub fn default_source_config(&self) -> SourceConfig {
+        SourceConfig {
+            weight: 1.0,
+            stale_timeout_ms: self.default_stale_timeout_ms,
+            fallback: false,
+        }
+    }
+
+    // Registers or reconfigures a source; false when the table is full.
+    pub fn configure_source(&mut self, name: &str, config: SourceConfig) -> bool {
+        let Some(index) = self.source_index(name, None) else {
+            return false;
+        };
+        let source = &mut self.sources[index];
+        source.configured = true;
+        if source.contributing {
+            let sum = sum_for(
+                &mut self.regular,
+                &mut self.fallback,
+                source.config.fallback,
+            );
+            sum.remove(source.temp_f, source.config.weight);
+            source.contributing = false;
+        }
+        source.config = SourceConfig {
+            weight: config.weight.max(0.0),
+            ..config
+        };
+        // The source rejoins the sums at its next reading or refresh.
+        true
+    }
+
+    pub fn update(&mut self, name: &str, temp_f: f32, now_ms: u64) -> SourceUpdate {
+        if !temp_f.is_finite() {
+            return SourceUpdate::Outlier;
+        }
+        let Some(index) = self.source_index(name, Some(now_ms)) else {
+            return SourceUpdate::TableFull;
+        };
+
+        let source = &mut self.sources[index];
+        let sum = sum_for(
+            &mut self.regular,
+            &mut self.fallback,
+            source.config.fallback,
+        );
+        if source.contributing {
+            sum.remove(source.temp_f, source.config.weight);
+        }
+
+        source.temp_f = temp_f;
+        source.updated_ms = Some(now_ms);
+        source.rejected = !source.config.fallback
+            && self
+                .median_f
+                .is_some_and(|median| (temp_f - median).abs() > self.reject_beyond_f);
+        source.contributing = !source.rejected;
+        if source.contributing {
+            sum.add(temp_f, source.config.weight);
+            SourceUpdate::Accepted
+        } else {
+            self.rejected_total += 1;
+            SourceUpdate::Outlier
+        }
+    }
+
+    pub fn refresh(&mut self, now_ms: u64) {
+        let mut fresh: BoundedVec<f32, MAX_SENSOR_SOURCES> = self
+            .sources
+            .iter()
+            .filter(|source| !source.config.fallback && source.is_fresh(now_ms))
+            .map(|source| source.temp_f)
+            .collect();
+
+        if fresh.len() >= MIN_SOURCES_FOR_REJECTION {
+            let median = median_of(&mut fresh);
+            let mut deviations: BoundedVec<f32, MAX_SENSOR_SOURCES> =
+                fresh.iter().map(|temp| (temp - median).abs()).collect();
+            let mad = median_of(&mut deviations);
+            self.median_f = Some(median);
+            self.reject_beyond_f = (self.mad_k * MAD_TO_SIGMA * mad).max(self.floor_f);
+        } else {
+            self.median_f = None;
+            self.reject_beyond_f = f32::INFINITY;
+        }
+
+        self.regular = WeightedSum::default();
+        self.fallback = WeightedSum::default();
+        for source in &mut self.sources {
+            let fresh = source.is_fresh(now_ms);
+            source.rejected = fresh
+                && !source.config.fallback
+                && self
+                    .median_f
+                    .is_some_and(|median| (source.temp_f - median).abs() > self.reject_beyond_f);
+            source.contributing = fresh && !source.rejected;
+            if source.contributing {
+                let sum = sum_for(
+                    &mut self.regular,
+                    &mut self.fallback,
+                    source.config.fallback,
+                );
+                sum.add(source.temp_f, source.config.weight);
+            }
+        }
+    }
+
+    pub fn fused_f(&self) -> Option<f32> {
+        self.regular.mean().or_else(|| self.fallback.mean())
+    }
+
+    // Staleness safety only trips once every source has gone quiet.
+    pub fn any_fresh(&self, now_ms: u64) -> bool {
+        self.sources.iter().any(|source| source.is_fresh(now_ms))
+    }
+
+    // Hottest fresh reading, rejected or not: the over-temperature cutoff must
+    // not be talked out of a probe sitting next to the fire.
+    pub fn max_fresh_f(&self, now_ms: u64) -> Option<f32> {
+        self.sources
+            .iter()
+            .filter(|source| source.is_fresh(now_ms))
+            .map(|source| source.temp_f)
+            .reduce(f32::max)
+    }
+
+    pub fn last_update_ms(&self) -> Option<u64> {
+        self.sources
+            .iter()
+            .filter_map(|source| source.updated_ms)
+            .max()
+    }
+
+    pub fn rejected_total(&self) -> u64 {
+        self.rejected_total
+    }
+
+    pub fn sources(&self, now_ms: u64) -> BoundedVec<SourceStatus, MAX_SENSOR_SOURCES> {
+        self.sources
+            .iter()
+            .filter(|source| source.updated_ms.is_some())
+            .map(|source| SourceStatus {
+                name: source.name.clone(),
+                temp_f: source.temp_f,
+                age_ms: source
+                    .updated_ms
+                    .map_or(0, |updated| now_ms.saturating_sub(updated)),
+                fresh: source.is_fresh(now_ms),
+                rejected: source.rejected,
+                weight: source.config.weight,
+                fallback: source.config.fallback,
+            })
+            .collect()
+    }
+
+    // A new source takes a free slot or, given the time, the one of the
+    // longest-silent stale source, since probes get replaced over time.
+    fn source_index(&mut self, name: &str, now_ms: Option<u64>) -> Option<usize> {
+        // The table is small enough to scan without std's hash map.
+        #[cfg(feature = "std")]
+        let existing = self.index.get(name).copied();
+        #[cfg(not(feature = "std"))]
+        let existing = self.sources.iter().position(|source| source.name == name);
+        if existing.is_some() {
+            return existing;
+        }
+        let source = Source {
+            name: copy_str::<MAX_SOURCE_NAME_LEN>(name)?,
+            config: self.default_source_config(),
+            temp_f: 0.0,
+            updated_ms: None,
+            contributing: false,
+            rejected: false,
+            configured: false,
+        };
+
+        let index = if self.sources.len() < MAX_SENSOR_SOURCES {
+            self.sources.push_bounded(source);
+            self.sources.len() - 1
+        } else {
+            let now_ms = now_ms?;
+            let index = self
+                .sources
+                .iter()
+                .enumerate()
+                .filter(|(_, source)| !source.configured && !source.is_fresh(now_ms))
+                .min_by_key(|(_, source)| source.updated_ms)
+                .map(|(index, _)| index)?;
+            let evicted = core::mem::replace(&mut self.sources[index], source);
+            if evicted.contributing {
+                let sum = sum_for(
+                    &mut self.regular,
+                    &mut self.fallback,
+                    evicted.config.fallback,
+                );
+                sum.remove(evicted.temp_f, evicted.config.weight);
+            }
+            #[cfg(feature = "std")]
+            self.index.remove(evicted.name.as_str());
+            index
+        };
+        #[cfg(feature = "std")]
+        self.index.insert(name.to_string(), index);
+        Some(index)
+    }
+}
+
+fn sum_for<'a>(
+    regular: &'a mut WeightedSum,
+    fallback: &'a mut WeightedSum,
+    is_fallback: bool,
+) -> &'a mut WeightedSum {
+    if is_fallback {
+        fallback
+    } else {
+        regular
+    }
+}
+
+fn median_of(values: &mut [f32]) -> f32 {
+    values.sort_unstable_by(f32::total_cmp);
+    let mid = values.len() / 2;
+    if values.len() % 2 == 0 {
+        (values[mid - 1] + values[mid]) / 2.0
+    } else {
+        values[mid]
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn fusion() -> SensorFusion {
+        SensorFusion::new(300_000, 3.0, 3.0)
+    }
+
+    #[test]
+    fn weighted_mean_tracks_updates_incrementally() {
+        let mut fusion = fusion();
+        fusion.update("a", 68.0, 0);
+        fusion.update("b", 70.0, 0);
+        assert_eq!(fusion.fused_f(), Some(69.0));
+
+        let config = SourceConfig {
+            weight: 3.0,
+            ..fusion.default_source_config()
+        };
+        fusion.configure_source("b", config);
+        fusion.update("b", 72.0, 1_000);
+        assert_eq!(fusion.fused_f(), Some(71.0));
+
+        // A rebuild from scratch agrees with the running sums.
+        fusion.refresh(2_000);
+        assert_eq!(fusion.fused_f(), Some(71.0));
+    }
+
+    #[test]
+    fn outlier_is_rejected_against_the_median() {
+        let mut fusion = fusion();
+        for (name, temp) in [("a", 68.0), ("b", 68.4), ("c", 69.0), ("d", 68.6)] {
+            fusion.update(name, temp, 0);
+        }
+        fusion.refresh(0);
+
+        // A probe lying on a sunny windowsill.
+        assert_eq!(fusion.update("d", 80.0, 1_000), SourceUpdate::Outlier);
+        assert!((fusion.fused_f().unwrap() - 68.466_67).abs() < 1e-3);
+        assert!(fusion.sources(1_000).iter().any(|source| source.rejected));
+        assert_eq!(fusion.rejected_total(), 1);
+        // It still counts for the over-temperature cutoff.
+        assert_eq!(fusion.max_fresh_f(1_000), Some(80.0));
+
+        // Back in line, it contributes again.
+        assert_eq!(fusion.update("d", 68.6, 2_000), SourceUpdate::Accepted);
+    }
+
+    #[test]
+    fn full_table_evicts_the_longest_silent_stale_source() {
+        let mut fusion = fusion();
+        let fallback = SourceConfig {
+            fallback: true,
+            ..fusion.default_source_config()
+        };
+        fusion.configure_source(DEFAULT_SENSOR_SOURCE, fallback);
+        for probe in 1..MAX_SENSOR_SOURCES {
+            fusion.update(&format!("probe-{probe}"), 68.0, probe as u64 * 1_000);
+        }
+
+        // Every source is still fresh, so there is nothing to evict.
+        assert_eq!(
+            fusion.update("replacement", 68.0, 100_000),
+            SourceUpdate::TableFull
+        );
+
+        // Once stale, the longest-silent probe makes room. The configured
+        // fallback keeps its slot although it never reported.
+        assert_eq!(
+            fusion.update("replacement", 69.0, 302_000),
+            SourceUpdate::Accepted
+        );
+        let sources = fusion.sources(302_000);
+        assert!(!sources.iter().any(|source| source.name == "probe-1"));
+        assert!(sources.iter().any(|source| source.name == "probe-2"));
+        assert!(sources.iter().any(|source| source.name == "replacement"));
+        assert!(fusion.configure_source(DEFAULT_SENSOR_SOURCE, fallback));
+    }
+
+    #[test]
+    fn stale_sources_drop_out_and_fallback_fills_in() {
+        let mut fusion = fusion();
+        let fallback = SourceConfig {
+            fallback: true,
+            ..fusion.default_source_config()
+        };
+        fusion.configure_source(DEFAULT_SENSOR_SOURCE, fallback);
+        fusion.update(DEFAULT_SENSOR_SOURCE, 60.0, 0);
+        fusion.update("probe", 70.0, 200_000);
+        assert_eq!(fusion.fused_f(), Some(70.0));
+
+        // The fallback went stale first, but a probe is still fresh.
+        fusion.refresh(350_000);
+        assert!(fusion.any_fresh(350_000));
+        assert_eq!(fusion.fused_f(), Some(70.0));
+
+        fusion.update(DEFAULT_SENSOR_SOURCE, 61.0, 560_000);
+        fusion.refresh(560_000);
+        assert_eq!(fusion.fused_f(), Some(61.0));
+
+        fusion.refresh(900_000);
+        assert!(!fusion.any_fresh(900_000));
+        assert_eq!(fusion.fused_f(), None);
+        assert_eq!(fusion.last_update_ms(), Some(560_000));
+    }
+}
@@ -0,0 +1,196 @@
+use std::sync::atomic::{AtomicU64, Ordering};
+
+use serde::Serialize;
+
+// Log-linear buckets: values below 8 are exact, every power of two above is
+// split into 8 sub-buckets, so a percentile is off by at most 12.5%. Values
+// at or above 2^36 (about 19 hours in microseconds) share the last bucket.
+const SUB_BUCKET_BITS: u32 = 3;
+const SUB_BUCKETS: usize = 1 << SUB_BUCKET_BITS;
+const MAX_EXPONENT: u32 = 35;
+pub const HISTOGRAM_BUCKETS: usize = (MAX_EXPONENT as usize - 1) * SUB_BUCKETS;
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+fn bucket_index(value: u64) -> usize {
+    if value < SUB_BUCKETS as u64 {
+        return value as usize;
+    }
+    let exponent = (63 - value.leading_zeros()).min(MAX_EXPONENT);
+    if exponent == MAX_EXPONENT && value >> MAX_EXPONENT > 1 {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    let sub = (value >> (exponent - SUB_BUCKET_BITS)) as usize & (SUB_BUCKETS - 1);
+    (exponent - SUB_BUCKET_BITS + 1) as usize * SUB_BUCKETS + sub
+}
+
+fn bucket_upper_bound(index: usize) -> u64 {
+    if index < SUB_BUCKETS {
+        return index as u64;
+    }
+    let shift = (index / SUB_BUCKETS - 1) as u32;
+    let sub = (index % SUB_BUCKETS) as u64;
+    ((SUB_BUCKETS as u64 + sub) << shift) + (1 << shift) - 1
+}
+
+// Fixed-size histogram of u64 samples (typically microseconds). Recording is
+// a handful of relaxed atomic adds and never allocates, so one instance can
+// be shared across tasks and threads without a lock.
+#[derive(Debug)]
+pub struct Histogram {
+    buckets: [AtomicU64; HISTOGRAM_BUCKETS],
+    count: AtomicU64,
+    sum: AtomicU64,
+    max: AtomicU64,
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Histogram {
+    pub const fn new() -> Self {
+        Self {
+            buckets: [ZERO; HISTOGRAM_BUCKETS],
+            count: ZERO,
+            sum: ZERO,
+            max: ZERO,
+        }
+    }
+
+    pub fn record(&self, value: u64) {
+        self.buckets[bucket_index(value)].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum.fetch_add(value, Ordering::Relaxed);
+        self.max.fetch_max(value, Ordering::Relaxed);
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count.load(Ordering::Relaxed)
+    }
+
+    // Concurrent recordings may land between the loads; the snapshot is
+    // consistent enough for reporting, not for accounting.
+    pub fn snapshot(&self) -> HistogramSnapshot {
+        HistogramSnapshot {
+            buckets: self
+                .buckets
+                .iter()
+                .map(|bucket| bucket.load(Ordering::Relaxed))
+                .collect(),
+            count: self.count.load(Ordering::Relaxed),
+            sum: self.sum.load(Ordering::Relaxed),
+            max: self.max.load(Ordering::Relaxed),
+        }
+    }
+
+    pub fn reset(&self) {
+        for bucket in &self.buckets {
+            bucket.store(0, Ordering::Relaxed);
+        }
+        self.count.store(0, Ordering::Relaxed);
+        self.sum.store(0, Ordering::Relaxed);
+        self.max.store(0, Ordering::Relaxed);
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HistogramSnapshot {
+    pub buckets: Vec<u64>,
+    pub count: u64,
+    pub sum: u64,
+    pub max: u64,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Serialize)]
+pub struct HistogramSummary {
+    pub count: u64,
+    pub mean: f64,
+    pub p50: u64,
+    pub p90: u64,
+    pub p99: u64,
+    pub p999: u64,
+    pub max: u64,
+}
+
+impl HistogramSnapshot {
+    // Upper bound of the bucket holding the q-th quantile, capped at the
+    // largest recorded value.
+    pub fn percentile(&self, quantile: f64) -> u64 {
+        if self.count == 0 {
+            return 0;
+        }
+        let rank = ((quantile.clamp(0.0, 1.0) * self.count as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (index, &bucket) in self.buckets.iter().enumerate() {
+            seen += bucket;
+            if seen >= rank {
+                return bucket_upper_bound(index).min(self.max);
+            }
+        }
+        self.max
+    }
+
+    pub fn mean(&self) -> f64 {
+        if self.count == 0 {
+            0.0
+        } else {
+            self.sum as f64 / self.count as f64
+        }
+    }
+
+    pub fn summary(&self) -> HistogramSummary {
+        HistogramSummary {
+            count: self.count,
+            mean: self.mean(),
+            p50: self.percentile(0.50),
+            p90: self.percentile(0.90),
+            p99: self.percentile(0.99),
+            p999: self.percentile(0.999),
+            max: self.max,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn buckets_cover_the_range_in_order() {
+        let mut previous = 0;
+        for value in (0..20).chain((5..36).map(|shift| 1_u64 << shift).flat_map(|v| [v - 1, v])) {
+            let index = bucket_index(value);
+            assert!(index >= previous, "value {value}");
+            assert!(bucket_upper_bound(index) >= value, "value {value}");
+            previous = index;
+        }
+        assert_eq!(bucket_index(u64::MAX), HISTOGRAM_BUCKETS - 1);
+    }
+
+    #[test]
+    fn percentiles_stay_within_bucket_error() {
+        let histogram = Histogram::new();
+        for value in 1..=10_000 {
+            histogram.record(value);
+        }
+        let snapshot = histogram.snapshot();
+        assert_eq!(snapshot.count, 10_000);
+        assert_eq!(snapshot.max, 10_000);
+        for (quantile, exact) in [(0.5, 5_000.0), (0.9, 9_000.0), (0.99, 9_900.0)] {
+            let estimate = snapshot.percentile(quantile) as f64;
+            assert!(
+                estimate >= exact && estimate <= exact * 1.125,
+                "p{quantile}: {estimate}"
+            );
+        }
+        assert_eq!(snapshot.percentile(1.0), 10_000);
+        assert!((snapshot.mean() - 5_000.5).abs() < 1e-9);
+
+        histogram.reset();
+        assert_eq!(histogram.snapshot().summary(), HistogramSummary::default());
+    }
+}
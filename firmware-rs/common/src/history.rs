@@ -0,0 +1,398 @@
+use std::collections::VecDeque;
+
+use serde::{Deserialize, Serialize};
+
+use crate::temperature::{round_tenths, DeciDegrees};
+
+// Readings buffered on the sensor while the broker is unreachable. At the
+// 30 s cadence this covers a little over two hours of outage.
+pub const SENSOR_BUFFER_CAPACITY: usize = 256;
+// Keeps every history batch well under the controller's MQTT payload limit.
+pub const HISTORY_BATCH_MAX_READINGS: usize = 8;
+pub const HISTORY_STORE_CAPACITY: usize = 720;
+
+// Temperature and humidity arrive on separate topics; readings this close
+// together are folded into one history point.
+const LIVE_MERGE_WINDOW_MS: u64 = 2_000;
+
+// Stored in place of a value that was not measured.
+const NO_READING: i16 = i16::MIN;
+
+#[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
+pub struct BufferedReading {
+    // The sensor has no synchronized clock, so readings are stamped relative
+    // to the moment the batch is published.
+    #[serde(rename = "ageMs")]
+    pub age_ms: u64,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub temp: Option<DeciDegrees>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub humidity: Option<f32>,
+}
+
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct HistoryBatch {
+    // Oldest first.
+    pub readings: Vec<BufferedReading>,
+    // Readings lost to buffer overflow since the previous batch.
+    #[serde(default)]
+    pub dropped: u64,
+}
+
+// Both values in tenths with a sentinel for a missing one, so a buffered
+// reading or history point is 16 bytes rather than the 24 or 32 it takes with
+// a pair of `Option<f32>`. Humidity validated to 0-100 % fits with room to
+// spare.
+#[derive(Debug, Clone, Copy)]
+struct PackedReading {
+    temp: i16,
+    humidity: i16,
+}
+
+impl PackedReading {
+    fn new(temp: Option<DeciDegrees>, humidity: Option<f32>) -> Self {
+        Self {
+            temp: temp.map_or(NO_READING, DeciDegrees::tenths),
+            humidity: humidity.map_or(NO_READING, round_tenths),
+        }
+    }
+
+    fn temp(self) -> Option<DeciDegrees> {
+        (self.temp != NO_READING).then_some(DeciDegrees::from_tenths(self.temp))
+    }
+
+    fn humidity(self) -> Option<f32> {
+        (self.humidity != NO_READING).then(|| f32::from(self.humidity) / 10.0)
+    }
+}
+
+#[derive(Debug, Clone, Copy)]
+struct StampedReading {
+    taken_ms: u64,
+    reading: PackedReading,
+}
+
+#[derive(Debug)]
+pub struct ReadingBuffer {
+    readings: VecDeque<StampedReading>,
+    capacity: usize,
+    dropped: u64,
+}
+
+impl Default for ReadingBuffer {
+    fn default() -> Self {
+        Self::new(SENSOR_BUFFER_CAPACITY)
+    }
+}
+
+impl ReadingBuffer {
+    pub fn new(capacity: usize) -> Self {
+        let capacity = capacity.max(1);
+        Self {
+            readings: VecDeque::with_capacity(capacity),
+            capacity,
+            dropped: 0,
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.readings.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.readings.is_empty()
+    }
+
+    pub fn push(&mut self, taken_ms: u64, temp: Option<DeciDegrees>, humidity: Option<f32>) {
+        if temp.is_none() && humidity.is_none() {
+            return;
+        }
+        if self.readings.len() >= self.capacity {
+            self.readings.pop_front();
+            self.dropped += 1;
+        }
+        self.readings.push_back(StampedReading {
+            taken_ms,
+            reading: PackedReading::new(temp, humidity),
+        });
+    }
+
+    // Builds the next batch without removing anything; call `commit` once the
+    // publish succeeded so a failed replay keeps the readings.
+    pub fn next_batch(&self, now_ms: u64) -> Option<HistoryBatch> {
+        if self.readings.is_empty() {
+            return None;
+        }
+        let readings = self
+            .readings
+            .iter()
+            .take(HISTORY_BATCH_MAX_READINGS)
+            .map(|reading| BufferedReading {
+                age_ms: now_ms.saturating_sub(reading.taken_ms),
+                temp: reading.reading.temp(),
+                humidity: reading.reading.humidity(),
+            })
+            .collect();
+        Some(HistoryBatch {
+            readings,
+            dropped: self.dropped,
+        })
+    }
+
+    pub fn commit(&mut self, batch: &HistoryBatch) {
+        let count = batch.readings.len().min(self.readings.len());
+        self.readings.drain(..count);
+        self.dropped = self.dropped.saturating_sub(batch.dropped);
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Serialize)]
+pub struct HistoryPoint {
+    #[serde(rename = "atMs")]
+    pub at_ms: u64,
+    pub temp: Option<DeciDegrees>,
+    pub humidity: Option<f32>,
+    pub replayed: bool,
+}
+
+#[derive(Debug, Clone, Copy)]
+struct StoredPoint {
+    at_ms: u64,
+    reading: PackedReading,
+    replayed: bool,
+}
+
+impl StoredPoint {
+    fn view(&self) -> HistoryPoint {
+        HistoryPoint {
+            at_ms: self.at_ms,
+            temp: self.reading.temp(),
+            humidity: self.reading.humidity(),
+            replayed: self.replayed,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct HistoryStats {
+    pub depth: usize,
+    pub capacity: usize,
+    pub live: u64,
+    pub replayed: u64,
+    #[serde(rename = "sensorDropped")]
+    pub sensor_dropped: u64,
+    pub evicted: u64,
+}
+
+#[derive(Debug)]
+pub struct HistoryStore {
+    // Kept sorted by `at_ms` so replayed readings land where they belong.
+    points: VecDeque<StoredPoint>,
+    stats: HistoryStats,
+}
+
+impl Default for HistoryStore {
+    fn default() -> Self {
+        Self::new(HISTORY_STORE_CAPACITY)
+    }
+}
+
+impl HistoryStore {
+    pub fn new(capacity: usize) -> Self {
+        let capacity = capacity.max(1);
+        Self {
+            points: VecDeque::with_capacity(capacity),
+            stats: HistoryStats {
+                capacity,
+                ..HistoryStats::default()
+            },
+        }
+    }
+
+    pub fn points(&self) -> impl Iterator<Item = HistoryPoint> + '_ {
+        self.points.iter().map(StoredPoint::view)
+    }
+
+    pub fn stats(&self) -> HistoryStats {
+        HistoryStats {
+            depth: self.points.len(),
+            ..self.stats
+        }
+    }
+
+    pub fn record_live(&mut self, now_ms: u64, temp: Option<DeciDegrees>, humidity: Option<f32>) {
+        if let Some(last) = self.points.back_mut() {
+            let (last_temp, last_humidity) = (last.reading.temp(), last.reading.humidity());
+            let mergeable = !last.replayed
+                && now_ms.saturating_sub(last.at_ms) <= LIVE_MERGE_WINDOW_MS
+                && (temp.is_none() || last_temp.is_none())
+                && (humidity.is_none() || last_humidity.is_none());
+            if mergeable {
+                last.reading = PackedReading::new(last_temp.or(temp), last_humidity.or(humidity));
+                return;
+            }
+        }
+        self.stats.live += 1;
+        self.insert(StoredPoint {
+            at_ms: now_ms,
+            reading: PackedReading::new(temp, humidity),
+            replayed: false,
+        });
+    }
+
+    // Replayed readings only extend the history; they never reach the engine,
+    // which must keep acting on live data alone.
+    pub fn ingest_batch(&mut self, batch: &HistoryBatch, now_ms: u64) -> usize {
+        self.stats.sensor_dropped += batch.dropped;
+        let mut accepted = 0;
+        for reading in &batch.readings {
+            if reading.temp.is_none() && reading.humidity.is_none() {
+                continue;
+            }
+            let inserted = self.insert(StoredPoint {
+                at_ms: now_ms.saturating_sub(reading.age_ms),
+                reading: PackedReading::new(reading.temp, reading.humidity),
+                replayed: true,
+            });
+            if inserted {
+                accepted += 1;
+            }
+        }
+        self.stats.replayed += accepted as u64;
+        accepted
+    }
+
+    fn insert(&mut self, point: StoredPoint) -> bool {
+        let full = self.points.len() >= self.stats.capacity;
+        let position = self
+            .points
+            .partition_point(|queued| queued.at_ms <= point.at_ms);
+        if full {
+            if position == 0 {
+                // Older than everything retained; nothing to evict for it.
+                self.stats.evicted += 1;
+                return false;
+            }
+            self.points.pop_front();
+            self.stats.evicted += 1;
+            self.points.insert(position - 1, point);
+        } else {
+            self.points.insert(position, point);
+        }
+        true
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn buffer_replays_oldest_first_in_bounded_batches() {
+        assert_eq!(std::mem::size_of::<StampedReading>(), 16);
+        assert_eq!(std::mem::size_of::<StoredPoint>(), 16);
+
+        let mut buffer = ReadingBuffer::new(4);
+        for i in 0..6_u64 {
+            buffer.push(
+                i * 30_000,
+                Some(DeciDegrees::from_degrees(68 + i as i16)),
+                Some(40.0),
+            );
+        }
+        assert_eq!(buffer.len(), 4);
+
+        let batch = buffer.next_batch(200_000).unwrap();
+        assert_eq!(batch.dropped, 2);
+        assert_eq!(
+            batch.readings.first().unwrap().temp,
+            Some(DeciDegrees::from_degrees(70))
+        );
+        assert_eq!(batch.readings.first().unwrap().age_ms, 140_000);
+
+        // A failed publish leaves the readings in place.
+        assert_eq!(buffer.next_batch(200_000), Some(batch.clone()));
+        buffer.commit(&batch);
+        assert!(buffer.is_empty());
+        assert!(buffer.next_batch(200_000).is_none());
+    }
+
+    #[test]
+    fn store_orders_replayed_readings_behind_live_ones() {
+        let mut store = HistoryStore::new(16);
+        store.record_live(100_000, Some(DeciDegrees::from_degrees(70)), None);
+        store.record_live(100_500, None, Some(41.0));
+
+        let batch = HistoryBatch {
+            readings: vec![
+                BufferedReading {
+                    age_ms: 60_000,
+                    temp: Some(DeciDegrees::from_degrees(68)),
+                    humidity: Some(40.0),
+                },
+                BufferedReading {
+                    age_ms: 30_000,
+                    temp: Some(DeciDegrees::from_degrees(69)),
+                    humidity: Some(40.5),
+                },
+            ],
+            dropped: 1,
+        };
+        assert_eq!(store.ingest_batch(&batch, 110_000), 2);
+
+        let points: Vec<_> = store.points().collect();
+        assert_eq!(points.len(), 3);
+        assert_eq!(points[0].at_ms, 50_000);
+        assert!(points[1].replayed);
+        assert_eq!(points[2].temp, Some(DeciDegrees::from_degrees(70)));
+        assert_eq!(points[2].humidity, Some(41.0));
+        assert!(!points[2].replayed);
+
+        let stats = store.stats();
+        assert_eq!(
+            (stats.live, stats.replayed, stats.sensor_dropped),
+            (1, 2, 1)
+        );
+    }
+
+    #[test]
+    fn full_store_evicts_oldest_and_rejects_stale_replay() {
+        let mut store = HistoryStore::new(2);
+        store.record_live(10_000, Some(DeciDegrees::from_degrees(70)), None);
+        store.record_live(20_000, Some(DeciDegrees::from_degrees(71)), None);
+        store.record_live(30_000, Some(DeciDegrees::from_degrees(72)), None);
+
+        let stale = HistoryBatch {
+            readings: vec![BufferedReading {
+                age_ms: 25_000,
+                temp: Some(DeciDegrees::from_degrees(60)),
+                humidity: None,
+            }],
+            dropped: 0,
+        };
+        assert_eq!(store.ingest_batch(&stale, 30_000), 0);
+        assert_eq!(
+            store.points().map(|point| point.at_ms).collect::<Vec<_>>(),
+            vec![20_000, 30_000]
+        );
+        assert_eq!(store.stats().evicted, 2);
+    }
+
+    #[test]
+    fn batch_json_uses_age_offsets() {
+        let batch = HistoryBatch {
+            readings: vec![BufferedReading {
+                age_ms: 1_500,
+                temp: Some(DeciDegrees::from_tenths(685)),
+                humidity: None,
+            }],
+            dropped: 0,
+        };
+        let json = serde_json::to_string(&batch).unwrap();
+        assert_eq!(
+            json,
+            r#"{"readings":[{"ageMs":1500,"temp":68.5}],"dropped":0}"#
+        );
+        assert_eq!(serde_json::from_str::<HistoryBatch>(&json).unwrap(), batch);
+    }
+}
@@ -0,0 +1,342 @@
+use std::{
+    collections::HashMap,
+    sync::{PoisonError, RwLock},
+};
+
+use serde::Serialize;
+use thiserror::Error;
+
+use crate::{
+    temperature::DeciDegrees,
+    trace::SensorSample,
+    types::{ControllerStatePayload, ThermostatState},
+    wire::{self, WireError},
+};
+
+// Two layouts identify a device. A stock controller and sensor publish
+// thermostat/controller/state and show up as device "thermostat"; devices
+// given their own prefix publish <device-id>/controller/state the same way.
+// Host controller zones publish <prefix>/zones/<zone-id>/controller/state and
+// are keyed by prefix and zone together, so a "den" on two controllers stays
+// two devices.
+pub const FLEET_TOPIC_FILTERS: [&str; 8] = [
+    "+/controller/state",
+    "+/controller/state/bin",
+    "+/sensor/temperature",
+    "+/sensor/humidity",
+    "+/zones/+/controller/state",
+    "+/zones/+/controller/state/bin",
+    "+/zones/+/sensor/temperature",
+    "+/zones/+/sensor/humidity",
+];
+
+#[derive(Debug, Clone, PartialEq)]
+pub enum FleetUpdate {
+    State(ControllerStatePayload),
+    Temperature(DeciDegrees),
+    Humidity(f32),
+}
+
+#[derive(Debug, Clone, PartialEq, Error)]
+pub enum IngestError {
+    #[error("topic is not a fleet topic")]
+    UnknownTopic,
+    #[error("invalid reading")]
+    InvalidReading,
+    #[error("invalid state json: {0}")]
+    Json(String),
+    #[error("invalid binary state: {0}")]
+    Wire(#[from] WireError),
+}
+
+// Returns the device key and the single-device topic: <prefix>/<rest> keys
+// as <prefix>, <prefix>/zones/<zone-id>/<rest> as <prefix>/zones/<zone-id>.
+pub fn split_device_topic(topic: &str) -> Option<(&str, &str)> {
+    let (prefix, rest) = topic.split_once('/')?;
+    if prefix.is_empty() {
+        return None;
+    }
+    let zone = rest
+        .strip_prefix("zones/")
+        .and_then(|zone| zone.split_once('/'));
+    match zone {
+        Some(("", _)) => None,
+        Some((zone_id, rest)) => {
+            let key_len = prefix.len() + "/zones/".len() + zone_id.len();
+            Some((&topic[..key_len], rest))
+        }
+        None => Some((prefix, rest)),
+    }
+}
+
+pub fn decode_fleet_message<'a>(
+    topic: &'a str,
+    payload: &[u8],
+) -> Result<(&'a str, FleetUpdate), IngestError> {
+    let (device_id, rest) = split_device_topic(topic).ok_or(IngestError::UnknownTopic)?;
+    let update = match rest {
+        "controller/state" => FleetUpdate::State(
+            serde_json::from_slice(payload).map_err(|err| IngestError::Json(err.to_string()))?,
+        ),
+        "controller/state/bin" => FleetUpdate::State(wire::decode_state(payload)?),
+        "sensor/temperature" => {
+            let temp = parse_reading(payload, -40.0..=150.0)?;
+            FleetUpdate::Temperature(DeciDegrees::from_f32(temp))
+        }
+        "sensor/humidity" => FleetUpdate::Humidity(parse_reading(payload, 0.0..=100.0)?),
+        _ => return Err(IngestError::UnknownTopic),
+    };
+    Ok((device_id, update))
+}
+
+fn parse_reading(payload: &[u8], range: std::ops::RangeInclusive<f32>) -> Result<f32, IngestError> {
+    std::str::from_utf8(payload)
+        .ok()
+        .and_then(SensorSample::parse)
+        .map(|sample| sample.value)
+        .filter(|value| value.is_finite() && range.contains(value))
+        .ok_or(IngestError::InvalidReading)
+}
+
+// FNV-1a: stable across runs, so a device always lands on the same worker.
+pub fn shard_for(device_id: &str, shards: usize) -> usize {
+    let hash = device_id
+        .bytes()
+        .fold(0xcbf2_9ce4_8422_2325_u64, |hash, byte| {
+            (hash ^ u64::from(byte)).wrapping_mul(0x0100_0000_01b3)
+        });
+    (hash % shards.max(1) as u64) as usize
+}
+
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct DeviceSnapshot {
+    pub state: Option<ControllerStatePayload>,
+    #[serde(rename = "sensorTempF")]
+    pub sensor_temp_f: Option<DeciDegrees>,
+    #[serde(rename = "sensorHumidity")]
+    pub sensor_humidity: Option<f32>,
+    pub messages: u64,
+    #[serde(rename = "lastSeenMs")]
+    pub last_seen_ms: u64,
+}
+
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct FleetSummary {
+    pub devices: usize,
+    #[serde(rename = "reportingState")]
+    pub reporting_state: usize,
+    #[serde(rename = "fireplacesOn")]
+    pub fireplaces_on: usize,
+    pub heating: usize,
+    pub cooldown: usize,
+    #[serde(rename = "avgTempF")]
+    pub avg_temp_f: Option<f32>,
+    pub messages: u64,
+}
+
+// Latest state per device, split into independently locked shards. Each
+// ingest worker owns the devices that hash to its shard, so writers never
+// contend with each other; readers only block the shard they are reading.
+#[derive(Debug)]
+pub struct FleetStore {
+    shards: Vec<RwLock<HashMap<String, DeviceSnapshot>>>,
+}
+
+impl FleetStore {
+    pub fn new(shards: usize) -> Self {
+        Self {
+            shards: (0..shards.max(1))
+                .map(|_| RwLock::new(HashMap::new()))
+                .collect(),
+        }
+    }
+
+    pub fn shard_count(&self) -> usize {
+        self.shards.len()
+    }
+
+    pub fn apply(&self, device_id: &str, update: FleetUpdate, now_ms: u64) {
+        let shard = &self.shards[shard_for(device_id, self.shards.len())];
+        let mut devices = shard.write().unwrap_or_else(PoisonError::into_inner);
+        // Only the first message from a device allocates its key.
+        let device = match devices.get_mut(device_id) {
+            Some(device) => device,
+            None => devices.entry(device_id.to_string()).or_default(),
+        };
+        device.messages += 1;
+        device.last_seen_ms = now_ms;
+        match update {
+            FleetUpdate::State(state) => device.state = Some(state),
+            FleetUpdate::Temperature(temp_f) => device.sensor_temp_f = Some(temp_f),
+            FleetUpdate::Humidity(humidity) => device.sensor_humidity = Some(humidity),
+        }
+    }
+
+    pub fn get(&self, device_id: &str) -> Option<DeviceSnapshot> {
+        let shard = &self.shards[shard_for(device_id, self.shards.len())];
+        let devices = shard.read().unwrap_or_else(PoisonError::into_inner);
+        devices.get(device_id).cloned()
+    }
+
+    pub fn devices(&self) -> Vec<(String, DeviceSnapshot)> {
+        let mut devices: Vec<(String, DeviceSnapshot)> = self
+            .shards
+            .iter()
+            .flat_map(|shard| {
+                let devices = shard.read().unwrap_or_else(PoisonError::into_inner);
+                devices
+                    .iter()
+                    .map(|(id, device)| (id.clone(), device.clone()))
+                    .collect::<Vec<_>>()
+            })
+            .collect();
+        devices.sort_by(|a, b| a.0.cmp(&b.0));
+        devices
+    }
+
+    pub fn summary(&self) -> FleetSummary {
+        let mut summary = FleetSummary::default();
+        let mut temp_sum_tenths = 0_i64;
+        for shard in &self.shards {
+            let devices = shard.read().unwrap_or_else(PoisonError::into_inner);
+            summary.devices += devices.len();
+            for device in devices.values() {
+                summary.messages += device.messages;
+                let Some(state) = &device.state else {
+                    continue;
+                };
+                summary.reporting_state += 1;
+                summary.fireplaces_on += usize::from(state.fireplace);
+                summary.heating += usize::from(state.state == ThermostatState::Heating);
+                summary.cooldown += usize::from(state.state == ThermostatState::Cooldown);
+                temp_sum_tenths += i64::from(state.temp.tenths());
+            }
+        }
+        if summary.reporting_state > 0 {
+            let mean_tenths = temp_sum_tenths as f64 / summary.reporting_state as f64;
+            summary.avg_temp_f = Some((mean_tenths / 10.0) as f32);
+        }
+        summary
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::types::ThermostatMode;
+
+    fn state(temp: f32, fireplace: bool) -> ControllerStatePayload {
+        ControllerStatePayload {
+            temp: DeciDegrees::from_f32(temp),
+            humidity: 40.0,
+            target: DeciDegrees::from_degrees(70),
+            mode: ThermostatMode::Heat,
+            state: if fireplace {
+                ThermostatState::Heating
+            } else {
+                ThermostatState::Satisfied
+            },
+            fireplace,
+            hold_active: false,
+            hold_remaining_min: 0,
+            in_cooldown: false,
+            cooldown_remaining_min: 0,
+            runtime_min: 0,
+        }
+    }
+
+    #[test]
+    fn decodes_json_binary_and_readings_per_device() {
+        let json = serde_json::to_vec(&state(68.0, true)).unwrap();
+        let mut binary = Vec::new();
+        wire::encode_state(&state(71.0, false), &mut binary);
+
+        assert_eq!(
+            decode_fleet_message("den/controller/state", &json),
+            Ok(("den", FleetUpdate::State(state(68.0, true))))
+        );
+        assert_eq!(
+            decode_fleet_message("attic/controller/state/bin", &binary),
+            Ok(("attic", FleetUpdate::State(state(71.0, false))))
+        );
+        assert_eq!(
+            decode_fleet_message("den/sensor/temperature", b"67.5"),
+            Ok((
+                "den",
+                FleetUpdate::Temperature(DeciDegrees::from_tenths(675))
+            ))
+        );
+        assert_eq!(
+            decode_fleet_message("den/sensor/temperature", b"67.5;seq=9;ts=1718000000000"),
+            Ok((
+                "den",
+                FleetUpdate::Temperature(DeciDegrees::from_tenths(675))
+            ))
+        );
+        assert_eq!(
+            decode_fleet_message("den/sensor/humidity", b"140"),
+            Err(IngestError::InvalidReading)
+        );
+        assert_eq!(
+            decode_fleet_message("den/controller/diagnostics", b"{}"),
+            Err(IngestError::UnknownTopic)
+        );
+    }
+
+    #[test]
+    fn stock_and_zone_topics_map_to_devices() {
+        let json = serde_json::to_vec(&state(68.0, true)).unwrap();
+        assert_eq!(
+            decode_fleet_message("thermostat/controller/state", &json),
+            Ok(("thermostat", FleetUpdate::State(state(68.0, true))))
+        );
+        assert_eq!(
+            decode_fleet_message("thermostat/zones/den/controller/state", &json),
+            Ok((
+                "thermostat/zones/den",
+                FleetUpdate::State(state(68.0, true))
+            ))
+        );
+        assert_eq!(
+            decode_fleet_message("basement/zones/den/sensor/humidity", b"41"),
+            Ok(("basement/zones/den", FleetUpdate::Humidity(41.0)))
+        );
+        assert_eq!(
+            decode_fleet_message("thermostat/zones//controller/state", &json),
+            Err(IngestError::UnknownTopic)
+        );
+        assert_eq!(
+            decode_fleet_message("thermostat/zones/den/cmnd/thermostat/target", b"70"),
+            Err(IngestError::UnknownTopic)
+        );
+    }
+
+    #[test]
+    fn store_keeps_latest_state_and_summarizes() {
+        let store = FleetStore::new(4);
+        store.apply("den", FleetUpdate::State(state(66.0, false)), 1);
+        store.apply("den", FleetUpdate::State(state(68.0, true)), 2);
+        store.apply(
+            "den",
+            FleetUpdate::Temperature(DeciDegrees::from_tenths(682)),
+            3,
+        );
+        store.apply("attic", FleetUpdate::State(state(72.0, false)), 4);
+        store.apply("garage", FleetUpdate::Humidity(55.0), 5);
+
+        let den = store.get("den").unwrap();
+        assert_eq!(den.messages, 3);
+        assert_eq!(den.last_seen_ms, 3);
+        assert_eq!(den.state, Some(state(68.0, true)));
+
+        let summary = store.summary();
+        assert_eq!(summary.devices, 3);
+        assert_eq!(summary.reporting_state, 2);
+        assert_eq!(summary.fireplaces_on, 1);
+        assert_eq!(summary.avg_temp_f, Some(70.0));
+        assert_eq!(summary.messages, 5);
+
+        let ids: Vec<String> = store.devices().into_iter().map(|(id, _)| id).collect();
+        assert_eq!(ids, ["attic", "den", "garage"]);
+    }
+}
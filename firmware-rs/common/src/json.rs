@@ -0,0 +1,891 @@
+// Allocation-free JSON encoder for the API types. The output is byte for byte
+// what `serde_json::to_vec` produces: compact, integers through itoa, floats
+// through ryu (non-finite as null) and the same string escapes. The bytes go to
+// a caller-provided sink, so an ESP handler can encode into a stack buffer or
+// the connection instead of a heap `Vec`.
+use core::fmt;
+
+use serde::ser::{self, Serialize};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum JsonError {
+    BufferFull,
+    // The chunk writer of a `ChunkedSink` failed; the caller keeps the cause.
+    Write,
+    KeyMustBeString,
+    // Raised by a `Serialize` impl; the message is dropped to avoid allocating.
+    Custom,
+}
+
+impl fmt::Display for JsonError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(match self {
+            Self::BufferFull => "json output does not fit the buffer",
+            Self::Write => "json chunk could not be written",
+            Self::KeyMustBeString => "json map key must be a string",
+            Self::Custom => "json value failed to serialize",
+        })
+    }
+}
+
+impl core::error::Error for JsonError {}
+
+impl ser::Error for JsonError {
+    fn custom<T: fmt::Display>(_msg: T) -> Self {
+        Self::Custom
+    }
+}
+
+pub trait JsonSink {
+    fn write(&mut self, bytes: &[u8]) -> Result<(), JsonError>;
+}
+
+pub struct SliceSink<'a> {
+    buf: &'a mut [u8],
+    len: usize,
+}
+
+impl<'a> SliceSink<'a> {
+    pub fn new(buf: &'a mut [u8]) -> Self {
+        Self { buf, len: 0 }
+    }
+
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+}
+
+impl JsonSink for SliceSink<'_> {
+    fn write(&mut self, bytes: &[u8]) -> Result<(), JsonError> {
+        let end = self.len + bytes.len();
+        let dest = self
+            .buf
+            .get_mut(self.len..end)
+            .ok_or(JsonError::BufferFull)?;
+        dest.copy_from_slice(bytes);
+        self.len = end;
+        Ok(())
+    }
+}
+
+// Collects output in `buf` and hands it to `write` one full buffer at a time,
+// so a response of any size streams through a fixed buffer. Call `finish` to
+// flush the last partial chunk.
+pub struct ChunkedSink<'a, W> {
+    buf: &'a mut [u8],
+    len: usize,
+    write: W,
+}
+
+impl<'a, W: FnMut(&[u8]) -> Result<(), JsonError>> ChunkedSink<'a, W> {
+    pub fn new(buf: &'a mut [u8], write: W) -> Self {
+        assert!(!buf.is_empty(), "chunk buffer must not be empty");
+        Self { buf, len: 0, write }
+    }
+
+    pub fn finish(mut self) -> Result<(), JsonError> {
+        if self.len > 0 {
+            (self.write)(&self.buf[..self.len])?;
+            self.len = 0;
+        }
+        Ok(())
+    }
+}
+
+impl<W: FnMut(&[u8]) -> Result<(), JsonError>> JsonSink for ChunkedSink<'_, W> {
+    fn write(&mut self, mut bytes: &[u8]) -> Result<(), JsonError> {
+        while !bytes.is_empty() {
+            let take = bytes.len().min(self.buf.len() - self.len);
+            self.buf[self.len..self.len + take].copy_from_slice(&bytes[..take]);
+            self.len += take;
+            bytes = &bytes[take..];
+            if self.len == self.buf.len() {
+                (self.write)(self.buf)?;
+                self.len = 0;
+            }
+        }
+        Ok(())
+    }
+}
+
+// Encodes `value` into the front of `buf` and returns the encoded length.
+pub fn to_slice<T: Serialize + ?Sized>(value: &T, buf: &mut [u8]) -> Result<usize, JsonError> {
+    let mut sink = SliceSink::new(buf);
+    to_sink(value, &mut sink)?;
+    Ok(sink.len())
+}
+
+pub fn to_sink<T: Serialize + ?Sized, S: JsonSink>(
+    value: &T,
+    sink: &mut S,
+) -> Result<(), JsonError> {
+    value.serialize(&mut Serializer { sink })
+}
+
+pub struct Serializer<'s, S> {
+    sink: &'s mut S,
+}
+
+impl<S: JsonSink> Serializer<'_, S> {
+    fn write_bool(&mut self, value: bool) -> Result<(), JsonError> {
+        self.sink.write(if value { b"true" } else { b"false" })
+    }
+
+    fn write_integer<I: itoa::Integer>(&mut self, value: I) -> Result<(), JsonError> {
+        self.sink
+            .write(itoa::Buffer::new().format(value).as_bytes())
+    }
+
+    fn write_float<F: ryu::Float>(&mut self, value: F, finite: bool) -> Result<(), JsonError> {
+        if finite {
+            self.sink
+                .write(ryu::Buffer::new().format_finite(value).as_bytes())
+        } else {
+            self.sink.write(b"null")
+        }
+    }
+
+    fn write_str(&mut self, value: &str) -> Result<(), JsonError> {
+        self.sink.write(b"\"")?;
+        self.write_escaped(value)?;
+        self.sink.write(b"\"")
+    }
+
+    fn write_escaped(&mut self, value: &str) -> Result<(), JsonError> {
+        let bytes = value.as_bytes();
+        let mut start = 0;
+        for (index, &byte) in bytes.iter().enumerate() {
+            let escape: &[u8] = match byte {
+                b'"' => b"\\\"",
+                b'\\' => b"\\\\",
+                b'\n' => b"\\n",
+                b'\r' => b"\\r",
+                b'\t' => b"\\t",
+                0x08 => b"\\b",
+                0x0c => b"\\f",
+                0x00..=0x1f => {
+                    const HEX: &[u8; 16] = b"0123456789abcdef";
+                    &[
+                        b'\\',
+                        b'u',
+                        b'0',
+                        b'0',
+                        HEX[(byte >> 4) as usize],
+                        HEX[(byte & 0x0f) as usize],
+                    ]
+                }
+                _ => continue,
+            };
+            self.sink.write(&bytes[start..index])?;
+            self.sink.write(escape)?;
+            start = index + 1;
+        }
+        self.sink.write(&bytes[start..])
+    }
+
+    fn write_quoted<F>(&mut self, write: F) -> Result<(), JsonError>
+    where
+        F: FnOnce(&mut Self) -> Result<(), JsonError>,
+    {
+        self.sink.write(b"\"")?;
+        write(self)?;
+        self.sink.write(b"\"")
+    }
+
+    fn write_display<T: fmt::Display + ?Sized>(&mut self, value: &T) -> Result<(), JsonError> {
+        // Escapes each fragment as `Display` produces it, so no String is built.
+        struct Escaped<'a, 's, S> {
+            ser: &'a mut Serializer<'s, S>,
+            error: Option<JsonError>,
+        }
+
+        impl<S: JsonSink> fmt::Write for Escaped<'_, '_, S> {
+            fn write_str(&mut self, fragment: &str) -> fmt::Result {
+                self.ser.write_escaped(fragment).map_err(|err| {
+                    self.error = Some(err);
+                    fmt::Error
+                })
+            }
+        }
+
+        let mut escaped = Escaped {
+            ser: self,
+            error: None,
+        };
+        match fmt::write(&mut escaped, format_args!("{value}")) {
+            Ok(()) => Ok(()),
+            Err(_) => Err(escaped.error.unwrap_or(JsonError::Custom)),
+        }
+    }
+
+    fn begin_variant(&mut self, variant: &str) -> Result<(), JsonError> {
+        self.sink.write(b"{")?;
+        self.write_str(variant)?;
+        self.sink.write(b":")
+    }
+}
+
+pub struct Compound<'a, 's, S> {
+    ser: &'a mut Serializer<'s, S>,
+    first: bool,
+    // Closes the `{"variant":` wrapper of tuple and struct variants.
+    variant: bool,
+}
+
+impl<'a, 's, S: JsonSink> Compound<'a, 's, S> {
+    fn open(
+        ser: &'a mut Serializer<'s, S>,
+        bracket: &[u8],
+        variant: bool,
+    ) -> Result<Self, JsonError> {
+        ser.sink.write(bracket)?;
+        Ok(Self {
+            ser,
+            first: true,
+            variant,
+        })
+    }
+
+    fn separator(&mut self) -> Result<(), JsonError> {
+        if !self.first {
+            self.ser.sink.write(b",")?;
+        }
+        self.first = false;
+        Ok(())
+    }
+
+    fn close(self, bracket: &[u8]) -> Result<(), JsonError> {
+        self.ser.sink.write(bracket)?;
+        if self.variant {
+            self.ser.sink.write(b"}")?;
+        }
+        Ok(())
+    }
+
+    fn field<T: Serialize + ?Sized>(&mut self, key: &str, value: &T) -> Result<(), JsonError> {
+        self.separator()?;
+        self.ser.write_str(key)?;
+        self.ser.sink.write(b":")?;
+        value.serialize(&mut *self.ser)
+    }
+}
+
+impl<'a, 's, S: JsonSink> ser::Serializer for &'a mut Serializer<'s, S> {
+    type Ok = ();
+    type Error = JsonError;
+    type SerializeSeq = Compound<'a, 's, S>;
+    type SerializeTuple = Compound<'a, 's, S>;
+    type SerializeTupleStruct = Compound<'a, 's, S>;
+    type SerializeTupleVariant = Compound<'a, 's, S>;
+    type SerializeMap = Compound<'a, 's, S>;
+    type SerializeStruct = Compound<'a, 's, S>;
+    type SerializeStructVariant = Compound<'a, 's, S>;
+
+    fn serialize_bool(self, value: bool) -> Result<(), JsonError> {
+        self.write_bool(value)
+    }
+
+    fn serialize_i8(self, value: i8) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_i16(self, value: i16) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_i32(self, value: i32) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_i64(self, value: i64) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_i128(self, value: i128) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_u8(self, value: u8) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_u16(self, value: u16) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_u32(self, value: u32) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_u64(self, value: u64) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_u128(self, value: u128) -> Result<(), JsonError> {
+        self.write_integer(value)
+    }
+
+    fn serialize_f32(self, value: f32) -> Result<(), JsonError> {
+        self.write_float(value, value.is_finite())
+    }
+
+    fn serialize_f64(self, value: f64) -> Result<(), JsonError> {
+        self.write_float(value, value.is_finite())
+    }
+
+    fn serialize_char(self, value: char) -> Result<(), JsonError> {
+        self.write_str(value.encode_utf8(&mut [0; 4]))
+    }
+
+    fn serialize_str(self, value: &str) -> Result<(), JsonError> {
+        self.write_str(value)
+    }
+
+    fn serialize_bytes(self, value: &[u8]) -> Result<(), JsonError> {
+        use ser::SerializeSeq;
+        let mut seq = self.serialize_seq(Some(value.len()))?;
+        for byte in value {
+            seq.serialize_element(byte)?;
+        }
+        seq.end()
+    }
+
+    fn serialize_none(self) -> Result<(), JsonError> {
+        self.sink.write(b"null")
+    }
+
+    fn serialize_some<T: Serialize + ?Sized>(self, value: &T) -> Result<(), JsonError> {
+        value.serialize(self)
+    }
+
+    fn serialize_unit(self) -> Result<(), JsonError> {
+        self.sink.write(b"null")
+    }
+
+    fn serialize_unit_struct(self, _name: &'static str) -> Result<(), JsonError> {
+        self.sink.write(b"null")
+    }
+
+    fn serialize_unit_variant(
+        self,
+        _name: &'static str,
+        _index: u32,
+        variant: &'static str,
+    ) -> Result<(), JsonError> {
+        self.write_str(variant)
+    }
+
+    fn serialize_newtype_struct<T: Serialize + ?Sized>(
+        self,
+        _name: &'static str,
+        value: &T,
+    ) -> Result<(), JsonError> {
+        value.serialize(self)
+    }
+
+    fn serialize_newtype_variant<T: Serialize + ?Sized>(
+        self,
+        _name: &'static str,
+        _index: u32,
+        variant: &'static str,
+        value: &T,
+    ) -> Result<(), JsonError> {
+        self.begin_variant(variant)?;
+        value.serialize(&mut *self)?;
+        self.sink.write(b"}")
+    }
+
+    fn serialize_seq(self, _len: Option<usize>) -> Result<Self::SerializeSeq, JsonError> {
+        Compound::open(self, b"[", false)
+    }
+
+    fn serialize_tuple(self, len: usize) -> Result<Self::SerializeTuple, JsonError> {
+        self.serialize_seq(Some(len))
+    }
+
+    fn serialize_tuple_struct(
+        self,
+        _name: &'static str,
+        len: usize,
+    ) -> Result<Self::SerializeTupleStruct, JsonError> {
+        self.serialize_seq(Some(len))
+    }
+
+    fn serialize_tuple_variant(
+        self,
+        _name: &'static str,
+        _index: u32,
+        variant: &'static str,
+        _len: usize,
+    ) -> Result<Self::SerializeTupleVariant, JsonError> {
+        self.begin_variant(variant)?;
+        Compound::open(self, b"[", true)
+    }
+
+    fn serialize_map(self, _len: Option<usize>) -> Result<Self::SerializeMap, JsonError> {
+        Compound::open(self, b"{", false)
+    }
+
+    fn serialize_struct(
+        self,
+        _name: &'static str,
+        _len: usize,
+    ) -> Result<Self::SerializeStruct, JsonError> {
+        Compound::open(self, b"{", false)
+    }
+
+    fn serialize_struct_variant(
+        self,
+        _name: &'static str,
+        _index: u32,
+        variant: &'static str,
+        _len: usize,
+    ) -> Result<Self::SerializeStructVariant, JsonError> {
+        self.begin_variant(variant)?;
+        Compound::open(self, b"{", true)
+    }
+
+    fn collect_str<T: fmt::Display + ?Sized>(self, value: &T) -> Result<(), JsonError> {
+        self.write_quoted(|ser| ser.write_display(value))
+    }
+}
+
+impl<S: JsonSink> ser::SerializeSeq for Compound<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+
+    fn serialize_element<T: Serialize + ?Sized>(&mut self, value: &T) -> Result<(), JsonError> {
+        self.separator()?;
+        value.serialize(&mut *self.ser)
+    }
+
+    fn end(self) -> Result<(), JsonError> {
+        self.close(b"]")
+    }
+}
+
+impl<S: JsonSink> ser::SerializeTuple for Compound<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+
+    fn serialize_element<T: Serialize + ?Sized>(&mut self, value: &T) -> Result<(), JsonError> {
+        ser::SerializeSeq::serialize_element(self, value)
+    }
+
+    fn end(self) -> Result<(), JsonError> {
+        self.close(b"]")
+    }
+}
+
+impl<S: JsonSink> ser::SerializeTupleStruct for Compound<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+
+    fn serialize_field<T: Serialize + ?Sized>(&mut self, value: &T) -> Result<(), JsonError> {
+        ser::SerializeSeq::serialize_element(self, value)
+    }
+
+    fn end(self) -> Result<(), JsonError> {
+        self.close(b"]")
+    }
+}
+
+impl<S: JsonSink> ser::SerializeTupleVariant for Compound<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+
+    fn serialize_field<T: Serialize + ?Sized>(&mut self, value: &T) -> Result<(), JsonError> {
+        ser::SerializeSeq::serialize_element(self, value)
+    }
+
+    fn end(self) -> Result<(), JsonError> {
+        self.close(b"]")
+    }
+}
+
+impl<S: JsonSink> ser::SerializeMap for Compound<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+
+    fn serialize_key<T: Serialize + ?Sized>(&mut self, key: &T) -> Result<(), JsonError> {
+        self.separator()?;
+        key.serialize(MapKeySerializer {
+            ser: &mut *self.ser,
+        })
+    }
+
+    fn serialize_value<T: Serialize + ?Sized>(&mut self, value: &T) -> Result<(), JsonError> {
+        self.ser.sink.write(b":")?;
+        value.serialize(&mut *self.ser)
+    }
+
+    fn end(self) -> Result<(), JsonError> {
+        self.close(b"}")
+    }
+}
+
+impl<S: JsonSink> ser::SerializeStruct for Compound<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+
+    fn serialize_field<T: Serialize + ?Sized>(
+        &mut self,
+        key: &'static str,
+        value: &T,
+    ) -> Result<(), JsonError> {
+        self.field(key, value)
+    }
+
+    fn end(self) -> Result<(), JsonError> {
+        self.close(b"}")
+    }
+}
+
+impl<S: JsonSink> ser::SerializeStructVariant for Compound<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+
+    fn serialize_field<T: Serialize + ?Sized>(
+        &mut self,
+        key: &'static str,
+        value: &T,
+    ) -> Result<(), JsonError> {
+        self.field(key, value)
+    }
+
+    fn end(self) -> Result<(), JsonError> {
+        self.close(b"}")
+    }
+}
+
+// Map keys follow serde_json: strings as they are, numbers and booleans quoted,
+// anything else rejected.
+struct MapKeySerializer<'a, 's, S> {
+    ser: &'a mut Serializer<'s, S>,
+}
+
+impl<S: JsonSink> ser::Serializer for MapKeySerializer<'_, '_, S> {
+    type Ok = ();
+    type Error = JsonError;
+    type SerializeSeq = ser::Impossible<(), JsonError>;
+    type SerializeTuple = ser::Impossible<(), JsonError>;
+    type SerializeTupleStruct = ser::Impossible<(), JsonError>;
+    type SerializeTupleVariant = ser::Impossible<(), JsonError>;
+    type SerializeMap = ser::Impossible<(), JsonError>;
+    type SerializeStruct = ser::Impossible<(), JsonError>;
+    type SerializeStructVariant = ser::Impossible<(), JsonError>;
+
+    fn serialize_bool(self, value: bool) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_bool(value))
+    }
+
+    fn serialize_i8(self, value: i8) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_i16(self, value: i16) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_i32(self, value: i32) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_i64(self, value: i64) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_i128(self, value: i128) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_u8(self, value: u8) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_u16(self, value: u16) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_u32(self, value: u32) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_u64(self, value: u64) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_u128(self, value: u128) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_integer(value))
+    }
+
+    fn serialize_f32(self, value: f32) -> Result<(), JsonError> {
+        if !value.is_finite() {
+            return Err(JsonError::KeyMustBeString);
+        }
+        self.ser.write_quoted(|ser| ser.write_float(value, true))
+    }
+
+    fn serialize_f64(self, value: f64) -> Result<(), JsonError> {
+        if !value.is_finite() {
+            return Err(JsonError::KeyMustBeString);
+        }
+        self.ser.write_quoted(|ser| ser.write_float(value, true))
+    }
+
+    fn serialize_char(self, value: char) -> Result<(), JsonError> {
+        self.ser.write_str(value.encode_utf8(&mut [0; 4]))
+    }
+
+    fn serialize_str(self, value: &str) -> Result<(), JsonError> {
+        self.ser.write_str(value)
+    }
+
+    fn serialize_bytes(self, _value: &[u8]) -> Result<(), JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_none(self) -> Result<(), JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_some<T: Serialize + ?Sized>(self, value: &T) -> Result<(), JsonError> {
+        value.serialize(self)
+    }
+
+    fn serialize_unit(self) -> Result<(), JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_unit_struct(self, _name: &'static str) -> Result<(), JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_unit_variant(
+        self,
+        _name: &'static str,
+        _index: u32,
+        variant: &'static str,
+    ) -> Result<(), JsonError> {
+        self.ser.write_str(variant)
+    }
+
+    fn serialize_newtype_struct<T: Serialize + ?Sized>(
+        self,
+        _name: &'static str,
+        value: &T,
+    ) -> Result<(), JsonError> {
+        value.serialize(self)
+    }
+
+    fn serialize_newtype_variant<T: Serialize + ?Sized>(
+        self,
+        _name: &'static str,
+        _index: u32,
+        _variant: &'static str,
+        _value: &T,
+    ) -> Result<(), JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_seq(self, _len: Option<usize>) -> Result<Self::SerializeSeq, JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_tuple(self, _len: usize) -> Result<Self::SerializeTuple, JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_tuple_struct(
+        self,
+        _name: &'static str,
+        _len: usize,
+    ) -> Result<Self::SerializeTupleStruct, JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_tuple_variant(
+        self,
+        _name: &'static str,
+        _index: u32,
+        _variant: &'static str,
+        _len: usize,
+    ) -> Result<Self::SerializeTupleVariant, JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_map(self, _len: Option<usize>) -> Result<Self::SerializeMap, JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_struct(
+        self,
+        _name: &'static str,
+        _len: usize,
+    ) -> Result<Self::SerializeStruct, JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn serialize_struct_variant(
+        self,
+        _name: &'static str,
+        _index: u32,
+        _variant: &'static str,
+        _len: usize,
+    ) -> Result<Self::SerializeStructVariant, JsonError> {
+        Err(JsonError::KeyMustBeString)
+    }
+
+    fn collect_str<T: fmt::Display + ?Sized>(self, value: &T) -> Result<(), JsonError> {
+        self.ser.write_quoted(|ser| ser.write_display(value))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{
+        ControllerStatus, DeciDegrees, PersistedSettings, ThermostatConfig, ThermostatEngine,
+    };
+    use serde::Serialize;
+    use std::{collections::BTreeMap, string::String, vec, vec::Vec};
+
+    fn encode<T: Serialize>(value: &T) -> Vec<u8> {
+        let mut buf = [0_u8; 2048];
+        let len = to_slice(value, &mut buf).expect("fits");
+        buf[..len].to_vec()
+    }
+
+    fn assert_matches_serde_json<T: Serialize>(value: &T) {
+        let expected = serde_json::to_vec(value).unwrap();
+        assert_eq!(
+            String::from_utf8(encode(value)).unwrap(),
+            String::from_utf8(expected).unwrap()
+        );
+    }
+
+    fn status() -> ControllerStatus {
+        let mut engine =
+            ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
+        engine.update_sensor_data(DeciDegrees::from_f32(68.4), 41.25, 1_000);
+        engine.status(5_000, true, Some(1_700_000_000), true, "America/New_York")
+    }
+
+    #[derive(Serialize)]
+    enum Variant {
+        Unit,
+        Newtype(u8),
+        Tuple(i16, bool),
+        Struct { name: &'static str },
+    }
+
+    #[derive(Serialize)]
+    struct Diagnostics {
+        #[serde(rename = "lastSendMs")]
+        last_send_ms: Option<u64>,
+        #[serde(rename = "lastError")]
+        last_error: Option<String>,
+        #[serde(rename = "staticIp")]
+        static_ip: Option<[u8; 4]>,
+        #[serde(skip_serializing_if = "Option::is_none")]
+        skipped: Option<u32>,
+        ratio: f64,
+        readings: Vec<f32>,
+        pair: (i64, char),
+        variants: Vec<Variant>,
+        labels: BTreeMap<u16, &'static str>,
+        raw: &'static [u8],
+    }
+
+    #[test]
+    fn api_types_match_serde_json() {
+        let status = status();
+        assert_matches_serde_json(&status);
+
+        let engine =
+            ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
+        assert_matches_serde_json(&engine.state_payload(0));
+    }
+
+    #[test]
+    fn edge_cases_match_serde_json() {
+        assert_matches_serde_json(&Diagnostics {
+            last_send_ms: Some(u64::MAX),
+            last_error: Some(String::from("tab\t \"quote\" back\\slash \u{1} \u{7f} é ☃")),
+            static_ip: None,
+            skipped: None,
+            ratio: 1e-7,
+            readings: vec![0.0, -0.5, 1.0 / 3.0, f32::NAN, f32::INFINITY, 1e21],
+            pair: (i64::MIN, '\n'),
+            variants: vec![
+                Variant::Unit,
+                Variant::Newtype(7),
+                Variant::Tuple(-3, true),
+                Variant::Struct { name: "x" },
+            ],
+            labels: [(1, "one"), (20, "twenty")].into_iter().collect(),
+            raw: &[0, 255],
+        });
+        assert_matches_serde_json(&Vec::<u8>::new());
+        assert_matches_serde_json(&());
+    }
+
+    #[test]
+    fn reports_a_full_buffer() {
+        let status = status();
+        let needed = encode(&status).len();
+
+        let mut buf = vec![0_u8; needed];
+        assert_eq!(to_slice(&status, &mut buf), Ok(needed));
+        assert_eq!(
+            to_slice(&status, &mut buf[..needed - 1]),
+            Err(JsonError::BufferFull)
+        );
+    }
+
+    #[test]
+    fn chunked_output_matches_serde_json_in_full_chunks() {
+        let status = status();
+        let mut chunks: Vec<Vec<u8>> = Vec::new();
+        let mut buf = [0_u8; 64];
+        let mut sink = ChunkedSink::new(&mut buf, |chunk: &[u8]| {
+            chunks.push(chunk.to_vec());
+            Ok(())
+        });
+        to_sink(&status, &mut sink).unwrap();
+        sink.finish().unwrap();
+
+        let (last, full) = chunks.split_last().unwrap();
+        assert!(full.iter().all(|chunk| chunk.len() == 64));
+        assert!(!last.is_empty() && last.len() <= 64);
+        assert_eq!(chunks.concat(), serde_json::to_vec(&status).unwrap());
+    }
+
+    #[test]
+    fn chunked_write_errors_stop_encoding() {
+        let mut calls = 0;
+        let mut buf = [0_u8; 8];
+        let result = to_sink(
+            &status(),
+            &mut ChunkedSink::new(&mut buf, |_: &[u8]| {
+                calls += 1;
+                Err(JsonError::Write)
+            }),
+        );
+        assert_eq!(result, Err(JsonError::Write));
+        assert_eq!(calls, 1);
+    }
+
+    #[test]
+    fn rejects_keys_that_are_not_strings() {
+        let map: BTreeMap<Vec<u8>, u8> = [(vec![1], 1)].into_iter().collect();
+        assert_eq!(
+            to_slice(&map, &mut [0; 32]),
+            Err(JsonError::KeyMustBeString)
+        );
+    }
+}
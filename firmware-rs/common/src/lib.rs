@@ -1,11 +1,111 @@
+#![cfg_attr(not(feature = "std"), no_std)]
+
+#[cfg(not(any(feature = "std", feature = "no_std")))]
+compile_error!("enable either the `std` feature or the `no_std` feature");
+
+// Unit tests use the standard library even when the crate is built without it.
+#[cfg(all(test, not(feature = "std")))]
+#[macro_use]
+extern crate std;
+
+#[cfg(feature = "std")]
+pub mod acquisition;
+pub mod bounded;
 pub mod config;
+#[cfg(feature = "std")]
+pub mod fleet;
+pub mod fusion;
+#[cfg(feature = "std")]
+pub mod histogram;
+#[cfg(feature = "std")]
+pub mod history;
+#[cfg(feature = "std")]
+pub mod ingest;
+pub mod json;
+#[cfg(feature = "std")]
+pub mod loadgen;
+#[cfg(feature = "std")]
+pub mod lock_profile;
+#[cfg(feature = "std")]
+pub mod memory;
+#[cfg(feature = "std")]
+pub mod metrics;
+#[cfg(feature = "std")]
+pub mod outbox;
+#[cfg(feature = "std")]
+pub mod publish;
 pub mod schedule;
+#[cfg(feature = "std")]
+pub mod schedule_transfer;
+pub mod sensor_policy;
+pub mod temperature;
 pub mod thermostat;
+#[cfg(feature = "std")]
 pub mod topics;
+pub mod trace;
 pub mod types;
+#[cfg(feature = "std")]
+pub mod wire;
+#[cfg(feature = "std")]
+pub mod zones;
 
-pub use config::{IrHardwareConfig, PersistedSettings, RuntimeConfig, ThermostatConfig};
+pub use bounded::{BoundedDeque, BoundedPush, BoundedString, BoundedVec};
+pub use config::{
+    IrHardwareConfig, PersistedSettings, SensorPublishPolicy, SettingsUpdate, ThermostatConfig,
+};
+pub use fusion::{SensorFusion, SourceConfig, SourceStatus, SourceUpdate, DEFAULT_SENSOR_SOURCE};
+pub use json::{ChunkedSink, JsonError, JsonSink, SliceSink};
 pub use schedule::{DayOfWeek, Schedule, ScheduleAction, ScheduleEntry};
-pub use thermostat::{EngineAction, HoldReason, ThermostatEngine};
-pub use topics::*;
+pub use sensor_policy::{BurstRequest, PublishGate, PublishTrigger, SensorPolicyUpdate};
+pub use temperature::DeciDegrees;
+pub use thermostat::{EngineAction, EngineActions, HoldReason, ThermostatEngine};
+pub use trace::{SampleTrace, SensorSample, TraceContext, TraceStage};
 pub use types::{ControllerStatePayload, ControllerStatus, ThermostatMode, ThermostatState};
+
+#[cfg(feature = "std")]
+pub use acquisition::{
+    Acquisition, AcquisitionStats, CycleTiming, MockSensorBus, ProbeAddress, ProbeReading,
+    ProbeResolution, SensorBus, SensorReadings,
+};
+#[cfg(feature = "std")]
+pub use config::RuntimeConfig;
+#[cfg(feature = "std")]
+pub use fleet::{FleetCommand, FleetEngine};
+#[cfg(feature = "std")]
+pub use histogram::{Histogram, HistogramSnapshot, HistogramSummary};
+#[cfg(feature = "std")]
+pub use history::{
+    BufferedReading, HistoryBatch, HistoryPoint, HistoryStats, HistoryStore, ReadingBuffer,
+};
+#[cfg(feature = "std")]
+pub use ingest::{
+    decode_fleet_message, DeviceSnapshot, FleetStore, FleetSummary, FleetUpdate, IngestError,
+};
+#[cfg(feature = "std")]
+pub use lock_profile::{contention_report, LockContentionReport, ProfiledMutex};
+#[cfg(feature = "esp-idf")]
+pub use memory::EspMemory;
+#[cfg(feature = "std")]
+pub use memory::{
+    in_subsystem, memory_report, register_thread, CountingAllocator, HeapStats, MemoryPlatform,
+    MemoryReport, Subsystem, SubsystemScope,
+};
+#[cfg(feature = "std")]
+pub use metrics::{ControllerMetrics, Counter, FixedHistogram, RouteLatencies};
+#[cfg(feature = "std")]
+pub use outbox::{EnqueueOutcome, OutboundMessage, Outbox, OutboxStats, PublishQos, TopicClass};
+#[cfg(feature = "std")]
+pub use publish::{PublishReason, StatePublisher, StateUpdate};
+#[cfg(feature = "std")]
+pub use schedule_transfer::{ScheduleAssembler, ScheduleParser, ScheduleTransferError};
+#[cfg(feature = "std")]
+pub use topics::*;
+#[cfg(feature = "std")]
+pub use trace::{StageLatencies, StageLatencyView};
+#[cfg(feature = "std")]
+pub use wire::WireError;
+#[cfg(feature = "std")]
+pub use zones::{
+    route_zone_topic, zone_scoped_topic, Zone, ZoneConfig, ZoneError, ZoneRegistry, ZoneTick,
+    DEFAULT_ZONE_ID,
+};
@@ -0,0 +1,279 @@
+use std::sync::atomic::{AtomicU64, Ordering};
+
+use serde::{Deserialize, Serialize};
+
+use crate::{
+    temperature::DeciDegrees,
+    topics::{zone_topic, TOPIC_CONTROLLER_STATE, TOPIC_CONTROLLER_STATE_BIN, TOPIC_SENSOR_TEMP},
+    types::{ControllerStatePayload, ThermostatMode, ThermostatState},
+    wire,
+};
+
+// Sensor readings can only carry a sequence number modulo this window (the
+// reading is 50.0 + (seq % 1000) / 10), so every client keeps its last 1000
+// send times.
+pub const SEQ_WINDOW: u64 = 1_000;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum LoadKind {
+    Sensor,
+    Controller,
+}
+
+// Where virtual devices publish: the per-device layout the fleet ingest
+// service reads, or the zone layout the host controller reads.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum TopicLayout {
+    Fleet,
+    Zones,
+}
+
+impl TopicLayout {
+    pub fn parse(value: &str) -> Option<Self> {
+        match value.trim().to_ascii_lowercase().as_str() {
+            "fleet" => Some(Self::Fleet),
+            "zones" => Some(Self::Zones),
+            _ => None,
+        }
+    }
+
+    pub fn sensor_topic(self, device_id: &str) -> String {
+        self.device_topic(device_id, TOPIC_SENSOR_TEMP)
+    }
+
+    pub fn controller_topic(self, device_id: &str, binary: bool) -> String {
+        let topic = if binary {
+            TOPIC_CONTROLLER_STATE_BIN
+        } else {
+            TOPIC_CONTROLLER_STATE
+        };
+        self.device_topic(device_id, topic)
+    }
+
+    pub fn filters(self) -> [String; 3] {
+        [
+            self.sensor_topic("+"),
+            self.controller_topic("+", false),
+            self.controller_topic("+", true),
+        ]
+    }
+
+    fn device_topic(self, device_id: &str, topic: &str) -> String {
+        match self {
+            Self::Fleet => format!("{device_id}/{}", topic.trim_start_matches("thermostat/")),
+            Self::Zones => zone_topic(device_id, topic),
+        }
+    }
+
+    // Returns the device id and whether the topic is a binary state topic.
+    pub fn split<'a>(self, topic: &'a str) -> Option<(&'a str, bool)> {
+        let rest = match self {
+            Self::Fleet => topic,
+            Self::Zones => topic.strip_prefix("thermostat/zones/")?,
+        };
+        let (device_id, suffix) = rest.split_once('/')?;
+        match suffix {
+            "sensor/temperature" | "controller/state" => Some((device_id, false)),
+            "controller/state/bin" => Some((device_id, true)),
+            _ => None,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PayloadMix {
+    Json,
+    Binary,
+    Mixed,
+}
+
+impl PayloadMix {
+    pub fn parse(value: &str) -> Option<Self> {
+        match value.trim().to_ascii_lowercase().as_str() {
+            "json" => Some(Self::Json),
+            "bin" | "binary" => Some(Self::Binary),
+            "mixed" => Some(Self::Mixed),
+            _ => None,
+        }
+    }
+
+    // Mixed alternates per message so every client exercises both decoders.
+    pub fn binary_for(self, seq: u64) -> bool {
+        match self {
+            Self::Json => false,
+            Self::Binary => true,
+            Self::Mixed => seq % 2 == 1,
+        }
+    }
+}
+
+// Ids stay valid zone ids (lowercase, digits, '-') so the same devices work
+// with either layout.
+pub fn device_id(prefix: &str, kind: LoadKind, index: usize) -> String {
+    let tag = match kind {
+        LoadKind::Sensor => 's',
+        LoadKind::Controller => 'c',
+    };
+    format!("{prefix}-{tag}{index:05}")
+}
+
+pub fn parse_device_id(prefix: &str, device_id: &str) -> Option<(LoadKind, usize)> {
+    let rest = device_id.strip_prefix(prefix)?.strip_prefix('-')?;
+    let kind = match rest.as_bytes().first()? {
+        b's' => LoadKind::Sensor,
+        b'c' => LoadKind::Controller,
+        _ => return None,
+    };
+    Some((kind, rest[1..].parse().ok()?))
+}
+
+pub fn sensor_payload(seq: u64) -> String {
+    format!("{:.1}", 50.0 + (seq % SEQ_WINDOW) as f32 / 10.0)
+}
+
+#[derive(Serialize)]
+struct JsonProbe<'a> {
+    #[serde(flatten)]
+    state: &'a ControllerStatePayload,
+    seq: u64,
+}
+
+#[derive(Deserialize)]
+struct SeqOnly {
+    seq: u64,
+}
+
+// A plausible controller state. JSON carries the sequence as an extra `seq`
+// field, which the state decoders ignore; the binary form has no spare field
+// so the sequence rides in runtime_min.
+pub fn controller_payload(seq: u64, binary: bool, out: &mut Vec<u8>) {
+    let heating = seq % 8 < 3;
+    let state = ControllerStatePayload {
+        temp: DeciDegrees::from_tenths(660 + (seq % 40) as i16),
+        humidity: 40.0,
+        target: DeciDegrees::from_degrees(70),
+        mode: ThermostatMode::Heat,
+        state: if heating {
+            ThermostatState::Heating
+        } else {
+            ThermostatState::Satisfied
+        },
+        fireplace: heating,
+        hold_active: false,
+        hold_remaining_min: 0,
+        in_cooldown: false,
+        cooldown_remaining_min: 0,
+        runtime_min: if binary { seq } else { 0 },
+    };
+    out.clear();
+    if binary {
+        wire::encode_state(&state, out);
+    } else {
+        // Serializing plain data into a Vec cannot fail.
+        serde_json::to_writer(&mut *out, &JsonProbe { state: &state, seq })
+            .expect("serialize state");
+    }
+}
+
+// Sequence numbers recovered from sensor payloads are already reduced modulo
+// SEQ_WINDOW; SendLog only looks at the value modulo the window anyway.
+pub fn decode_seq(kind: LoadKind, binary: bool, payload: &[u8]) -> Option<u64> {
+    match (kind, binary) {
+        (LoadKind::Sensor, _) => {
+            let value: f32 = std::str::from_utf8(payload).ok()?.trim().parse().ok()?;
+            let step = ((value - 50.0) * 10.0).round();
+            (0.0..SEQ_WINDOW as f32)
+                .contains(&step)
+                .then_some(step as u64)
+        }
+        (LoadKind::Controller, true) => wire::decode_state(payload).ok().map(|s| s.runtime_min),
+        (LoadKind::Controller, false) => serde_json::from_slice::<SeqOnly>(payload)
+            .ok()
+            .map(|probe| probe.seq),
+    }
+}
+
+// Send time per in-flight sequence number for one virtual client. The
+// publisher writes and the observer reads from different tasks, so slots are
+// atomics; a message that arrives more than SEQ_WINDOW sends late is
+// attributed to the wrong send and shows up as an outlier.
+#[derive(Debug)]
+pub struct SendLog {
+    sent_us: Box<[AtomicU64]>,
+}
+
+impl Default for SendLog {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl SendLog {
+    pub fn new() -> Self {
+        Self {
+            sent_us: (0..SEQ_WINDOW).map(|_| AtomicU64::new(0)).collect(),
+        }
+    }
+
+    pub fn record(&self, seq: u64, sent_us: u64) {
+        // Zero marks an empty slot, so a send at t=0 is nudged to 1 us.
+        self.sent_us[(seq % SEQ_WINDOW) as usize].store(sent_us.max(1), Ordering::Relaxed);
+    }
+
+    pub fn latency_us(&self, seq: u64, received_us: u64) -> Option<u64> {
+        let sent_us = self.sent_us[(seq % SEQ_WINDOW) as usize].load(Ordering::Relaxed);
+        (sent_us != 0).then(|| received_us.saturating_sub(sent_us))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::ingest::{decode_fleet_message, FleetUpdate};
+
+    #[test]
+    fn payloads_round_trip_sequence_and_stay_decodable() {
+        let mut payload = Vec::new();
+        for seq in [0, 1, 999, 1_234, 987_654] {
+            let sensor = sensor_payload(seq);
+            assert_eq!(
+                decode_seq(LoadKind::Sensor, false, sensor.as_bytes()),
+                Some(seq % SEQ_WINDOW)
+            );
+
+            for binary in [false, true] {
+                controller_payload(seq, binary, &mut payload);
+                assert_eq!(
+                    decode_seq(LoadKind::Controller, binary, &payload),
+                    Some(seq)
+                );
+                let topic = TopicLayout::Fleet.controller_topic("lg-c00001", binary);
+                let (device_id, update) = decode_fleet_message(&topic, &payload).unwrap();
+                assert_eq!(device_id, "lg-c00001");
+                assert!(matches!(update, FleetUpdate::State(_)));
+            }
+        }
+    }
+
+    #[test]
+    fn layouts_and_device_ids_round_trip() {
+        let id = device_id("lg", LoadKind::Controller, 42);
+        assert_eq!(id, "lg-c00042");
+        assert_eq!(parse_device_id("lg", &id), Some((LoadKind::Controller, 42)));
+        assert_eq!(parse_device_id("lg", "den"), None);
+
+        assert_eq!(
+            TopicLayout::Fleet.sensor_topic("lg-s00001"),
+            "lg-s00001/sensor/temperature"
+        );
+        let zone = TopicLayout::Zones.controller_topic("lg-c00001", true);
+        assert_eq!(zone, "thermostat/zones/lg-c00001/controller/state/bin");
+        assert_eq!(TopicLayout::Zones.split(&zone), Some(("lg-c00001", true)));
+        assert_eq!(TopicLayout::Fleet.split("lg-s00001/sensor/humidity"), None);
+
+        let log = SendLog::new();
+        assert_eq!(log.latency_us(7, 100), None);
+        log.record(7, 40);
+        assert_eq!(log.latency_us(7 + SEQ_WINDOW, 100), Some(60));
+    }
+}
@@ -0,0 +1,401 @@
+use std::{
+    fmt,
+    sync::{LockResult, Mutex, MutexGuard},
+};
+
+use serde::Serialize;
+
+#[cfg(feature = "lock-profiling")]
+pub use profile::{HoldTimer, LockProfile, ProfiledGuard};
+
+pub const LOCK_PROFILING_ENABLED: bool = cfg!(feature = "lock-profiling");
+
+// A named `std::sync::Mutex`. With the `lock-profiling` feature every
+// acquisition records its wait, its hold time and the call site holding the
+// lock; without it the name is dropped and `lock` is the plain mutex call.
+pub struct ProfiledMutex<T> {
+    inner: Mutex<T>,
+    #[cfg(feature = "lock-profiling")]
+    profile: &'static LockProfile,
+}
+
+impl<T> ProfiledMutex<T> {
+    pub fn new(name: &'static str, value: T) -> Self {
+        #[cfg(not(feature = "lock-profiling"))]
+        let _ = name;
+        Self {
+            inner: Mutex::new(value),
+            #[cfg(feature = "lock-profiling")]
+            profile: LockProfile::named(name),
+        }
+    }
+
+    #[cfg(not(feature = "lock-profiling"))]
+    #[inline]
+    pub fn lock(&self) -> LockResult<MutexGuard<'_, T>> {
+        self.inner.lock()
+    }
+
+    #[cfg(feature = "lock-profiling")]
+    #[track_caller]
+    pub fn lock(&self) -> LockResult<ProfiledGuard<MutexGuard<'_, T>>> {
+        use std::sync::{PoisonError, TryLockError};
+
+        let site = std::panic::Location::caller();
+        let started = std::time::Instant::now();
+        let (result, contended) = match self.inner.try_lock() {
+            Ok(guard) => (Ok(guard), false),
+            Err(TryLockError::WouldBlock) => (self.inner.lock(), true),
+            Err(TryLockError::Poisoned(poisoned)) => (Err(poisoned), false),
+        };
+        let timer = self.profile.acquired(site, started, contended);
+        match result {
+            Ok(guard) => Ok(ProfiledGuard::new(guard, timer)),
+            Err(poisoned) => Err(PoisonError::new(ProfiledGuard::new(
+                poisoned.into_inner(),
+                timer,
+            ))),
+        }
+    }
+}
+
+impl<T: fmt::Debug> fmt::Debug for ProfiledMutex<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        self.inner.fmt(f)
+    }
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct LockContentionReport {
+    pub enabled: bool,
+    // Most total wait first.
+    pub locks: Vec<LockContention>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct LockContention {
+    pub name: &'static str,
+    pub acquisitions: u64,
+    // Acquisitions that found the lock held and had to block.
+    pub contended: u64,
+    #[serde(rename = "waitTotalUs")]
+    pub wait_total_us: u64,
+    #[serde(rename = "waitP99Us")]
+    pub wait_p99_us: u64,
+    #[serde(rename = "waitMaxUs")]
+    pub wait_max_us: u64,
+    #[serde(rename = "holdTotalUs")]
+    pub hold_total_us: u64,
+    #[serde(rename = "holdP99Us")]
+    pub hold_p99_us: u64,
+    #[serde(rename = "holdMaxUs")]
+    pub hold_max_us: u64,
+    // Longest total hold first: the sites that make everyone else wait.
+    pub sites: Vec<LockSiteContention>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct LockSiteContention {
+    pub site: String,
+    pub acquisitions: u64,
+    #[serde(rename = "waitTotalUs")]
+    pub wait_total_us: u64,
+    #[serde(rename = "holdTotalUs")]
+    pub hold_total_us: u64,
+    #[serde(rename = "holdMaxUs")]
+    pub hold_max_us: u64,
+}
+
+pub fn contention_report() -> LockContentionReport {
+    #[cfg(feature = "lock-profiling")]
+    let locks = profile::report();
+    #[cfg(not(feature = "lock-profiling"))]
+    let locks = Vec::new();
+    LockContentionReport {
+        enabled: LOCK_PROFILING_ENABLED,
+        locks,
+    }
+}
+
+#[cfg(feature = "lock-profiling")]
+mod profile {
+    use std::{
+        ops::{Deref, DerefMut},
+        panic::Location,
+        sync::{
+            atomic::{AtomicU64, Ordering},
+            OnceLock,
+        },
+        time::{Duration, Instant},
+    };
+
+    use super::{LockContention, LockSiteContention};
+    use crate::metrics::{Counter, FixedHistogram, DURATION_BUCKETS_US};
+
+    // Sized for the controllers' shared state with room to spare; each
+    // profile is about 1 KB, which only profiling builds pay for.
+    const MAX_LOCKS: usize = 16;
+    const SITES_PER_LOCK: usize = 12;
+
+    #[derive(Debug)]
+    struct SiteStats {
+        location: OnceLock<&'static Location<'static>>,
+        acquisitions: Counter,
+        wait_us: Counter,
+        hold_us: Counter,
+        max_hold_us: AtomicU64,
+    }
+
+    #[allow(clippy::declare_interior_mutable_const)]
+    const EMPTY_SITE: SiteStats = SiteStats {
+        location: OnceLock::new(),
+        acquisitions: Counter::new(),
+        wait_us: Counter::new(),
+        hold_us: Counter::new(),
+        max_hold_us: AtomicU64::new(0),
+    };
+
+    #[derive(Debug)]
+    pub struct LockProfile {
+        name: OnceLock<&'static str>,
+        acquisitions: Counter,
+        contended: Counter,
+        wait: FixedHistogram,
+        hold: FixedHistogram,
+        max_wait_us: AtomicU64,
+        max_hold_us: AtomicU64,
+        sites: [SiteStats; SITES_PER_LOCK],
+        other_site: SiteStats,
+    }
+
+    #[allow(clippy::declare_interior_mutable_const)]
+    const EMPTY_PROFILE: LockProfile = LockProfile {
+        name: OnceLock::new(),
+        acquisitions: Counter::new(),
+        contended: Counter::new(),
+        wait: FixedHistogram::new(DURATION_BUCKETS_US),
+        hold: FixedHistogram::new(DURATION_BUCKETS_US),
+        max_wait_us: AtomicU64::new(0),
+        max_hold_us: AtomicU64::new(0),
+        sites: [EMPTY_SITE; SITES_PER_LOCK],
+        other_site: EMPTY_SITE,
+    };
+
+    static PROFILES: [LockProfile; MAX_LOCKS] = [EMPTY_PROFILE; MAX_LOCKS];
+    static OTHER_PROFILE: LockProfile = EMPTY_PROFILE;
+
+    fn micros(elapsed: Duration) -> u64 {
+        elapsed.as_micros().try_into().unwrap_or(u64::MAX)
+    }
+
+    impl LockProfile {
+        // Locks created with the same name share one profile (per-zone
+        // locks, for example).
+        pub fn named(name: &'static str) -> &'static Self {
+            for profile in &PROFILES {
+                if *profile.name.get_or_init(|| name) == name {
+                    return profile;
+                }
+            }
+            &OTHER_PROFILE
+        }
+
+        fn site(&self, location: &'static Location<'static>) -> &SiteStats {
+            for site in &self.sites {
+                let claimed = *site.location.get_or_init(|| location);
+                if std::ptr::eq(claimed, location) || *claimed == *location {
+                    return site;
+                }
+            }
+            &self.other_site
+        }
+
+        // Called once the lock is held; the returned timer records the hold
+        // when the guard drops.
+        pub fn acquired(
+            &'static self,
+            location: &'static Location<'static>,
+            started: Instant,
+            contended: bool,
+        ) -> HoldTimer {
+            let acquired = Instant::now();
+            let wait_us = micros(acquired - started);
+            let site = self.site(location);
+            self.acquisitions.inc();
+            if contended {
+                self.contended.inc();
+            }
+            self.wait.record_us(wait_us);
+            self.max_wait_us.fetch_max(wait_us, Ordering::Relaxed);
+            site.acquisitions.inc();
+            site.wait_us.add(wait_us);
+            HoldTimer {
+                profile: self,
+                site,
+                acquired,
+            }
+        }
+
+        fn contention(&self, name: &'static str) -> LockContention {
+            let mut sites: Vec<LockSiteContention> = self
+                .sites
+                .iter()
+                .filter_map(|site| Some((site.location.get()?.to_string(), site)))
+                .chain(
+                    (self.other_site.acquisitions.get() > 0)
+                        .then(|| ("other".to_string(), &self.other_site)),
+                )
+                .map(|(location, site)| LockSiteContention {
+                    site: location,
+                    acquisitions: site.acquisitions.get(),
+                    wait_total_us: site.wait_us.get(),
+                    hold_total_us: site.hold_us.get(),
+                    hold_max_us: site.max_hold_us.load(Ordering::Relaxed),
+                })
+                .collect();
+            sites.sort_by(|a, b| b.hold_total_us.cmp(&a.hold_total_us));
+
+            let wait_max_us = self.max_wait_us.load(Ordering::Relaxed);
+            let hold_max_us = self.max_hold_us.load(Ordering::Relaxed);
+            LockContention {
+                name,
+                acquisitions: self.acquisitions.get(),
+                contended: self.contended.get(),
+                wait_total_us: self.wait.sum_us(),
+                wait_p99_us: self
+                    .wait
+                    .quantile_bound_us(0.99)
+                    .map_or(wait_max_us, |bound| bound.min(wait_max_us)),
+                wait_max_us,
+                hold_total_us: self.hold.sum_us(),
+                hold_p99_us: self
+                    .hold
+                    .quantile_bound_us(0.99)
+                    .map_or(hold_max_us, |bound| bound.min(hold_max_us)),
+                hold_max_us,
+                sites,
+            }
+        }
+    }
+
+    #[derive(Debug)]
+    pub struct HoldTimer {
+        profile: &'static LockProfile,
+        site: &'static SiteStats,
+        acquired: Instant,
+    }
+
+    impl Drop for HoldTimer {
+        fn drop(&mut self) {
+            let hold_us = micros(self.acquired.elapsed());
+            self.profile.hold.record_us(hold_us);
+            self.profile
+                .max_hold_us
+                .fetch_max(hold_us, Ordering::Relaxed);
+            self.site.hold_us.add(hold_us);
+            self.site.max_hold_us.fetch_max(hold_us, Ordering::Relaxed);
+        }
+    }
+
+    // Wraps any lock guard. The guard is declared first so the lock is
+    // released before the hold time is recorded.
+    #[derive(Debug)]
+    pub struct ProfiledGuard<G> {
+        guard: G,
+        _timer: HoldTimer,
+    }
+
+    impl<G> ProfiledGuard<G> {
+        pub fn new(guard: G, timer: HoldTimer) -> Self {
+            Self {
+                guard,
+                _timer: timer,
+            }
+        }
+    }
+
+    impl<G: Deref> Deref for ProfiledGuard<G> {
+        type Target = G::Target;
+
+        fn deref(&self) -> &Self::Target {
+            &self.guard
+        }
+    }
+
+    impl<G: DerefMut> DerefMut for ProfiledGuard<G> {
+        fn deref_mut(&mut self) -> &mut Self::Target {
+            &mut self.guard
+        }
+    }
+
+    pub(super) fn report() -> Vec<LockContention> {
+        let mut locks: Vec<LockContention> = PROFILES
+            .iter()
+            .filter_map(|profile| Some(profile.contention(profile.name.get()?)))
+            .chain(
+                (OTHER_PROFILE.acquisitions.get() > 0).then(|| OTHER_PROFILE.contention("other")),
+            )
+            .collect();
+        locks.sort_by(|a, b| b.wait_total_us.cmp(&a.wait_total_us));
+        locks
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn profiled_mutex_is_a_drop_in_mutex() {
+        let counter = ProfiledMutex::new("test-drop-in", 0_u32);
+        *counter.lock().unwrap() += 2;
+        {
+            let mut guard = counter.lock().unwrap();
+            *guard += 1;
+        }
+        assert_eq!(*counter.lock().unwrap(), 3);
+        assert_eq!(contention_report().enabled, LOCK_PROFILING_ENABLED);
+        if !LOCK_PROFILING_ENABLED {
+            assert!(contention_report().locks.is_empty());
+        }
+    }
+
+    #[cfg(feature = "lock-profiling")]
+    #[test]
+    fn contention_is_attributed_to_the_holding_site() {
+        use std::{
+            sync::{mpsc, Arc},
+            thread,
+            time::Duration,
+        };
+
+        let shared = Arc::new(ProfiledMutex::new("test-contended", ()));
+        let (locked_tx, locked_rx) = mpsc::channel();
+        let holder = {
+            let shared = Arc::clone(&shared);
+            thread::spawn(move || {
+                let _guard = shared.lock().unwrap();
+                locked_tx.send(()).unwrap();
+                thread::sleep(Duration::from_millis(30));
+            })
+        };
+        // The holder keeps the lock for 30 ms, so this acquisition blocks.
+        locked_rx.recv().unwrap();
+        drop(shared.lock().unwrap());
+        holder.join().unwrap();
+
+        let report = contention_report();
+        let lock = report
+            .locks
+            .iter()
+            .find(|lock| lock.name == "test-contended")
+            .unwrap();
+        assert_eq!(lock.acquisitions, 2);
+        assert_eq!(lock.contended, 1);
+        assert!(lock.wait_max_us >= 10_000, "wait {}", lock.wait_max_us);
+        assert!(lock.hold_max_us >= 25_000, "hold {}", lock.hold_max_us);
+        assert_eq!(lock.sites.len(), 2);
+        assert!(lock.sites[0].site.contains("lock_profile.rs"));
+        assert!(lock.sites[0].hold_max_us >= 25_000);
+    }
+}
@@ -0,0 +1,610 @@
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    future::Future,
+    marker::PhantomData,
+    pin::Pin,
+    sync::{
+        atomic::{AtomicBool, AtomicU64, AtomicU8, AtomicUsize, Ordering},
+        Mutex,
+    },
+    task::{Context, Poll},
+};
+
+use serde::Serialize;
+
+// Live threads that can be charged to a subsystem at the same time. Threads
+// past this (large tokio pools) count as `Other`.
+const THREAD_SLOTS: usize = 32;
+
+// Where a thread's allocations are charged. Registered threads default to
+// their own subsystem; `SubsystemScope` and `in_subsystem` override it for a
+// stretch of work.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+pub enum Subsystem {
+    Other,
+    Main,
+    Control,
+    Mqtt,
+    Http,
+    Ir,
+    Storage,
+    Ota,
+    Acquisition,
+}
+
+impl Subsystem {
+    pub const ALL: [Self; 9] = [
+        Self::Other,
+        Self::Main,
+        Self::Control,
+        Self::Mqtt,
+        Self::Http,
+        Self::Ir,
+        Self::Storage,
+        Self::Ota,
+        Self::Acquisition,
+    ];
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Self::Other => "other",
+            Self::Main => "main",
+            Self::Control => "control",
+            Self::Mqtt => "mqtt",
+            Self::Http => "http",
+            Self::Ir => "ir",
+            Self::Storage => "storage",
+            Self::Ota => "ota",
+            Self::Acquisition => "acquisition",
+        }
+    }
+}
+
+// What the allocator and report need from the target. `thread_key` runs on
+// every allocation, so it must not allocate and must be non-zero and unique
+// per live thread (the FreeRTOS task handle, or a thread-local address).
+pub trait MemoryPlatform: Sync {
+    fn thread_key(&self) -> usize;
+
+    // Lowest free stack seen for the thread, in bytes.
+    fn stack_free_bytes(&self, _key: usize) -> Option<usize> {
+        None
+    }
+
+    fn heap(&self) -> HeapStats {
+        HeapStats::default()
+    }
+}
+
+#[derive(Debug)]
+struct AllocCounters {
+    allocations: AtomicU64,
+    allocated_bytes: AtomicU64,
+    frees: AtomicU64,
+    freed_bytes: AtomicU64,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO_COUNTERS: AllocCounters = AllocCounters {
+    allocations: AtomicU64::new(0),
+    allocated_bytes: AtomicU64::new(0),
+    frees: AtomicU64::new(0),
+    freed_bytes: AtomicU64::new(0),
+};
+
+#[derive(Debug)]
+struct ThreadSlot {
+    // 0 marks a free slot.
+    key: AtomicUsize,
+    subsystem: AtomicU8,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const EMPTY_SLOT: ThreadSlot = ThreadSlot {
+    key: AtomicUsize::new(0),
+    subsystem: AtomicU8::new(Subsystem::Other as u8),
+};
+
+static INSTALLED: AtomicBool = AtomicBool::new(false);
+static LIVE_BYTES: AtomicUsize = AtomicUsize::new(0);
+static PEAK_LIVE_BYTES: AtomicUsize = AtomicUsize::new(0);
+static FAILURES: AtomicU64 = AtomicU64::new(0);
+static COUNTERS: [AllocCounters; Subsystem::ALL.len()] = [ZERO_COUNTERS; Subsystem::ALL.len()];
+static SLOTS: [ThreadSlot; THREAD_SLOTS] = [EMPTY_SLOT; THREAD_SLOTS];
+// Name, stack size and last stack sample per registered thread. Only touched
+// by registration and reports, never by the allocator.
+static THREADS: Mutex<Vec<ThreadRecord>> = Mutex::new(Vec::new());
+
+fn find_slot(key: usize) -> Option<&'static ThreadSlot> {
+    SLOTS
+        .iter()
+        .find(|slot| slot.key.load(Ordering::Relaxed) == key)
+}
+
+// Returns the slot and whether this call claimed it.
+fn claim_slot(key: usize) -> Option<(&'static ThreadSlot, bool)> {
+    if let Some(slot) = find_slot(key) {
+        return Some((slot, false));
+    }
+    SLOTS
+        .iter()
+        .find(|slot| {
+            slot.key
+                .compare_exchange(0, key, Ordering::AcqRel, Ordering::Relaxed)
+                .is_ok()
+        })
+        .map(|slot| (slot, true))
+}
+
+fn release_slot(slot: &ThreadSlot) {
+    slot.subsystem
+        .store(Subsystem::Other as u8, Ordering::Relaxed);
+    slot.key.store(0, Ordering::Release);
+}
+
+fn counters_for(key: usize) -> &'static AllocCounters {
+    let subsystem = find_slot(key).map_or(Subsystem::Other as u8, |slot| {
+        slot.subsystem.load(Ordering::Relaxed)
+    });
+    &COUNTERS[subsystem as usize]
+}
+
+// Wraps the system allocator with global and per-subsystem counters. Each
+// allocation costs a few relaxed atomic adds and a scan of the thread slots.
+//
+//   #[global_allocator]
+//   static ALLOCATOR: CountingAllocator = CountingAllocator::new(System, &PLATFORM);
+pub struct CountingAllocator<A = System> {
+    inner: A,
+    platform: &'static dyn MemoryPlatform,
+}
+
+impl<A> CountingAllocator<A> {
+    pub const fn new(inner: A, platform: &'static dyn MemoryPlatform) -> Self {
+        Self { inner, platform }
+    }
+
+    fn record_alloc(&self, ptr: *mut u8, size: usize) {
+        if ptr.is_null() {
+            FAILURES.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+        if !INSTALLED.load(Ordering::Relaxed) {
+            INSTALLED.store(true, Ordering::Relaxed);
+        }
+        let live = LIVE_BYTES.fetch_add(size, Ordering::Relaxed) + size;
+        PEAK_LIVE_BYTES.fetch_max(live, Ordering::Relaxed);
+        let counters = counters_for(self.platform.thread_key());
+        counters.allocations.fetch_add(1, Ordering::Relaxed);
+        counters
+            .allocated_bytes
+            .fetch_add(size as u64, Ordering::Relaxed);
+    }
+
+    // Frees are charged to the freeing thread, which is not always the one
+    // that allocated (a message built by MQTT and dropped by the control
+    // loop), so per-subsystem allocated minus freed is not a live size.
+    fn record_free(&self, size: usize) {
+        LIVE_BYTES.fetch_sub(size, Ordering::Relaxed);
+        let counters = counters_for(self.platform.thread_key());
+        counters.frees.fetch_add(1, Ordering::Relaxed);
+        counters
+            .freed_bytes
+            .fetch_add(size as u64, Ordering::Relaxed);
+    }
+}
+
+unsafe impl<A: GlobalAlloc> GlobalAlloc for CountingAllocator<A> {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let ptr = self.inner.alloc(layout);
+        self.record_alloc(ptr, layout.size());
+        ptr
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        let ptr = self.inner.alloc_zeroed(layout);
+        self.record_alloc(ptr, layout.size());
+        ptr
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        self.inner.dealloc(ptr, layout);
+        self.record_free(layout.size());
+    }
+
+    // Counted as a free of the old block and an allocation of the new one.
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let new_ptr = self.inner.realloc(ptr, layout, new_size);
+        if !new_ptr.is_null() {
+            self.record_free(layout.size());
+        }
+        self.record_alloc(new_ptr, new_size);
+        new_ptr
+    }
+}
+
+#[derive(Debug)]
+struct ThreadRecord {
+    name: &'static str,
+    subsystem: Subsystem,
+    stack_size: Option<usize>,
+    // Platform key while the thread runs.
+    key: Option<usize>,
+    // Lowest free stack sampled when earlier runs of this thread exited.
+    exited_free_min: Option<usize>,
+}
+
+// Keeps a thread registered; hold it for the thread's whole life. Dropping it
+// samples the stack high-water mark one last time, so short-lived threads
+// (OTA apply) still report how close they came to overflowing.
+#[must_use = "the thread is unregistered when this is dropped"]
+pub struct ThreadRegistration {
+    platform: &'static dyn MemoryPlatform,
+    key: usize,
+    name: &'static str,
+    slot: Option<&'static ThreadSlot>,
+}
+
+impl ThreadRegistration {
+    // For threads that run until reboot, or that we don't own (the HTTP
+    // server task).
+    pub fn keep(self) {
+        std::mem::forget(self);
+    }
+}
+
+impl Drop for ThreadRegistration {
+    fn drop(&mut self) {
+        let free = self.platform.stack_free_bytes(self.key);
+        if let Some(slot) = self.slot {
+            release_slot(slot);
+        }
+        let mut threads = THREADS.lock().unwrap_or_else(|err| err.into_inner());
+        if let Some(record) = threads.iter_mut().find(|record| record.name == self.name) {
+            record.key = None;
+            record.exited_free_min = min_option(record.exited_free_min, free);
+        }
+    }
+}
+
+// Call first thing on a new thread. Threads that restart under the same name
+// (OTA apply) share one report entry.
+pub fn register_thread(
+    platform: &'static dyn MemoryPlatform,
+    name: &'static str,
+    subsystem: Subsystem,
+    stack_size: Option<usize>,
+) -> ThreadRegistration {
+    let key = platform.thread_key();
+    let slot = claim_slot(key).map(|(slot, _)| {
+        slot.subsystem.store(subsystem as u8, Ordering::Relaxed);
+        slot
+    });
+
+    let mut threads = THREADS.lock().unwrap_or_else(|err| err.into_inner());
+    match threads.iter_mut().find(|record| record.name == name) {
+        Some(record) => {
+            record.subsystem = subsystem;
+            record.stack_size = stack_size;
+            record.key = Some(key);
+        }
+        None => threads.push(ThreadRecord {
+            name,
+            subsystem,
+            stack_size,
+            key: Some(key),
+            exited_free_min: None,
+        }),
+    }
+
+    ThreadRegistration {
+        platform,
+        key,
+        name,
+        slot,
+    }
+}
+
+// Charges the current thread's allocations to `subsystem` until dropped.
+// Not `Send`: on an async runtime wrap the future with `in_subsystem`
+// instead of holding a scope across an await.
+pub struct SubsystemScope {
+    slot: Option<&'static ThreadSlot>,
+    previous: u8,
+    claimed: bool,
+    _not_send: PhantomData<*const ()>,
+}
+
+impl SubsystemScope {
+    pub fn enter(platform: &dyn MemoryPlatform, subsystem: Subsystem) -> Self {
+        let (slot, claimed, previous) = match claim_slot(platform.thread_key()) {
+            Some((slot, claimed)) => {
+                let previous = slot.subsystem.swap(subsystem as u8, Ordering::Relaxed);
+                (Some(slot), claimed, previous)
+            }
+            None => (None, false, Subsystem::Other as u8),
+        };
+        Self {
+            slot,
+            previous,
+            claimed,
+            _not_send: PhantomData,
+        }
+    }
+}
+
+impl Drop for SubsystemScope {
+    fn drop(&mut self) {
+        let Some(slot) = self.slot else {
+            return;
+        };
+        if self.claimed {
+            release_slot(slot);
+        } else {
+            slot.subsystem.store(self.previous, Ordering::Relaxed);
+        }
+    }
+}
+
+// A future whose every poll runs inside a `SubsystemScope`, so work on a
+// multi-threaded executor is charged correctly whichever worker polls it.
+pub struct InSubsystem<F> {
+    platform: &'static dyn MemoryPlatform,
+    subsystem: Subsystem,
+    inner: F,
+}
+
+pub fn in_subsystem<F: Future>(
+    platform: &'static dyn MemoryPlatform,
+    subsystem: Subsystem,
+    future: F,
+) -> InSubsystem<F> {
+    InSubsystem {
+        platform,
+        subsystem,
+        inner: future,
+    }
+}
+
+impl<F: Future> Future for InSubsystem<F> {
+    type Output = F::Output;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<F::Output> {
+        let _scope = SubsystemScope::enter(self.platform, self.subsystem);
+        // SAFETY: `inner` is structurally pinned; it is never moved out of
+        // the wrapper or handed out unpinned.
+        unsafe { self.map_unchecked_mut(|this| &mut this.inner) }.poll(cx)
+    }
+}
+
+fn min_option(a: Option<usize>, b: Option<usize>) -> Option<usize> {
+    match (a, b) {
+        (Some(a), Some(b)) => Some(a.min(b)),
+        (a, b) => a.or(b),
+    }
+}
+
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct HeapStats {
+    #[serde(rename = "freeBytes")]
+    pub free_bytes: Option<u64>,
+    #[serde(rename = "minFreeBytes")]
+    pub min_free_bytes: Option<u64>,
+    // The biggest single allocation that can still succeed; far below
+    // `freeBytes` means the heap is fragmented.
+    #[serde(rename = "largestFreeBlockBytes")]
+    pub largest_free_block_bytes: Option<u64>,
+    #[serde(rename = "residentBytes")]
+    pub resident_bytes: Option<u64>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct AllocatorStats {
+    // False when the binary runs on the plain system allocator (tests); the
+    // counters then stay at zero.
+    pub counting: bool,
+    pub allocations: u64,
+    pub frees: u64,
+    #[serde(rename = "liveBytes")]
+    pub live_bytes: u64,
+    #[serde(rename = "peakLiveBytes")]
+    pub peak_live_bytes: u64,
+    pub failures: u64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct ThreadMemory {
+    pub name: &'static str,
+    pub subsystem: &'static str,
+    pub running: bool,
+    #[serde(rename = "stackSizeBytes")]
+    pub stack_size_bytes: Option<usize>,
+    #[serde(rename = "stackFreeMinBytes")]
+    pub stack_free_min_bytes: Option<usize>,
+    #[serde(rename = "stackPeakUsedBytes")]
+    pub stack_peak_used_bytes: Option<usize>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct SubsystemAllocations {
+    pub subsystem: &'static str,
+    pub allocations: u64,
+    #[serde(rename = "allocatedBytes")]
+    pub allocated_bytes: u64,
+    pub frees: u64,
+    #[serde(rename = "freedBytes")]
+    pub freed_bytes: u64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct MemoryReport {
+    pub heap: HeapStats,
+    pub allocator: AllocatorStats,
+    pub threads: Vec<ThreadMemory>,
+    pub subsystems: Vec<SubsystemAllocations>,
+}
+
+pub fn memory_report(platform: &dyn MemoryPlatform) -> MemoryReport {
+    let mut subsystems = Vec::with_capacity(Subsystem::ALL.len());
+    let (mut allocations, mut frees) = (0, 0);
+    for subsystem in Subsystem::ALL {
+        let counters = &COUNTERS[subsystem as usize];
+        let view = SubsystemAllocations {
+            subsystem: subsystem.name(),
+            allocations: counters.allocations.load(Ordering::Relaxed),
+            allocated_bytes: counters.allocated_bytes.load(Ordering::Relaxed),
+            frees: counters.frees.load(Ordering::Relaxed),
+            freed_bytes: counters.freed_bytes.load(Ordering::Relaxed),
+        };
+        allocations += view.allocations;
+        frees += view.frees;
+        subsystems.push(view);
+    }
+    subsystems.sort_by(|a, b| b.allocated_bytes.cmp(&a.allocated_bytes));
+
+    let threads = THREADS
+        .lock()
+        .unwrap_or_else(|err| err.into_inner())
+        .iter()
+        .map(|record| {
+            let live_free = record.key.and_then(|key| platform.stack_free_bytes(key));
+            let free = min_option(live_free, record.exited_free_min);
+            ThreadMemory {
+                name: record.name,
+                subsystem: record.subsystem.name(),
+                running: record.key.is_some(),
+                stack_size_bytes: record.stack_size,
+                stack_free_min_bytes: free,
+                stack_peak_used_bytes: record
+                    .stack_size
+                    .zip(free)
+                    .map(|(size, free)| size.saturating_sub(free)),
+            }
+        })
+        .collect();
+
+    MemoryReport {
+        heap: platform.heap(),
+        allocator: AllocatorStats {
+            counting: INSTALLED.load(Ordering::Relaxed),
+            allocations,
+            frees,
+            live_bytes: LIVE_BYTES.load(Ordering::Relaxed) as u64,
+            peak_live_bytes: PEAK_LIVE_BYTES.load(Ordering::Relaxed) as u64,
+            failures: FAILURES.load(Ordering::Relaxed),
+        },
+        threads,
+        subsystems,
+    }
+}
+
+// FreeRTOS hooks for the counting allocator on the ESP builds. ESP-IDF
+// reports stack high-water marks in bytes, not words.
+#[cfg(feature = "esp-idf")]
+pub struct EspMemory;
+
+#[cfg(feature = "esp-idf")]
+impl MemoryPlatform for EspMemory {
+    fn thread_key(&self) -> usize {
+        unsafe { esp_idf_sys::xTaskGetCurrentTaskHandle() as usize }
+    }
+
+    fn stack_free_bytes(&self, key: usize) -> Option<usize> {
+        let free = unsafe { esp_idf_sys::uxTaskGetStackHighWaterMark(key as _) };
+        Some(free as usize)
+    }
+
+    fn heap(&self) -> HeapStats {
+        unsafe {
+            HeapStats {
+                free_bytes: Some(esp_idf_sys::esp_get_free_heap_size().into()),
+                min_free_bytes: Some(esp_idf_sys::esp_get_minimum_free_heap_size().into()),
+                largest_free_block_bytes: Some(esp_idf_sys::heap_caps_get_largest_free_block(
+                    esp_idf_sys::MALLOC_CAP_8BIT,
+                ) as u64),
+                resident_bytes: None,
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::thread;
+
+    use super::*;
+
+    struct TestPlatform;
+
+    impl MemoryPlatform for TestPlatform {
+        fn thread_key(&self) -> usize {
+            thread_local! {
+                static ANCHOR: u8 = const { 0 };
+            }
+            ANCHOR.with(|anchor| anchor as *const u8 as usize)
+        }
+
+        fn stack_free_bytes(&self, _key: usize) -> Option<usize> {
+            Some(5_000)
+        }
+    }
+
+    static PLATFORM: TestPlatform = TestPlatform;
+    // Not the global allocator: only the calls below go through it, so the
+    // counters see nothing from other tests.
+    static ALLOCATOR: CountingAllocator = CountingAllocator::new(System, &PLATFORM);
+
+    fn allocated(report: &MemoryReport, subsystem: Subsystem) -> (u64, u64) {
+        let view = report
+            .subsystems
+            .iter()
+            .find(|view| view.subsystem == subsystem.name())
+            .unwrap();
+        (view.allocations, view.allocated_bytes)
+    }
+
+    #[test]
+    fn allocations_are_charged_to_the_thread_subsystem() {
+        let before = memory_report(&PLATFORM);
+        thread::spawn(|| {
+            let _registration =
+                register_thread(&PLATFORM, "test-mqtt", Subsystem::Mqtt, Some(8_192));
+            let layout = Layout::from_size_align(64, 8).unwrap();
+            unsafe {
+                let ptr = ALLOCATOR.alloc(layout);
+                {
+                    let _scope = SubsystemScope::enter(&PLATFORM, Subsystem::Storage);
+                    let grown = ALLOCATOR.realloc(ptr, layout, 256);
+                    ALLOCATOR.dealloc(grown, Layout::from_size_align(256, 8).unwrap());
+                }
+            }
+        })
+        .join()
+        .unwrap();
+        let after = memory_report(&PLATFORM);
+
+        let delta = |subsystem| {
+            let (count, bytes) = allocated(&after, subsystem);
+            let (count_before, bytes_before) = allocated(&before, subsystem);
+            (count - count_before, bytes - bytes_before)
+        };
+        assert_eq!(delta(Subsystem::Mqtt), (1, 64));
+        assert_eq!(delta(Subsystem::Storage), (1, 256));
+        assert!(after.allocator.counting);
+        assert!(after.allocator.peak_live_bytes >= 256);
+
+        let thread = after
+            .threads
+            .iter()
+            .find(|thread| thread.name == "test-mqtt")
+            .unwrap();
+        assert!(!thread.running);
+        assert_eq!(thread.stack_free_min_bytes, Some(5_000));
+        assert_eq!(thread.stack_peak_used_bytes, Some(3_192));
+        // The exited thread's slot is free again.
+        assert!(SLOTS
+            .iter()
+            .all(|slot| slot.key.load(Ordering::Relaxed) == 0));
+    }
+}
@@ -0,0 +1,506 @@
+use std::{
+    fmt::Write,
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        OnceLock,
+    },
+    time::Duration,
+};
+
+use crate::{
+    outbox::{ClassStats, OutboxStats},
+    trace::StageLatencies,
+};
+
+// Upper bounds in microseconds, exported in seconds. One set covers lock
+// waits (microseconds) through NVS writes and IR frames (hundreds of ms).
+pub const DURATION_BUCKETS_US: &[u64] = &[
+    10, 50, 100, 500, 1_000, 5_000, 10_000, 50_000, 100_000, 250_000, 500_000, 1_000_000,
+    2_500_000, 5_000_000,
+];
+// Control loop periods: 200 ms on the ESP32, 1 s on the host.
+pub const PERIOD_BUCKETS_US: &[u64] = &[
+    100_000, 200_000, 210_000, 250_000, 500_000, 1_000_000, 1_010_000, 1_250_000, 2_000_000,
+    5_000_000, 10_000_000,
+];
+// Distinct HTTP routes tracked before the rest are folded into "other". Both
+// controllers register fewer than this.
+pub const HTTP_ROUTE_SLOTS: usize = 64;
+
+const MAX_BUCKETS: usize = 16;
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+#[derive(Debug, Default)]
+pub struct Counter(AtomicU64);
+
+impl Counter {
+    pub const fn new() -> Self {
+        Self(ZERO)
+    }
+
+    pub fn inc(&self) {
+        self.add(1);
+    }
+
+    pub fn add(&self, value: u64) {
+        self.0.fetch_add(value, Ordering::Relaxed);
+    }
+
+    pub fn get(&self) -> u64 {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+// Prometheus-style histogram with a handful of fixed `le` buckets. Unlike
+// `Histogram` it is small enough (about 150 bytes) to keep one per HTTP route
+// on the ESP32; recording is a short bounds scan and three relaxed adds.
+#[derive(Debug)]
+pub struct FixedHistogram {
+    bounds_us: &'static [u64],
+    // Last used slot is the +Inf bucket.
+    buckets: [AtomicU64; MAX_BUCKETS],
+    count: AtomicU64,
+    sum_us: AtomicU64,
+}
+
+impl FixedHistogram {
+    pub const fn new(bounds_us: &'static [u64]) -> Self {
+        assert!(bounds_us.len() < MAX_BUCKETS);
+        Self {
+            bounds_us,
+            buckets: [ZERO; MAX_BUCKETS],
+            count: ZERO,
+            sum_us: ZERO,
+        }
+    }
+
+    pub fn record_us(&self, value_us: u64) {
+        let index = self.bounds_us.partition_point(|&bound| bound < value_us);
+        self.buckets[index].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum_us.fetch_add(value_us, Ordering::Relaxed);
+    }
+
+    pub fn record(&self, elapsed: Duration) {
+        self.record_us(elapsed.as_micros().try_into().unwrap_or(u64::MAX));
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count.load(Ordering::Relaxed)
+    }
+
+    pub fn sum_us(&self) -> u64 {
+        self.sum_us.load(Ordering::Relaxed)
+    }
+
+    // Upper bound of the bucket holding the q-th quantile, or None when it
+    // falls past the last bound.
+    pub fn quantile_bound_us(&self, quantile: f64) -> Option<u64> {
+        let count = self.count();
+        if count == 0 {
+            return Some(0);
+        }
+        let rank = ((quantile.clamp(0.0, 1.0) * count as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (index, bound) in self.bounds_us.iter().enumerate() {
+            seen += self.buckets[index].load(Ordering::Relaxed);
+            if seen >= rank {
+                return Some(*bound);
+            }
+        }
+        None
+    }
+
+    fn write(&self, out: &mut String, name: &str, labels: &str) {
+        let separator = if labels.is_empty() { "" } else { "," };
+        let mut cumulative = 0;
+        for (index, bound) in self.bounds_us.iter().enumerate() {
+            cumulative += self.buckets[index].load(Ordering::Relaxed);
+            let _ = writeln!(
+                out,
+                "{name}_bucket{{{labels}{separator}le=\"{}\"}} {cumulative}",
+                seconds(*bound)
+            );
+        }
+        cumulative += self.buckets[self.bounds_us.len()].load(Ordering::Relaxed);
+        let _ = writeln!(
+            out,
+            "{name}_bucket{{{labels}{separator}le=\"+Inf\"}} {cumulative}"
+        );
+        let labels = if labels.is_empty() {
+            String::new()
+        } else {
+            format!("{{{labels}}}")
+        };
+        let sum = seconds(self.sum_us.load(Ordering::Relaxed));
+        let _ = writeln!(out, "{name}_sum{labels} {sum}");
+        let _ = writeln!(out, "{name}_count{labels} {cumulative}");
+    }
+}
+
+#[derive(Debug)]
+struct RouteSlot {
+    route: OnceLock<Box<str>>,
+    latency: FixedHistogram,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const EMPTY_ROUTE: RouteSlot = RouteSlot {
+    route: OnceLock::new(),
+    latency: FixedHistogram::new(DURATION_BUCKETS_US),
+};
+
+// Request latency per route template. A route claims a slot the first time
+// it is seen (the only allocation); after that recording is a scan over the
+// claimed names.
+#[derive(Debug)]
+pub struct RouteLatencies {
+    slots: [RouteSlot; HTTP_ROUTE_SLOTS],
+    other: FixedHistogram,
+}
+
+impl Default for RouteLatencies {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl RouteLatencies {
+    pub const fn new() -> Self {
+        Self {
+            slots: [EMPTY_ROUTE; HTTP_ROUTE_SLOTS],
+            other: FixedHistogram::new(DURATION_BUCKETS_US),
+        }
+    }
+
+    pub fn record(&self, route: &str, elapsed: Duration) {
+        self.histogram(route).record(elapsed);
+    }
+
+    fn histogram(&self, route: &str) -> &FixedHistogram {
+        for slot in &self.slots {
+            let claimed = match slot.route.get() {
+                Some(claimed) => claimed,
+                // Losing the race to another route moves on to the next slot.
+                None => slot.route.get_or_init(|| route.into()),
+            };
+            if claimed.as_ref() == route {
+                return &slot.latency;
+            }
+        }
+        &self.other
+    }
+
+    fn write(&self, out: &mut String, name: &str) {
+        for slot in &self.slots {
+            let Some(route) = slot.route.get() else {
+                break;
+            };
+            let labels = format!("route=\"{}\"", escape_label(route));
+            slot.latency.write(out, name, &labels);
+        }
+        if self.other.count() > 0 {
+            self.other.write(out, name, "route=\"other\"");
+        }
+    }
+}
+
+// Everything the controllers measure on their hot paths. One static instance
+// per process; every field is recorded without locking or allocating.
+#[derive(Debug)]
+pub struct ControllerMetrics {
+    pub loop_period: FixedHistogram,
+    pub loop_jitter: FixedHistogram,
+    pub tick_duration: FixedHistogram,
+    pub engine_lock_wait: FixedHistogram,
+    pub ir_lock_wait: FixedHistogram,
+    pub mqtt_received: Counter,
+    pub mqtt_errors: Counter,
+    pub ir_frame_duration: FixedHistogram,
+    pub ir_frame_failures: Counter,
+    pub storage_write_duration: FixedHistogram,
+    pub storage_write_failures: Counter,
+    pub http: RouteLatencies,
+}
+
+impl Default for ControllerMetrics {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl ControllerMetrics {
+    pub const fn new() -> Self {
+        Self {
+            loop_period: FixedHistogram::new(PERIOD_BUCKETS_US),
+            loop_jitter: FixedHistogram::new(DURATION_BUCKETS_US),
+            tick_duration: FixedHistogram::new(DURATION_BUCKETS_US),
+            engine_lock_wait: FixedHistogram::new(DURATION_BUCKETS_US),
+            ir_lock_wait: FixedHistogram::new(DURATION_BUCKETS_US),
+            mqtt_received: Counter::new(),
+            mqtt_errors: Counter::new(),
+            ir_frame_duration: FixedHistogram::new(DURATION_BUCKETS_US),
+            ir_frame_failures: Counter::new(),
+            storage_write_duration: FixedHistogram::new(DURATION_BUCKETS_US),
+            storage_write_failures: Counter::new(),
+            http: RouteLatencies::new(),
+        }
+    }
+
+    // Jitter is the distance from the nominal period in either direction.
+    pub fn record_loop_period(&self, period: Duration, nominal: Duration) {
+        self.loop_period.record(period);
+        self.loop_jitter.record(period.abs_diff(nominal));
+    }
+
+    pub fn record_storage_write<T, E>(&self, elapsed: Duration, result: &Result<T, E>) {
+        self.storage_write_duration.record(elapsed);
+        if result.is_err() {
+            self.storage_write_failures.inc();
+        }
+    }
+
+    // Prometheus text exposition format 0.0.4. The outbox and pipeline
+    // latencies keep their own counters, so they are read at scrape time.
+    pub fn render(&self, outbox: &OutboxStats, pipeline: &StageLatencies, out: &mut String) {
+        write_histogram(
+            out,
+            "thermostat_control_loop_period_seconds",
+            "Time between control loop iterations.",
+            &[("", &self.loop_period)],
+        );
+        write_histogram(
+            out,
+            "thermostat_control_loop_jitter_seconds",
+            "Deviation of the control loop period from nominal.",
+            &[("", &self.loop_jitter)],
+        );
+        write_histogram(
+            out,
+            "thermostat_control_tick_duration_seconds",
+            "Work done per control loop iteration.",
+            &[("", &self.tick_duration)],
+        );
+        write_histogram(
+            out,
+            "thermostat_lock_wait_seconds",
+            "Time spent waiting to acquire a shared lock.",
+            &[
+                ("lock=\"engine\"", &self.engine_lock_wait),
+                ("lock=\"ir\"", &self.ir_lock_wait),
+            ],
+        );
+        write_counter(
+            out,
+            "thermostat_mqtt_received_total",
+            "MQTT messages received.",
+            self.mqtt_received.get(),
+        );
+        write_counter(
+            out,
+            "thermostat_mqtt_errors_total",
+            "MQTT messages that failed to process.",
+            self.mqtt_errors.get(),
+        );
+        write_outbox(out, outbox);
+        write_histogram(
+            out,
+            "thermostat_ir_frame_duration_seconds",
+            "IR frame transmission time including repeats.",
+            &[("", &self.ir_frame_duration)],
+        );
+        write_counter(
+            out,
+            "thermostat_ir_frame_failures_total",
+            "IR frames that failed to transmit.",
+            self.ir_frame_failures.get(),
+        );
+        write_histogram(
+            out,
+            "thermostat_storage_write_duration_seconds",
+            "Settings and schedule writes (NVS on the ESP32, files on the host).",
+            &[("", &self.storage_write_duration)],
+        );
+        write_counter(
+            out,
+            "thermostat_storage_write_failures_total",
+            "Settings and schedule writes that failed.",
+            self.storage_write_failures.get(),
+        );
+        write_header(
+            out,
+            "thermostat_http_request_duration_seconds",
+            "HTTP request handling time per route.",
+            "histogram",
+        );
+        self.http
+            .write(out, "thermostat_http_request_duration_seconds");
+        write_pipeline(out, pipeline);
+    }
+}
+
+pub fn write_gauge(out: &mut String, name: &str, help: &str, value: u64) {
+    write_header(out, name, help, "gauge");
+    let _ = writeln!(out, "{name} {value}");
+}
+
+pub fn write_counter(out: &mut String, name: &str, help: &str, value: u64) {
+    write_header(out, name, help, "counter");
+    let _ = writeln!(out, "{name} {value}");
+}
+
+fn write_histogram(out: &mut String, name: &str, help: &str, series: &[(&str, &FixedHistogram)]) {
+    write_header(out, name, help, "histogram");
+    for (labels, histogram) in series {
+        histogram.write(out, name, labels);
+    }
+}
+
+fn write_header(out: &mut String, name: &str, help: &str, kind: &str) {
+    let _ = writeln!(out, "# HELP {name} {help}");
+    let _ = writeln!(out, "# TYPE {name} {kind}");
+}
+
+// Metric name suffix, help text and the field it reads.
+type OutboxCounter = (&'static str, &'static str, fn(&ClassStats) -> u64);
+
+fn write_outbox(out: &mut String, outbox: &OutboxStats) {
+    let classes: [(&str, &ClassStats); 4] = [
+        ("state", &outbox.state),
+        ("schedule", &outbox.schedule),
+        ("diagnostics", &outbox.diagnostics),
+        ("command", &outbox.command),
+    ];
+    let counters: [OutboxCounter; 5] = [
+        ("enqueued", "Messages queued for publishing.", |s| {
+            s.enqueued
+        }),
+        ("published", "Messages handed to the MQTT client.", |s| {
+            s.published
+        }),
+        (
+            "collapsed",
+            "Messages replaced by a newer payload for the same topic.",
+            |s| s.collapsed,
+        ),
+        (
+            "dropped",
+            "Messages dropped because the queue was full.",
+            |s| s.dropped,
+        ),
+        (
+            "failed",
+            "Publish attempts that failed and were retried.",
+            |s| s.failed,
+        ),
+    ];
+    for (field, help, value) in counters {
+        let name = format!("thermostat_mqtt_outbox_{field}_total");
+        write_header(out, &name, help, "counter");
+        for (class, stats) in classes {
+            let _ = writeln!(out, "{name}{{class=\"{class}\"}} {}", value(stats));
+        }
+    }
+    write_header(
+        out,
+        "thermostat_mqtt_outbox_depth",
+        "Messages waiting in the outbox.",
+        "gauge",
+    );
+    for (class, stats) in classes {
+        let _ = writeln!(
+            out,
+            "thermostat_mqtt_outbox_depth{{class=\"{class}\"}} {}",
+            stats.depth
+        );
+    }
+}
+
+fn write_pipeline(out: &mut String, pipeline: &StageLatencies) {
+    let name = "thermostat_pipeline_latency_seconds";
+    write_header(
+        out,
+        name,
+        "Sensor-to-IR latency per pipeline stage.",
+        "summary",
+    );
+    for view in pipeline.views() {
+        let stage = view.stage;
+        let latency = view.latency_ms;
+        for (quantile, value_ms) in [
+            ("0.5", latency.p50),
+            ("0.9", latency.p90),
+            ("0.99", latency.p99),
+        ] {
+            let _ = writeln!(
+                out,
+                "{name}{{stage=\"{stage}\",quantile=\"{quantile}\"}} {}",
+                seconds(value_ms * 1_000)
+            );
+        }
+        let sum_ms = latency.mean * latency.count as f64;
+        let _ = writeln!(out, "{name}_sum{{stage=\"{stage}\"}} {}", sum_ms / 1_000.0);
+        let _ = writeln!(out, "{name}_count{{stage=\"{stage}\"}} {}", latency.count);
+    }
+}
+
+fn seconds(value_us: u64) -> f64 {
+    value_us as f64 / 1_000_000.0
+}
+
+fn escape_label(value: &str) -> String {
+    value
+        .replace('\\', "\\\\")
+        .replace('"', "\\\"")
+        .replace('\n', "\\n")
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn histogram_buckets_are_cumulative() {
+        let histogram = FixedHistogram::new(&[100, 1_000]);
+        for value_us in [50, 100, 101, 5_000] {
+            histogram.record_us(value_us);
+        }
+        let mut out = String::new();
+        histogram.write(&mut out, "t", "lock=\"engine\"");
+        assert_eq!(
+            out,
+            "t_bucket{lock=\"engine\",le=\"0.0001\"} 2\n\
+             t_bucket{lock=\"engine\",le=\"0.001\"} 3\n\
+             t_bucket{lock=\"engine\",le=\"+Inf\"} 4\n\
+             t_sum{lock=\"engine\"} 0.005251\n\
+             t_count{lock=\"engine\"} 4\n"
+        );
+    }
+
+    #[test]
+    fn routes_claim_slots_and_render() {
+        let routes = RouteLatencies::new();
+        for index in 0..HTTP_ROUTE_SLOTS + 2 {
+            routes.record(&format!("/api/r{index}"), Duration::from_micros(20));
+        }
+        routes.record("/api/r0", Duration::from_secs(10));
+        assert_eq!(routes.histogram("/api/r0").count(), 2);
+        assert_eq!(routes.other.count(), 2);
+
+        let metrics = ControllerMetrics::new();
+        metrics.record_loop_period(Duration::from_millis(1_004), Duration::from_secs(1));
+        metrics
+            .http
+            .record("/api/zones/{id}", Duration::from_millis(3));
+        let mut out = String::new();
+        metrics.render(&OutboxStats::default(), &StageLatencies::new(), &mut out);
+        assert!(out.contains("thermostat_control_loop_jitter_seconds_bucket{le=\"0.005\"} 1\n"));
+        assert!(out.contains(
+            "thermostat_http_request_duration_seconds_count{route=\"/api/zones/{id}\"} 1\n"
+        ));
+        assert!(out.contains("thermostat_mqtt_outbox_dropped_total{class=\"state\"} 0\n"));
+        assert!(out.contains("# TYPE thermostat_pipeline_latency_seconds summary\n"));
+    }
+}
@@ -0,0 +1,378 @@
+use std::{borrow::Cow, collections::VecDeque};
+
+use serde::Serialize;
+use serde_json::{Map, Value};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum TopicClass {
+    State,
+    // Deltas share the state queue and its limits, but a newer delta is
+    // merged into a queued one instead of replacing it.
+    StateDelta,
+    Schedule,
+    Diagnostics,
+    // Requests to other devices, such as sensor bursts. Their own queue keeps
+    // them from evicting, or being evicted by, state snapshots.
+    Command,
+}
+
+impl TopicClass {
+    // Drain order. Commands are rare and only useful while fresh, so they
+    // go first.
+    const ALL: [Self; 4] = [
+        Self::Command,
+        Self::State,
+        Self::Schedule,
+        Self::Diagnostics,
+    ];
+
+    fn index(self) -> usize {
+        match self {
+            Self::State | Self::StateDelta => 0,
+            Self::Schedule => 1,
+            Self::Diagnostics => 2,
+            Self::Command => 3,
+        }
+    }
+
+    // State and schedule topics carry snapshots, and a newer command to the
+    // same topic supersedes a queued one, so only the newest payload per
+    // topic is worth sending. Diagnostics are events and stay FIFO.
+    fn latest_wins(self) -> bool {
+        !matches!(self, Self::Diagnostics)
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PublishQos {
+    AtMostOnce,
+    AtLeastOnce,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct OutboundMessage {
+    pub class: TopicClass,
+    pub topic: Cow<'static, str>,
+    pub qos: PublishQos,
+    pub retain: bool,
+    pub payload: Vec<u8>,
+}
+
+impl OutboundMessage {
+    pub fn new(
+        class: TopicClass,
+        topic: impl Into<Cow<'static, str>>,
+        qos: PublishQos,
+        retain: bool,
+        payload: Vec<u8>,
+    ) -> Self {
+        Self {
+            class,
+            topic: topic.into(),
+            qos,
+            retain,
+            payload,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum EnqueueOutcome {
+    Queued,
+    Collapsed,
+    DroppedOldest,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct ClassStats {
+    pub depth: usize,
+    pub capacity: usize,
+    pub enqueued: u64,
+    pub collapsed: u64,
+    pub dropped: u64,
+    pub published: u64,
+    pub failed: u64,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct OutboxStats {
+    pub state: ClassStats,
+    pub schedule: ClassStats,
+    pub diagnostics: ClassStats,
+    pub command: ClassStats,
+}
+
+#[derive(Debug)]
+pub struct Outbox {
+    queues: [VecDeque<OutboundMessage>; 4],
+    stats: [ClassStats; 4],
+}
+
+impl Default for Outbox {
+    fn default() -> Self {
+        Self::new(8, 4, 8, 4)
+    }
+}
+
+impl Outbox {
+    pub fn new(
+        state_capacity: usize,
+        schedule_capacity: usize,
+        diagnostics_capacity: usize,
+        command_capacity: usize,
+    ) -> Self {
+        let capacities = [
+            state_capacity,
+            schedule_capacity,
+            diagnostics_capacity,
+            command_capacity,
+        ];
+        Self {
+            queues: capacities.map(|capacity| VecDeque::with_capacity(capacity.max(1))),
+            stats: capacities.map(|capacity| ClassStats {
+                capacity: capacity.max(1),
+                ..ClassStats::default()
+            }),
+        }
+    }
+
+    // Never blocks: a full class sheds its oldest message instead of making
+    // the caller wait for the broker.
+    pub fn enqueue(&mut self, message: OutboundMessage) -> EnqueueOutcome {
+        let class = message.class.index();
+        self.stats[class].enqueued += 1;
+        self.insert(message, false)
+    }
+
+    pub fn pop(&mut self) -> Option<OutboundMessage> {
+        TopicClass::ALL
+            .iter()
+            .find_map(|class| self.queues[class.index()].pop_front())
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.queues.iter().all(VecDeque::is_empty)
+    }
+
+    pub fn record_published(&mut self, class: TopicClass) {
+        self.stats[class.index()].published += 1;
+    }
+
+    // Puts a message that failed to publish back at the head of its queue,
+    // unless a newer payload for the same topic arrived in the meantime.
+    pub fn retry(&mut self, message: OutboundMessage) -> EnqueueOutcome {
+        self.stats[message.class.index()].failed += 1;
+        let class = message.class;
+        let queue = &mut self.queues[class.index()];
+        if class.latest_wins() {
+            if let Some(queued) = queue
+                .iter_mut()
+                .find(|queued| queued.topic == message.topic)
+            {
+                if class == TopicClass::StateDelta {
+                    merge_delta(&message.payload, &mut queued.payload);
+                }
+                self.stats[class.index()].collapsed += 1;
+                return EnqueueOutcome::Collapsed;
+            }
+        }
+        self.insert(message, true)
+    }
+
+    pub fn stats(&self) -> OutboxStats {
+        let snapshot = |class: TopicClass| ClassStats {
+            depth: self.queues[class.index()].len(),
+            ..self.stats[class.index()]
+        };
+        OutboxStats {
+            state: snapshot(TopicClass::State),
+            schedule: snapshot(TopicClass::Schedule),
+            diagnostics: snapshot(TopicClass::Diagnostics),
+            command: snapshot(TopicClass::Command),
+        }
+    }
+
+    fn insert(&mut self, mut message: OutboundMessage, front: bool) -> EnqueueOutcome {
+        let class = message.class;
+        let stats = &mut self.stats[class.index()];
+        let queue = &mut self.queues[class.index()];
+
+        if class.latest_wins() {
+            if let Some(queued) = queue
+                .iter_mut()
+                .find(|queued| queued.topic == message.topic)
+            {
+                if class == TopicClass::StateDelta {
+                    merge_delta(&queued.payload, &mut message.payload);
+                }
+                *queued = message;
+                stats.collapsed += 1;
+                return EnqueueOutcome::Collapsed;
+            }
+        }
+
+        let mut outcome = EnqueueOutcome::Queued;
+        if queue.len() >= stats.capacity {
+            if front {
+                // A retried message is older than everything queued behind it.
+                stats.dropped += 1;
+                return EnqueueOutcome::DroppedOldest;
+            }
+            queue.pop_front();
+            stats.dropped += 1;
+            outcome = EnqueueOutcome::DroppedOldest;
+        }
+
+        if front {
+            queue.push_front(message);
+        } else {
+            queue.push_back(message);
+        }
+        outcome
+    }
+}
+
+// Folds the fields of an older JSON delta under a newer one. The publisher
+// counts a queued delta as sent, so dropping it would lose those changes.
+fn merge_delta(older: &[u8], newer: &mut Vec<u8>) {
+    let (Ok(mut merged), Ok(latest)) = (
+        serde_json::from_slice::<Map<String, Value>>(older),
+        serde_json::from_slice::<Map<String, Value>>(newer),
+    ) else {
+        return;
+    };
+    merged.extend(latest);
+    if let Ok(payload) = serde_json::to_vec(&merged) {
+        *newer = payload;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn message(class: TopicClass, topic: &'static str, payload: &[u8]) -> OutboundMessage {
+        OutboundMessage::new(
+            class,
+            topic,
+            PublishQos::AtLeastOnce,
+            true,
+            payload.to_vec(),
+        )
+    }
+
+    #[test]
+    fn state_topics_collapse_to_latest_value() {
+        let mut outbox = Outbox::new(4, 2, 4, 2);
+        outbox.enqueue(message(TopicClass::State, "state", b"1"));
+        outbox.enqueue(message(TopicClass::State, "delta", b"a"));
+        assert_eq!(
+            outbox.enqueue(message(TopicClass::State, "state", b"2")),
+            EnqueueOutcome::Collapsed
+        );
+
+        assert_eq!(outbox.pop().unwrap().payload, b"2");
+        assert_eq!(outbox.pop().unwrap().payload, b"a");
+        assert!(outbox.pop().is_none());
+        assert_eq!(outbox.stats().state.collapsed, 1);
+    }
+
+    #[test]
+    fn collapsed_deltas_keep_every_changed_field() {
+        let mut outbox = Outbox::new(4, 2, 4, 2);
+        outbox.enqueue(message(
+            TopicClass::StateDelta,
+            "delta",
+            br#"{"mode":"HEAT","target":70.0,"version":2}"#,
+        ));
+        assert_eq!(
+            outbox.enqueue(message(
+                TopicClass::StateDelta,
+                "delta",
+                br#"{"target":71.0,"version":3}"#,
+            )),
+            EnqueueOutcome::Collapsed
+        );
+
+        let merged: Value = serde_json::from_slice(&outbox.pop().unwrap().payload).unwrap();
+        assert_eq!(
+            merged,
+            serde_json::json!({"mode": "HEAT", "target": 71.0, "version": 3})
+        );
+
+        // A failed delta folds under the one queued after it.
+        outbox.enqueue(message(
+            TopicClass::StateDelta,
+            "delta",
+            br#"{"temp":68.5}"#,
+        ));
+        let failed = outbox.pop().unwrap();
+        outbox.enqueue(message(
+            TopicClass::StateDelta,
+            "delta",
+            br#"{"state":"HEATING"}"#,
+        ));
+        assert_eq!(outbox.retry(failed), EnqueueOutcome::Collapsed);
+        let merged: Value = serde_json::from_slice(&outbox.pop().unwrap().payload).unwrap();
+        assert_eq!(
+            merged,
+            serde_json::json!({"temp": 68.5, "state": "HEATING"})
+        );
+        assert_eq!(outbox.stats().state.collapsed, 2);
+    }
+
+    #[test]
+    fn full_class_drops_oldest_without_touching_others() {
+        let mut outbox = Outbox::new(4, 2, 2, 2);
+        outbox.enqueue(message(TopicClass::Schedule, "schedule", b"s"));
+        for payload in [b"1", b"2", b"3"] {
+            outbox.enqueue(message(TopicClass::Diagnostics, "diag", payload));
+        }
+
+        let stats = outbox.stats();
+        assert_eq!(stats.diagnostics.dropped, 1);
+        assert_eq!(stats.diagnostics.depth, 2);
+        assert_eq!(stats.schedule.depth, 1);
+
+        // Schedule drains before diagnostics; the oldest diagnostic is gone.
+        assert_eq!(outbox.pop().unwrap().payload, b"s");
+        assert_eq!(outbox.pop().unwrap().payload, b"2");
+    }
+
+    #[test]
+    fn failed_publish_is_retried_unless_superseded() {
+        let mut outbox = Outbox::default();
+        outbox.enqueue(message(TopicClass::State, "state", b"1"));
+        let first = outbox.pop().unwrap();
+
+        assert_eq!(outbox.retry(first.clone()), EnqueueOutcome::Queued);
+        let first = outbox.pop().unwrap();
+        outbox.enqueue(message(TopicClass::State, "state", b"2"));
+        assert_eq!(outbox.retry(first), EnqueueOutcome::Collapsed);
+
+        assert_eq!(outbox.pop().unwrap().payload, b"2");
+        assert_eq!(outbox.stats().state.failed, 2);
+    }
+
+    #[test]
+    fn commands_do_not_share_the_state_queue() {
+        let mut outbox = Outbox::new(1, 2, 2, 2);
+        outbox.enqueue(message(TopicClass::State, "state", b"snapshot"));
+        assert_eq!(
+            outbox.enqueue(message(TopicClass::Command, "burst", b"1")),
+            EnqueueOutcome::Queued
+        );
+        assert_eq!(
+            outbox.enqueue(message(TopicClass::Command, "burst", b"2")),
+            EnqueueOutcome::Collapsed
+        );
+
+        let stats = outbox.stats();
+        assert_eq!(stats.state.depth, 1);
+        assert_eq!(stats.state.dropped, 0);
+        assert_eq!(stats.command.depth, 1);
+
+        assert_eq!(outbox.pop().unwrap().payload, b"2");
+        assert_eq!(outbox.pop().unwrap().payload, b"snapshot");
+    }
+}
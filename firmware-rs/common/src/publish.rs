@@ -0,0 +1,297 @@
+use serde_json::{Map, Value};
+
+use crate::{config::ThermostatConfig, types::ControllerStatePayload};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PublishReason {
+    Changed,
+    Heartbeat,
+}
+
+#[derive(Debug, Clone)]
+pub struct StateUpdate {
+    pub reason: PublishReason,
+    pub version: u64,
+    // Retained full snapshot. With deltas enabled this is only sent on the
+    // first publish and on heartbeats; changes in between go out as deltas.
+    pub full: Option<ControllerStatePayload>,
+    pub delta: Option<Map<String, Value>>,
+    // The snapshot this update describes; `commit` records it as published.
+    pub snapshot: ControllerStatePayload,
+}
+
+#[derive(Debug, Default)]
+pub struct StatePublisher {
+    version: u64,
+    last_published: Option<ControllerStatePayload>,
+    last_publish_ms: Option<u64>,
+    last_full_ms: Option<u64>,
+    schedule_version: Option<u64>,
+}
+
+impl StatePublisher {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn version(&self) -> u64 {
+        self.version
+    }
+
+    pub fn last_published(&self) -> Option<&ControllerStatePayload> {
+        self.last_published.as_ref()
+    }
+
+    // Nothing is recorded until `commit`, so an update that fails to
+    // serialize or enqueue is offered again on the next poll.
+    pub fn poll(
+        &self,
+        payload: ControllerStatePayload,
+        now_ms: u64,
+        config: &ThermostatConfig,
+    ) -> Option<StateUpdate> {
+        let changed = self.last_published.as_ref() != Some(&payload);
+        let since_publish = self.last_publish_ms.map(|last| now_ms.saturating_sub(last));
+        let heartbeat_due = self.last_full_ms.map_or(true, |last| {
+            now_ms.saturating_sub(last) >= config.state_heartbeat_interval_ms
+        });
+
+        let reason = if changed {
+            // Hold the change back while rate limited; it is still pending on
+            // the next poll because nothing was committed.
+            if since_publish.is_some_and(|elapsed| elapsed < config.state_min_publish_interval_ms) {
+                return None;
+            }
+            PublishReason::Changed
+        } else if heartbeat_due {
+            PublishReason::Heartbeat
+        } else {
+            return None;
+        };
+
+        let version = if changed {
+            self.version.wrapping_add(1)
+        } else {
+            self.version
+        };
+
+        let send_delta = config.state_delta_enabled
+            && reason == PublishReason::Changed
+            && self.last_published.is_some()
+            && !heartbeat_due;
+
+        let (full, delta) = if send_delta {
+            let delta = self
+                .last_published
+                .as_ref()
+                .map(|previous| state_delta(previous, &payload, version));
+            (None, delta)
+        } else {
+            (Some(payload.clone()), None)
+        };
+
+        Some(StateUpdate {
+            reason,
+            version,
+            full,
+            delta,
+            snapshot: payload,
+        })
+    }
+
+    // Call once the update's payloads are in the outbox.
+    pub fn commit(&mut self, update: &StateUpdate, now_ms: u64) {
+        self.version = update.version;
+        if update.full.is_some() {
+            self.last_full_ms = Some(now_ms);
+        }
+        self.last_publish_ms = Some(now_ms);
+        self.last_published = Some(update.snapshot.clone());
+    }
+
+    pub fn schedule_due(&self, schedule_version: u64) -> bool {
+        self.schedule_version != Some(schedule_version)
+    }
+
+    pub fn mark_schedule_published(&mut self, schedule_version: u64) {
+        self.schedule_version = Some(schedule_version);
+    }
+
+    // Retained state can be lost when the broker restarts, so a fresh MQTT
+    // session republishes everything on the next poll.
+    pub fn force(&mut self) {
+        self.last_published = None;
+        self.last_publish_ms = None;
+        self.last_full_ms = None;
+        self.schedule_version = None;
+    }
+}
+
+pub fn state_delta(
+    previous: &ControllerStatePayload,
+    current: &ControllerStatePayload,
+    version: u64,
+) -> Map<String, Value> {
+    let mut delta = Map::new();
+    let (Ok(Value::Object(previous)), Ok(Value::Object(current))) = (
+        serde_json::to_value(previous),
+        serde_json::to_value(current),
+    ) else {
+        return delta;
+    };
+
+    for (key, value) in current {
+        if previous.get(&key) != Some(&value) {
+            delta.insert(key, value);
+        }
+    }
+    delta.insert("version".to_string(), Value::from(version));
+    delta
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{
+        config::PersistedSettings, temperature::DeciDegrees, thermostat::ThermostatEngine,
+        types::ThermostatMode,
+    };
+
+    // Polls and commits, as a publish that reaches the outbox does.
+    fn publish(
+        publisher: &mut StatePublisher,
+        payload: ControllerStatePayload,
+        now_ms: u64,
+        config: &ThermostatConfig,
+    ) -> Option<StateUpdate> {
+        let update = publisher.poll(payload, now_ms, config)?;
+        publisher.commit(&update, now_ms);
+        Some(update)
+    }
+
+    #[test]
+    fn publishes_on_change_and_heartbeat_only() {
+        let config = ThermostatConfig::default();
+        let mut engine = ThermostatEngine::new(config.clone(), PersistedSettings::default());
+        let mut publisher = StatePublisher::new();
+
+        let first = publish(&mut publisher, engine.state_payload(0), 0, &config).unwrap();
+        assert_eq!(first.reason, PublishReason::Changed);
+        assert!(first.full.is_some());
+        assert!(publish(&mut publisher, engine.state_payload(500), 500, &config).is_none());
+        assert!(publish(
+            &mut publisher,
+            engine.state_payload(30_000),
+            30_000,
+            &config
+        )
+        .is_none());
+
+        engine.update_sensor_data(DeciDegrees::from_tenths(685), 40.0, 30_000);
+        let changed = publish(
+            &mut publisher,
+            engine.state_payload(30_000),
+            30_000,
+            &config,
+        )
+        .unwrap();
+        assert_eq!(changed.reason, PublishReason::Changed);
+        assert_eq!(changed.version, 2);
+
+        assert!(publish(
+            &mut publisher,
+            engine.state_payload(60_000),
+            60_000,
+            &config
+        )
+        .is_none());
+        let heartbeat = publish(
+            &mut publisher,
+            engine.state_payload(90_000),
+            90_000,
+            &config,
+        )
+        .unwrap();
+        assert_eq!(heartbeat.reason, PublishReason::Heartbeat);
+        assert_eq!(heartbeat.version, 2);
+    }
+
+    #[test]
+    fn rate_limits_changes_without_losing_them() {
+        let config = ThermostatConfig::default();
+        let mut engine = ThermostatEngine::new(config.clone(), PersistedSettings::default());
+        let mut publisher = StatePublisher::new();
+        publish(&mut publisher, engine.state_payload(0), 0, &config);
+
+        engine.update_sensor_data(DeciDegrees::from_tenths(685), 40.0, 200);
+        assert!(publish(&mut publisher, engine.state_payload(200), 200, &config).is_none());
+
+        let retry_ms = config.state_min_publish_interval_ms;
+        let update = publish(
+            &mut publisher,
+            engine.state_payload(retry_ms),
+            retry_ms,
+            &config,
+        )
+        .unwrap();
+        assert_eq!(update.full.unwrap().temp, DeciDegrees::from_tenths(685));
+    }
+
+    #[test]
+    fn delta_carries_only_changed_fields() {
+        let config = ThermostatConfig {
+            state_delta_enabled: true,
+            ..ThermostatConfig::default()
+        };
+        let mut engine = ThermostatEngine::new(config.clone(), PersistedSettings::default());
+        let mut publisher = StatePublisher::new();
+        assert!(publish(&mut publisher, engine.state_payload(0), 0, &config)
+            .unwrap()
+            .full
+            .is_some());
+
+        engine.set_mode(ThermostatMode::Heat);
+        let update = publish(&mut publisher, engine.state_payload(5_000), 5_000, &config).unwrap();
+        assert!(update.full.is_none());
+        let delta = update.delta.unwrap();
+        assert_eq!(delta.get("mode"), Some(&Value::from("HEAT")));
+        assert_eq!(delta.get("version"), Some(&Value::from(2u64)));
+        assert!(!delta.contains_key("temp"));
+    }
+
+    #[test]
+    fn uncommitted_update_is_offered_again() {
+        let config = ThermostatConfig::default();
+        let mut engine = ThermostatEngine::new(config.clone(), PersistedSettings::default());
+        let mut publisher = StatePublisher::new();
+        publish(&mut publisher, engine.state_payload(0), 0, &config);
+
+        engine.update_sensor_data(DeciDegrees::from_tenths(685), 40.0, 5_000);
+        let dropped = publisher
+            .poll(engine.state_payload(5_000), 5_000, &config)
+            .unwrap();
+        let retried = publisher
+            .poll(engine.state_payload(5_250), 5_250, &config)
+            .unwrap();
+        assert_eq!(retried.version, dropped.version);
+        assert_eq!(retried.reason, PublishReason::Changed);
+
+        publisher.commit(&retried, 5_250);
+        assert!(publisher
+            .poll(engine.state_payload(5_500), 5_500, &config)
+            .is_none());
+    }
+
+    #[test]
+    fn schedule_republishes_only_on_version_bump() {
+        let mut publisher = StatePublisher::new();
+        assert!(publisher.schedule_due(0));
+        publisher.mark_schedule_published(0);
+        assert!(!publisher.schedule_due(0));
+        assert!(publisher.schedule_due(1));
+
+        publisher.mark_schedule_published(1);
+        publisher.force();
+        assert!(publisher.schedule_due(1));
+    }
+}
@@ -1,7 +1,13 @@
 use chrono::{DateTime, Datelike, Duration, FixedOffset, TimeZone, Timelike, Weekday};
 use serde::{Deserialize, Serialize};
 
-use crate::types::ThermostatMode;
+use crate::{
+    bounded::BoundedVec, config::PersistedSettings, temperature::DeciDegrees, types::ThermostatMode,
+};
+
+// The compact transfer format's limit, and without std the capacity of
+// `Schedule::entries`.
+pub const MAX_SCHEDULE_ENTRIES: usize = 512;
 
 #[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Serialize, Deserialize)]
 #[serde(rename_all = "UPPERCASE")]
@@ -28,6 +34,18 @@ impl DayOfWeek {
         }
     }
 
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Self::Mon => "MON",
+            Self::Tue => "TUE",
+            Self::Wed => "WED",
+            Self::Thu => "THU",
+            Self::Fri => "FRI",
+            Self::Sat => "SAT",
+            Self::Sun => "SUN",
+        }
+    }
+
     pub fn from_index(index: usize) -> Self {
         match index % 7 {
             0 => Self::Mon,
@@ -53,50 +71,56 @@ impl DayOfWeek {
     }
 }
 
-#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq, Eq)]
 pub struct ScheduleEntry {
     pub day: DayOfWeek,
     #[serde(rename = "startMinutes")]
     pub start_minutes: u16,
     pub mode: ThermostatMode,
     #[serde(rename = "targetTemp")]
-    pub target_temp_f: f32,
+    pub target_temp_f: DeciDegrees,
 }
 
 impl ScheduleEntry {
     pub fn validate(&self) -> bool {
         self.start_minutes < 24 * 60
-            && self.target_temp_f.is_finite()
-            && (60.0..=84.0).contains(&self.target_temp_f)
+            && (PersistedSettings::TARGET_MIN..=PersistedSettings::TARGET_MAX)
+                .contains(&self.target_temp_f)
+    }
+
+    fn sort_key(&self) -> (usize, u16) {
+        (self.day.index(), self.start_minutes)
     }
 }
 
-#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq, Eq)]
 pub struct Schedule {
     pub enabled: bool,
-    pub entries: Vec<ScheduleEntry>,
+    pub entries: BoundedVec<ScheduleEntry, MAX_SCHEDULE_ENTRIES>,
 }
 
 impl Default for Schedule {
     fn default() -> Self {
         Self {
             enabled: false,
-            entries: Vec::new(),
+            entries: BoundedVec::new(),
         }
     }
 }
 
-#[derive(Debug, Clone, Copy, PartialEq)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub struct ScheduleAction {
     pub mode: ThermostatMode,
-    pub target_temp_f: f32,
+    pub target_temp_f: DeciDegrees,
 }
 
 impl Schedule {
     pub fn normalize(&mut self) {
         self.entries.retain(ScheduleEntry::validate);
-        self.entries
-            .sort_by_key(|entry| (entry.day.index(), entry.start_minutes));
+        #[cfg(feature = "std")]
+        self.entries.sort_by_key(ScheduleEntry::sort_key);
+        #[cfg(not(feature = "std"))]
+        insertion_sort(&mut self.entries);
     }
 
     pub fn current_action(&self, now: DateTime<FixedOffset>) -> Option<ScheduleAction> {
@@ -176,6 +200,19 @@ impl Schedule {
     }
 }
 
+// Stable like `sort_by_key`, which needs an allocator. Schedules arrive
+// mostly sorted, so this stays close to linear.
+#[cfg(not(feature = "std"))]
+fn insertion_sort(entries: &mut [ScheduleEntry]) {
+    for sorted in 1..entries.len() {
+        let mut index = sorted;
+        while index > 0 && entries[index - 1].sort_key() > entries[index].sort_key() {
+            entries.swap(index - 1, index);
+            index -= 1;
+        }
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -191,12 +228,14 @@ mod tests {
     fn wraps_schedule_to_previous_day() {
         let mut schedule = Schedule {
             enabled: true,
-            entries: vec![ScheduleEntry {
+            entries: [ScheduleEntry {
                 day: DayOfWeek::Sun,
                 start_minutes: 23 * 60,
                 mode: ThermostatMode::Heat,
-                target_temp_f: 69.0,
-            }],
+                target_temp_f: DeciDegrees::from_degrees(69),
+            }]
+            .into_iter()
+            .collect(),
         };
         schedule.normalize();
 
@@ -205,27 +244,29 @@ mod tests {
         let action = schedule.current_action(now).unwrap();
 
         assert_eq!(action.mode, ThermostatMode::Heat);
-        assert_eq!(action.target_temp_f, 69.0);
+        assert_eq!(action.target_temp_f, DeciDegrees::from_degrees(69));
     }
 
     #[test]
     fn finds_next_event_in_current_week() {
         let mut schedule = Schedule {
             enabled: true,
-            entries: vec![
+            entries: [
                 ScheduleEntry {
                     day: DayOfWeek::Mon,
                     start_minutes: 9 * 60,
                     mode: ThermostatMode::Heat,
-                    target_temp_f: 71.0,
+                    target_temp_f: DeciDegrees::from_degrees(71),
                 },
                 ScheduleEntry {
                     day: DayOfWeek::Mon,
                     start_minutes: 18 * 60,
                     mode: ThermostatMode::Off,
-                    target_temp_f: 68.0,
+                    target_temp_f: DeciDegrees::from_degrees(68),
                 },
-            ],
+            ]
+            .into_iter()
+            .collect(),
         };
         schedule.normalize();
 
@@ -235,4 +276,45 @@ mod tests {
 
         assert_eq!(next, expected);
     }
+
+    #[test]
+    fn normalize_orders_entries_and_keeps_ties_in_input_order() {
+        let entry = |day, hour: u16, degrees| ScheduleEntry {
+            day,
+            start_minutes: hour * 60,
+            mode: ThermostatMode::Heat,
+            target_temp_f: DeciDegrees::from_degrees(degrees),
+        };
+        let mut schedule = Schedule {
+            enabled: true,
+            entries: [
+                entry(DayOfWeek::Tue, 7, 70),
+                entry(DayOfWeek::Mon, 22, 64),
+                entry(DayOfWeek::Mon, 6, 71),
+                entry(DayOfWeek::Mon, 22, 62),
+                entry(DayOfWeek::Sun, 30, 70),
+            ]
+            .into_iter()
+            .collect(),
+        };
+        schedule.normalize();
+
+        let order: BoundedVec<_, 4> = schedule
+            .entries
+            .iter()
+            .map(|entry| (entry.day, entry.start_minutes / 60, entry.target_temp_f))
+            .collect();
+        assert_eq!(
+            order,
+            [
+                (DayOfWeek::Mon, 6, DeciDegrees::from_degrees(71)),
+                (DayOfWeek::Mon, 22, DeciDegrees::from_degrees(64)),
+                (DayOfWeek::Mon, 22, DeciDegrees::from_degrees(62)),
+                (DayOfWeek::Tue, 7, DeciDegrees::from_degrees(70)),
+            ]
+        );
+        // The later of two entries at the same time wins.
+        let action = schedule.current_action(fixed_time(5, 23, 0)).unwrap();
+        assert_eq!(action.target_temp_f, DeciDegrees::from_degrees(62));
+    }
 }
@@ -0,0 +1,499 @@
+use std::fmt::Write as _;
+
+use thiserror::Error;
+
+pub use crate::schedule::MAX_SCHEDULE_ENTRIES;
+use crate::{
+    schedule::{DayOfWeek, Schedule, ScheduleEntry},
+    temperature::DeciDegrees,
+    types::ThermostatMode,
+};
+
+// Compact line-oriented schedule format:
+//
+//   ENABLED
+//   MON 06:30 HEAT 71.5
+//   MON 22:00 OFF 62
+//
+// The first non-comment line is ENABLED or DISABLED, every following line is
+// one entry. Lines may end in '\n' or ';' and '#' starts a comment line.
+const MAX_LINE_LEN: usize = 48;
+
+#[derive(Debug, Clone, PartialEq, Eq, Error)]
+pub enum ScheduleTransferError {
+    #[error("line {0} is too long")]
+    LineTooLong(usize),
+    #[error("line {0}: expected ENABLED or DISABLED")]
+    MissingHeader(usize),
+    #[error("line {0}: invalid schedule entry")]
+    InvalidEntry(usize),
+    #[error("schedule exceeds {MAX_SCHEDULE_ENTRIES} entries")]
+    TooManyEntries,
+    #[error("schedule document is empty")]
+    Empty,
+    #[error("invalid chunk header")]
+    InvalidChunkHeader,
+    #[error("chunk {got} out of sequence, expected {expected}")]
+    OutOfSequence { expected: u16, got: u16 },
+    #[error("no transfer in progress")]
+    NoTransfer,
+}
+
+#[derive(Debug)]
+pub struct ScheduleParser {
+    line: [u8; MAX_LINE_LEN],
+    line_len: usize,
+    line_no: usize,
+    overflow: bool,
+    enabled: Option<bool>,
+    entries: Vec<ScheduleEntry>,
+}
+
+impl Default for ScheduleParser {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl ScheduleParser {
+    pub fn new() -> Self {
+        Self {
+            line: [0; MAX_LINE_LEN],
+            line_len: 0,
+            line_no: 0,
+            overflow: false,
+            enabled: None,
+            entries: Vec::new(),
+        }
+    }
+
+    pub fn entry_count(&self) -> usize {
+        self.entries.len()
+    }
+
+    // Input may be split at any byte; only the current line is buffered.
+    pub fn feed(&mut self, bytes: &[u8]) -> Result<(), ScheduleTransferError> {
+        for &byte in bytes {
+            match byte {
+                b'\n' | b';' => self.end_line()?,
+                b'\r' => {}
+                _ if self.line_len < MAX_LINE_LEN => {
+                    self.line[self.line_len] = byte;
+                    self.line_len += 1;
+                }
+                _ => self.overflow = true,
+            }
+        }
+        Ok(())
+    }
+
+    pub fn finish(mut self) -> Result<Schedule, ScheduleTransferError> {
+        self.end_line()?;
+        let Some(enabled) = self.enabled else {
+            return Err(ScheduleTransferError::Empty);
+        };
+
+        let mut schedule = Schedule {
+            enabled,
+            entries: self.entries,
+        };
+        schedule.normalize();
+        Ok(schedule)
+    }
+
+    fn end_line(&mut self) -> Result<(), ScheduleTransferError> {
+        self.line_no += 1;
+        let line_no = self.line_no;
+        let line_len = std::mem::take(&mut self.line_len);
+        if std::mem::take(&mut self.overflow) {
+            return Err(ScheduleTransferError::LineTooLong(line_no));
+        }
+
+        let line = std::str::from_utf8(&self.line[..line_len])
+            .map_err(|_| ScheduleTransferError::InvalidEntry(line_no))?
+            .trim();
+        if line.is_empty() || line.starts_with('#') {
+            return Ok(());
+        }
+
+        if self.enabled.is_none() {
+            self.enabled = match line {
+                "ENABLED" => Some(true),
+                "DISABLED" => Some(false),
+                _ => return Err(ScheduleTransferError::MissingHeader(line_no)),
+            };
+            return Ok(());
+        }
+
+        let entry = parse_entry(line).ok_or(ScheduleTransferError::InvalidEntry(line_no))?;
+        if self.entries.len() >= MAX_SCHEDULE_ENTRIES {
+            return Err(ScheduleTransferError::TooManyEntries);
+        }
+        self.entries.push(entry);
+        Ok(())
+    }
+}
+
+fn parse_entry(line: &str) -> Option<ScheduleEntry> {
+    let mut fields = line.split_ascii_whitespace();
+    let day = match fields.next()? {
+        "MON" => DayOfWeek::Mon,
+        "TUE" => DayOfWeek::Tue,
+        "WED" => DayOfWeek::Wed,
+        "THU" => DayOfWeek::Thu,
+        "FRI" => DayOfWeek::Fri,
+        "SAT" => DayOfWeek::Sat,
+        "SUN" => DayOfWeek::Sun,
+        _ => return None,
+    };
+    let (hours, minutes) = fields.next()?.split_once(':')?;
+    let minutes = if minutes.len() == 2 {
+        minutes
+            .parse::<u16>()
+            .ok()
+            .filter(|minutes| *minutes < 60)?
+    } else {
+        return None;
+    };
+    let hours = hours.parse::<u16>().ok().filter(|hours| *hours < 24)?;
+    let start_minutes = hours * 60 + minutes;
+    let mode = match fields.next()? {
+        "HEAT" => ThermostatMode::Heat,
+        "OFF" => ThermostatMode::Off,
+        _ => return None,
+    };
+    let target_temp_f = DeciDegrees::from_f32(fields.next()?.parse().ok()?);
+    if fields.next().is_some() {
+        return None;
+    }
+
+    let entry = ScheduleEntry {
+        day,
+        start_minutes,
+        mode,
+        target_temp_f,
+    };
+    entry.validate().then_some(entry)
+}
+
+pub fn write_compact(schedule: &Schedule, out: &mut String) {
+    out.push_str(if schedule.enabled {
+        "ENABLED\n"
+    } else {
+        "DISABLED\n"
+    });
+    for entry in &schedule.entries {
+        let _ = writeln!(
+            out,
+            "{} {:02}:{:02} {} {}",
+            entry.day.as_str(),
+            entry.start_minutes / 60,
+            entry.start_minutes % 60,
+            entry.mode.as_str(),
+            entry.target_temp_f
+        );
+    }
+}
+
+// Chunked MQTT transfer. Each chunk starts with a "<transfer-id> <seq>/<total>"
+// header line followed by a slice of the compact document; lines may span
+// chunks. The schedule is only returned once the final chunk arrives, so the
+// caller can swap it in atomically.
+#[derive(Debug, Default)]
+pub struct ScheduleAssembler {
+    transfer: Option<Transfer>,
+}
+
+// A partial transfer with no chunk for this long is abandoned and its buffer
+// freed; a publisher sends every chunk back to back.
+pub const TRANSFER_IDLE_TIMEOUT_MS: u64 = 30_000;
+
+#[derive(Debug)]
+struct Transfer {
+    id: String,
+    next_seq: u16,
+    total: u16,
+    last_chunk_ms: u64,
+    parser: ScheduleParser,
+}
+
+impl ScheduleAssembler {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn in_progress(&self) -> bool {
+        self.transfer.is_some()
+    }
+
+    // Drops a partial transfer that has gone idle. Returns true when one was
+    // dropped.
+    pub fn expire(&mut self, now_ms: u64) -> bool {
+        let idle = self.transfer.as_ref().is_some_and(|transfer| {
+            now_ms.saturating_sub(transfer.last_chunk_ms) >= TRANSFER_IDLE_TIMEOUT_MS
+        });
+        if idle {
+            self.transfer = None;
+        }
+        idle
+    }
+
+    pub fn accept(
+        &mut self,
+        chunk: &[u8],
+        now_ms: u64,
+    ) -> Result<Option<Schedule>, ScheduleTransferError> {
+        let (id, seq, total, body) = parse_chunk_header(chunk)?;
+        self.expire(now_ms);
+
+        // Sequence 0 of a new transfer id starts over, abandoning any partial
+        // transfer; a repeated sequence 0 of the current id is a duplicate.
+        let current_id = self.transfer.as_ref().map(|transfer| transfer.id.as_str());
+        if seq == 0 && current_id != Some(id) {
+            self.transfer = Some(Transfer {
+                id: id.to_string(),
+                next_seq: 0,
+                total,
+                last_chunk_ms: now_ms,
+                parser: ScheduleParser::new(),
+            });
+        }
+
+        let transfer = match self.transfer.as_mut() {
+            Some(transfer) if transfer.id == id && transfer.total == total => transfer,
+            _ => return Err(ScheduleTransferError::NoTransfer),
+        };
+        transfer.last_chunk_ms = now_ms;
+
+        if seq != transfer.next_seq {
+            // A redelivered chunk (QoS1 duplicate) is harmless; anything else
+            // means data was lost and the transfer cannot be committed.
+            if seq < transfer.next_seq {
+                return Ok(None);
+            }
+            let expected = transfer.next_seq;
+            self.transfer = None;
+            return Err(ScheduleTransferError::OutOfSequence { expected, got: seq });
+        }
+
+        if let Err(err) = transfer.parser.feed(body) {
+            self.transfer = None;
+            return Err(err);
+        }
+        transfer.next_seq += 1;
+
+        if transfer.next_seq < transfer.total {
+            return Ok(None);
+        }
+
+        let transfer = self
+            .transfer
+            .take()
+            .ok_or(ScheduleTransferError::NoTransfer)?;
+        transfer.parser.finish().map(Some)
+    }
+}
+
+fn parse_chunk_header(chunk: &[u8]) -> Result<(&str, u16, u16, &[u8]), ScheduleTransferError> {
+    let split = chunk
+        .iter()
+        .position(|&byte| byte == b'\n')
+        .ok_or(ScheduleTransferError::InvalidChunkHeader)?;
+    let header = std::str::from_utf8(&chunk[..split])
+        .map_err(|_| ScheduleTransferError::InvalidChunkHeader)?;
+
+    let (id, sequence) = header
+        .trim()
+        .split_once(' ')
+        .ok_or(ScheduleTransferError::InvalidChunkHeader)?;
+    let (seq, total) = sequence
+        .split_once('/')
+        .ok_or(ScheduleTransferError::InvalidChunkHeader)?;
+    let seq = seq
+        .parse::<u16>()
+        .map_err(|_| ScheduleTransferError::InvalidChunkHeader)?;
+    let total = total
+        .parse::<u16>()
+        .map_err(|_| ScheduleTransferError::InvalidChunkHeader)?;
+
+    if id.is_empty() || total == 0 || seq >= total {
+        return Err(ScheduleTransferError::InvalidChunkHeader);
+    }
+    Ok((id, seq, total, &chunk[split + 1..]))
+}
+
+// Splits a schedule into chunk payloads no larger than `max_payload` bytes,
+// breaking only at line boundaries.
+pub fn compact_chunks(schedule: &Schedule, transfer_id: &str, max_payload: usize) -> Vec<String> {
+    let mut document = String::new();
+    write_compact(schedule, &mut document);
+
+    let header_room = transfer_id.len() + 14;
+    let budget = max_payload
+        .saturating_sub(header_room)
+        .max(MAX_LINE_LEN + 1);
+    let mut bodies = vec![String::new()];
+    for line in document.split_inclusive('\n') {
+        let current = bodies.last_mut().expect("at least one chunk");
+        if !current.is_empty() && current.len() + line.len() > budget {
+            bodies.push(String::new());
+        }
+        bodies
+            .last_mut()
+            .expect("at least one chunk")
+            .push_str(line);
+    }
+
+    let total = bodies.len();
+    bodies
+        .into_iter()
+        .enumerate()
+        .map(|(seq, body)| format!("{transfer_id} {seq}/{total}\n{body}"))
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn dense_schedule(per_day: u16) -> Schedule {
+        let mut entries = Vec::new();
+        for day in 0..7 {
+            for slot in 0..per_day {
+                entries.push(ScheduleEntry {
+                    day: DayOfWeek::from_index(day),
+                    start_minutes: slot * (24 * 60 / per_day),
+                    mode: if slot % 2 == 0 {
+                        ThermostatMode::Heat
+                    } else {
+                        ThermostatMode::Off
+                    },
+                    target_temp_f: DeciDegrees::from_degrees(60 + (slot % 24) as i16),
+                });
+            }
+        }
+        Schedule {
+            enabled: true,
+            entries,
+        }
+    }
+
+    #[test]
+    fn parses_compact_document_split_at_any_byte() {
+        let document = b"# weekday\nENABLED\nTUE 22:00 OFF 62;MON 06:30 HEAT 71.5\r\n";
+        let mut parser = ScheduleParser::new();
+        for byte in document {
+            parser.feed(std::slice::from_ref(byte)).unwrap();
+        }
+        let schedule = parser.finish().unwrap();
+
+        assert!(schedule.enabled);
+        assert_eq!(schedule.entries.len(), 2);
+        assert_eq!(schedule.entries[0].day, DayOfWeek::Mon);
+        assert_eq!(schedule.entries[0].start_minutes, 390);
+        assert_eq!(
+            schedule.entries[0].target_temp_f,
+            DeciDegrees::from_tenths(715)
+        );
+    }
+
+    #[test]
+    fn rejects_invalid_entries_with_line_numbers() {
+        let mut parser = ScheduleParser::new();
+        assert_eq!(
+            parser.feed(b"MON 06:30 HEAT 70\n"),
+            Err(ScheduleTransferError::MissingHeader(1))
+        );
+
+        let mut parser = ScheduleParser::new();
+        assert_eq!(
+            parser.feed(b"ENABLED\nMON 06:30 HEAT 99\n"),
+            Err(ScheduleTransferError::InvalidEntry(2))
+        );
+
+        let mut parser = ScheduleParser::new();
+        assert_eq!(
+            parser.feed(&[b'x'; 100]).and_then(|_| parser.feed(b"\n")),
+            Err(ScheduleTransferError::LineTooLong(1))
+        );
+    }
+
+    #[test]
+    fn rejects_out_of_range_times() {
+        // 1092 hours in minutes wraps a u16 to 00:43.
+        for line in [
+            "MON 1092:59 HEAT 70",
+            "MON 24:00 HEAT 70",
+            "MON 06:60 HEAT 70",
+        ] {
+            let mut parser = ScheduleParser::new();
+            parser.feed(b"ENABLED\n").unwrap();
+            assert_eq!(
+                parser.feed(format!("{line}\n").as_bytes()),
+                Err(ScheduleTransferError::InvalidEntry(2)),
+                "{line}"
+            );
+        }
+    }
+
+    #[test]
+    fn chunked_transfer_commits_only_on_final_chunk() {
+        let schedule = dense_schedule(48);
+        let chunks = compact_chunks(&schedule, "a1", 512);
+        assert!(chunks.len() > 1);
+        assert!(chunks.iter().all(|chunk| chunk.len() <= 512));
+
+        let mut assembler = ScheduleAssembler::new();
+        let (last, rest) = chunks.split_last().unwrap();
+        for chunk in rest {
+            assert_eq!(assembler.accept(chunk.as_bytes(), 0), Ok(None));
+        }
+        // Redelivered chunk is ignored.
+        assert_eq!(assembler.accept(rest[0].as_bytes(), 0), Ok(None));
+
+        let mut expected = schedule;
+        expected.normalize();
+        assert_eq!(assembler.accept(last.as_bytes(), 0), Ok(Some(expected)));
+        assert!(!assembler.in_progress());
+    }
+
+    #[test]
+    fn lost_chunk_aborts_transfer() {
+        let chunks = compact_chunks(&dense_schedule(24), "b2", 256);
+        assert!(chunks.len() > 2);
+
+        let mut assembler = ScheduleAssembler::new();
+        assembler.accept(chunks[0].as_bytes(), 0).unwrap();
+        assert_eq!(
+            assembler.accept(chunks[2].as_bytes(), 0),
+            Err(ScheduleTransferError::OutOfSequence {
+                expected: 1,
+                got: 2
+            })
+        );
+        assert_eq!(
+            assembler.accept(chunks[1].as_bytes(), 0),
+            Err(ScheduleTransferError::NoTransfer)
+        );
+    }
+
+    #[test]
+    fn idle_transfer_expires() {
+        let chunks = compact_chunks(&dense_schedule(24), "c3", 256);
+        assert!(chunks.len() > 2);
+
+        let mut assembler = ScheduleAssembler::new();
+        assembler.accept(chunks[0].as_bytes(), 0).unwrap();
+        assembler.accept(chunks[1].as_bytes(), 20_000).unwrap();
+        // Idle time counts from the last chunk, not the first.
+        assert!(!assembler.expire(40_000));
+        assert!(assembler.in_progress());
+
+        assert!(assembler.expire(20_000 + TRANSFER_IDLE_TIMEOUT_MS));
+        assert!(!assembler.in_progress());
+        assert_eq!(
+            assembler.accept(chunks[2].as_bytes(), 50_000),
+            Err(ScheduleTransferError::NoTransfer)
+        );
+    }
+}
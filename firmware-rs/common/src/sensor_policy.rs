@@ -0,0 +1,372 @@
+use serde::{Deserialize, Serialize};
+
+use crate::{
+    bounded::{BoundedDeque, BoundedPush},
+    config::SensorPublishPolicy,
+};
+
+// The rate is measured across this window rather than between consecutive
+// samples, so a single-LSB flip of the DS18B20 (about 0.1 F) cannot trigger it.
+const RATE_WINDOW_MS: u64 = 30_000;
+const RATE_WINDOW_MAX_SAMPLES: usize = 32;
+
+const BURST_MAX_DURATION_MS: u64 = 900_000;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PublishTrigger {
+    First,
+    Burst,
+    RateOfChange,
+    Deadband,
+    Heartbeat,
+}
+
+// Sent by the controller when it needs dense samples, e.g. right after a
+// power transition. A zero duration cancels a running burst.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub struct BurstRequest {
+    #[serde(rename = "intervalMs")]
+    pub interval_ms: u64,
+    #[serde(rename = "durationMs")]
+    pub duration_ms: u64,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Serialize, Deserialize)]
+pub struct SensorPolicyUpdate {
+    #[serde(
+        rename = "sampleIntervalMs",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub sample_interval_ms: Option<u64>,
+    #[serde(rename = "deadbandF", default, skip_serializing_if = "Option::is_none")]
+    pub deadband_f: Option<f32>,
+    #[serde(
+        rename = "rateFPerMin",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub rate_f_per_min: Option<f32>,
+    #[serde(
+        rename = "humidityDeadband",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub humidity_deadband: Option<f32>,
+    #[serde(
+        rename = "minIntervalMs",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub min_interval_ms: Option<u64>,
+    #[serde(
+        rename = "heartbeatMs",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub heartbeat_ms: Option<u64>,
+    #[serde(
+        rename = "resolutionBits",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub resolution_bits: Option<u8>,
+    #[serde(
+        rename = "traceReadings",
+        default,
+        skip_serializing_if = "Option::is_none"
+    )]
+    pub trace_readings: Option<bool>,
+}
+
+impl From<&SensorPublishPolicy> for SensorPolicyUpdate {
+    fn from(policy: &SensorPublishPolicy) -> Self {
+        Self {
+            sample_interval_ms: Some(policy.sample_interval_ms),
+            deadband_f: Some(policy.deadband_f),
+            rate_f_per_min: Some(policy.rate_f_per_min),
+            humidity_deadband: Some(policy.humidity_deadband),
+            min_interval_ms: Some(policy.min_interval_ms),
+            heartbeat_ms: Some(policy.heartbeat_ms),
+            resolution_bits: Some(policy.resolution_bits),
+            trace_readings: Some(policy.trace_readings),
+        }
+    }
+}
+
+impl SensorPublishPolicy {
+    // Fields missing from the update keep their current value; out-of-range
+    // values are clamped like the rest of the persisted config.
+    pub fn apply(&mut self, update: &SensorPolicyUpdate) {
+        if let Some(value) = update.sample_interval_ms {
+            self.sample_interval_ms = value;
+        }
+        if let Some(value) = update.deadband_f.filter(|value| value.is_finite()) {
+            self.deadband_f = value;
+        }
+        if let Some(value) = update.rate_f_per_min.filter(|value| value.is_finite()) {
+            self.rate_f_per_min = value;
+        }
+        if let Some(value) = update.humidity_deadband.filter(|value| value.is_finite()) {
+            self.humidity_deadband = value;
+        }
+        if let Some(value) = update.min_interval_ms {
+            self.min_interval_ms = value;
+        }
+        if let Some(value) = update.heartbeat_ms {
+            self.heartbeat_ms = value;
+        }
+        if let Some(value) = update.resolution_bits {
+            self.resolution_bits = value;
+        }
+        if let Some(value) = update.trace_readings {
+            self.trace_readings = value;
+        }
+        self.sanitize();
+    }
+}
+
+// Decides which sampled readings are worth publishing: anything outside the
+// deadband or moving faster than the rate threshold goes out immediately,
+// otherwise the sensor stays quiet until the heartbeat is due.
+#[derive(Debug, Default)]
+pub struct PublishGate {
+    recent: BoundedDeque<(u64, f32), RATE_WINDOW_MAX_SAMPLES>,
+    last_publish_ms: Option<u64>,
+    published_temp: Option<f32>,
+    published_humidity: Option<f32>,
+    burst: Option<(u64, u64)>,
+}
+
+impl PublishGate {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn evaluate(
+        &mut self,
+        policy: &SensorPublishPolicy,
+        now_ms: u64,
+        temp_f: Option<f32>,
+        humidity: Option<f32>,
+    ) -> Option<PublishTrigger> {
+        if temp_f.is_none() && humidity.is_none() {
+            return None;
+        }
+
+        let rate_f_per_min = temp_f.and_then(|temp_f| self.sample_rate(now_ms, temp_f));
+
+        let Some(last_publish_ms) = self.last_publish_ms else {
+            return Some(PublishTrigger::First);
+        };
+        let elapsed = now_ms.saturating_sub(last_publish_ms);
+        if elapsed < policy.min_interval_ms {
+            return None;
+        }
+        if self.burst_interval_ms(now_ms).is_some() {
+            // Every burst sample goes out: the controller's trend detector
+            // needs the dense series, not just the deadband crossings.
+            return Some(PublishTrigger::Burst);
+        }
+
+        if policy.rate_f_per_min > 0.0
+            && rate_f_per_min.is_some_and(|rate| rate >= policy.rate_f_per_min)
+        {
+            return Some(PublishTrigger::RateOfChange);
+        }
+        if outside_deadband(self.published_temp, temp_f, policy.deadband_f)
+            || outside_deadband(self.published_humidity, humidity, policy.humidity_deadband)
+        {
+            return Some(PublishTrigger::Deadband);
+        }
+        if elapsed >= policy.heartbeat_ms {
+            return Some(PublishTrigger::Heartbeat);
+        }
+        None
+    }
+
+    pub fn mark_published(&mut self, now_ms: u64, temp_f: Option<f32>, humidity: Option<f32>) {
+        self.last_publish_ms = Some(now_ms);
+        self.published_temp = temp_f.or(self.published_temp);
+        self.published_humidity = humidity.or(self.published_humidity);
+    }
+
+    fn sample_rate(&mut self, now_ms: u64, temp_f: f32) -> Option<f32> {
+        while self
+            .recent
+            .front()
+            .is_some_and(|(sampled_ms, _)| now_ms.saturating_sub(*sampled_ms) > RATE_WINDOW_MS)
+            || self.recent.len() >= RATE_WINDOW_MAX_SAMPLES
+        {
+            self.recent.pop_front();
+        }
+
+        let rate = self.recent.front().and_then(|&(sampled_ms, previous)| {
+            let span_ms = now_ms.saturating_sub(sampled_ms);
+            (span_ms >= RATE_WINDOW_MS / 2)
+                .then(|| (temp_f - previous).abs() * 60_000.0 / span_ms as f32)
+        });
+        self.recent.push_bounded((now_ms, temp_f));
+        rate
+    }
+
+    pub fn start_burst(&mut self, now_ms: u64, request: &BurstRequest) {
+        if request.duration_ms == 0 {
+            self.burst = None;
+            return;
+        }
+        let interval_ms = request.interval_ms.clamp(1_000, 30_000);
+        let until_ms = now_ms.saturating_add(request.duration_ms.min(BURST_MAX_DURATION_MS));
+        self.burst = Some((interval_ms, until_ms));
+    }
+
+    pub fn burst_interval_ms(&self, now_ms: u64) -> Option<u64> {
+        self.burst
+            .filter(|&(_, until_ms)| now_ms < until_ms)
+            .map(|(interval_ms, _)| interval_ms)
+    }
+
+    // How long to wait before taking the next sample.
+    pub fn sample_interval_ms(&self, policy: &SensorPublishPolicy, now_ms: u64) -> u64 {
+        self.burst_interval_ms(now_ms)
+            .map_or(policy.sample_interval_ms, |interval_ms| {
+                interval_ms.min(policy.sample_interval_ms)
+            })
+    }
+
+    // Makes the next reading publish regardless of the policy, e.g. after an
+    // MQTT reconnect when the controller may already consider us stale.
+    pub fn force(&mut self) {
+        self.last_publish_ms = None;
+    }
+}
+
+fn outside_deadband(published: Option<f32>, current: Option<f32>, deadband: f32) -> bool {
+    match (published, current) {
+        (Some(published), Some(current)) => (current - published).abs() >= deadband,
+        (None, Some(_)) => true,
+        _ => false,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::config::ThermostatConfig;
+
+    fn step(
+        gate: &mut PublishGate,
+        policy: &SensorPublishPolicy,
+        now_ms: u64,
+        temp_f: f32,
+    ) -> Option<PublishTrigger> {
+        let trigger = gate.evaluate(policy, now_ms, Some(temp_f), Some(40.0));
+        if trigger.is_some() {
+            gate.mark_published(now_ms, Some(temp_f), Some(40.0));
+        }
+        trigger
+    }
+
+    #[test]
+    fn steady_readings_only_publish_on_heartbeat() {
+        let policy = SensorPublishPolicy::default();
+        let mut gate = PublishGate::new();
+
+        assert_eq!(
+            step(&mut gate, &policy, 0, 68.0),
+            Some(PublishTrigger::First)
+        );
+        let mut published = 0;
+        for tick in 1..=48_u64 {
+            let now_ms = tick * policy.sample_interval_ms;
+            let jitter = if tick % 2 == 0 { 0.05 } else { -0.05 };
+            if let Some(trigger) = step(&mut gate, &policy, now_ms, 68.0 + jitter) {
+                assert_eq!(trigger, PublishTrigger::Heartbeat);
+                published += 1;
+            }
+        }
+        // 240 s of sampling at 5 s: two heartbeats instead of 48 reports.
+        assert_eq!(published, 2);
+    }
+
+    #[test]
+    fn swings_publish_immediately() {
+        let policy = SensorPublishPolicy::default();
+        let wide = SensorPublishPolicy {
+            deadband_f: 1.0,
+            ..policy
+        };
+        let mut gate = PublishGate::new();
+        step(&mut gate, &wide, 0, 68.0);
+
+        // A 1 F/min ramp stays inside the 1 F deadband for a full minute, but
+        // the rate trigger reports it as soon as the window has 15 s of data.
+        assert_eq!(step(&mut gate, &wide, 5_000, 68.08), None);
+        assert_eq!(step(&mut gate, &wide, 10_000, 68.17), None);
+        assert_eq!(
+            step(&mut gate, &wide, 15_000, 68.25),
+            Some(PublishTrigger::RateOfChange)
+        );
+
+        let no_rate = SensorPublishPolicy {
+            rate_f_per_min: 0.0,
+            ..policy
+        };
+        let mut gate = PublishGate::new();
+        step(&mut gate, &no_rate, 0, 68.0);
+        assert_eq!(step(&mut gate, &no_rate, 5_000, 68.1), None);
+        assert_eq!(
+            step(&mut gate, &no_rate, 10_000, 68.3),
+            Some(PublishTrigger::Deadband)
+        );
+        // Rate limited even when the reading is far outside the deadband.
+        assert_eq!(step(&mut gate, &no_rate, 11_000, 70.0), None);
+    }
+
+    #[test]
+    fn burst_publishes_every_sample_until_it_expires() {
+        let policy = SensorPublishPolicy::default();
+        let mut gate = PublishGate::new();
+        step(&mut gate, &policy, 0, 68.0);
+
+        gate.start_burst(
+            1_000,
+            &BurstRequest {
+                interval_ms: 2_000,
+                duration_ms: 10_000,
+            },
+        );
+        assert_eq!(gate.sample_interval_ms(&policy, 1_000), 2_000);
+        assert_eq!(
+            step(&mut gate, &policy, 3_000, 68.0),
+            Some(PublishTrigger::Burst)
+        );
+        // Still honours the minimum publish spacing.
+        assert_eq!(step(&mut gate, &policy, 4_000, 68.0), None);
+
+        assert_eq!(step(&mut gate, &policy, 11_000, 68.0), None);
+        assert_eq!(
+            gate.sample_interval_ms(&policy, 11_000),
+            policy.sample_interval_ms
+        );
+    }
+
+    #[test]
+    fn partial_update_keeps_other_fields_and_clamps() {
+        let mut policy = SensorPublishPolicy::default();
+        let update: SensorPolicyUpdate =
+            serde_json::from_str(r#"{"deadbandF":0.5,"heartbeatMs":900000}"#).unwrap();
+        policy.apply(&update);
+
+        assert_eq!(policy.deadband_f, 0.5);
+        assert_eq!(policy.heartbeat_ms, SensorPublishPolicy::HEARTBEAT_MAX_MS);
+        assert!(policy.heartbeat_ms < ThermostatConfig::default().sensor_stale_timeout_ms);
+        assert_eq!(
+            policy.sample_interval_ms,
+            SensorPublishPolicy::default().sample_interval_ms
+        );
+
+        let echoed = serde_json::to_value(SensorPolicyUpdate::from(&policy)).unwrap();
+        assert_eq!(echoed["heartbeatMs"], 240_000);
+    }
+}
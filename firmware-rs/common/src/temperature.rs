@@ -0,0 +1,121 @@
+use core::fmt;
+
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+
+// Temperature in tenths of a degree Fahrenheit. Sensors report to 0.1 F, so
+// every reading is held exactly: comparisons need no epsilon and a value
+// takes two bytes instead of four. JSON keeps carrying plain numbers (68.5);
+// incoming numbers are rounded to the nearest tenth.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub struct DeciDegrees(i16);
+
+impl DeciDegrees {
+    pub const MIN: Self = Self(i16::MIN);
+    pub const MAX: Self = Self(i16::MAX);
+
+    pub const fn from_tenths(tenths: i16) -> Self {
+        Self(tenths)
+    }
+
+    pub const fn from_degrees(degrees: i16) -> Self {
+        Self(degrees * 10)
+    }
+
+    // Rounds to the nearest tenth and saturates at the ends of the range. NaN
+    // becomes 0 F as with any float cast, so raw readings are range-checked
+    // before they get here.
+    pub fn from_f32(degrees: f32) -> Self {
+        Self(round_tenths(degrees))
+    }
+
+    pub const fn tenths(self) -> i16 {
+        self.0
+    }
+
+    pub fn to_f32(self) -> f32 {
+        f32::from(self.0) / 10.0
+    }
+
+    // Rounded toward zero, like the float cast it replaces.
+    pub const fn whole_degrees(self) -> i32 {
+        self.0 as i32 / 10
+    }
+
+    pub const fn saturating_add(self, other: Self) -> Self {
+        Self(self.0.saturating_add(other.0))
+    }
+
+    pub const fn saturating_sub(self, other: Self) -> Self {
+        Self(self.0.saturating_sub(other.0))
+    }
+}
+
+// Half away from zero, like `f32::round`, which is a libm call on targets
+// without a rounding instruction; conversions run on every engine tick.
+pub(crate) fn round_tenths(value: f32) -> i16 {
+    let tenths = value * 10.0;
+    (tenths + 0.5_f32.copysign(tenths)) as i16
+}
+
+impl From<DeciDegrees> for f32 {
+    fn from(value: DeciDegrees) -> Self {
+        value.to_f32()
+    }
+}
+
+// Matches `f32`'s formatting of the same value ("62", "71.5"), which the
+// compact schedule format and log lines already rely on.
+impl fmt::Display for DeciDegrees {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let sign = if self.0 < 0 { "-" } else { "" };
+        let tenths = self.0.unsigned_abs();
+        match tenths % 10 {
+            0 => write!(f, "{sign}{}", tenths / 10),
+            fraction => write!(f, "{sign}{}.{fraction}", tenths / 10),
+        }
+    }
+}
+
+impl Serialize for DeciDegrees {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        serializer.serialize_f32(self.to_f32())
+    }
+}
+
+impl<'de> Deserialize<'de> for DeciDegrees {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> Result<Self, D::Error> {
+        f32::deserialize(deserializer).map(Self::from_f32)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::string::ToString;
+
+    use super::*;
+
+    #[test]
+    fn converts_exactly_and_keeps_json_numbers() {
+        let temp = DeciDegrees::from_f32(68.44);
+        assert_eq!(temp, DeciDegrees::from_tenths(684));
+        assert_eq!(temp.to_f32(), 68.4);
+        assert_eq!(
+            DeciDegrees::from_f32(70.0 + 0.1 + 0.2),
+            DeciDegrees::from_tenths(703)
+        );
+        assert_eq!(DeciDegrees::from_f32(1e9), DeciDegrees::MAX);
+        assert_eq!(DeciDegrees::from_f32(-0.46).to_string(), "-0.5");
+        assert_eq!(DeciDegrees::from_degrees(62).to_string(), "62");
+        assert_eq!(DeciDegrees::from_tenths(697).whole_degrees(), 69);
+
+        assert_eq!(serde_json::to_string(&temp).unwrap(), "68.4");
+        assert_eq!(
+            serde_json::from_str::<DeciDegrees>("71.46").unwrap(),
+            DeciDegrees::from_tenths(715)
+        );
+        assert_eq!(
+            serde_json::from_str::<DeciDegrees>("72").unwrap(),
+            DeciDegrees::from_degrees(72)
+        );
+    }
+}
@@ -1,8 +1,30 @@
+use core::fmt::Write as _;
+
 use crate::{
-    config::{PersistedSettings, ThermostatConfig},
-    types::{ControllerStatePayload, ControllerStatus, ThermostatMode, ThermostatState},
+    bounded::{truncate_str, BoundedDeque, BoundedPush, BoundedString, BoundedVec},
+    config::{PersistedSettings, SettingsUpdate, ThermostatConfig},
+    fusion::{
+        SensorFusion, SourceConfig, SourceStatus, SourceUpdate, DEFAULT_SENSOR_SOURCE,
+        MAX_SENSOR_SOURCES,
+    },
+    sensor_policy::BurstRequest,
+    temperature::DeciDegrees,
+    trace::{SampleTrace, TraceContext},
+    types::{
+        ControllerStatePayload, ControllerStatus, ThermostatMode, ThermostatState,
+        TIMER_STRING_CAPACITY, TIMEZONE_CAPACITY,
+    },
 };
 
+// Temperature and humidity arrive as separate updates carrying the same
+// temperature; only the first of such a pair counts as a trend sample.
+const TREND_MIN_SAMPLE_SPACING_MS: u64 = 1_000;
+const TREND_MAX_SAMPLES: usize = 64;
+
+// A power-on sequence is the longest batch: 13 actions.
+pub const MAX_ENGINE_ACTIONS: usize = 16;
+pub type EngineActions = BoundedVec<EngineAction, MAX_ENGINE_ACTIONS>;
+
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub enum HoldReason {
     ManualOverride,
@@ -37,11 +59,12 @@ pub struct ThermostatEngine {
     settings: PersistedSettings,
 
     state: ThermostatState,
-    current_temp_f: f32,
+    current_temp_f: DeciDegrees,
     current_humidity: f32,
     fireplace_on: bool,
 
-    last_sensor_update_ms: Option<u64>,
+    // `current_temp_f` is the fused value, cached after every update.
+    fusion: SensorFusion,
     last_state_change_ms: Option<u64>,
 
     hold: Option<HoldState>,
@@ -50,10 +73,15 @@ pub struct ThermostatEngine {
     cooldown_start_ms: Option<u64>,
     in_cooldown: bool,
 
-    previous_temp_f: Option<f32>,
-    last_trend_sample_ms: Option<u64>,
-    trend_direction: i8,
-    consecutive_trend: u8,
+    trend_samples: BoundedDeque<(u64, DeciDegrees), TREND_MAX_SAMPLES>,
+    burst_until_ms: Option<u64>,
+    burst_pending: bool,
+
+    // Trailer and receive time of a reading no tick has evaluated yet. The
+    // next tick consumes it and keeps it in `decision_sample` only when the
+    // thresholds, not a safety or hold path, decided that tick's actions.
+    pending_sample: Option<(Option<SampleTrace>, u64)>,
+    decision_sample: Option<(Option<SampleTrace>, u64)>,
 
     // Tracked fireplace device state used by IR action mapping.
     light_level: u8,
@@ -64,23 +92,36 @@ pub struct ThermostatEngine {
 impl ThermostatEngine {
     pub fn new(config: ThermostatConfig, mut settings: PersistedSettings) -> Self {
         settings.sanitize();
+        let mut fusion = SensorFusion::new(
+            config.sensor_stale_timeout_ms,
+            config.fusion_outlier_mad_k,
+            config.fusion_outlier_floor_f,
+        );
+        // Sensors with per-probe topics also repeat their first probe on the
+        // plain topic; counting it only as a fallback avoids double weight.
+        let fallback = SourceConfig {
+            fallback: true,
+            ..fusion.default_source_config()
+        };
+        fusion.configure_source(DEFAULT_SENSOR_SOURCE, fallback);
         Self {
             config,
             settings,
             state: ThermostatState::Idle,
-            current_temp_f: 0.0,
+            current_temp_f: DeciDegrees::default(),
             current_humidity: 0.0,
             fireplace_on: false,
-            last_sensor_update_ms: None,
+            fusion,
             last_state_change_ms: None,
             hold: None,
             heating_start_ms: None,
             cooldown_start_ms: None,
             in_cooldown: false,
-            previous_temp_f: None,
-            last_trend_sample_ms: None,
-            trend_direction: 0,
-            consecutive_trend: 0,
+            trend_samples: BoundedDeque::new(),
+            burst_until_ms: None,
+            burst_pending: false,
+            pending_sample: None,
+            decision_sample: None,
             light_level: 0,
             timer_state: 0,
             fireplace_temp_f: 70,
@@ -91,7 +132,7 @@ impl ThermostatEngine {
         &self.settings
     }
 
-    pub fn current_temp_f(&self) -> f32 {
+    pub fn current_temp_f(&self) -> DeciDegrees {
         self.current_temp_f
     }
 
@@ -107,15 +148,77 @@ impl ThermostatEngine {
         self.fireplace_on
     }
 
-    pub fn update_sensor_data(&mut self, temp_f: f32, humidity: f32, now_ms: u64) {
-        self.current_temp_f = temp_f;
+    pub fn update_sensor_data(&mut self, temp_f: DeciDegrees, humidity: f32, now_ms: u64) {
         self.current_humidity = humidity;
-        self.last_sensor_update_ms = Some(now_ms);
+        self.update_source_temperature(DEFAULT_SENSOR_SOURCE, temp_f, now_ms);
+    }
+
+    pub fn update_humidity(&mut self, humidity: f32) {
+        self.current_humidity = humidity;
+    }
+
+    pub fn update_source_temperature(
+        &mut self,
+        source: &str,
+        temp_f: DeciDegrees,
+        now_ms: u64,
+    ) -> SourceUpdate {
+        // Fusion keeps its weighted statistics in floating point; its result
+        // is rounded back to the sensors' tenth-degree resolution.
+        let outcome = self.fusion.update(source, temp_f.to_f32(), now_ms);
+        let Some(fused_f) = self.fusion.fused_f().map(DeciDegrees::from_f32) else {
+            return outcome;
+        };
+        self.current_temp_f = fused_f;
+
+        let spaced = self.trend_samples.back().map_or(true, |&(sampled_ms, _)| {
+            now_ms.saturating_sub(sampled_ms) >= TREND_MIN_SAMPLE_SPACING_MS
+        });
+        if spaced {
+            if self.trend_samples.len() >= TREND_MAX_SAMPLES {
+                self.trend_samples.pop_front();
+            }
+            self.trend_samples.push_bounded((now_ms, fused_f));
+        }
+        outcome
+    }
+
+    pub fn note_sample_trace(&mut self, trace: Option<SampleTrace>, received_ms: u64) {
+        self.pending_sample = Some((trace, received_ms));
     }
 
-    pub fn set_target_temp(&mut self, temp_f: f32) -> bool {
-        let clamped = temp_f.clamp(60.0, 84.0);
-        if (self.settings.target_temp_f - clamped).abs() > f32::EPSILON {
+    // Trace for the actions returned by the last `tick`.
+    pub fn trace_context(&self, decided_ms: u64) -> TraceContext {
+        let Some((trace, received_ms)) = self.decision_sample else {
+            return TraceContext::untraced(decided_ms);
+        };
+        TraceContext {
+            seq: trace.map(|trace| trace.seq),
+            captured_epoch_ms: trace.and_then(|trace| trace.captured_epoch_ms),
+            received_ms: Some(received_ms),
+            decided_ms,
+        }
+    }
+
+    pub fn sensor_sources(&self, now_ms: u64) -> BoundedVec<SourceStatus, MAX_SENSOR_SOURCES> {
+        self.fusion.sources(now_ms)
+    }
+
+    // Returns a pending request for dense sensor sampling, at most once per
+    // trigger. The controller forwards it to the sensor.
+    pub fn take_burst_request(&mut self) -> Option<BurstRequest> {
+        if !core::mem::take(&mut self.burst_pending) {
+            return None;
+        }
+        Some(BurstRequest {
+            interval_ms: self.config.burst_sample_interval_ms,
+            duration_ms: self.config.burst_duration_ms,
+        })
+    }
+
+    pub fn set_target_temp(&mut self, temp_f: DeciDegrees) -> bool {
+        let clamped = temp_f.clamp(PersistedSettings::TARGET_MIN, PersistedSettings::TARGET_MAX);
+        if self.settings.target_temp_f != clamped {
             self.settings.target_temp_f = clamped;
             true
         } else {
@@ -123,9 +226,12 @@ impl ThermostatEngine {
         }
     }
 
-    pub fn set_hysteresis(&mut self, hysteresis_f: f32) -> bool {
-        let clamped = hysteresis_f.clamp(0.5, 5.0);
-        if (self.settings.hysteresis_f - clamped).abs() > f32::EPSILON {
+    pub fn set_hysteresis(&mut self, hysteresis_f: DeciDegrees) -> bool {
+        let clamped = hysteresis_f.clamp(
+            PersistedSettings::HYSTERESIS_MIN,
+            PersistedSettings::HYSTERESIS_MAX,
+        );
+        if self.settings.hysteresis_f != clamped {
             self.settings.hysteresis_f = clamped;
             true
         } else {
@@ -149,8 +255,8 @@ impl ThermostatEngine {
         &mut self,
         mode: ThermostatMode,
         now_ms: u64,
-    ) -> (bool, Vec<EngineAction>) {
-        let mut actions = Vec::new();
+    ) -> (bool, EngineActions) {
+        let mut actions = EngineActions::new();
         let changed = self.set_mode(mode);
 
         if changed && mode == ThermostatMode::Off && self.fireplace_on {
@@ -173,19 +279,56 @@ impl ThermostatEngine {
         }
     }
 
-    pub fn tick(&mut self, now_ms: u64) -> Vec<EngineAction> {
-        let mut actions = Vec::new();
+    // Applies all of `update` or, when any field is invalid, none of it. The
+    // bool reports whether a persisted setting changed.
+    pub fn apply_settings(
+        &mut self,
+        update: &SettingsUpdate,
+        now_ms: u64,
+    ) -> Result<(bool, EngineActions), &'static str> {
+        update.validate()?;
 
+        let mut changed = false;
+        let mut actions = EngineActions::new();
+        if let Some(mode) = update.mode {
+            (changed, actions) = self.set_mode_with_actions(mode, now_ms);
+        }
+        if let Some(target_temp_f) = update.target_temp_f {
+            changed |= self.set_target_temp(target_temp_f);
+        }
+        if let Some(hysteresis_f) = update.hysteresis_f {
+            changed |= self.set_hysteresis(hysteresis_f);
+        }
+        if let Some(offset) = update.fireplace_offset_f {
+            changed |= self.set_fireplace_offset(offset);
+        }
+        Ok((changed, actions))
+    }
+
+    pub fn tick(&mut self, now_ms: u64) -> EngineActions {
+        let mut actions = EngineActions::new();
+        let was_on = self.fireplace_on;
+        let sample = self.pending_sample.take();
+
+        self.fusion.refresh(now_ms);
+        if let Some(fused_f) = self.fusion.fused_f() {
+            self.current_temp_f = DeciDegrees::from_f32(fused_f);
+        }
         self.expire_hold_if_needed(now_ms);
         self.complete_cooldown_if_needed(now_ms);
         self.check_runtime_limit(now_ms, &mut actions);
         self.detect_external_remote(now_ms);
-        self.evaluate_state(now_ms, &mut actions);
+        let safety_shutoff = !actions.is_empty();
+        let by_threshold = self.evaluate_state(now_ms, &mut actions);
+        self.decision_sample = sample.filter(|_| by_threshold && !safety_shutoff);
 
+        if self.fireplace_on != was_on {
+            self.request_burst(now_ms);
+        }
         actions
     }
 
-    pub fn manual_on(&mut self, now_ms: u64) -> Vec<EngineAction> {
+    pub fn manual_on(&mut self, now_ms: u64) -> EngineActions {
         self.fireplace_on = true;
         self.heating_start_ms = Some(now_ms);
         self.last_state_change_ms = Some(now_ms);
@@ -194,10 +337,11 @@ impl ThermostatEngine {
             HoldReason::ManualOverride,
             now_ms,
         );
-        vec![EngineAction::PowerOn]
+        self.request_burst(now_ms);
+        one_action(EngineAction::PowerOn)
     }
 
-    pub fn manual_off(&mut self, now_ms: u64) -> Vec<EngineAction> {
+    pub fn manual_off(&mut self, now_ms: u64) -> EngineActions {
         self.fireplace_on = false;
         self.heating_start_ms = None;
         self.last_state_change_ms = Some(now_ms);
@@ -206,51 +350,52 @@ impl ThermostatEngine {
             HoldReason::ManualOverride,
             now_ms,
         );
-        vec![EngineAction::PowerOff]
+        self.request_burst(now_ms);
+        one_action(EngineAction::PowerOff)
     }
 
-    pub fn manual_heat_on(&mut self, now_ms: u64) -> Vec<EngineAction> {
+    pub fn manual_heat_on(&mut self, now_ms: u64) -> EngineActions {
         self.enter_hold_internal(
             self.config.hold_duration_ms,
             HoldReason::ManualOverride,
             now_ms,
         );
-        vec![EngineAction::HeatOn]
+        one_action(EngineAction::HeatOn)
     }
 
-    pub fn manual_heat_off(&mut self, now_ms: u64) -> Vec<EngineAction> {
+    pub fn manual_heat_off(&mut self, now_ms: u64) -> EngineActions {
         self.enter_hold_internal(
             self.config.hold_duration_ms,
             HoldReason::ManualOverride,
             now_ms,
         );
-        vec![EngineAction::HeatOff]
+        one_action(EngineAction::HeatOff)
     }
 
-    pub fn manual_heat_up(&mut self) -> Vec<EngineAction> {
+    pub fn manual_heat_up(&mut self) -> EngineActions {
         if self.fireplace_temp_f >= 80 {
-            return Vec::new();
+            return EngineActions::new();
         }
         self.fireplace_temp_f += 2;
-        vec![EngineAction::TempUp]
+        one_action(EngineAction::TempUp)
     }
 
-    pub fn manual_heat_down(&mut self) -> Vec<EngineAction> {
+    pub fn manual_heat_down(&mut self) -> EngineActions {
         if self.fireplace_temp_f <= 60 {
-            return Vec::new();
+            return EngineActions::new();
         }
         self.fireplace_temp_f -= 2;
-        vec![EngineAction::TempDown]
+        one_action(EngineAction::TempDown)
     }
 
-    pub fn manual_light_toggle(&mut self) -> Vec<EngineAction> {
+    pub fn manual_light_toggle(&mut self) -> EngineActions {
         self.advance_light_state();
-        vec![EngineAction::LightToggle]
+        one_action(EngineAction::LightToggle)
     }
 
-    pub fn manual_timer_toggle(&mut self) -> Vec<EngineAction> {
+    pub fn manual_timer_toggle(&mut self) -> EngineActions {
         self.timer_state = (self.timer_state + 1) % 11;
-        vec![EngineAction::TimerToggle]
+        one_action(EngineAction::TimerToggle)
     }
 
     pub fn enter_hold(&mut self, duration_ms: Option<u64>, now_ms: u64) {
@@ -272,13 +417,11 @@ impl ThermostatEngine {
     }
 
     pub fn is_sensor_data_valid(&self, now_ms: u64) -> bool {
-        self.last_sensor_update_ms
-            .map(|last| now_ms.saturating_sub(last) < self.config.sensor_stale_timeout_ms)
-            .unwrap_or(false)
+        self.fusion.any_fresh(now_ms)
     }
 
     pub fn last_sensor_update_ms(&self) -> Option<u64> {
-        self.last_sensor_update_ms
+        self.fusion.last_update_ms()
     }
 
     pub fn is_in_hold(&self) -> bool {
@@ -317,32 +460,30 @@ impl ThermostatEngine {
         }
     }
 
-    pub fn timer_string(&self) -> String {
-        match self.timer_state {
-            0 => "OFF".to_string(),
-            1 => "0.5hr".to_string(),
-            n => format!("{}hr", n - 1),
-        }
+    pub fn timer_string(&self) -> BoundedString<TIMER_STRING_CAPACITY> {
+        let mut text = BoundedString::new();
+        let _ = match self.timer_state {
+            0 => text.write_str("OFF"),
+            1 => text.write_str("0.5hr"),
+            n => write!(text, "{}hr", n - 1),
+        };
+        text
     }
 
     pub fn apply_schedule_action(
         &mut self,
         mode: ThermostatMode,
-        target_temp_f: f32,
+        target_temp_f: DeciDegrees,
         now_ms: u64,
-    ) -> (bool, Vec<EngineAction>) {
+    ) -> (bool, EngineActions) {
         if self.is_in_hold() {
-            return (false, Vec::new());
+            return (false, EngineActions::new());
         }
 
-        let mut actions = Vec::new();
-        let mut changed = false;
-        let (mode_changed, mut mode_actions) = self.set_mode_with_actions(mode, now_ms);
-        changed |= mode_changed;
-        actions.append(&mut mode_actions);
-        changed |= self.set_target_temp(target_temp_f);
+        let (mode_changed, actions) = self.set_mode_with_actions(mode, now_ms);
+        let target_changed = self.set_target_temp(target_temp_f);
 
-        (changed, actions)
+        (mode_changed | target_changed, actions)
     }
 
     pub fn status(
@@ -378,7 +519,7 @@ impl ThermostatEngine {
             schedule_enabled,
             next_schedule_event_epoch,
             time_synced,
-            timezone: timezone.to_string(),
+            timezone: truncate_str::<TIMEZONE_CAPACITY>(timezone),
         }
     }
 
@@ -387,8 +528,8 @@ impl ThermostatEngine {
             temp: self.current_temp_f,
             humidity: self.current_humidity,
             target: self.settings.target_temp_f,
-            mode: self.settings.mode.as_str(),
-            state: self.state.as_str(),
+            mode: self.settings.mode,
+            state: self.state,
             fireplace: self.fireplace_on,
             hold_active: self.is_in_hold(),
             hold_remaining_min: self.hold_remaining_ms(now_ms) / 60_000,
@@ -421,14 +562,14 @@ impl ThermostatEngine {
         }
     }
 
-    fn check_runtime_limit(&mut self, now_ms: u64, actions: &mut Vec<EngineAction>) {
+    fn check_runtime_limit(&mut self, now_ms: u64, actions: &mut EngineActions) {
         if !self.fireplace_on {
             return;
         }
 
         if self.runtime_ms(now_ms) >= self.config.max_runtime_ms && self.heating_start_ms.is_some()
         {
-            actions.push(EngineAction::PowerOff);
+            actions.push_bounded(EngineAction::PowerOff);
             self.fireplace_on = false;
             self.in_cooldown = true;
             self.cooldown_start_ms = Some(now_ms);
@@ -437,46 +578,99 @@ impl ThermostatEngine {
         }
     }
 
+    fn request_burst(&mut self, now_ms: u64) {
+        self.burst_pending = true;
+        self.burst_until_ms = Some(now_ms.saturating_add(self.config.burst_duration_ms));
+    }
+
+    // Least-squares slope over the trend window, scaled to the change per
+    // `trend_sample_interval_ms` so the thresholds keep their meaning no
+    // matter how densely the sensor reports. The second value is the slope of
+    // the gentlest of `trend_samples_required` consecutive runs of samples, so
+    // a single step in the reading, which lands in one run only, cannot pass
+    // for a trend.
+    fn trend_delta(&mut self, now_ms: u64) -> Option<(f32, f32, f32)> {
+        let window_start = now_ms.saturating_sub(self.config.trend_window_ms);
+        while self
+            .trend_samples
+            .front()
+            .is_some_and(|&(sampled_ms, _)| sampled_ms < window_start)
+        {
+            self.trend_samples.pop_front();
+        }
+
+        let min_samples = usize::from(self.config.trend_samples_required) + 1;
+        let (&(first_ms, _), &(last_ms, _)) =
+            (self.trend_samples.front()?, self.trend_samples.back()?);
+        if self.trend_samples.len() < min_samples
+            || last_ms.saturating_sub(first_ms) < self.config.trend_min_span_ms
+        {
+            return None;
+        }
+
+        let last = self.trend_samples.len() - 1;
+        let overall = self.trend_slope(0, last)?;
+
+        // Runs share their boundary sample, so every interval between two
+        // readings belongs to exactly one run.
+        let runs = usize::from(self.config.trend_samples_required).max(1);
+        let (mut min_run, mut max_run) = (f32::MAX, f32::MIN);
+        for run in 0..runs {
+            let slope = self.trend_slope(run * last / runs, (run + 1) * last / runs)?;
+            min_run = min_run.min(slope);
+            max_run = max_run.max(slope);
+        }
+        Some((overall, min_run, max_run))
+    }
+
+    // Slope of the trend samples `first..=last`, per `trend_sample_interval_ms`.
+    fn trend_slope(&self, first: usize, last: usize) -> Option<f32> {
+        let samples = || self.trend_samples.iter().skip(first).take(last + 1 - first);
+        let &(first_ms, _) = samples().next()?;
+        let count = (last + 1 - first) as f32;
+        let elapsed = |sampled_ms: u64| (sampled_ms - first_ms) as f32;
+        let mean_t = samples().map(|&(t, _)| elapsed(t)).sum::<f32>() / count;
+        let mean_y = samples().map(|&(_, y)| y.to_f32()).sum::<f32>() / count;
+        let (covariance, variance) =
+            samples().fold((0.0, 0.0), |(covariance, variance), &(t, y)| {
+                let dt = elapsed(t) - mean_t;
+                (covariance + dt * (y.to_f32() - mean_y), variance + dt * dt)
+            });
+        if variance <= 0.0 {
+            return None;
+        }
+        Some(covariance / variance * self.config.trend_sample_interval_ms as f32)
+    }
+
     fn detect_external_remote(&mut self, now_ms: u64) {
         if !self.is_sensor_data_valid(now_ms) {
             return;
         }
 
-        if let Some(last) = self.last_trend_sample_ms {
-            if now_ms.saturating_sub(last) < self.config.trend_sample_interval_ms {
-                return;
-            }
-        }
-        self.last_trend_sample_ms = Some(now_ms);
-
-        let Some(previous) = self.previous_temp_f else {
-            self.previous_temp_f = Some(self.current_temp_f);
+        let Some((delta, min_run, max_run)) = self.trend_delta(now_ms) else {
             return;
         };
 
-        let delta = self.current_temp_f - previous;
-        self.previous_temp_f = Some(self.current_temp_f);
-
-        let new_direction = if delta > self.config.trend_rising_threshold_f {
+        // The window as a whole must cross the threshold and every run must
+        // lean at least halfway the same way.
+        let rising = self.config.trend_rising_threshold_f;
+        let falling = self.config.trend_falling_threshold_f;
+        let direction = if delta > rising && min_run > rising / 2.0 {
             1
-        } else if delta < self.config.trend_falling_threshold_f {
+        } else if delta < falling && max_run < falling / 2.0 {
             -1
         } else {
+            // A trend halfway to either threshold is worth a closer look;
+            // ask the sensor for dense samples unless a burst is running.
+            let leaning = delta > rising / 2.0 || delta < falling / 2.0;
+            let burst_running = self.burst_until_ms.is_some_and(|until| now_ms < until);
+            if leaning && !burst_running {
+                self.request_burst(now_ms);
+            }
             0
         };
 
-        if new_direction == self.trend_direction && new_direction != 0 {
-            self.consecutive_trend = self.consecutive_trend.saturating_add(1);
-        } else {
-            self.consecutive_trend = if new_direction == 0 { 0 } else { 1 };
-            self.trend_direction = new_direction;
-        }
-
-        if self.consecutive_trend < self.config.trend_samples_required {
-            return;
-        }
-
-        if self.trend_direction == 1 && !self.fireplace_on {
+        if direction == 1 && !self.fireplace_on {
             self.fireplace_on = true;
             self.heating_start_ms = Some(now_ms);
             self.enter_hold_internal(
@@ -484,8 +678,8 @@ impl ThermostatEngine {
                 HoldReason::ExternalRemote,
                 now_ms,
             );
-            self.consecutive_trend = 0;
-        } else if self.trend_direction == -1 && self.fireplace_on {
+            self.trend_samples.clear();
+        } else if direction == -1 && self.fireplace_on {
             self.fireplace_on = false;
             self.heating_start_ms = None;
             self.enter_hold_internal(
@@ -493,16 +687,24 @@ impl ThermostatEngine {
                 HoldReason::ExternalRemote,
                 now_ms,
             );
-            self.consecutive_trend = 0;
+            self.trend_samples.clear();
         }
     }
 
-    fn evaluate_state(&mut self, now_ms: u64, actions: &mut Vec<EngineAction>) {
+    // Returns true when the actions came from comparing the reading against
+    // the target band rather than from a safety, mode, cooldown or hold path.
+    fn evaluate_state(&mut self, now_ms: u64, actions: &mut EngineActions) -> bool {
         // Emergency shutoff: absolute max temperature ceiling
-        if self.current_temp_f >= self.config.absolute_max_temp_f && self.fireplace_on {
+        let hottest_f = self
+            .fusion
+            .max_fresh_f(now_ms)
+            .map_or(self.current_temp_f, |max_f| {
+                DeciDegrees::from_f32(max_f).max(self.current_temp_f)
+            });
+        if hottest_f >= self.config.absolute_max_temp_f && self.fireplace_on {
             self.turn_fireplace_off(now_ms, actions);
             self.state = ThermostatState::Idle;
-            return;
+            return false;
         }
 
         if self.settings.mode == ThermostatMode::Off {
@@ -510,17 +712,17 @@ impl ThermostatEngine {
                 self.turn_fireplace_off(now_ms, actions);
             }
             self.state = ThermostatState::Idle;
-            return;
+            return false;
         }
 
         if self.in_cooldown {
             self.state = ThermostatState::Cooldown;
-            return;
+            return false;
         }
 
         if self.is_in_hold() {
             self.state = ThermostatState::Hold;
-            return;
+            return false;
         }
 
         if !self.is_sensor_data_valid(now_ms) {
@@ -528,11 +730,17 @@ impl ThermostatEngine {
                 self.turn_fireplace_off(now_ms, actions);
             }
             self.state = ThermostatState::Idle;
-            return;
+            return false;
         }
 
-        let lower_bound = self.settings.target_temp_f - self.settings.hysteresis_f;
-        let upper_bound = self.settings.target_temp_f + self.settings.hysteresis_f;
+        let lower_bound = self
+            .settings
+            .target_temp_f
+            .saturating_sub(self.settings.hysteresis_f);
+        let upper_bound = self
+            .settings
+            .target_temp_f
+            .saturating_add(self.settings.hysteresis_f);
 
         if !self.fireplace_on {
             if self.current_temp_f < lower_bound {
@@ -549,6 +757,7 @@ impl ThermostatEngine {
         } else {
             self.state = ThermostatState::Heating;
         }
+        true
     }
 
     fn can_change_state(&self, now_ms: u64) -> bool {
@@ -557,30 +766,30 @@ impl ThermostatEngine {
             .unwrap_or(true)
     }
 
-    fn turn_fireplace_on(&mut self, now_ms: u64, actions: &mut Vec<EngineAction>) {
+    fn turn_fireplace_on(&mut self, now_ms: u64, actions: &mut EngineActions) {
         if self.fireplace_on {
             return;
         }
 
-        actions.push(EngineAction::PowerOn);
-        actions.push(EngineAction::Delay(500));
-        actions.push(EngineAction::HeatOn);
-        actions.push(EngineAction::Delay(200));
+        actions.push_bounded(EngineAction::PowerOn);
+        actions.push_bounded(EngineAction::Delay(500));
+        actions.push_bounded(EngineAction::HeatOn);
+        actions.push_bounded(EngineAction::Delay(200));
 
         let desired = Self::normalize_fireplace_temp(
-            self.settings.target_temp_f as i32 + self.settings.fireplace_offset_f,
+            self.settings.target_temp_f.whole_degrees() + self.settings.fireplace_offset_f,
         );
         self.fireplace_temp_f = desired;
-        actions.push(EngineAction::SetTemp(desired));
-        actions.push(EngineAction::Delay(200));
+        actions.push_bounded(EngineAction::SetTemp(desired));
+        actions.push_bounded(EngineAction::Delay(200));
 
         // Fireplace defaults light to 4 on power-on; send 4 toggles to return to OFF.
         self.light_level = 4;
         for step in 0..4 {
-            actions.push(EngineAction::LightToggle);
+            actions.push_bounded(EngineAction::LightToggle);
             self.advance_light_state();
             if step < 3 {
-                actions.push(EngineAction::Delay(200));
+                actions.push_bounded(EngineAction::Delay(200));
             }
         }
 
@@ -590,12 +799,12 @@ impl ThermostatEngine {
         self.state = ThermostatState::Heating;
     }
 
-    fn turn_fireplace_off(&mut self, now_ms: u64, actions: &mut Vec<EngineAction>) {
+    fn turn_fireplace_off(&mut self, now_ms: u64, actions: &mut EngineActions) {
         if !self.fireplace_on {
             return;
         }
 
-        actions.push(EngineAction::PowerOff);
+        actions.push_bounded(EngineAction::PowerOff);
         self.fireplace_on = false;
         self.heating_start_ms = None;
         self.last_state_change_ms = Some(now_ms);
@@ -619,6 +828,12 @@ impl ThermostatEngine {
     }
 }
 
+fn one_action(action: EngineAction) -> EngineActions {
+    let mut actions = EngineActions::new();
+    actions.push_bounded(action);
+    actions
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -629,17 +844,68 @@ mod tests {
             ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
         let mut settings = engine.settings.clone();
         settings.mode = ThermostatMode::Heat;
-        settings.target_temp_f = 70.0;
-        settings.hysteresis_f = 2.0;
+        settings.target_temp_f = DeciDegrees::from_degrees(70);
+        settings.hysteresis_f = DeciDegrees::from_degrees(2);
         engine.settings = settings;
 
-        engine.update_sensor_data(65.0, 40.0, 1_000);
+        engine.update_sensor_data(DeciDegrees::from_degrees(65), 40.0, 1_000);
         let actions = engine.tick(300_999);
 
         assert!(actions.contains(&EngineAction::PowerOn));
         assert!(engine.is_fireplace_on());
     }
 
+    #[test]
+    fn apply_settings_changes_every_field_at_once() {
+        let mut engine =
+            ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
+        engine.settings.mode = ThermostatMode::Heat;
+        engine.fireplace_on = true;
+        engine.heating_start_ms = Some(0);
+
+        let update: SettingsUpdate = serde_json::from_str(
+            r#"{"targetTemp":72.5,"mode":"OFF","hysteresis":1.5,"fireplaceOffset":6}"#,
+        )
+        .unwrap();
+        let (changed, actions) = engine.apply_settings(&update, 1_000).unwrap();
+
+        assert!(changed);
+        assert_eq!(actions, [EngineAction::PowerOff]);
+        assert!(!engine.is_fireplace_on());
+        let settings = engine.settings();
+        assert_eq!(settings.mode, ThermostatMode::Off);
+        assert_eq!(settings.target_temp_f, DeciDegrees::from_tenths(725));
+        assert_eq!(settings.hysteresis_f, DeciDegrees::from_tenths(15));
+        assert_eq!(settings.fireplace_offset_f, 6);
+    }
+
+    #[test]
+    fn apply_settings_rejects_the_whole_update_when_a_field_is_invalid() {
+        let mut engine =
+            ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
+        let update = SettingsUpdate {
+            target_temp_f: Some(DeciDegrees::from_degrees(75)),
+            mode: Some(ThermostatMode::Heat),
+            fireplace_offset_f: Some(5),
+            ..SettingsUpdate::default()
+        };
+
+        assert_eq!(
+            engine.apply_settings(&update, 1_000),
+            Err("Invalid offset value (2-10, even only)")
+        );
+        assert_eq!(
+            engine.settings().target_temp_f,
+            DeciDegrees::from_degrees(70)
+        );
+        assert_eq!(engine.settings().mode, ThermostatMode::Off);
+
+        assert!(engine
+            .apply_settings(&SettingsUpdate::default(), 1_000)
+            .is_err());
+        assert!(serde_json::from_str::<SettingsUpdate>(r#"{"target":72}"#).is_err());
+    }
+
     #[test]
     fn runtime_limit_triggers_cooldown() {
         let mut engine =
@@ -685,11 +951,11 @@ mod tests {
         assert_eq!(engine.fireplace_temp_f, 60);
 
         engine.fireplace_temp_f = 78;
-        assert_eq!(engine.manual_heat_up(), vec![EngineAction::TempUp]);
+        assert_eq!(engine.manual_heat_up(), [EngineAction::TempUp]);
         assert_eq!(engine.fireplace_temp_f, 80);
 
         engine.fireplace_temp_f = 62;
-        assert_eq!(engine.manual_heat_down(), vec![EngineAction::TempDown]);
+        assert_eq!(engine.manual_heat_down(), [EngineAction::TempDown]);
         assert_eq!(engine.fireplace_temp_f, 60);
     }
 
@@ -697,17 +963,12 @@ mod tests {
     fn manual_light_toggle_cycles_levels() {
         let mut engine =
             ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
-        let mut observed = Vec::new();
-
-        for _ in 0..5 {
-            assert_eq!(
-                engine.manual_light_toggle(),
-                vec![EngineAction::LightToggle]
-            );
-            observed.push(engine.light_level);
-        }
+        let observed = [(); 5].map(|()| {
+            assert_eq!(engine.manual_light_toggle(), [EngineAction::LightToggle]);
+            engine.light_level
+        });
 
-        assert_eq!(observed, vec![4, 3, 2, 1, 0]);
+        assert_eq!(observed, [4, 3, 2, 1, 0]);
     }
 
     #[test]
@@ -716,17 +977,11 @@ mod tests {
             ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
 
         for state in 1..=10 {
-            assert_eq!(
-                engine.manual_timer_toggle(),
-                vec![EngineAction::TimerToggle]
-            );
+            assert_eq!(engine.manual_timer_toggle(), [EngineAction::TimerToggle]);
             assert_eq!(engine.timer_state, state);
         }
 
-        assert_eq!(
-            engine.manual_timer_toggle(),
-            vec![EngineAction::TimerToggle]
-        );
+        assert_eq!(engine.manual_timer_toggle(), [EngineAction::TimerToggle]);
         assert_eq!(engine.timer_state, 0);
     }
 
@@ -742,7 +997,7 @@ mod tests {
         let (changed, actions) = engine.set_mode_with_actions(ThermostatMode::Off, 1_300);
 
         assert!(changed);
-        assert_eq!(actions, vec![EngineAction::PowerOff]);
+        assert_eq!(actions, [EngineAction::PowerOff]);
         assert!(!engine.is_fireplace_on());
         assert_eq!(engine.state(), ThermostatState::Idle);
     }
@@ -753,11 +1008,11 @@ mod tests {
             ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
         let mut settings = engine.settings.clone();
         settings.mode = ThermostatMode::Heat;
-        settings.target_temp_f = 69.0;
+        settings.target_temp_f = DeciDegrees::from_degrees(69);
         settings.fireplace_offset_f = 4;
         engine.settings = settings;
 
-        engine.update_sensor_data(60.0, 40.0, 0);
+        engine.update_sensor_data(DeciDegrees::from_degrees(60), 40.0, 0);
         let actions = engine.tick(299_999);
 
         assert!(actions.contains(&EngineAction::SetTemp(74)));
@@ -769,11 +1024,11 @@ mod tests {
             ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
         let mut settings = engine.settings.clone();
         settings.mode = ThermostatMode::Heat;
-        settings.target_temp_f = 70.0;
-        settings.hysteresis_f = 2.0;
+        settings.target_temp_f = DeciDegrees::from_degrees(70);
+        settings.hysteresis_f = DeciDegrees::from_degrees(2);
         engine.settings = settings;
 
-        engine.update_sensor_data(65.0, 40.0, 1_000);
+        engine.update_sensor_data(DeciDegrees::from_degrees(65), 40.0, 1_000);
         let actions = engine.tick(300_999);
 
         assert_eq!(actions.first(), Some(&EngineAction::PowerOn));
@@ -793,7 +1048,7 @@ mod tests {
         engine.fireplace_on = true;
         engine.heating_start_ms = Some(100);
         engine.last_state_change_ms = Some(100);
-        engine.update_sensor_data(70.0, 40.0, 100);
+        engine.update_sensor_data(DeciDegrees::from_degrees(70), 40.0, 100);
 
         // Sensor goes stale (300s timeout exceeded)
         let actions = engine.tick(300_101);
@@ -803,18 +1058,43 @@ mod tests {
         assert_eq!(engine.state(), ThermostatState::Idle);
     }
 
+    #[test]
+    fn fused_sources_go_stale_only_together() {
+        let mut engine =
+            ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
+        engine.settings.mode = ThermostatMode::Heat;
+        engine.fireplace_on = true;
+        engine.heating_start_ms = Some(100);
+        engine.last_state_change_ms = Some(100);
+
+        engine.update_sensor_data(DeciDegrees::from_degrees(68), 40.0, 100);
+        engine.update_source_temperature("28-0000000000a1", DeciDegrees::from_degrees(70), 100);
+        engine.update_source_temperature("28-0000000000a2", DeciDegrees::from_degrees(71), 200_000);
+        // Per-probe sources outrank the plain sensor topic.
+        assert_eq!(engine.current_temp_f(), DeciDegrees::from_tenths(705));
+
+        let actions = engine.tick(300_101);
+        assert!(!actions.contains(&EngineAction::PowerOff));
+        assert!(engine.is_sensor_data_valid(300_101));
+        assert_eq!(engine.current_temp_f(), DeciDegrees::from_degrees(71));
+
+        let actions = engine.tick(500_001);
+        assert!(actions.contains(&EngineAction::PowerOff));
+        assert_eq!(engine.state(), ThermostatState::Idle);
+    }
+
     #[test]
     fn absolute_max_temp_emergency_shutoff() {
         let mut engine =
             ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
         let mut settings = engine.settings.clone();
         settings.mode = ThermostatMode::Heat;
-        settings.target_temp_f = 70.0;
+        settings.target_temp_f = DeciDegrees::from_degrees(70);
         engine.settings = settings;
 
         engine.fireplace_on = true;
         engine.heating_start_ms = Some(100);
-        engine.update_sensor_data(95.0, 40.0, 500);
+        engine.update_sensor_data(DeciDegrees::from_degrees(95), 40.0, 500);
 
         let actions = engine.tick(600);
 
@@ -834,7 +1114,7 @@ mod tests {
         engine.fireplace_on = true;
         engine.heating_start_ms = Some(100);
         engine.last_state_change_ms = Some(100);
-        engine.update_sensor_data(70.0, 40.0, 100);
+        engine.update_sensor_data(DeciDegrees::from_degrees(70), 40.0, 100);
 
         // Set mode to Off immediately (within min_cycle window)
         let (changed, actions) = engine.set_mode_with_actions(ThermostatMode::Off, 200);
@@ -844,4 +1124,118 @@ mod tests {
         assert!(!engine.is_fireplace_on());
         assert_eq!(engine.state(), ThermostatState::Idle);
     }
+
+    fn satisfied_heat_engine() -> ThermostatEngine {
+        let mut engine =
+            ThermostatEngine::new(ThermostatConfig::default(), PersistedSettings::default());
+        engine.settings.mode = ThermostatMode::Heat;
+        engine.settings.target_temp_f = DeciDegrees::from_degrees(70);
+        engine
+    }
+
+    #[test]
+    fn dense_samples_detect_external_remote_within_one_interval() {
+        let mut engine = satisfied_heat_engine();
+
+        // A 1.2 F/min rise sampled every 5 s, as during a burst.
+        for step in 0..=6_u64 {
+            let now_ms = 1_000 + step * 5_000;
+            engine.update_sensor_data(DeciDegrees::from_tenths(700 + step as i16), 40.0, now_ms);
+            engine.tick(now_ms);
+            assert_eq!(engine.is_fireplace_on(), step == 6, "step {step}");
+        }
+        assert!(engine.is_in_hold());
+        assert!(engine.take_burst_request().is_some());
+        assert!(engine.take_burst_request().is_none());
+    }
+
+    #[test]
+    fn sparse_samples_keep_legacy_detection_latency() {
+        let mut engine = satisfied_heat_engine();
+
+        for step in 0..=3_u64 {
+            let now_ms = 1_000 + step * 30_000;
+            engine.update_sensor_data(
+                DeciDegrees::from_tenths(690 + step as i16 * 4),
+                40.0,
+                now_ms,
+            );
+            engine.tick(now_ms);
+            assert_eq!(engine.is_fireplace_on(), step == 3, "step {step}");
+        }
+    }
+
+    #[test]
+    fn only_threshold_decisions_on_a_fresh_reading_are_traced() {
+        let mut engine = satisfied_heat_engine();
+        let trace = |seq| {
+            Some(SampleTrace {
+                seq,
+                captured_epoch_ms: None,
+            })
+        };
+
+        engine.update_sensor_data(DeciDegrees::from_degrees(65), 40.0, 1_000);
+        engine.note_sample_trace(trace(7), 1_000);
+        assert!(engine.tick(1_500).contains(&EngineAction::PowerOn));
+        let context = engine.trace_context(1_500);
+        assert_eq!(context.seq, Some(7));
+        assert_eq!(context.received_ms, Some(1_000));
+
+        // The reading is consumed by the tick that evaluated it.
+        engine.tick(2_000);
+        assert_eq!(engine.trace_context(2_000), TraceContext::untraced(2_000));
+
+        // A safety shutoff is not attributed to the reading that preceded it.
+        engine.update_sensor_data(DeciDegrees::from_degrees(95), 40.0, 3_000);
+        engine.note_sample_trace(trace(8), 3_000);
+        assert!(engine.tick(3_500).contains(&EngineAction::PowerOff));
+        assert_eq!(engine.trace_context(3_500), TraceContext::untraced(3_500));
+    }
+
+    #[test]
+    fn single_step_in_sparse_readings_is_not_a_trend() {
+        let mut engine = satisfied_heat_engine();
+
+        for (step, tenths) in [700, 700, 700, 715, 715, 715].into_iter().enumerate() {
+            let now_ms = 1_000 + step as u64 * 30_000;
+            engine.update_sensor_data(DeciDegrees::from_tenths(tenths), 40.0, now_ms);
+            engine.tick(now_ms);
+        }
+        assert!(!engine.is_fireplace_on());
+        assert!(!engine.is_in_hold());
+    }
+
+    #[test]
+    fn single_step_in_dense_readings_is_not_a_trend() {
+        let mut engine = satisfied_heat_engine();
+
+        for step in 0..=6_u64 {
+            let now_ms = 1_000 + step * 5_000;
+            let tenths = if step == 6 { 705 } else { 700 };
+            engine.update_sensor_data(DeciDegrees::from_tenths(tenths), 40.0, now_ms);
+            engine.tick(now_ms);
+        }
+        assert!(!engine.is_fireplace_on());
+        assert!(!engine.is_in_hold());
+    }
+
+    #[test]
+    fn uncertain_trend_requests_burst_sampling() {
+        let mut engine = satisfied_heat_engine();
+
+        // 0.2 F per 30 s is past half the rising threshold but short of it.
+        for step in 0..=3_u64 {
+            let now_ms = 1_000 + step * 30_000;
+            engine.update_sensor_data(
+                DeciDegrees::from_tenths(700 + step as i16 * 2),
+                40.0,
+                now_ms,
+            );
+            engine.tick(now_ms);
+        }
+        assert!(!engine.is_fireplace_on());
+        let request = engine.take_burst_request().unwrap();
+        assert_eq!(request.interval_ms, engine.config.burst_sample_interval_ms);
+    }
 }
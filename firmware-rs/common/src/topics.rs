@@ -1,12 +1,52 @@
 pub const TOPIC_SENSOR_TEMP: &str = "thermostat/sensor/temperature";
 pub const TOPIC_SENSOR_HUMIDITY: &str = "thermostat/sensor/humidity";
 pub const TOPIC_SENSOR_STATUS: &str = "thermostat/sensor/status";
+pub const TOPIC_SENSOR_HISTORY: &str = "thermostat/sensor/history";
+pub const TOPIC_SENSOR_POLICY: &str = "thermostat/sensor/policy";
+
+// One topic per DS18B20, keyed by ROM id: thermostat/sensor/<rom-id>/temperature.
+pub const TOPIC_SENSOR_PROBE_TEMP_FILTER: &str = "thermostat/sensor/+/temperature";
+
+pub fn sensor_probe_temperature_topic(rom_id: &str) -> String {
+    format!("thermostat/sensor/{rom_id}/temperature")
+}
+
+pub fn sensor_probe_id(topic: &str) -> Option<&str> {
+    topic
+        .strip_prefix("thermostat/sensor/")?
+        .strip_suffix("/temperature")
+        .filter(|id| !id.is_empty() && !id.contains('/'))
+}
 
 pub const TOPIC_CONTROLLER_STATE: &str = "thermostat/controller/state";
+pub const TOPIC_CONTROLLER_STATE_DELTA: &str = "thermostat/controller/state/delta";
 pub const TOPIC_CONTROLLER_SCHEDULE_STATE: &str = "thermostat/controller/schedule/state";
+pub const TOPIC_CONTROLLER_STATE_BIN: &str = "thermostat/controller/state/bin";
+pub const TOPIC_CONTROLLER_SCHEDULE_STATE_BIN: &str = "thermostat/controller/schedule/state/bin";
+pub const TOPIC_CONTROLLER_DIAGNOSTICS: &str = "thermostat/controller/diagnostics";
 
 pub const TOPIC_CMD_POWER: &str = "thermostat/cmnd/fireplace/power";
 pub const TOPIC_CMD_TARGET: &str = "thermostat/cmnd/thermostat/target";
 pub const TOPIC_CMD_MODE: &str = "thermostat/cmnd/thermostat/mode";
 pub const TOPIC_CMD_HOLD: &str = "thermostat/cmnd/thermostat/hold";
+// JSON `SettingsUpdate`, applied as one change like PATCH /api/settings.
+pub const TOPIC_CMD_SETTINGS: &str = "thermostat/cmnd/thermostat/settings";
 pub const TOPIC_CMD_SCHEDULE: &str = "thermostat/cmnd/thermostat/schedule";
+pub const TOPIC_CMD_SCHEDULE_CHUNK: &str = "thermostat/cmnd/thermostat/schedule/chunk";
+pub const TOPIC_CMD_SENSOR_POLICY: &str = "thermostat/cmnd/sensor/policy";
+pub const TOPIC_CMD_SENSOR_BURST: &str = "thermostat/cmnd/sensor/burst";
+
+// Zone-scoped topics nest the single-zone ones under thermostat/zones/<id>/,
+// e.g. thermostat/zones/den/sensor/temperature.
+pub const ZONE_TOPIC_PREFIX: &str = "thermostat/zones/";
+
+pub fn zone_topic(zone_id: &str, topic: &str) -> String {
+    let rest = topic.strip_prefix("thermostat/").unwrap_or(topic);
+    format!("{ZONE_TOPIC_PREFIX}{zone_id}/{rest}")
+}
+
+// Splits a zone-scoped topic into its zone id and the single-zone topic.
+pub fn split_zone_topic(topic: &str) -> Option<(&str, String)> {
+    let (zone_id, rest) = topic.strip_prefix(ZONE_TOPIC_PREFIX)?.split_once('/')?;
+    (!zone_id.is_empty() && !rest.is_empty()).then(|| (zone_id, format!("thermostat/{rest}")))
+}
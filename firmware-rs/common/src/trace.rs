@@ -0,0 +1,280 @@
+#[cfg(feature = "std")]
+use std::time::{SystemTime, UNIX_EPOCH};
+
+#[cfg(feature = "std")]
+use serde::Serialize;
+
+#[cfg(feature = "std")]
+use crate::histogram::{Histogram, HistogramSummary};
+
+// Wall-clock readings before 2020-01-01 mean the clock was never set (an ESP32
+// without SNTP starts at 1970), so cross-device stages are skipped.
+#[cfg(feature = "std")]
+const MIN_VALID_EPOCH_MS: u64 = 1_577_836_800_000;
+
+#[cfg(feature = "std")]
+pub fn wall_clock_ms() -> Option<u64> {
+    let now_ms = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .ok()?
+        .as_millis()
+        .try_into()
+        .ok()?;
+    (now_ms >= MIN_VALID_EPOCH_MS).then_some(now_ms)
+}
+
+// Optional trailer on sensor readings:
+//   68.2                          plain reading
+//   68.2;seq=42;ts=1718000000123  sequence number and capture time (epoch ms)
+// Controllers older than this format only parse the plain form, so sensors
+// send the trailer only when the publish policy enables it. Unknown keys are
+// ignored so the trailer can grow.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct SampleTrace {
+    pub seq: u32,
+    pub captured_epoch_ms: Option<u64>,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct SensorSample {
+    pub value: f32,
+    pub trace: Option<SampleTrace>,
+}
+
+impl SensorSample {
+    pub fn parse(payload: &str) -> Option<Self> {
+        let mut fields = payload.trim().split(';');
+        let value = fields.next()?.trim().parse::<f32>().ok()?;
+        let mut seq = None;
+        let mut captured_epoch_ms = None;
+        for field in fields {
+            match field.trim().split_once('=') {
+                Some(("seq", raw)) => seq = raw.parse().ok(),
+                Some(("ts", raw)) => captured_epoch_ms = raw.parse().ok(),
+                _ => {}
+            }
+        }
+        Some(Self {
+            value,
+            trace: seq.map(|seq| SampleTrace {
+                seq,
+                captured_epoch_ms,
+            }),
+        })
+    }
+
+    #[cfg(feature = "std")]
+    pub fn format(&self) -> String {
+        match self.trace {
+            None => format!("{:.1}", self.value),
+            Some(SampleTrace {
+                seq,
+                captured_epoch_ms: Some(ts),
+            }) => format!("{:.1};seq={seq};ts={ts}", self.value),
+            Some(SampleTrace { seq, .. }) => format!("{:.1};seq={seq}", self.value),
+        }
+    }
+}
+
+// Where a batch of engine actions came from. Times without "epoch" are the
+// controller's monotonic milliseconds. Actions not caused by a reading
+// (manual, schedule, safety) have no sensor fields.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct TraceContext {
+    pub seq: Option<u32>,
+    pub captured_epoch_ms: Option<u64>,
+    pub received_ms: Option<u64>,
+    pub decided_ms: u64,
+}
+
+impl TraceContext {
+    pub fn untraced(decided_ms: u64) -> Self {
+        Self {
+            decided_ms,
+            ..Self::default()
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum TraceStage {
+    // Sensor capture to controller receipt; needs both wall clocks set.
+    SensorToController,
+    // Controller receipt to the tick that emitted actions.
+    ReceiveToDecision,
+    // Decision to the first IR frame (IR lock, send rate limit). Every stage
+    // from here on is recorded once per action batch.
+    DecisionToIr,
+    // First IR frame to the last repeat of the batch's first action.
+    IrTransmit,
+    // Sensor capture to that action sent; needs both wall clocks set.
+    SampleToIr,
+}
+
+impl TraceStage {
+    pub const ALL: [Self; 5] = [
+        Self::SensorToController,
+        Self::ReceiveToDecision,
+        Self::DecisionToIr,
+        Self::IrTransmit,
+        Self::SampleToIr,
+    ];
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Self::SensorToController => "sensorToController",
+            Self::ReceiveToDecision => "receiveToDecision",
+            Self::DecisionToIr => "decisionToIr",
+            Self::IrTransmit => "irTransmit",
+            Self::SampleToIr => "sampleToIr",
+        }
+    }
+}
+
+#[cfg(feature = "std")]
+#[derive(Debug, Clone, Serialize)]
+pub struct StageLatencyView {
+    pub stage: &'static str,
+    #[serde(flatten)]
+    pub latency_ms: HistogramSummary,
+}
+
+// One millisecond histogram per stage. Recording is lock-free, so a single
+// static instance serves the MQTT, control and IR paths.
+#[cfg(feature = "std")]
+#[derive(Debug, Default)]
+pub struct StageLatencies {
+    stages: [Histogram; TraceStage::ALL.len()],
+}
+
+#[cfg(feature = "std")]
+impl StageLatencies {
+    pub const fn new() -> Self {
+        Self {
+            stages: [
+                Histogram::new(),
+                Histogram::new(),
+                Histogram::new(),
+                Histogram::new(),
+                Histogram::new(),
+            ],
+        }
+    }
+
+    pub fn record(&self, stage: TraceStage, ms: u64) {
+        self.stages[stage as usize].record(ms);
+    }
+
+    pub fn record_receive(&self, trace: &SampleTrace, received_epoch_ms: Option<u64>) {
+        if let (Some(captured), Some(received)) = (trace.captured_epoch_ms, received_epoch_ms) {
+            self.record(
+                TraceStage::SensorToController,
+                received.saturating_sub(captured),
+            );
+        }
+    }
+
+    pub fn record_decision(&self, trace: &TraceContext) {
+        if let Some(received_ms) = trace.received_ms {
+            self.record(
+                TraceStage::ReceiveToDecision,
+                trace.decided_ms.saturating_sub(received_ms),
+            );
+        }
+    }
+
+    pub fn record_ir(
+        &self,
+        trace: &TraceContext,
+        started_ms: u64,
+        finished_ms: u64,
+        finished_epoch_ms: Option<u64>,
+    ) {
+        self.record(
+            TraceStage::DecisionToIr,
+            started_ms.saturating_sub(trace.decided_ms),
+        );
+        self.record(
+            TraceStage::IrTransmit,
+            finished_ms.saturating_sub(started_ms),
+        );
+        if let (Some(captured), Some(finished)) = (trace.captured_epoch_ms, finished_epoch_ms) {
+            self.record(TraceStage::SampleToIr, finished.saturating_sub(captured));
+        }
+    }
+
+    pub fn views(&self) -> Vec<StageLatencyView> {
+        TraceStage::ALL
+            .iter()
+            .map(|&stage| StageLatencyView {
+                stage: stage.name(),
+                latency_ms: self.stages[stage as usize].snapshot().summary(),
+            })
+            .collect()
+    }
+}
+
+#[cfg(all(test, feature = "std"))]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn sample_format_is_backward_compatible() {
+        assert_eq!(
+            SensorSample::parse("68.2"),
+            Some(SensorSample {
+                value: 68.2,
+                trace: None
+            })
+        );
+        let traced = SensorSample {
+            value: 68.2,
+            trace: Some(SampleTrace {
+                seq: 42,
+                captured_epoch_ms: Some(1_718_000_000_123),
+            }),
+        };
+        let payload = traced.format();
+        assert_eq!(payload, "68.2;seq=42;ts=1718000000123");
+        assert_eq!(SensorSample::parse(&payload), Some(traced));
+        assert_eq!(
+            SensorSample::parse(" 70.0;seq=7;fw=3 ").unwrap().trace,
+            Some(SampleTrace {
+                seq: 7,
+                captured_epoch_ms: None
+            })
+        );
+        assert_eq!(SensorSample::parse("warm;seq=1"), None);
+    }
+
+    #[test]
+    fn stages_record_from_one_trace() {
+        let latencies = StageLatencies::new();
+        let sample = SampleTrace {
+            seq: 1,
+            captured_epoch_ms: Some(1_000_000),
+        };
+        latencies.record_receive(&sample, Some(1_000_150));
+        let trace = TraceContext {
+            seq: Some(sample.seq),
+            captured_epoch_ms: sample.captured_epoch_ms,
+            received_ms: Some(5_000),
+            decided_ms: 5_400,
+        };
+        latencies.record_decision(&trace);
+        latencies.record_ir(&trace, 5_700, 5_900, Some(1_000_900));
+        // Manual actions only contribute the IR stages.
+        latencies.record_decision(&TraceContext::untraced(6_000));
+
+        let views = latencies.views();
+        let p50 = |name: &str| {
+            let view = views.iter().find(|view| view.stage == name).unwrap();
+            (view.latency_ms.count, view.latency_ms.p50)
+        };
+        assert_eq!(p50("sensorToController"), (1, 150));
+        assert_eq!(p50("receiveToDecision"), (1, 400));
+        assert_eq!(p50("decisionToIr"), (1, 300));
+        assert_eq!(p50("irTransmit"), (1, 200));
+        assert_eq!(p50("sampleToIr"), (1, 900));
+    }
+}
@@ -1,5 +1,12 @@
 use serde::{Deserialize, Serialize};
 
+use crate::{bounded::BoundedString, temperature::DeciDegrees};
+
+// Longest is "0.5hr".
+pub const TIMER_STRING_CAPACITY: usize = 8;
+// The longest IANA zone name is 32 bytes; without std, longer ones are cut.
+pub const TIMEZONE_CAPACITY: usize = 48;
+
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
 #[serde(rename_all = "UPPERCASE")]
 pub enum ThermostatMode {
@@ -41,12 +48,12 @@ impl ThermostatState {
 #[derive(Debug, Clone, Serialize)]
 pub struct ControllerStatus {
     #[serde(rename = "currentTemp")]
-    pub current_temp: f32,
+    pub current_temp: DeciDegrees,
     #[serde(rename = "currentHumidity")]
     pub current_humidity: f32,
     #[serde(rename = "targetTemp")]
-    pub target_temp: f32,
-    pub hysteresis: f32,
+    pub target_temp: DeciDegrees,
+    pub hysteresis: DeciDegrees,
     #[serde(rename = "fireplaceOffset")]
     pub fireplace_offset: i32,
     #[serde(rename = "fireplaceTemp")]
@@ -62,7 +69,7 @@ pub struct ControllerStatus {
     #[serde(rename = "timerState")]
     pub timer_state: u8,
     #[serde(rename = "timerString")]
-    pub timer_string: String,
+    pub timer_string: BoundedString<TIMER_STRING_CAPACITY>,
     #[serde(rename = "holdActive")]
     pub hold_active: bool,
     #[serde(rename = "holdRemainingMs")]
@@ -85,16 +92,16 @@ pub struct ControllerStatus {
     pub next_schedule_event_epoch: Option<i64>,
     #[serde(rename = "timeSynced")]
     pub time_synced: bool,
-    pub timezone: String,
+    pub timezone: BoundedString<TIMEZONE_CAPACITY>,
 }
 
-#[derive(Debug, Clone, Serialize)]
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
 pub struct ControllerStatePayload {
-    pub temp: f32,
+    pub temp: DeciDegrees,
     pub humidity: f32,
-    pub target: f32,
-    pub mode: &'static str,
-    pub state: &'static str,
+    pub target: DeciDegrees,
+    pub mode: ThermostatMode,
+    pub state: ThermostatState,
     pub fireplace: bool,
     #[serde(rename = "holdActive")]
     pub hold_active: bool,
@@ -0,0 +1,398 @@
+use thiserror::Error;
+
+use crate::{
+    schedule::{DayOfWeek, Schedule, ScheduleEntry},
+    temperature::DeciDegrees,
+    types::{ControllerStatePayload, ThermostatMode, ThermostatState},
+};
+
+// Compact binary encoding for the retained state topics. Every message starts
+// with the schema version and a kind tag; integers are LEB128 varints,
+// temperatures little-endian i16 tenths of a degree and other floats
+// little-endian f32, so values round-trip exactly.
+pub const WIRE_SCHEMA_VERSION: u8 = 2;
+// Version 1 sent temperatures as f32. It is still decoded so retained
+// messages and schedules saved by older firmware stay readable.
+const WIRE_SCHEMA_V1: u8 = 1;
+
+const KIND_STATE: u8 = 1;
+const KIND_SCHEDULE: u8 = 2;
+
+const STATE_FLAG_FIREPLACE: u8 = 1 << 0;
+const STATE_FLAG_HOLD: u8 = 1 << 1;
+const STATE_FLAG_COOLDOWN: u8 = 1 << 2;
+
+const ENTRY_MODE_HEAT: u8 = 1 << 3;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Error)]
+pub enum WireError {
+    #[error("payload truncated")]
+    Truncated,
+    #[error("unsupported schema version {0}")]
+    UnsupportedVersion(u8),
+    #[error("unexpected message kind {0}")]
+    UnexpectedKind(u8),
+    #[error("invalid field value")]
+    InvalidValue,
+    #[error("trailing bytes after payload")]
+    TrailingBytes,
+}
+
+pub fn encode_state(payload: &ControllerStatePayload, out: &mut Vec<u8>) {
+    out.push(WIRE_SCHEMA_VERSION);
+    out.push(KIND_STATE);
+    out.extend_from_slice(&payload.temp.tenths().to_le_bytes());
+    out.extend_from_slice(&payload.humidity.to_le_bytes());
+    out.extend_from_slice(&payload.target.tenths().to_le_bytes());
+    out.push(mode_code(payload.mode));
+    out.push(state_code(payload.state));
+
+    let mut flags = 0;
+    if payload.fireplace {
+        flags |= STATE_FLAG_FIREPLACE;
+    }
+    if payload.hold_active {
+        flags |= STATE_FLAG_HOLD;
+    }
+    if payload.in_cooldown {
+        flags |= STATE_FLAG_COOLDOWN;
+    }
+    out.push(flags);
+
+    write_varint(out, payload.hold_remaining_min);
+    write_varint(out, payload.cooldown_remaining_min);
+    write_varint(out, payload.runtime_min);
+}
+
+pub fn decode_state(bytes: &[u8]) -> Result<ControllerStatePayload, WireError> {
+    let mut reader = Reader::new(bytes);
+    reader.header(KIND_STATE)?;
+
+    let temp = reader.temp()?;
+    let humidity = reader.f32()?;
+    let target = reader.temp()?;
+    let mode = mode_from_code(reader.u8()?)?;
+    let state = state_from_code(reader.u8()?)?;
+    let flags = reader.u8()?;
+    if flags & !(STATE_FLAG_FIREPLACE | STATE_FLAG_HOLD | STATE_FLAG_COOLDOWN) != 0 {
+        return Err(WireError::InvalidValue);
+    }
+
+    let payload = ControllerStatePayload {
+        temp,
+        humidity,
+        target,
+        mode,
+        state,
+        fireplace: flags & STATE_FLAG_FIREPLACE != 0,
+        hold_active: flags & STATE_FLAG_HOLD != 0,
+        hold_remaining_min: reader.varint()?,
+        in_cooldown: flags & STATE_FLAG_COOLDOWN != 0,
+        cooldown_remaining_min: reader.varint()?,
+        runtime_min: reader.varint()?,
+    };
+    reader.finish()?;
+    Ok(payload)
+}
+
+pub fn encode_schedule(schedule: &Schedule, out: &mut Vec<u8>) {
+    out.push(WIRE_SCHEMA_VERSION);
+    out.push(KIND_SCHEDULE);
+    out.push(u8::from(schedule.enabled));
+    write_varint(out, schedule.entries.len() as u64);
+    for entry in &schedule.entries {
+        encode_schedule_entry(entry, out);
+    }
+}
+
+pub fn decode_schedule(bytes: &[u8]) -> Result<Schedule, WireError> {
+    let mut reader = Reader::new(bytes);
+    reader.header(KIND_SCHEDULE)?;
+
+    let enabled = match reader.u8()? {
+        0 => false,
+        1 => true,
+        _ => return Err(WireError::InvalidValue),
+    };
+    let count = reader.varint()?;
+    // Every entry needs at least four bytes (six in version 1), so a count
+    // larger than the remaining input is malformed and must not drive the
+    // allocation.
+    let min_entry_len = if reader.version == WIRE_SCHEMA_V1 {
+        6
+    } else {
+        4
+    };
+    if count > (reader.remaining() / min_entry_len) as u64 {
+        return Err(WireError::Truncated);
+    }
+
+    let mut entries = Vec::with_capacity(count as usize);
+    for _ in 0..count {
+        entries.push(decode_schedule_entry(&mut reader)?);
+    }
+    reader.finish()?;
+    Ok(Schedule { enabled, entries })
+}
+
+fn encode_schedule_entry(entry: &ScheduleEntry, out: &mut Vec<u8>) {
+    let mut packed = entry.day.index() as u8;
+    if entry.mode == ThermostatMode::Heat {
+        packed |= ENTRY_MODE_HEAT;
+    }
+    out.push(packed);
+    write_varint(out, u64::from(entry.start_minutes));
+    out.extend_from_slice(&entry.target_temp_f.tenths().to_le_bytes());
+}
+
+fn decode_schedule_entry(reader: &mut Reader<'_>) -> Result<ScheduleEntry, WireError> {
+    let packed = reader.u8()?;
+    let day = packed & !ENTRY_MODE_HEAT;
+    if day > 6 {
+        return Err(WireError::InvalidValue);
+    }
+    let start_minutes = u16::try_from(reader.varint()?).map_err(|_| WireError::InvalidValue)?;
+
+    Ok(ScheduleEntry {
+        day: DayOfWeek::from_index(day as usize),
+        start_minutes,
+        mode: if packed & ENTRY_MODE_HEAT != 0 {
+            ThermostatMode::Heat
+        } else {
+            ThermostatMode::Off
+        },
+        target_temp_f: reader.temp()?,
+    })
+}
+
+fn mode_code(mode: ThermostatMode) -> u8 {
+    match mode {
+        ThermostatMode::Off => 0,
+        ThermostatMode::Heat => 1,
+    }
+}
+
+fn mode_from_code(code: u8) -> Result<ThermostatMode, WireError> {
+    match code {
+        0 => Ok(ThermostatMode::Off),
+        1 => Ok(ThermostatMode::Heat),
+        _ => Err(WireError::InvalidValue),
+    }
+}
+
+fn state_code(state: ThermostatState) -> u8 {
+    match state {
+        ThermostatState::Idle => 0,
+        ThermostatState::Heating => 1,
+        ThermostatState::Satisfied => 2,
+        ThermostatState::Hold => 3,
+        ThermostatState::Cooldown => 4,
+    }
+}
+
+fn state_from_code(code: u8) -> Result<ThermostatState, WireError> {
+    match code {
+        0 => Ok(ThermostatState::Idle),
+        1 => Ok(ThermostatState::Heating),
+        2 => Ok(ThermostatState::Satisfied),
+        3 => Ok(ThermostatState::Hold),
+        4 => Ok(ThermostatState::Cooldown),
+        _ => Err(WireError::InvalidValue),
+    }
+}
+
+fn write_varint(out: &mut Vec<u8>, mut value: u64) {
+    while value >= 0x80 {
+        out.push((value as u8) | 0x80);
+        value >>= 7;
+    }
+    out.push(value as u8);
+}
+
+struct Reader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+    version: u8,
+}
+
+impl<'a> Reader<'a> {
+    fn new(bytes: &'a [u8]) -> Self {
+        Self {
+            bytes,
+            pos: 0,
+            version: WIRE_SCHEMA_VERSION,
+        }
+    }
+
+    fn remaining(&self) -> usize {
+        self.bytes.len() - self.pos
+    }
+
+    fn header(&mut self, kind: u8) -> Result<(), WireError> {
+        let version = self.u8()?;
+        if version != WIRE_SCHEMA_VERSION && version != WIRE_SCHEMA_V1 {
+            return Err(WireError::UnsupportedVersion(version));
+        }
+        self.version = version;
+        let actual = self.u8()?;
+        if actual != kind {
+            return Err(WireError::UnexpectedKind(actual));
+        }
+        Ok(())
+    }
+
+    fn u8(&mut self) -> Result<u8, WireError> {
+        let byte = *self.bytes.get(self.pos).ok_or(WireError::Truncated)?;
+        self.pos += 1;
+        Ok(byte)
+    }
+
+    fn f32(&mut self) -> Result<f32, WireError> {
+        let end = self.pos + 4;
+        let chunk = self.bytes.get(self.pos..end).ok_or(WireError::Truncated)?;
+        self.pos = end;
+        Ok(f32::from_le_bytes([chunk[0], chunk[1], chunk[2], chunk[3]]))
+    }
+
+    fn i16(&mut self) -> Result<i16, WireError> {
+        let end = self.pos + 2;
+        let chunk = self.bytes.get(self.pos..end).ok_or(WireError::Truncated)?;
+        self.pos = end;
+        Ok(i16::from_le_bytes([chunk[0], chunk[1]]))
+    }
+
+    fn temp(&mut self) -> Result<DeciDegrees, WireError> {
+        if self.version != WIRE_SCHEMA_V1 {
+            return self.i16().map(DeciDegrees::from_tenths);
+        }
+        match self.f32()? {
+            value if value.is_finite() => Ok(DeciDegrees::from_f32(value)),
+            _ => Err(WireError::InvalidValue),
+        }
+    }
+
+    fn varint(&mut self) -> Result<u64, WireError> {
+        let mut value = 0_u64;
+        for shift in (0..64).step_by(7) {
+            let byte = self.u8()?;
+            value |= u64::from(byte & 0x7f) << shift;
+            if byte & 0x80 == 0 {
+                return Ok(value);
+            }
+        }
+        Err(WireError::InvalidValue)
+    }
+
+    fn finish(&self) -> Result<(), WireError> {
+        if self.pos == self.bytes.len() {
+            Ok(())
+        } else {
+            Err(WireError::TrailingBytes)
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sample_state() -> ControllerStatePayload {
+        ControllerStatePayload {
+            temp: DeciDegrees::from_tenths(684),
+            humidity: 41.0,
+            target: DeciDegrees::from_degrees(70),
+            mode: ThermostatMode::Heat,
+            state: ThermostatState::Heating,
+            fireplace: true,
+            hold_active: false,
+            hold_remaining_min: 0,
+            in_cooldown: false,
+            cooldown_remaining_min: 0,
+            runtime_min: 187,
+        }
+    }
+
+    #[test]
+    fn state_round_trips_and_is_smaller_than_json() {
+        let state = sample_state();
+        let mut bytes = Vec::new();
+        encode_state(&state, &mut bytes);
+
+        assert_eq!(decode_state(&bytes), Ok(state.clone()));
+        assert!(bytes.len() * 5 < serde_json::to_vec(&state).unwrap().len());
+    }
+
+    #[test]
+    fn schedule_round_trips() {
+        let schedule = Schedule {
+            enabled: true,
+            entries: vec![
+                ScheduleEntry {
+                    day: DayOfWeek::Mon,
+                    start_minutes: 6 * 60 + 30,
+                    mode: ThermostatMode::Heat,
+                    target_temp_f: DeciDegrees::from_tenths(715),
+                },
+                ScheduleEntry {
+                    day: DayOfWeek::Sun,
+                    start_minutes: 23 * 60,
+                    mode: ThermostatMode::Off,
+                    target_temp_f: DeciDegrees::from_degrees(64),
+                },
+            ],
+        };
+        let mut bytes = Vec::new();
+        encode_schedule(&schedule, &mut bytes);
+
+        assert_eq!(decode_schedule(&bytes), Ok(schedule));
+    }
+
+    #[test]
+    fn rejects_malformed_payloads() {
+        let mut bytes = Vec::new();
+        encode_state(&sample_state(), &mut bytes);
+
+        assert_eq!(
+            decode_state(&bytes[..bytes.len() - 1]),
+            Err(WireError::Truncated)
+        );
+        assert_eq!(
+            decode_schedule(&bytes),
+            Err(WireError::UnexpectedKind(KIND_STATE))
+        );
+
+        let mut future = bytes.clone();
+        future[0] = WIRE_SCHEMA_VERSION + 1;
+        assert_eq!(
+            decode_state(&future),
+            Err(WireError::UnsupportedVersion(WIRE_SCHEMA_VERSION + 1))
+        );
+
+        bytes.push(0);
+        assert_eq!(decode_state(&bytes), Err(WireError::TrailingBytes));
+
+        let huge_count = [WIRE_SCHEMA_VERSION, KIND_SCHEDULE, 1, 0xff, 0xff, 0x03];
+        assert_eq!(decode_schedule(&huge_count), Err(WireError::Truncated));
+    }
+
+    #[test]
+    fn decodes_version_one_float_temperatures() {
+        let mut state = vec![WIRE_SCHEMA_V1, KIND_STATE];
+        for value in [68.4_f32, 41.0, 70.0] {
+            state.extend_from_slice(&value.to_le_bytes());
+        }
+        state.extend_from_slice(&[1, 1, STATE_FLAG_FIREPLACE, 0, 0, 187, 1]);
+        assert_eq!(decode_state(&state), Ok(sample_state()));
+
+        let mut schedule = vec![WIRE_SCHEMA_V1, KIND_SCHEDULE, 1, 1, ENTRY_MODE_HEAT, 0x0a];
+        schedule.extend_from_slice(&71.5_f32.to_le_bytes());
+        assert_eq!(
+            decode_schedule(&schedule).unwrap().entries[0].target_temp_f,
+            DeciDegrees::from_tenths(715)
+        );
+
+        schedule.truncate(6);
+        schedule.extend_from_slice(&f32::NAN.to_le_bytes());
+        assert_eq!(decode_schedule(&schedule), Err(WireError::InvalidValue));
+    }
+}
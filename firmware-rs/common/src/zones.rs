@@ -0,0 +1,433 @@
+use std::{borrow::Cow, collections::HashMap};
+
+use chrono::{DateTime, FixedOffset, Offset};
+use serde::{Deserialize, Serialize};
+use thiserror::Error;
+
+use crate::{
+    config::{PersistedSettings, ThermostatConfig},
+    publish::StatePublisher,
+    schedule::{Schedule, ScheduleAction},
+    sensor_policy::BurstRequest,
+    thermostat::{EngineAction, ThermostatEngine},
+    topics::{split_zone_topic, zone_topic},
+    trace::TraceContext,
+};
+
+// The zone the single-zone topics and routes drive. Every registry holds it;
+// it cannot be removed and does not count towards MAX_ZONES.
+pub const DEFAULT_ZONE_ID: &str = "default";
+
+pub const MAX_ZONES: usize = 32;
+pub const MAX_ZONE_ID_LEN: usize = 32;
+
+#[derive(Debug, Clone, PartialEq, Eq, Error)]
+pub enum ZoneError {
+    #[error("zone id must be 1-{MAX_ZONE_ID_LEN} characters of a-z, 0-9, '-' or '_'")]
+    InvalidId,
+    #[error("zone '{0}' already exists")]
+    Duplicate(String),
+    #[error("zone limit of {MAX_ZONES} reached")]
+    Full,
+}
+
+// Persisted form of one zone; the host controller keeps a list of these in
+// zones.json.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(default)]
+pub struct ZoneConfig {
+    pub id: String,
+    pub name: String,
+    pub ir_channel: u8,
+    pub settings: PersistedSettings,
+    pub schedule: Schedule,
+}
+
+impl Default for ZoneConfig {
+    fn default() -> Self {
+        Self {
+            id: String::new(),
+            name: String::new(),
+            ir_channel: 0,
+            settings: PersistedSettings::default(),
+            schedule: Schedule::default(),
+        }
+    }
+}
+
+impl ZoneConfig {
+    pub fn sanitize(&mut self) {
+        self.settings.sanitize();
+        self.schedule.normalize();
+        if self.name.is_empty() {
+            self.name = self.id.clone();
+        }
+    }
+}
+
+// Ids end up in MQTT topics and URL paths, so wildcards and separators are out.
+pub fn is_valid_zone_id(id: &str) -> bool {
+    !id.is_empty()
+        && id.len() <= MAX_ZONE_ID_LEN
+        && id
+            .bytes()
+            .all(|byte| matches!(byte, b'a'..=b'z' | b'0'..=b'9' | b'-' | b'_'))
+}
+
+// The default zone keeps the original topics; other zones nest them under
+// thermostat/zones/<id>/.
+pub fn zone_scoped_topic(zone_id: &str, topic: &'static str) -> Cow<'static, str> {
+    if zone_id == DEFAULT_ZONE_ID {
+        Cow::Borrowed(topic)
+    } else {
+        Cow::Owned(zone_topic(zone_id, topic))
+    }
+}
+
+// Inverse of zone_scoped_topic: the zone a topic belongs to and its
+// single-zone form.
+pub fn route_zone_topic(topic: &str) -> (&str, Cow<'_, str>) {
+    match split_zone_topic(topic) {
+        Some((zone_id, rest)) => (zone_id, Cow::Owned(rest)),
+        None => (DEFAULT_ZONE_ID, Cow::Borrowed(topic)),
+    }
+}
+
+#[derive(Debug)]
+pub struct Zone {
+    pub id: String,
+    pub name: String,
+    pub ir_channel: u8,
+    pub engine: ThermostatEngine,
+    pub publisher: StatePublisher,
+    schedule: Schedule,
+    schedule_version: u64,
+    // The schedule can only change its answer when the local minute (or the
+    // UTC offset) does, so the lookup is cached between those.
+    cached_action: Option<((i64, i32), Option<ScheduleAction>)>,
+}
+
+impl Zone {
+    fn new(config: ZoneConfig, thermostat: ThermostatConfig) -> Self {
+        Self {
+            id: config.id,
+            name: config.name,
+            ir_channel: config.ir_channel,
+            engine: ThermostatEngine::new(thermostat, config.settings),
+            publisher: StatePublisher::new(),
+            schedule: config.schedule,
+            schedule_version: 0,
+            cached_action: None,
+        }
+    }
+
+    pub fn schedule(&self) -> &Schedule {
+        &self.schedule
+    }
+
+    pub fn schedule_version(&self) -> u64 {
+        self.schedule_version
+    }
+
+    pub fn set_schedule(&mut self, mut schedule: Schedule) {
+        schedule.normalize();
+        self.schedule = schedule;
+        self.schedule_version += 1;
+        self.cached_action = None;
+    }
+
+    pub fn is_default(&self) -> bool {
+        self.id == DEFAULT_ZONE_ID
+    }
+
+    pub fn topic(&self, topic: &'static str) -> Cow<'static, str> {
+        zone_scoped_topic(&self.id, topic)
+    }
+
+    pub fn config(&self) -> ZoneConfig {
+        ZoneConfig {
+            id: self.id.clone(),
+            name: self.name.clone(),
+            ir_channel: self.ir_channel,
+            settings: self.engine.settings().clone(),
+            schedule: self.schedule.clone(),
+        }
+    }
+
+    fn scheduled_action(&mut self, now: DateTime<FixedOffset>) -> Option<ScheduleAction> {
+        let key = (
+            now.timestamp().div_euclid(60),
+            now.offset().fix().local_minus_utc(),
+        );
+        match self.cached_action {
+            Some((cached_key, action)) if cached_key == key => action,
+            _ => {
+                let action = self.schedule.current_action(now);
+                self.cached_action = Some((key, action));
+                action
+            }
+        }
+    }
+}
+
+// Only zones that have something to do show up in a tick.
+#[derive(Debug, Clone, PartialEq)]
+pub struct ZoneTick {
+    pub zone_id: String,
+    pub ir_channel: u8,
+    pub actions: Vec<EngineAction>,
+    pub burst: Option<BurstRequest>,
+    pub trace: TraceContext,
+}
+
+// Hosts many independent engines and schedules behind one shared tick.
+// Zones share the thermostat tuning; settings and schedules are per zone.
+// The default zone always sits at index 0, which swap_remove never moves.
+#[derive(Debug)]
+pub struct ZoneRegistry {
+    thermostat: ThermostatConfig,
+    zones: Vec<Zone>,
+    index: HashMap<String, usize>,
+}
+
+impl ZoneRegistry {
+    pub fn new(thermostat: ThermostatConfig) -> Self {
+        Self::with_default_zone(
+            thermostat,
+            PersistedSettings::default(),
+            Schedule::default(),
+        )
+    }
+
+    pub fn with_default_zone(
+        thermostat: ThermostatConfig,
+        settings: PersistedSettings,
+        schedule: Schedule,
+    ) -> Self {
+        let mut config = ZoneConfig {
+            id: DEFAULT_ZONE_ID.to_string(),
+            settings,
+            schedule,
+            ..ZoneConfig::default()
+        };
+        config.sanitize();
+        let zone = Zone::new(config, thermostat.clone());
+        Self {
+            thermostat,
+            zones: vec![zone],
+            index: HashMap::from([(DEFAULT_ZONE_ID.to_string(), 0)]),
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.zones.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.zones.is_empty()
+    }
+
+    pub fn default_zone(&self) -> &Zone {
+        &self.zones[0]
+    }
+
+    pub fn default_zone_mut(&mut self) -> &mut Zone {
+        &mut self.zones[0]
+    }
+
+    pub fn add(&mut self, mut config: ZoneConfig) -> Result<&mut Zone, ZoneError> {
+        if !is_valid_zone_id(&config.id) {
+            return Err(ZoneError::InvalidId);
+        }
+        if self.index.contains_key(&config.id) {
+            return Err(ZoneError::Duplicate(config.id));
+        }
+        if self.zones.len() > MAX_ZONES {
+            return Err(ZoneError::Full);
+        }
+
+        config.sanitize();
+        self.index.insert(config.id.clone(), self.zones.len());
+        self.zones.push(Zone::new(config, self.thermostat.clone()));
+        Ok(self.zones.last_mut().unwrap())
+    }
+
+    pub fn remove(&mut self, id: &str) -> Option<Zone> {
+        if id == DEFAULT_ZONE_ID {
+            return None;
+        }
+        let index = self.index.remove(id)?;
+        let zone = self.zones.swap_remove(index);
+        if let Some(moved) = self.zones.get(index) {
+            self.index.insert(moved.id.clone(), index);
+        }
+        Some(zone)
+    }
+
+    pub fn get(&self, id: &str) -> Option<&Zone> {
+        self.index.get(id).map(|&index| &self.zones[index])
+    }
+
+    pub fn get_mut(&mut self, id: &str) -> Option<&mut Zone> {
+        self.index.get(id).map(|&index| &mut self.zones[index])
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = &Zone> {
+        self.zones.iter()
+    }
+
+    pub fn iter_mut(&mut self) -> impl Iterator<Item = &mut Zone> {
+        self.zones.iter_mut()
+    }
+
+    // The added zones only: the default zone persists through the
+    // single-zone runtime and schedule files.
+    pub fn configs(&self) -> Vec<ZoneConfig> {
+        self.zones[1..].iter().map(Zone::config).collect()
+    }
+
+    // One pass over every zone: apply its schedule (when the clock is known),
+    // then run the engine.
+    pub fn tick_all(
+        &mut self,
+        now_ms: u64,
+        local_now: Option<DateTime<FixedOffset>>,
+    ) -> Vec<ZoneTick> {
+        let mut ticks = Vec::new();
+        for zone in &mut self.zones {
+            let mut actions = Vec::new();
+            if let Some(action) = local_now.and_then(|now| zone.scheduled_action(now)) {
+                let (_, mut schedule_actions) =
+                    zone.engine
+                        .apply_schedule_action(action.mode, action.target_temp_f, now_ms);
+                actions.append(&mut schedule_actions);
+            }
+            actions.append(&mut zone.engine.tick(now_ms));
+
+            let burst = zone.engine.take_burst_request();
+            if !actions.is_empty() || burst.is_some() {
+                ticks.push(ZoneTick {
+                    zone_id: zone.id.clone(),
+                    ir_channel: zone.ir_channel,
+                    actions,
+                    burst,
+                    trace: zone.engine.trace_context(now_ms),
+                });
+            }
+        }
+        ticks
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use chrono::TimeZone;
+
+    use super::*;
+    use crate::{
+        schedule::{DayOfWeek, ScheduleEntry},
+        temperature::DeciDegrees,
+        types::ThermostatMode,
+    };
+
+    fn zone(id: &str) -> ZoneConfig {
+        ZoneConfig {
+            id: id.to_string(),
+            ..ZoneConfig::default()
+        }
+    }
+
+    #[test]
+    fn registry_validates_ids_and_keeps_index_after_remove() {
+        let mut zones = ZoneRegistry::new(ThermostatConfig::default());
+        assert_eq!(zones.add(zone("Den")).err(), Some(ZoneError::InvalidId));
+        assert_eq!(zones.add(zone("a/b")).err(), Some(ZoneError::InvalidId));
+        assert_eq!(zones.add(zone("+")).err(), Some(ZoneError::InvalidId));
+
+        for id in ["living", "den", "office"] {
+            zones.add(zone(id)).unwrap();
+        }
+        assert_eq!(
+            zones.add(zone("den")).err(),
+            Some(ZoneError::Duplicate("den".to_string()))
+        );
+
+        assert!(zones.remove("living").is_some());
+        assert!(zones.get("living").is_none());
+        assert_eq!(zones.get("office").unwrap().id, "office");
+        assert_eq!(zones.get("den").unwrap().name, "den");
+        // Two added zones plus the default one.
+        assert_eq!(zones.len(), 3);
+    }
+
+    #[test]
+    fn default_zone_keeps_legacy_topics_and_cannot_be_removed() {
+        let mut zones = ZoneRegistry::new(ThermostatConfig::default());
+        zones.add(zone("den")).unwrap();
+        assert_eq!(
+            zones.add(zone(DEFAULT_ZONE_ID)).err(),
+            Some(ZoneError::Duplicate(DEFAULT_ZONE_ID.to_string()))
+        );
+        assert!(zones.remove(DEFAULT_ZONE_ID).is_none());
+        assert!(zones.default_zone().is_default());
+        assert_eq!(zones.configs().len(), 1);
+
+        let topic = zones.default_zone().topic(crate::topics::TOPIC_CMD_TARGET);
+        assert_eq!(topic, crate::topics::TOPIC_CMD_TARGET);
+        assert_eq!(route_zone_topic(&topic), (DEFAULT_ZONE_ID, topic.clone()));
+        let topic = zones
+            .get("den")
+            .unwrap()
+            .topic(crate::topics::TOPIC_CMD_TARGET);
+        assert_eq!(
+            route_zone_topic(&topic),
+            ("den", Cow::Borrowed(crate::topics::TOPIC_CMD_TARGET))
+        );
+
+        for index in 1..MAX_ZONES {
+            zones.add(zone(&format!("zone-{index}"))).unwrap();
+        }
+        assert_eq!(zones.add(zone("extra")).err(), Some(ZoneError::Full));
+    }
+
+    #[test]
+    fn tick_all_runs_each_zone_on_its_own_schedule() {
+        let mut zones = ZoneRegistry::new(ThermostatConfig::default());
+        let mut living = zone("living");
+        living.ir_channel = 1;
+        living.schedule = Schedule {
+            enabled: true,
+            entries: vec![ScheduleEntry {
+                day: DayOfWeek::Mon,
+                start_minutes: 6 * 60,
+                mode: ThermostatMode::Heat,
+                target_temp_f: DeciDegrees::from_degrees(72),
+            }],
+        };
+        zones.add(living).unwrap();
+        zones.add(zone("den")).unwrap();
+
+        for zone in zones.iter_mut() {
+            zone.engine
+                .update_sensor_data(DeciDegrees::from_degrees(66), 40.0, 0);
+        }
+
+        // Monday 2024-01-01 07:00 local.
+        let now = FixedOffset::west_opt(8 * 3600)
+            .unwrap()
+            .with_ymd_and_hms(2024, 1, 1, 7, 0, 0)
+            .unwrap();
+        let ticks = zones.tick_all(1_000, Some(now));
+
+        assert_eq!(ticks.len(), 1);
+        assert_eq!(ticks[0].zone_id, "living");
+        assert_eq!(ticks[0].ir_channel, 1);
+        assert!(ticks[0].actions.contains(&EngineAction::PowerOn));
+        assert!(zones.get("living").unwrap().engine.is_fireplace_on());
+        assert!(!zones.get("den").unwrap().engine.is_fireplace_on());
+        assert_eq!(
+            zones.get("living").unwrap().config().settings.target_temp_f,
+            DeciDegrees::from_degrees(72)
+        );
+    }
+}
@@ -1,9 +1,10 @@
 use core::convert::TryInto;
 use std::{
+    borrow::Cow,
     net::Ipv4Addr,
     sync::{
-        atomic::{AtomicBool, AtomicU32, Ordering},
-        Arc, Mutex, OnceLock,
+        atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering},
+        Arc, Once, OnceLock,
     },
     thread,
     time::{Duration, Instant},
@@ -42,25 +43,61 @@ use sha2::{Digest, Sha256};
 
 use thermostat_common::{
     config::{IrHardwareConfig, NetworkConfig},
-    EngineAction, PersistedSettings, RuntimeConfig, Schedule, ScheduleAction,
-    ThermostatConfig, ThermostatEngine, ThermostatMode, TOPIC_CMD_HOLD,
-    TOPIC_CMD_MODE, TOPIC_CMD_POWER, TOPIC_CMD_SCHEDULE, TOPIC_CMD_TARGET,
-    TOPIC_CONTROLLER_SCHEDULE_STATE, TOPIC_CONTROLLER_STATE, TOPIC_SENSOR_HUMIDITY,
-    TOPIC_SENSOR_TEMP,
+    contention_report,
+    json::{self, ChunkedSink},
+    memory_report, metrics, register_thread,
+    schedule_transfer::{self, MAX_SCHEDULE_ENTRIES},
+    sensor_probe_id,
+    trace::wall_clock_ms,
+    wire, ControllerMetrics, DeciDegrees, EngineAction, EnqueueOutcome, EspMemory, HistoryBatch,
+    HistoryPoint, HistoryStats, HistoryStore, JsonError, OutboundMessage, Outbox, OutboxStats,
+    PersistedSettings, ProfiledMutex, PublishQos, RuntimeConfig, Schedule, ScheduleAction,
+    ScheduleAssembler, ScheduleParser, SensorSample, SettingsUpdate, SourceStatus, SourceUpdate,
+    StageLatencies, StatePublisher, Subsystem, SubsystemScope, ThermostatEngine, ThermostatMode,
+    TopicClass, TraceContext, DEFAULT_SENSOR_SOURCE, TOPIC_CMD_HOLD, TOPIC_CMD_MODE,
+    TOPIC_CMD_POWER, TOPIC_CMD_SCHEDULE, TOPIC_CMD_SCHEDULE_CHUNK, TOPIC_CMD_SENSOR_BURST,
+    TOPIC_CMD_SETTINGS, TOPIC_CMD_TARGET, TOPIC_CONTROLLER_DIAGNOSTICS,
+    TOPIC_CONTROLLER_SCHEDULE_STATE, TOPIC_CONTROLLER_SCHEDULE_STATE_BIN, TOPIC_CONTROLLER_STATE,
+    TOPIC_CONTROLLER_STATE_BIN, TOPIC_CONTROLLER_STATE_DELTA, TOPIC_SENSOR_HISTORY,
+    TOPIC_SENSOR_HUMIDITY, TOPIC_SENSOR_PROBE_TEMP_FILTER, TOPIC_SENSOR_TEMP,
 };
 
 use crate::ir::IrTransmitter;
 
+// Recorded by the MQTT, control and IR action paths.
+pub(crate) static PIPELINE_LATENCY: StageLatencies = StageLatencies::new();
+pub(crate) static METRICS: ControllerMetrics = ControllerMetrics::new();
+
 const NVS_NAMESPACE: &str = "thermostat";
 const NVS_RUNTIME_KEY: &str = "runtime_json";
 const NVS_SCHEDULE_KEY: &str = "schedule_json";
+const NVS_SCHEDULE_BIN_KEY: &str = "schedule_bin";
+// Header plus at most seven bytes per encoded entry.
+const NVS_SCHEDULE_BLOB_MAX: usize = 16 + MAX_SCHEDULE_ENTRIES * 7;
 const MAX_HTTP_BODY: usize = 4096;
+// One default lwIP TCP segment (1440 bytes) less the 7 bytes of chunk framing.
+const HTTP_CHUNK_SIZE: usize = 1433;
 const OTA_CHUNK_SIZE: usize = 4096;
 const MAX_MQTT_PAYLOAD_BYTES: usize = 512;
+const DIAGNOSTICS_PUBLISH_INTERVAL_MS: u64 = 60_000;
+// Two hours at the sensor cadence; the full host-sized store would not fit
+// comfortably in a single JSON response on the ESP32.
+const HISTORY_CAPACITY: usize = 240;
 const PROVISIONING_AP_SSID: &str = "ThermostatController-AP";
 const PROVISIONING_AP_PASSWORD: &str = "ThermostatSetup";
 const WATCHDOG_TIMEOUT_SEC: u32 = 30;
 const SETTINGS_SAVE_RETRY_MS: u64 = 1_000;
+// Sleep between control loop iterations; the measured period adds the work.
+const CONTROL_LOOP_PERIOD: Duration = Duration::from_millis(200);
+// Task stacks, reported with their high-water marks at
+// /api/diagnostics/memory. The main task's size is
+// CONFIG_ESP_MAIN_TASK_STACK_SIZE in sdkconfig.defaults.
+const MAIN_TASK_STACK_SIZE: usize = 32 * 1024;
+const HTTP_STACK_SIZE: usize = 16 * 1024;
+const MQTT_RX_STACK_SIZE: usize = 12 * 1024;
+const CONTROL_LOOP_STACK_SIZE: usize = 12 * 1024;
+const MQTT_TX_STACK_SIZE: usize = 6 * 1024;
+const OTA_STACK_SIZE: usize = 16 * 1024;
 const WIFI_RESTART_GRACE_MS: u64 = 300_000;
 const WIFI_CONNECT_ATTEMPTS: u32 = 5;
 const WIFI_RETRY_DELAY_MS: u64 = 3_000;
@@ -167,13 +204,17 @@ enum WifiStartup {
 
 #[derive(Clone)]
 struct SharedState {
-    engine: Arc<Mutex<ThermostatEngine>>,
-    schedule: Arc<Mutex<Schedule>>,
-    timezone: Arc<Mutex<String>>,
+    engine: Arc<ProfiledMutex<ThermostatEngine>>,
+    schedule: Arc<ProfiledMutex<Schedule>>,
+    schedule_version: Arc<AtomicU64>,
+    schedule_transfer: Arc<ProfiledMutex<ScheduleAssembler>>,
+    outbox: Arc<ProfiledMutex<Outbox>>,
+    history: Arc<ProfiledMutex<HistoryStore>>,
+    timezone: Arc<ProfiledMutex<String>>,
     time_synced: Arc<AtomicBool>,
-    ir_sender: Arc<Mutex<IrTransmitter>>,
-    ota: Arc<Mutex<OtaRuntimeState>>,
-    settings_save_deadline_ms: Arc<Mutex<Option<u64>>>,
+    ir_sender: Arc<ProfiledMutex<IrTransmitter>>,
+    ota: Arc<ProfiledMutex<OtaRuntimeState>>,
+    settings_save_deadline_ms: Arc<ProfiledMutex<Option<u64>>>,
     wifi_connected: Arc<AtomicBool>,
     mqtt_connected: Arc<AtomicBool>,
 }
@@ -186,7 +227,7 @@ struct StatusLed {
 #[derive(Clone)]
 struct NvsStore {
     partition: EspDefaultNvsPartition,
-    lock: Arc<Mutex<()>>,
+    lock: Arc<ProfiledMutex<()>>,
 }
 
 #[derive(Debug, Serialize)]
@@ -198,9 +239,12 @@ struct TimeStatus {
     now_epoch: i64,
 }
 
+// Update bodies borrow their strings from the request buffer; a string is only
+// copied when it contains JSON escapes.
 #[derive(Debug, Deserialize)]
-struct TimezoneUpdate {
-    timezone: String,
+struct TimezoneUpdate<'a> {
+    #[serde(borrow)]
+    timezone: Cow<'a, str>,
 }
 
 #[derive(Debug, Serialize)]
@@ -229,21 +273,21 @@ struct NetworkConfigView {
 }
 
 #[derive(Debug, Deserialize)]
-struct NetworkConfigUpdate {
-    #[serde(rename = "wifiSsid")]
-    wifi_ssid: String,
-    #[serde(rename = "wifiPass", default)]
-    wifi_pass: Option<String>,
-    #[serde(rename = "mqttHost")]
-    mqtt_host: String,
+struct NetworkConfigUpdate<'a> {
+    #[serde(rename = "wifiSsid", borrow)]
+    wifi_ssid: Cow<'a, str>,
+    #[serde(rename = "wifiPass", default, borrow)]
+    wifi_pass: Option<Cow<'a, str>>,
+    #[serde(rename = "mqttHost", borrow)]
+    mqtt_host: Cow<'a, str>,
     #[serde(rename = "mqttPort")]
     mqtt_port: u16,
-    #[serde(rename = "mqttUser")]
-    mqtt_user: String,
-    #[serde(rename = "mqttPass", default)]
-    mqtt_pass: Option<String>,
-    #[serde(rename = "otaPassword", default)]
-    ota_password: Option<String>,
+    #[serde(rename = "mqttUser", borrow)]
+    mqtt_user: Cow<'a, str>,
+    #[serde(rename = "mqttPass", default, borrow)]
+    mqtt_pass: Option<Cow<'a, str>>,
+    #[serde(rename = "otaPassword", default, borrow)]
+    ota_password: Option<Cow<'a, str>>,
     #[serde(rename = "useStaticIp")]
     use_static_ip: bool,
     #[serde(rename = "staticIp")]
@@ -287,6 +331,27 @@ struct IrConfigUpdateResponse {
     ir: IrConfigView,
 }
 
+#[derive(Debug, Serialize)]
+struct MqttDiagnostics {
+    outbox: OutboxStats,
+}
+
+#[derive(Debug, Serialize)]
+struct SensorSourcesView {
+    #[serde(rename = "fusedTempF")]
+    fused_temp_f: DeciDegrees,
+    valid: bool,
+    sources: Vec<SourceStatus>,
+}
+
+#[derive(Debug, Serialize)]
+struct HistoryView {
+    #[serde(rename = "nowMs")]
+    now_ms: u64,
+    stats: HistoryStats,
+    points: Vec<HistoryPoint>,
+}
+
 #[derive(Debug, Default)]
 struct OtaRuntimeState {
     in_progress: bool,
@@ -347,12 +412,19 @@ struct OtaStatusResponse {
 pub fn run() -> anyhow::Result<()> {
     esp_idf_svc::sys::link_patches();
     EspLogger::initialize_default();
+    register_thread(
+        &EspMemory,
+        "main",
+        Subsystem::Main,
+        Some(MAIN_TASK_STACK_SIZE),
+    )
+    .keep();
 
     let sys_loop = EspSystemEventLoop::take()?;
     let nvs_partition = EspDefaultNvsPartition::take()?;
     let nvs_store = NvsStore {
         partition: nvs_partition.clone(),
-        lock: Arc::new(Mutex::new(())),
+        lock: Arc::new(ProfiledMutex::new("nvs", ())),
     };
 
     let mut runtime = nvs_store.load_runtime_config().unwrap_or_else(|err| {
@@ -427,23 +499,33 @@ pub fn run() -> anyhow::Result<()> {
     });
 
     let shared_state = SharedState {
-        engine: Arc::new(Mutex::new(ThermostatEngine::new(
-            ThermostatConfig::default(),
-            runtime.settings.clone(),
-        ))),
-        schedule: Arc::new(Mutex::new(schedule)),
-        timezone: Arc::new(Mutex::new(runtime.timezone.clone())),
+        engine: Arc::new(ProfiledMutex::new(
+            "engine",
+            ThermostatEngine::new(runtime.thermostat.clone(), runtime.settings.clone()),
+        )),
+        schedule: Arc::new(ProfiledMutex::new("schedule", schedule)),
+        schedule_version: Arc::new(AtomicU64::new(0)),
+        schedule_transfer: Arc::new(ProfiledMutex::new(
+            "schedule_transfer",
+            ScheduleAssembler::new(),
+        )),
+        outbox: Arc::new(ProfiledMutex::new("outbox", Outbox::default())),
+        history: Arc::new(ProfiledMutex::new(
+            "history",
+            HistoryStore::new(HISTORY_CAPACITY),
+        )),
+        timezone: Arc::new(ProfiledMutex::new("timezone", runtime.timezone.clone())),
         time_synced: Arc::new(AtomicBool::new(false)),
-        ir_sender: Arc::new(Mutex::new(ir_sender)),
-        ota: Arc::new(Mutex::new(OtaRuntimeState::default())),
-        settings_save_deadline_ms: Arc::new(Mutex::new(None)),
+        ir_sender: Arc::new(ProfiledMutex::new("ir_sender", ir_sender)),
+        ota: Arc::new(ProfiledMutex::new("ota", OtaRuntimeState::default())),
+        settings_save_deadline_ms: Arc::new(ProfiledMutex::new("settings_save_deadline", None)),
         wifi_connected: Arc::new(AtomicBool::new(true)),
         mqtt_connected: Arc::new(AtomicBool::new(false)),
     };
     let status_led = init_status_led(STATUS_LED_PIN);
 
     let (mqtt_client, mqtt_conn) = create_mqtt_client(&runtime.network)?;
-    let mqtt_client = Arc::new(Mutex::new(mqtt_client));
+    let mqtt_client = Arc::new(ProfiledMutex::new("mqtt_client", mqtt_client));
 
     // Generation counter triggers (re)subscribe from the control loop thread — cannot
     // subscribe from within the MQTT event loop without deadlocking on the client mutex.
@@ -463,6 +545,7 @@ pub fn run() -> anyhow::Result<()> {
         status_led,
         mqtt_subscribe_gen,
     );
+    spawn_mqtt_sender(shared_state.clone(), mqtt_client.clone());
 
     let server = create_http_server(shared_state.clone(), nvs_store)?;
 
@@ -512,27 +595,29 @@ fn create_http_server(
     nvs_store: NvsStore,
 ) -> anyhow::Result<EspHttpServer<'static>> {
     let conf = HttpConfiguration {
-        stack_size: 16 * 1024,
+        stack_size: HTTP_STACK_SIZE,
         max_open_sockets: 4,
+        // The default of 32 URI handlers is already used up by the API routes.
+        max_uri_handlers: 48,
         lru_purge_enable: true,
         ..Default::default()
     };
 
     let mut server = EspHttpServer::new(&conf)?;
 
-    server.fn_handler::<anyhow::Error, _>("/", Method::Get, move |req| {
+    timed_handler(&mut server, "/", Method::Get, move |req| {
         req.into_response(200, Some("OK"), &[("Content-Type", "text/html; charset=utf-8")])?
             .write_all(INDEX_HTML.as_bytes())?;
         Ok(())
     })?;
 
-    server.fn_handler::<anyhow::Error, _>("/app.js", Method::Get, move |req| {
+    timed_handler(&mut server, "/app.js", Method::Get, move |req| {
         req.into_response(200, Some("OK"), &[("Content-Type", "application/javascript; charset=utf-8")])?
             .write_all(APP_JS.as_bytes())?;
         Ok(())
     })?;
 
-    server.fn_handler::<anyhow::Error, _>("/style.css", Method::Get, move |req| {
+    timed_handler(&mut server, "/style.css", Method::Get, move |req| {
         req.into_response(200, Some("OK"), &[("Content-Type", "text/css; charset=utf-8")])?
             .write_all(STYLE_CSS.as_bytes())?;
         Ok(())
@@ -540,7 +625,7 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/status", Method::Get, move |req| {
+        timed_handler(&mut server, "/api/status", Method::Get, move |req| {
             let status = build_status(&state);
             write_json(req, &status)
         })?;
@@ -548,7 +633,7 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/target", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/target", Method::Post, move |req| {
             let uri = req.uri().to_string();
             let Some(target) =
                 query_param(&uri, "value").and_then(|value| value.parse::<f32>().ok())
@@ -559,7 +644,7 @@ fn create_http_server(
             let now_ms = monotonic_ms();
             {
                 let mut engine = state.engine.lock().unwrap();
-                let changed = engine.set_target_temp(target);
+                let changed = engine.set_target_temp(DeciDegrees::from_f32(target));
                 if changed {
                     queue_settings_save(&state, now_ms, engine.config.settings_save_debounce_ms);
                 }
@@ -572,7 +657,7 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/mode", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/mode", Method::Post, move |req| {
             let uri = req.uri().to_string();
             let Some(value) = query_param(&uri, "value") else {
                 return write_error(req, 400, "Missing 'value' parameter");
@@ -591,7 +676,7 @@ fn create_http_server(
                 let (changed, actions) = engine.set_mode_with_actions(mode, now_ms);
                 (changed, actions, debounce_ms)
             };
-            execute_engine_actions(&state, actions);
+            execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
             if changed {
                 queue_settings_save(&state, now_ms, debounce_ms);
             }
@@ -603,7 +688,7 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/hysteresis", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/hysteresis", Method::Post, move |req| {
             let uri = req.uri().to_string();
             let Some(value) = query_param(&uri, "value") else {
                 return write_error(req, 400, "Missing 'value' parameter");
@@ -619,7 +704,7 @@ fn create_http_server(
             let now_ms = monotonic_ms();
             {
                 let mut engine = state.engine.lock().unwrap();
-                let changed = engine.set_hysteresis(hysteresis);
+                let changed = engine.set_hysteresis(DeciDegrees::from_f32(hysteresis));
                 if changed {
                     queue_settings_save(&state, now_ms, engine.config.settings_save_debounce_ms);
                 }
@@ -632,7 +717,7 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/offset", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/offset", Method::Post, move |req| {
             let uri = req.uri().to_string();
             let Some(value) = query_param(&uri, "value") else {
                 return write_error(req, 400, "Missing 'value' parameter");
@@ -661,12 +746,49 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/on", Method::Post, move |req| {
+        timed_handler(
+            &mut server,
+            "/api/settings",
+            Method::Patch,
+            move |mut req| {
+                let mut buf = EMPTY_REQUEST_BODY;
+                let body = read_request_body(&mut req, &mut buf)?;
+                let update: SettingsUpdate = match serde_json::from_slice(body) {
+                    Ok(update) => update,
+                    Err(err) => return write_error(req, 400, &err.to_string()),
+                };
+
+                // One engine critical section, one action batch and one queued save
+                // for however many fields changed.
+                let now_ms = monotonic_ms();
+                let (result, debounce_ms) = {
+                    let mut engine = state.engine.lock().unwrap();
+                    let debounce_ms = engine.config.settings_save_debounce_ms;
+                    (engine.apply_settings(&update, now_ms), debounce_ms)
+                };
+                let (changed, actions) = match result {
+                    Ok(applied) => applied,
+                    Err(message) => return write_error(req, 400, message),
+                };
+                execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
+                if changed {
+                    queue_settings_save(&state, now_ms, debounce_ms);
+                }
+
+                let status = build_status(&state);
+                write_json(req, &status)
+            },
+        )?;
+    }
+
+    {
+        let state = state.clone();
+        timed_handler(&mut server, "/api/ir/on", Method::Post, move |req| {
             let actions = {
                 let mut engine = state.engine.lock().unwrap();
                 engine.manual_on(monotonic_ms())
             };
-            execute_engine_actions(&state, actions);
+            execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
             let status = build_status(&state);
             write_json(req, &status)
@@ -675,12 +797,12 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/off", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/ir/off", Method::Post, move |req| {
             let actions = {
                 let mut engine = state.engine.lock().unwrap();
                 engine.manual_off(monotonic_ms())
             };
-            execute_engine_actions(&state, actions);
+            execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
             let status = build_status(&state);
             write_json(req, &status)
@@ -689,12 +811,12 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/heat/on", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/ir/heat/on", Method::Post, move |req| {
             let actions = {
                 let mut engine = state.engine.lock().unwrap();
                 engine.manual_heat_on(monotonic_ms())
             };
-            execute_engine_actions(&state, actions);
+            execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
             let status = build_status(&state);
             write_json(req, &status)
@@ -703,12 +825,12 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/heat/off", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/ir/heat/off", Method::Post, move |req| {
             let actions = {
                 let mut engine = state.engine.lock().unwrap();
                 engine.manual_heat_off(monotonic_ms())
             };
-            execute_engine_actions(&state, actions);
+            execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
             let status = build_status(&state);
             write_json(req, &status)
@@ -717,12 +839,12 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/heat/up", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/ir/heat/up", Method::Post, move |req| {
             let actions = {
                 let mut engine = state.engine.lock().unwrap();
                 engine.manual_heat_up()
             };
-            execute_engine_actions(&state, actions);
+            execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
             let status = build_status(&state);
             write_json(req, &status)
@@ -731,12 +853,12 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/heat/down", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/ir/heat/down", Method::Post, move |req| {
             let actions = {
                 let mut engine = state.engine.lock().unwrap();
                 engine.manual_heat_down()
             };
-            execute_engine_actions(&state, actions);
+            execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
             let status = build_status(&state);
             write_json(req, &status)
@@ -745,35 +867,45 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/light/toggle", Method::Post, move |req| {
-            let actions = {
-                let mut engine = state.engine.lock().unwrap();
-                engine.manual_light_toggle()
-            };
-            execute_engine_actions(&state, actions);
+        timed_handler(
+            &mut server,
+            "/api/ir/light/toggle",
+            Method::Post,
+            move |req| {
+                let actions = {
+                    let mut engine = state.engine.lock().unwrap();
+                    engine.manual_light_toggle()
+                };
+                execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
-            let status = build_status(&state);
-            write_json(req, &status)
-        })?;
+                let status = build_status(&state);
+                write_json(req, &status)
+            },
+        )?;
     }
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/timer/toggle", Method::Post, move |req| {
-            let actions = {
-                let mut engine = state.engine.lock().unwrap();
-                engine.manual_timer_toggle()
-            };
-            execute_engine_actions(&state, actions);
+        timed_handler(
+            &mut server,
+            "/api/ir/timer/toggle",
+            Method::Post,
+            move |req| {
+                let actions = {
+                    let mut engine = state.engine.lock().unwrap();
+                    engine.manual_timer_toggle()
+                };
+                execute_engine_actions(&state, actions, TraceContext::untraced(monotonic_ms()));
 
-            let status = build_status(&state);
-            write_json(req, &status)
-        })?;
+                let status = build_status(&state);
+                write_json(req, &status)
+            },
+        )?;
     }
 
     {
         let state = state.clone();
-        server.fn_handler("/api/hold/enter", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/hold/enter", Method::Post, move |req| {
             let uri = req.uri().to_string();
             let duration_ms = query_param(&uri, "minutes")
                 .and_then(|value| value.parse::<u64>().ok())
@@ -792,7 +924,7 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/hold/exit", Method::Post, move |req| {
+        timed_handler(&mut server, "/api/hold/exit", Method::Post, move |req| {
             {
                 let mut engine = state.engine.lock().unwrap();
                 engine.exit_hold();
@@ -803,9 +935,55 @@ fn create_http_server(
         })?;
     }
 
+    timed_handler(&mut server, "/api/trace/latency", Method::Get, |req| {
+        write_json(req, &PIPELINE_LATENCY.views())
+    })?;
+
+    timed_handler(&mut server, "/api/diagnostics/locks", Method::Get, |req| {
+        write_json(req, &contention_report())
+    })?;
+
+    timed_handler(&mut server, "/api/diagnostics/memory", Method::Get, |req| {
+        write_json(req, &memory_report(&EspMemory))
+    })?;
+
     {
         let state = state.clone();
-        server.fn_handler("/api/safety/reset", Method::Post, move |req| {
+        timed_handler(&mut server, "/metrics", Method::Get, move |req| {
+            let outbox = state.outbox.lock().unwrap().stats();
+            let mut body = String::with_capacity(8 * 1024);
+            METRICS.render(&outbox, &PIPELINE_LATENCY, &mut body);
+            let (free_heap, min_free_heap) = unsafe {
+                (
+                    esp_idf_svc::sys::esp_get_free_heap_size(),
+                    esp_idf_svc::sys::esp_get_minimum_free_heap_size(),
+                )
+            };
+            metrics::write_gauge(
+                &mut body,
+                "thermostat_heap_free_bytes",
+                "Free heap.",
+                free_heap.into(),
+            );
+            metrics::write_gauge(
+                &mut body,
+                "thermostat_heap_min_free_bytes",
+                "Lowest free heap since boot.",
+                min_free_heap.into(),
+            );
+            req.into_response(
+                200,
+                Some("OK"),
+                &[("Content-Type", "text/plain; version=0.0.4; charset=utf-8")],
+            )?
+            .write_all(body.as_bytes())?;
+            Ok(())
+        })?;
+    }
+
+    {
+        let state = state.clone();
+        timed_handler(&mut server, "/api/safety/reset", Method::Post, move |req| {
             {
                 let mut engine = state.engine.lock().unwrap();
                 engine.reset_safety();
@@ -818,7 +996,7 @@ fn create_http_server(
 
     {
         let state = state.clone();
-        server.fn_handler("/api/schedule", Method::Get, move |req| {
+        timed_handler(&mut server, "/api/schedule", Method::Get, move |req| {
             let schedule = state.schedule.lock().unwrap().clone();
             write_json(req, &schedule)
         })?;
@@ -827,25 +1005,74 @@ fn create_http_server(
     {
         let state = state.clone();
         let nvs_store = nvs_store.clone();
-        server.fn_handler::<anyhow::Error, _>("/api/schedule", Method::Put, move |mut req| {
-            let body = read_request_body(&mut req)?;
+        timed_handler(&mut server, "/api/schedule", Method::Put, move |mut req| {
+            let mut buf = EMPTY_REQUEST_BODY;
+            let body = read_request_body(&mut req, &mut buf)?;
             let mut schedule: Schedule =
-                serde_json::from_slice(&body).context("invalid schedule payload")?;
+                serde_json::from_slice(body).context("invalid schedule payload")?;
             schedule.normalize();
 
-            {
-                let mut current = state.schedule.lock().unwrap();
-                *current = schedule.clone();
-            }
-
-            nvs_store.save_schedule(&schedule)?;
+            commit_schedule(&state, &nvs_store, schedule.clone())?;
             write_json(req, &schedule)
         })?;
     }
 
     {
         let state = state.clone();
-        server.fn_handler("/api/time", Method::Get, move |req| {
+        timed_handler(
+            &mut server,
+            "/api/schedule/compact",
+            Method::Get,
+            move |req| {
+                let mut body = String::new();
+                schedule_transfer::write_compact(&state.schedule.lock().unwrap(), &mut body);
+                req.into_response(
+                    200,
+                    Some("OK"),
+                    &[("Content-Type", "text/plain; charset=utf-8")],
+                )?
+                .write_all(body.as_bytes())?;
+                Ok(())
+            },
+        )?;
+    }
+
+    {
+        let state = state.clone();
+        let nvs_store = nvs_store.clone();
+        timed_handler(
+            &mut server,
+            "/api/schedule/compact",
+            Method::Put,
+            move |mut req| {
+                // Stream the body through the parser so dense programs are not
+                // bounded by MAX_HTTP_BODY; only the parsed entries are kept.
+                let mut parser = ScheduleParser::new();
+                let mut chunk = [0_u8; 256];
+                loop {
+                    let read = req.read(&mut chunk)?;
+                    if read == 0 {
+                        break;
+                    }
+                    if let Err(err) = parser.feed(&chunk[..read]) {
+                        return write_error(req, 400, &err.to_string());
+                    }
+                }
+
+                let schedule = match parser.finish() {
+                    Ok(schedule) => schedule,
+                    Err(err) => return write_error(req, 400, &err.to_string()),
+                };
+
+                commit_schedule(&state, &nvs_store, schedule.clone())?;
+                write_json(req, &schedule)
+            },
+        )?;
+    }
+
+    {
+        let state = state.clone();
+        timed_handler(&mut server, "/api/time", Method::Get, move |req| {
             let timezone = state.timezone.lock().unwrap().clone();
             let payload = TimeStatus {
                 time_synced: state.time_synced.load(Ordering::Relaxed),
@@ -860,25 +1087,27 @@ fn create_http_server(
     {
         let state = state.clone();
         let nvs_store = nvs_store.clone();
-        server.fn_handler::<anyhow::Error, _>("/api/timezone", Method::Put, move |mut req| {
-            let body = read_request_body(&mut req)?;
+        timed_handler(&mut server, "/api/timezone", Method::Put, move |mut req| {
+            let mut buf = EMPTY_REQUEST_BODY;
+            let body = read_request_body(&mut req, &mut buf)?;
             let update: TimezoneUpdate =
-                serde_json::from_slice(&body).context("invalid timezone payload")?;
+                serde_json::from_slice(body).context("invalid timezone payload")?;
 
             if update.timezone.parse::<Tz>().is_err() {
                 return write_error(req, 400, "Invalid timezone value");
             }
 
+            let timezone = update.timezone.into_owned();
             {
-                let mut timezone = state.timezone.lock().unwrap();
-                *timezone = update.timezone.clone();
+                let mut current = state.timezone.lock().unwrap();
+                *current = timezone.clone();
             }
 
             persist_runtime_from_state(&nvs_store, &state)?;
 
             let payload = TimeStatus {
                 time_synced: state.time_synced.load(Ordering::Relaxed),
-                timezone: update.timezone,
+                timezone,
                 now_epoch: Utc::now().timestamp(),
             };
 
@@ -888,7 +1117,7 @@ fn create_http_server(
 
     {
         let nvs_store = nvs_store.clone();
-        server.fn_handler("/api/network", Method::Get, move |req| {
+        timed_handler(&mut server, "/api/network", Method::Get, move |req| {
             let runtime = nvs_store.load_runtime_config().unwrap_or_default();
             let payload = build_network_config_view(&runtime.network);
             write_json(req, &payload)
@@ -897,10 +1126,11 @@ fn create_http_server(
 
     {
         let nvs_store = nvs_store.clone();
-        server.fn_handler::<anyhow::Error, _>("/api/network", Method::Put, move |mut req| {
-            let body = read_request_body(&mut req)?;
+        timed_handler(&mut server, "/api/network", Method::Put, move |mut req| {
+            let mut buf = EMPTY_REQUEST_BODY;
+            let body = read_request_body(&mut req, &mut buf)?;
             let update: NetworkConfigUpdate =
-                serde_json::from_slice(&body).context("invalid network payload")?;
+                serde_json::from_slice(body).context("invalid network payload")?;
 
             if let Err(message) = validate_network_update(&update) {
                 return write_error(req, 400, message);
@@ -913,7 +1143,7 @@ fn create_http_server(
 
     {
         let nvs_store = nvs_store.clone();
-        server.fn_handler("/api/ir/config", Method::Get, move |req| {
+        timed_handler(&mut server, "/api/ir/config", Method::Get, move |req| {
             let runtime = nvs_store.load_runtime_config().unwrap_or_default();
             let payload = build_ir_config_view(&runtime.ir);
             write_json(req, &payload)
@@ -922,31 +1152,96 @@ fn create_http_server(
 
     {
         let nvs_store = nvs_store.clone();
-        server.fn_handler::<anyhow::Error, _>("/api/ir/config", Method::Put, move |mut req| {
-            let body = read_request_body(&mut req)?;
-            let update: IrConfigUpdate =
-                serde_json::from_slice(&body).context("invalid ir config payload")?;
+        timed_handler(
+            &mut server,
+            "/api/ir/config",
+            Method::Put,
+            move |mut req| {
+                let mut buf = EMPTY_REQUEST_BODY;
+                let body = read_request_body(&mut req, &mut buf)?;
+                let update: IrConfigUpdate =
+                    serde_json::from_slice(body).context("invalid ir config payload")?;
+
+                if let Err(message) = validate_ir_update(&update) {
+                    return write_error(req, 400, message);
+                }
 
-            if let Err(message) = validate_ir_update(&update) {
-                return write_error(req, 400, message);
-            }
+                let payload = apply_ir_update(&nvs_store, update)?;
+                write_json(req, &payload)
+            },
+        )?;
+    }
 
-            let payload = apply_ir_update(&nvs_store, update)?;
+    {
+        let state = state.clone();
+        timed_handler(
+            &mut server,
+            "/api/ir/diagnostics",
+            Method::Get,
+            move |req| {
+                let diagnostics = state.ir_sender.lock().unwrap().diagnostics();
+                write_json(req, &diagnostics)
+            },
+        )?;
+    }
+
+    {
+        let state = state.clone();
+        timed_handler(
+            &mut server,
+            "/api/mqtt/diagnostics",
+            Method::Get,
+            move |req| {
+                let outbox = state.outbox.lock().unwrap().stats();
+                write_json(req, &MqttDiagnostics { outbox })
+            },
+        )?;
+    }
+
+    {
+        let state = state.clone();
+        timed_handler(&mut server, "/api/sensors", Method::Get, move |req| {
+            let now_ms = monotonic_ms();
+            let payload = {
+                let engine = state.engine.lock().unwrap();
+                SensorSourcesView {
+                    fused_temp_f: engine.current_temp_f(),
+                    valid: engine.is_sensor_data_valid(now_ms),
+                    sources: engine.sensor_sources(now_ms),
+                }
+            };
             write_json(req, &payload)
         })?;
     }
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ir/diagnostics", Method::Get, move |req| {
-            let diagnostics = state.ir_sender.lock().unwrap().diagnostics();
-            write_json(req, &diagnostics)
+        timed_handler(&mut server, "/api/history", Method::Get, move |req| {
+            let uri = req.uri().to_string();
+            let since_ms = match query_param(&uri, "since").map(|value| value.parse::<u64>()) {
+                None => 0,
+                Some(Ok(since_ms)) => since_ms,
+                Some(Err(_)) => return write_error(req, 400, "Invalid 'since' parameter"),
+            };
+
+            let payload = {
+                let history = state.history.lock().unwrap();
+                HistoryView {
+                    now_ms: monotonic_ms(),
+                    stats: history.stats(),
+                    points: history
+                        .points()
+                        .filter(|point| point.at_ms >= since_ms)
+                        .collect(),
+                }
+            };
+            write_json(req, &payload)
         })?;
     }
 
     {
         let state = state.clone();
-        server.fn_handler("/api/ota/status", Method::Get, move |req| {
+        timed_handler(&mut server, "/api/ota/status", Method::Get, move |req| {
             let payload = build_ota_status_response(&state);
             write_json(req, &payload)
         })?;
@@ -955,29 +1250,35 @@ fn create_http_server(
     {
         let state = state.clone();
         let nvs_store = nvs_store.clone();
-        server.fn_handler::<anyhow::Error, _>("/api/ota/apply", Method::Post, move |mut req| {
-            let body = read_request_body(&mut req)?;
-            let update: OtaApplyRequest =
-                serde_json::from_slice(&body).context("invalid ota payload")?;
-
-            if let Err(message) = validate_ota_apply_request(&update) {
-                return write_error(req, 400, message);
-            }
+        timed_handler(
+            &mut server,
+            "/api/ota/apply",
+            Method::Post,
+            move |mut req| {
+                let mut buf = EMPTY_REQUEST_BODY;
+                let body = read_request_body(&mut req, &mut buf)?;
+                let update: OtaApplyRequest =
+                    serde_json::from_slice(body).context("invalid ota payload")?;
+
+                if let Err(message) = validate_ota_apply_request(&update) {
+                    return write_error(req, 400, message);
+                }
 
-            match apply_ota_update(&state, &nvs_store, update) {
-                Ok(payload) => write_json(req, &payload),
-                Err(err) => {
-                    let message = err.to_string();
-                    if message.contains("invalid OTA password") {
-                        write_error(req, 403, &message)
-                    } else if message.contains("already in progress") {
-                        write_error(req, 409, &message)
-                    } else {
-                        write_error(req, 500, "Failed to start OTA apply")
+                match apply_ota_update(&state, &nvs_store, update) {
+                    Ok(payload) => write_json(req, &payload),
+                    Err(err) => {
+                        let message = err.to_string();
+                        if message.contains("invalid OTA password") {
+                            write_error(req, 403, &message)
+                        } else if message.contains("already in progress") {
+                            write_error(req, 409, &message)
+                        } else {
+                            write_error(req, 500, "Failed to start OTA apply")
+                        }
                     }
                 }
-            }
-        })?;
+            },
+        )?;
     }
 
     Ok(server)
@@ -985,7 +1286,7 @@ fn create_http_server(
 
 fn create_provisioning_http_server(nvs_store: NvsStore) -> anyhow::Result<EspHttpServer<'static>> {
     let conf = HttpConfiguration {
-        stack_size: 16 * 1024,
+        stack_size: HTTP_STACK_SIZE,
         max_open_sockets: 4,
         lru_purge_enable: true,
         ..Default::default()
@@ -1020,9 +1321,10 @@ fn create_provisioning_http_server(nvs_store: NvsStore) -> anyhow::Result<EspHtt
     {
         let nvs_store = nvs_store.clone();
         server.fn_handler::<anyhow::Error, _>("/api/network", Method::Put, move |mut req| {
-            let body = read_request_body(&mut req)?;
+            let mut buf = EMPTY_REQUEST_BODY;
+            let body = read_request_body(&mut req, &mut buf)?;
             let update: NetworkConfigUpdate =
-                serde_json::from_slice(&body).context("invalid network payload")?;
+                serde_json::from_slice(body).context("invalid network payload")?;
 
             if let Err(message) = validate_network_update(&update) {
                 return write_error(req, 400, message);
@@ -1053,9 +1355,10 @@ fn create_provisioning_http_server(nvs_store: NvsStore) -> anyhow::Result<EspHtt
     {
         let nvs_store = nvs_store.clone();
         server.fn_handler::<anyhow::Error, _>("/api/ir/config", Method::Put, move |mut req| {
-            let body = read_request_body(&mut req)?;
+            let mut buf = EMPTY_REQUEST_BODY;
+            let body = read_request_body(&mut req, &mut buf)?;
             let update: IrConfigUpdate =
-                serde_json::from_slice(&body).context("invalid ir config payload")?;
+                serde_json::from_slice(body).context("invalid ir config payload")?;
 
             if let Err(message) = validate_ir_update(&update) {
                 return write_error(req, 400, message);
@@ -1108,37 +1411,81 @@ fn create_provisioning_http_server(nvs_store: NvsStore) -> anyhow::Result<EspHtt
     Ok(server)
 }
 
-fn read_request_body(
+// With `static-json` the body is read into a buffer on the handler's own
+// stack instead of the heap; update payloads then borrow their strings from
+// it. Handlers own the buffer so the 4 KB array is never moved between frames.
+#[cfg(feature = "static-json")]
+type RequestBody = [u8; MAX_HTTP_BODY];
+#[cfg(feature = "static-json")]
+const EMPTY_REQUEST_BODY: RequestBody = [0; MAX_HTTP_BODY];
+
+#[cfg(not(feature = "static-json"))]
+type RequestBody = Vec<u8>;
+#[cfg(not(feature = "static-json"))]
+const EMPTY_REQUEST_BODY: RequestBody = Vec::new();
+
+fn read_request_body<'b>(
     req: &mut esp_idf_svc::http::server::Request<
         &mut esp_idf_svc::http::server::EspHttpConnection<'_>,
     >,
-) -> anyhow::Result<Vec<u8>> {
+    buf: &'b mut RequestBody,
+) -> anyhow::Result<&'b [u8]> {
     let len = req.content_len().unwrap_or(0) as usize;
     if len > MAX_HTTP_BODY {
         return Err(anyhow!("request body too large"));
     }
 
-    let mut body = vec![0_u8; len];
+    #[cfg(not(feature = "static-json"))]
+    buf.resize(len, 0);
+    let body = &mut buf[..len];
     if len > 0 {
-        req.read_exact(&mut body)?;
+        req.read_exact(body)?;
     }
     Ok(body)
 }
 
+// Registers an API handler whose latency is recorded under its route path.
+fn timed_handler<F>(
+    server: &mut EspHttpServer<'static>,
+    uri: &'static str,
+    method: Method,
+    handler: F,
+) -> anyhow::Result<()>
+where
+    F: for<'r> Fn(
+            esp_idf_svc::http::server::Request<
+                &mut esp_idf_svc::http::server::EspHttpConnection<'r>,
+            >,
+        ) -> anyhow::Result<()>
+        + Send
+        + 'static,
+{
+    server.fn_handler(uri, method, move |req| {
+        // Handlers run on the HTTP server's task, which ESP-IDF creates.
+        static HTTP_TASK: Once = Once::new();
+        HTTP_TASK.call_once(|| {
+            register_thread(&EspMemory, "httpd", Subsystem::Http, Some(HTTP_STACK_SIZE)).keep();
+        });
+        let started = Instant::now();
+        let result = handler(req);
+        METRICS.http.record(uri, started.elapsed());
+        result
+    })?;
+    Ok(())
+}
+
 fn write_json<T: Serialize>(
     req: esp_idf_svc::http::server::Request<
         &mut esp_idf_svc::http::server::EspHttpConnection<'_>,
     >,
     payload: &T,
 ) -> anyhow::Result<()> {
-    let body = serde_json::to_vec(payload)?;
-    req.into_response(
-        200,
-        Some("OK"),
-        &[("Content-Type", "application/json; charset=utf-8")],
-    )?
-    .write_all(&body)?;
-    Ok(())
+    respond_json(req, 200, Some("OK"), payload)
+}
+
+#[derive(Serialize)]
+struct ErrorBody<'a> {
+    error: &'a str,
 }
 
 fn write_error(
@@ -1148,15 +1495,61 @@ fn write_error(
     status_code: u16,
     message: &str,
 ) -> anyhow::Result<()> {
-    let payload = serde_json::json!({ "error": message });
-    let body = serde_json::to_vec(&payload)?;
-    req.into_response(
-        status_code,
-        None,
-        &[("Content-Type", "application/json; charset=utf-8")],
-    )?
-    .write_all(&body)?;
-    Ok(())
+    respond_json(req, status_code, None, &ErrorBody { error: message })
+}
+
+// Encodes straight into a stack buffer and sends each full buffer as one HTTP
+// chunk, so the body is never held on the heap and the first segment leaves
+// before the rest of the payload is encoded. The headers go out with the
+// first chunk: a payload that fails to encode before filling one is still
+// answered with the server's 500, and a later failure can only cut the
+// body short, so it is logged here.
+fn respond_json<T: Serialize>(
+    req: esp_idf_svc::http::server::Request<
+        &mut esp_idf_svc::http::server::EspHttpConnection<'_>,
+    >,
+    status_code: u16,
+    reason: Option<&str>,
+    payload: &T,
+) -> anyhow::Result<()> {
+    const HEADERS: [(&str, &str); 1] = [("Content-Type", "application/json; charset=utf-8")];
+
+    let mut request = Some(req);
+    let mut response = None;
+    let mut write_failure = None;
+    let mut chunk = [0_u8; HTTP_CHUNK_SIZE];
+    let mut sink = ChunkedSink::new(&mut chunk, |bytes: &[u8]| {
+        let written = match request.take() {
+            Some(req) => req
+                .into_response(status_code, reason, &HEADERS)
+                .and_then(|started| response.insert(started).write_all(bytes)),
+            None => response
+                .as_mut()
+                .expect("the response starts with the first chunk")
+                .write_all(bytes),
+        };
+        written.map_err(|err| {
+            write_failure = Some(err);
+            JsonError::Write
+        })
+    });
+    let result = json::to_sink(payload, &mut sink).and_then(|()| sink.finish());
+
+    if let Some(err) = write_failure {
+        return Err(err.into());
+    }
+    match (result, request) {
+        (Ok(()), None) => Ok(()),
+        (Ok(()), Some(req)) => {
+            req.into_response(status_code, reason, &HEADERS)?;
+            Ok(())
+        }
+        (Err(err), Some(_)) => Err(err.into()),
+        (Err(err), None) => {
+            warn!("json response ({status_code}) cut short after the headers were sent: {err}");
+            Err(err.into())
+        }
+    }
 }
 
 fn query_param(uri: &str, key: &str) -> Option<String> {
@@ -1407,15 +1800,19 @@ fn create_mqtt_client(
     Ok(EspMqttClient::new(url.as_str(), &conf)?)
 }
 
-fn subscribe_topics(mqtt: &Arc<Mutex<EspMqttClient<'static>>>) -> anyhow::Result<()> {
+fn subscribe_topics(mqtt: &Arc<ProfiledMutex<EspMqttClient<'static>>>) -> anyhow::Result<()> {
     let topics = [
         TOPIC_SENSOR_TEMP,
+        TOPIC_SENSOR_PROBE_TEMP_FILTER,
         TOPIC_SENSOR_HUMIDITY,
+        TOPIC_SENSOR_HISTORY,
         TOPIC_CMD_POWER,
         TOPIC_CMD_TARGET,
         TOPIC_CMD_MODE,
         TOPIC_CMD_HOLD,
+        TOPIC_CMD_SETTINGS,
         TOPIC_CMD_SCHEDULE,
+        TOPIC_CMD_SCHEDULE_CHUNK,
     ];
 
     let mut mqtt = mqtt.lock().unwrap();
@@ -1434,8 +1831,14 @@ fn spawn_mqtt_receiver(
 ) {
     thread::Builder::new()
         .name("mqtt-rx".into())
-        .stack_size(12 * 1024)
+        .stack_size(MQTT_RX_STACK_SIZE)
         .spawn(move || {
+            let _memory = register_thread(
+                &EspMemory,
+                "mqtt-rx",
+                Subsystem::Mqtt,
+                Some(MQTT_RX_STACK_SIZE),
+            );
             loop {
                 match conn.next() {
                     Ok(event) => {
@@ -1467,10 +1870,12 @@ fn spawn_mqtt_receiver(
                                 continue;
                             }
 
+                            METRICS.mqtt_received.inc();
                             if let Ok(message) = core::str::from_utf8(data) {
                                 if let Err(err) =
                                     handle_mqtt_message(&state, &nvs_store, topic, message)
                                 {
+                                    METRICS.mqtt_errors.inc();
                                     warn!("mqtt message handling failed: {err:#}");
                                 }
                             }
@@ -1490,27 +1895,39 @@ fn spawn_mqtt_receiver(
 fn spawn_control_loop(
     state: SharedState,
     nvs_store: NvsStore,
-    mqtt: Arc<Mutex<EspMqttClient<'static>>>,
+    mqtt: Arc<ProfiledMutex<EspMqttClient<'static>>>,
     mut status_led: Option<StatusLed>,
     mqtt_subscribe_gen: Arc<AtomicU32>,
 ) {
     thread::Builder::new()
         .name("control-loop".into())
-        .stack_size(12 * 1024)
+        .stack_size(CONTROL_LOOP_STACK_SIZE)
         .spawn(move || {
+            let _memory = register_thread(
+                &EspMemory,
+                "control-loop",
+                Subsystem::Control,
+                Some(CONTROL_LOOP_STACK_SIZE),
+            );
             if let Err(err) = add_current_task_to_watchdog() {
                 warn!("failed to register control loop with watchdog: {err:#}");
             }
 
-            let mut last_state_publish_ms = 0_u64;
+            let mut publisher = StatePublisher::new();
+            let mut last_diagnostics_ms = 0_u64;
             let mut wifi_disconnected_since_ms: Option<u64> = None;
             let mut last_subscribed_gen = 0_u32;
             let mut subscribe_backoff_ms = 200_u64;
             let mut last_subscribe_attempt_ms = 0_u64;
             let mut last_stale_log_ms = 0_u64;
+            let mut last_tick: Option<Instant> = None;
 
             loop {
                 feed_watchdog();
+                let tick_started = Instant::now();
+                if let Some(last) = last_tick.replace(tick_started) {
+                    METRICS.record_loop_period(tick_started - last, CONTROL_LOOP_PERIOD);
+                }
                 let now_ms = monotonic_ms();
 
                 let current_gen = mqtt_subscribe_gen.load(Ordering::Relaxed);
@@ -1521,6 +1938,7 @@ fn spawn_control_loop(
                             Ok(()) => {
                                 last_subscribed_gen = current_gen;
                                 subscribe_backoff_ms = 200;
+                                publisher.force();
                                 info!("mqtt subscribe succeeded (gen {current_gen})");
                             }
                             Err(err) => {
@@ -1578,12 +1996,18 @@ fn spawn_control_loop(
                         let (_, schedule_actions) =
                             engine.apply_schedule_action(mode, target_temp_f, now_ms);
                         drop(engine);
-                        execute_engine_actions(&state, schedule_actions);
+                        execute_engine_actions(
+                            &state,
+                            schedule_actions,
+                            TraceContext::untraced(now_ms),
+                        );
                     }
                 }
 
-                let actions = {
+                let (actions, trace) = {
+                    let lock_started = Instant::now();
                     let mut engine = state.engine.lock().unwrap();
+                    METRICS.engine_lock_wait.record(lock_started.elapsed());
                     let was_valid = engine.is_sensor_data_valid(now_ms);
                     let actions = engine.tick(now_ms);
                     let is_valid = engine.is_sensor_data_valid(now_ms);
@@ -1607,20 +2031,31 @@ fn spawn_control_loop(
                         }
                     }
 
-                    actions
+                    (actions, engine.trace_context(now_ms))
                 };
 
-                execute_engine_actions(&state, actions);
+                if !actions.is_empty() {
+                    PIPELINE_LATENCY.record_decision(&trace);
+                }
+                execute_engine_actions(&state, actions, trace);
                 flush_pending_settings_save(&nvs_store, &state, now_ms);
+                request_sensor_burst(&state);
+                if state.schedule_transfer.lock().unwrap().expire(now_ms) {
+                    warn!("abandoned schedule transfer expired");
+                }
 
-                if now_ms.saturating_sub(last_state_publish_ms) >= 10_000 {
-                    last_state_publish_ms = now_ms;
-                    if let Err(err) = publish_state(&state, &mqtt) {
-                        warn!("state publish failed: {err:#}");
+                if let Err(err) = publish_state(&state, &mut publisher, now_ms) {
+                    warn!("state publish failed: {err:#}");
+                }
+                if now_ms.saturating_sub(last_diagnostics_ms) >= DIAGNOSTICS_PUBLISH_INTERVAL_MS {
+                    last_diagnostics_ms = now_ms;
+                    if let Err(err) = publish_diagnostics(&state) {
+                        warn!("diagnostics publish failed: {err:#}");
                     }
                 }
 
-                thread::sleep(Duration::from_millis(200));
+                METRICS.tick_duration.record(tick_started.elapsed());
+                thread::sleep(CONTROL_LOOP_PERIOD);
             }
         })
         .expect("failed to spawn control loop thread");
@@ -1628,34 +2063,193 @@ fn spawn_control_loop(
 
 fn publish_state(
     state: &SharedState,
-    mqtt: &Arc<Mutex<EspMqttClient<'static>>>,
+    publisher: &mut StatePublisher,
+    now_ms: u64,
 ) -> anyhow::Result<()> {
-    let now_ms = monotonic_ms();
-
-    let state_payload = {
+    let (update, binary_enabled) = {
         let engine = state.engine.lock().unwrap();
-        serde_json::to_vec(&engine.state_payload(now_ms))?
+        let update = publisher.poll(engine.state_payload(now_ms), now_ms, &engine.config);
+        (update, engine.config.state_binary_enabled)
     };
 
-    let schedule_payload = {
-        let schedule = state.schedule.lock().unwrap().clone();
-        serde_json::to_vec(&schedule)?
-    };
+    if let Some(update) = &update {
+        // Serialize everything before enqueueing anything, so a failure
+        // leaves the publisher uncommitted and the update is retried.
+        let full = update.full.as_ref().map(serde_json::to_vec).transpose()?;
+        let delta = update.delta.as_ref().map(serde_json::to_vec).transpose()?;
+        if let Some(payload) = full {
+            enqueue_publish(
+                state,
+                TopicClass::State,
+                TOPIC_CONTROLLER_STATE,
+                true,
+                payload,
+            );
+        }
+        if let Some(payload) = delta {
+            enqueue_publish(
+                state,
+                TopicClass::StateDelta,
+                TOPIC_CONTROLLER_STATE_DELTA,
+                false,
+                payload,
+            );
+        }
+        if binary_enabled {
+            let mut body = Vec::with_capacity(32);
+            wire::encode_state(&update.snapshot, &mut body);
+            enqueue_publish(
+                state,
+                TopicClass::State,
+                TOPIC_CONTROLLER_STATE_BIN,
+                true,
+                body,
+            );
+        }
+        publisher.commit(update, now_ms);
+    }
+
+    // Serialize straight from the guarded schedule instead of cloning it, and
+    // only when an edit has bumped its version since the last publish.
+    let schedule_version = state.schedule_version.load(Ordering::Acquire);
+    if publisher.schedule_due(schedule_version) {
+        let (payload, binary) = {
+            let schedule = state.schedule.lock().unwrap();
+            let binary = binary_enabled.then(|| {
+                let mut body = Vec::new();
+                wire::encode_schedule(&schedule, &mut body);
+                body
+            });
+            (serde_json::to_vec(&*schedule)?, binary)
+        };
 
-    // Single lock scope for both publishes to avoid re-acquiring the mutex
-    // and to reduce window for disconnect between the two operations.
-    let mut client = mqtt.lock().unwrap();
-    client.publish(TOPIC_CONTROLLER_STATE, QoS::AtLeastOnce, true, &state_payload)?;
-    client.publish(
-        TOPIC_CONTROLLER_SCHEDULE_STATE,
-        QoS::AtLeastOnce,
-        true,
-        &schedule_payload,
-    )?;
+        if let Some(body) = binary {
+            enqueue_publish(
+                state,
+                TopicClass::Schedule,
+                TOPIC_CONTROLLER_SCHEDULE_STATE_BIN,
+                true,
+                body,
+            );
+        }
+        enqueue_publish(
+            state,
+            TopicClass::Schedule,
+            TOPIC_CONTROLLER_SCHEDULE_STATE,
+            true,
+            payload,
+        );
+        publisher.mark_schedule_published(schedule_version);
+    }
+
+    Ok(())
+}
 
+fn publish_diagnostics(state: &SharedState) -> anyhow::Result<()> {
+    let outbox = state.outbox.lock().unwrap().stats();
+    let payload = serde_json::to_vec(&MqttDiagnostics { outbox })?;
+    enqueue_publish(
+        state,
+        TopicClass::Diagnostics,
+        TOPIC_CONTROLLER_DIAGNOSTICS,
+        false,
+        payload,
+    );
     Ok(())
 }
 
+fn request_sensor_burst(state: &SharedState) {
+    let Some(burst) = state.engine.lock().unwrap().take_burst_request() else {
+        return;
+    };
+    // Not retained: a stale burst must not restart when the sensor
+    // reconnects. Latest request wins in the command class.
+    match serde_json::to_vec(&burst) {
+        Ok(payload) => enqueue_publish(
+            state,
+            TopicClass::Command,
+            TOPIC_CMD_SENSOR_BURST,
+            false,
+            payload,
+        ),
+        Err(err) => warn!("failed to encode sensor burst request: {err}"),
+    }
+}
+
+fn enqueue_publish(
+    state: &SharedState,
+    class: TopicClass,
+    topic: &'static str,
+    retain: bool,
+    payload: Vec<u8>,
+) {
+    let qos = if retain {
+        PublishQos::AtLeastOnce
+    } else {
+        PublishQos::AtMostOnce
+    };
+    let outcome = state
+        .outbox
+        .lock()
+        .unwrap()
+        .enqueue(OutboundMessage::new(class, topic, qos, retain, payload));
+    if outcome == EnqueueOutcome::DroppedOldest {
+        warn!("mqtt outbox full, dropped oldest {class:?} message");
+    }
+}
+
+// Sole owner of blocking publishes, so a slow or unreachable broker stalls
+// this thread instead of the control loop.
+fn spawn_mqtt_sender(state: SharedState, mqtt: Arc<ProfiledMutex<EspMqttClient<'static>>>) {
+    thread::Builder::new()
+        .name("mqtt-tx".into())
+        .stack_size(MQTT_TX_STACK_SIZE)
+        .spawn(move || {
+            let _memory = register_thread(
+                &EspMemory,
+                "mqtt-tx",
+                Subsystem::Mqtt,
+                Some(MQTT_TX_STACK_SIZE),
+            );
+            loop {
+                if !state.mqtt_connected.load(Ordering::Relaxed) {
+                    thread::sleep(Duration::from_millis(500));
+                    continue;
+                }
+
+                let next = state.outbox.lock().unwrap().pop();
+                let Some(message) = next else {
+                    thread::sleep(Duration::from_millis(50));
+                    continue;
+                };
+
+                let qos = match message.qos {
+                    PublishQos::AtMostOnce => QoS::AtMostOnce,
+                    PublishQos::AtLeastOnce => QoS::AtLeastOnce,
+                };
+                let result = mqtt.lock().unwrap().publish(
+                    &message.topic,
+                    qos,
+                    message.retain,
+                    &message.payload,
+                );
+
+                match result {
+                    Ok(_) => {
+                        let mut outbox = state.outbox.lock().unwrap();
+                        outbox.record_published(message.class);
+                    }
+                    Err(err) => {
+                        warn!("mqtt publish to {} failed: {err:?}", message.topic);
+                        state.outbox.lock().unwrap().retry(message);
+                        thread::sleep(Duration::from_millis(500));
+                    }
+                }
+            }
+        })
+        .expect("failed to spawn mqtt sender thread");
+}
+
 fn handle_mqtt_message(
     state: &SharedState,
     nvs_store: &NvsStore,
@@ -1664,25 +2258,74 @@ fn handle_mqtt_message(
 ) -> anyhow::Result<()> {
     let now_ms = monotonic_ms();
 
+    if let Some(probe_id) = sensor_probe_id(topic) {
+        if let Some(SensorSample { value: temp, trace }) = SensorSample::parse(message) {
+            if temp.is_finite() && (-40.0..=150.0).contains(&temp) {
+                let mut engine = state.engine.lock().unwrap();
+                match engine.update_source_temperature(
+                    probe_id,
+                    DeciDegrees::from_f32(temp),
+                    now_ms,
+                ) {
+                    SourceUpdate::Accepted => engine.note_sample_trace(trace, now_ms),
+                    SourceUpdate::Outlier => {
+                        info!("ignoring {temp:.1} F from sensor probe {probe_id} (outlier)")
+                    }
+                    SourceUpdate::TableFull => {
+                        warn!("ignoring sensor probe {probe_id}: every source slot is in use")
+                    }
+                }
+            }
+        }
+        return Ok(());
+    }
+
     match topic {
         TOPIC_SENSOR_TEMP => {
-            if let Ok(temp) = message.parse::<f32>() {
+            if let Some(SensorSample { value: temp, trace }) = SensorSample::parse(message) {
                 if temp.is_finite() && (-40.0..=150.0).contains(&temp) {
-                    let mut engine = state.engine.lock().unwrap();
-                    let humidity = engine.current_humidity();
-                    engine.update_sensor_data(temp, humidity, now_ms);
+                    if let Some(trace) = &trace {
+                        PIPELINE_LATENCY.record_receive(trace, wall_clock_ms());
+                    }
+                    let temp = DeciDegrees::from_f32(temp);
+                    {
+                        let mut engine = state.engine.lock().unwrap();
+                        engine.update_source_temperature(DEFAULT_SENSOR_SOURCE, temp, now_ms);
+                        engine.note_sample_trace(trace, now_ms);
+                    }
+                    state
+                        .history
+                        .lock()
+                        .unwrap()
+                        .record_live(now_ms, Some(temp), None);
                 }
             }
         }
         TOPIC_SENSOR_HUMIDITY => {
             if let Ok(humidity) = message.parse::<f32>() {
                 if humidity.is_finite() && (0.0..=100.0).contains(&humidity) {
-                    let mut engine = state.engine.lock().unwrap();
-                    let temp = engine.current_temp_f();
-                    engine.update_sensor_data(temp, humidity, now_ms);
+                    {
+                        let mut engine = state.engine.lock().unwrap();
+                        engine.update_humidity(humidity);
+                    }
+                    state
+                        .history
+                        .lock()
+                        .unwrap()
+                        .record_live(now_ms, None, Some(humidity));
                 }
             }
         }
+        TOPIC_SENSOR_HISTORY => match serde_json::from_str::<HistoryBatch>(message) {
+            Ok(batch) => {
+                let accepted = state.history.lock().unwrap().ingest_batch(&batch, now_ms);
+                info!(
+                    "ingested {accepted}/{} replayed sensor readings",
+                    batch.readings.len()
+                );
+            }
+            Err(err) => warn!("invalid sensor history payload: {err}"),
+        },
         TOPIC_CMD_POWER => {
             let actions = {
                 let mut engine = state.engine.lock().unwrap();
@@ -1694,12 +2337,12 @@ fn handle_mqtt_message(
                     Vec::new()
                 }
             };
-            execute_engine_actions(state, actions);
+            execute_engine_actions(state, actions, TraceContext::untraced(now_ms));
         }
         TOPIC_CMD_TARGET => {
             if let Ok(target) = message.parse::<f32>() {
                 let mut engine = state.engine.lock().unwrap();
-                let changed = engine.set_target_temp(target);
+                let changed = engine.set_target_temp(DeciDegrees::from_f32(target));
                 if changed {
                     queue_settings_save(state, now_ms, engine.config.settings_save_debounce_ms);
                 }
@@ -1721,11 +2364,30 @@ fn handle_mqtt_message(
                     (false, Vec::new(), debounce_ms)
                 }
             };
-            execute_engine_actions(state, actions);
+            execute_engine_actions(state, actions, TraceContext::untraced(now_ms));
             if changed {
                 queue_settings_save(state, now_ms, debounce_ms);
             }
         }
+        TOPIC_CMD_SETTINGS => match serde_json::from_str::<SettingsUpdate>(message) {
+            Ok(update) => {
+                let (result, debounce_ms) = {
+                    let mut engine = state.engine.lock().unwrap();
+                    let debounce_ms = engine.config.settings_save_debounce_ms;
+                    (engine.apply_settings(&update, now_ms), debounce_ms)
+                };
+                match result {
+                    Ok((changed, actions)) => {
+                        execute_engine_actions(state, actions, TraceContext::untraced(now_ms));
+                        if changed {
+                            queue_settings_save(state, now_ms, debounce_ms);
+                        }
+                    }
+                    Err(message) => warn!("ignoring settings command: {message}"),
+                }
+            }
+            Err(err) => warn!("invalid settings command: {err}"),
+        },
         TOPIC_CMD_HOLD => {
             let mut engine = state.engine.lock().unwrap();
             if message.eq_ignore_ascii_case("on") || message.eq_ignore_ascii_case("enter") {
@@ -1741,11 +2403,25 @@ fn handle_mqtt_message(
         TOPIC_CMD_SCHEDULE => {
             if let Ok(mut schedule) = serde_json::from_str::<Schedule>(message) {
                 schedule.normalize();
-                {
-                    let mut current = state.schedule.lock().unwrap();
-                    *current = schedule.clone();
+                commit_schedule(state, nvs_store, schedule)?;
+            }
+        }
+        TOPIC_CMD_SCHEDULE_CHUNK => {
+            let committed = state
+                .schedule_transfer
+                .lock()
+                .unwrap()
+                .accept(message.as_bytes(), now_ms);
+            match committed {
+                Ok(Some(schedule)) => {
+                    info!(
+                        "schedule transfer committed ({} entries)",
+                        schedule.entries.len()
+                    );
+                    commit_schedule(state, nvs_store, schedule)?;
                 }
-                nvs_store.save_schedule(&schedule)?;
+                Ok(None) => {}
+                Err(err) => warn!("schedule chunk rejected: {err}"),
             }
         }
         _ => {}
@@ -1754,19 +2430,48 @@ fn handle_mqtt_message(
     Ok(())
 }
 
-fn execute_engine_actions(state: &SharedState, actions: Vec<EngineAction>) {
+fn commit_schedule(
+    state: &SharedState,
+    nvs_store: &NvsStore,
+    schedule: Schedule,
+) -> anyhow::Result<()> {
+    nvs_store.save_schedule(&schedule)?;
+    {
+        let mut current = state.schedule.lock().unwrap();
+        *current = schedule;
+    }
+    state.schedule_version.fetch_add(1, Ordering::Release);
+    Ok(())
+}
+
+// The trace is recorded once per batch, at the first action that sent a frame.
+fn execute_engine_actions(state: &SharedState, actions: Vec<EngineAction>, trace: TraceContext) {
+    let _memory = SubsystemScope::enter(&EspMemory, Subsystem::Ir);
+    let mut recorded = false;
     for action in actions {
         if let EngineAction::Delay(ms) = action {
             thread::sleep(Duration::from_millis(ms));
             continue;
         }
 
+        let lock_started = Instant::now();
         let mut transmitter = state.ir_sender.lock().unwrap();
+        METRICS.ir_lock_wait.record(lock_started.elapsed());
         let description = format!("{action:?}");
-        if let Err(err) = transmitter.execute_action(action) {
-            warn!("engine action failed [{description}]: {err:#}");
-        } else {
-            info!("engine action sent [{description}]");
+        match transmitter.execute_action(action) {
+            Ok(sent) => {
+                info!("engine action sent [{description}] (seq {:?})", trace.seq);
+                if let Some(sent) = sent.filter(|_| !recorded) {
+                    recorded = true;
+                    PIPELINE_LATENCY.record_ir(
+                        &trace,
+                        sent.started_ms,
+                        sent.finished_ms,
+                        wall_clock_ms(),
+                    );
+                }
+            }
+            Err(err) => warn!("engine action failed [{description}]: {err:#}"),
         }
     }
 }
@@ -1836,7 +2541,7 @@ fn flush_pending_settings_save(nvs_store: &NvsStore, state: &SharedState, now_ms
     }
 }
 
-fn validate_network_update(update: &NetworkConfigUpdate) -> Result<(), &'static str> {
+fn validate_network_update(update: &NetworkConfigUpdate<'_>) -> Result<(), &'static str> {
     if update.wifi_ssid.trim().is_empty() {
         return Err("wifiSsid cannot be empty");
     }
@@ -1857,23 +2562,23 @@ fn validate_network_update(update: &NetworkConfigUpdate) -> Result<(), &'static
 
 fn apply_network_update(
     nvs_store: &NvsStore,
-    update: NetworkConfigUpdate,
+    update: NetworkConfigUpdate<'_>,
 ) -> anyhow::Result<NetworkUpdateResponse> {
     let mut runtime = nvs_store.load_runtime_config().unwrap_or_default();
     let previous = runtime.network.clone();
 
-    runtime.network.wifi_ssid = update.wifi_ssid;
+    runtime.network.wifi_ssid = update.wifi_ssid.into_owned();
     if let Some(pass) = update.wifi_pass {
-        runtime.network.wifi_pass = pass;
+        runtime.network.wifi_pass = pass.into_owned();
     }
-    runtime.network.mqtt_host = update.mqtt_host;
+    runtime.network.mqtt_host = update.mqtt_host.into_owned();
     runtime.network.mqtt_port = update.mqtt_port;
-    runtime.network.mqtt_user = update.mqtt_user;
+    runtime.network.mqtt_user = update.mqtt_user.into_owned();
     if let Some(pass) = update.mqtt_pass {
-        runtime.network.mqtt_pass = pass;
+        runtime.network.mqtt_pass = pass.into_owned();
     }
     if let Some(pass) = update.ota_password {
-        runtime.network.ota_password = pass;
+        runtime.network.ota_password = pass.into_owned();
     }
     runtime.network.use_static_ip = update.use_static_ip;
     runtime.network.static_ip = update.static_ip;
@@ -1973,8 +2678,14 @@ fn apply_ota_update(
     let ota_state = state.ota.clone();
     let spawn_result = thread::Builder::new()
         .name("ota-apply".into())
-        .stack_size(16 * 1024)
+        .stack_size(OTA_STACK_SIZE)
         .spawn(move || {
+            let _memory = register_thread(
+                &EspMemory,
+                "ota-apply",
+                Subsystem::Ota,
+                Some(OTA_STACK_SIZE),
+            );
             let reboot_after_apply = update.reboot.unwrap_or(true);
             let expected_sha = update
                 .sha256
@@ -2026,7 +2737,7 @@ fn apply_ota_update(
 }
 
 fn download_and_apply_ota(
-    ota_state: &Arc<Mutex<OtaRuntimeState>>,
+    ota_state: &Arc<ProfiledMutex<OtaRuntimeState>>,
     url: &str,
     expected_sha256: Option<&str>,
 ) -> anyhow::Result<(u64, String)> {
@@ -2211,18 +2922,27 @@ impl NvsStore {
     }
 
     fn save_runtime_config(&self, runtime: &RuntimeConfig) -> anyhow::Result<()> {
+        let _memory = SubsystemScope::enter(&EspMemory, Subsystem::Storage);
         let _guard = self.lock.lock().unwrap();
         let mut nvs = EspNvs::new(self.partition.clone(), NVS_NAMESPACE, true)?;
         let payload = serde_json::to_string(runtime)?;
-        nvs.set_str(NVS_RUNTIME_KEY, &payload)?;
+        let started = Instant::now();
+        let result = nvs.set_str(NVS_RUNTIME_KEY, &payload);
+        METRICS.record_storage_write(started.elapsed(), &result);
+        result?;
         Ok(())
     }
 
     fn load_schedule(&self) -> anyhow::Result<Schedule> {
         let _guard = self.lock.lock().unwrap();
         let nvs = EspNvs::new(self.partition.clone(), NVS_NAMESPACE, true)?;
-        let mut buffer = vec![0_u8; 4096];
+        let mut buffer = vec![0_u8; NVS_SCHEDULE_BLOB_MAX];
+
+        if let Some(value) = nvs.get_blob(NVS_SCHEDULE_BIN_KEY, &mut buffer)? {
+            return Ok(wire::decode_schedule(value)?);
+        }
 
+        // Schedules written before the binary blob still live under the JSON key.
         match nvs.get_str(NVS_SCHEDULE_KEY, &mut buffer)? {
             Some(value) => Ok(serde_json::from_str::<Schedule>(value)?),
             None => Ok(Schedule::default()),
@@ -2230,10 +2950,16 @@ impl NvsStore {
     }
 
     fn save_schedule(&self, schedule: &Schedule) -> anyhow::Result<()> {
+        let _memory = SubsystemScope::enter(&EspMemory, Subsystem::Storage);
         let _guard = self.lock.lock().unwrap();
         let mut nvs = EspNvs::new(self.partition.clone(), NVS_NAMESPACE, true)?;
-        let payload = serde_json::to_string(schedule)?;
-        nvs.set_str(NVS_SCHEDULE_KEY, &payload)?;
+        let mut payload = Vec::with_capacity(NVS_SCHEDULE_BLOB_MAX);
+        wire::encode_schedule(schedule, &mut payload);
+        let started = Instant::now();
+        let result = nvs.set_blob(NVS_SCHEDULE_BIN_KEY, &payload);
+        METRICS.record_storage_write(started.elapsed(), &result);
+        result?;
+        nvs.remove(NVS_SCHEDULE_KEY)?;
         Ok(())
     }
 }
@@ -2342,7 +3068,7 @@ fn now_in_timezone(timezone: &str) -> Option<chrono::DateTime<chrono::FixedOffse
     Some(local.with_timezone(&local.offset().fix()))
 }
 
-fn monotonic_ms() -> u64 {
+pub(crate) fn monotonic_ms() -> u64 {
     static START: OnceLock<Instant> = OnceLock::new();
     START
         .get_or_init(Instant::now)
@@ -2351,4 +3077,3 @@ fn monotonic_ms() -> u64 {
         .try_into()
         .unwrap_or(u64::MAX)
 }
-
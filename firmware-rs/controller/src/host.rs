@@ -1,8 +1,10 @@
 use std::{
+    borrow::Cow,
     collections::HashMap,
     io::ErrorKind,
     net::SocketAddr,
     path::PathBuf,
+    pin::Pin,
     sync::{
         atomic::{AtomicBool, Ordering},
         Arc, OnceLock,
@@ -12,34 +14,125 @@ use std::{
 
 use anyhow::Context;
 use axum::{
-    extract::{Query, State},
-    http::StatusCode,
+    body::{Body, HttpBody},
+    extract::{MatchedPath, Path, Query, Request, State},
+    http::{header, StatusCode},
+    middleware::{self, Next},
     response::IntoResponse,
-    routing::{get, post, put},
+    routing::{delete, get, patch, post, put},
     Json, Router,
 };
 use chrono::{Offset, Utc};
 use chrono_tz::Tz;
 use rumqttc::{AsyncClient, Event, Incoming, MqttOptions, QoS};
 use serde::{Deserialize, Serialize};
-use tokio::{net::TcpListener, sync::Mutex};
+use tokio::{
+    net::TcpListener,
+    sync::{mpsc, oneshot, Mutex, MutexGuard, Notify},
+};
 use tower_http::services::ServeDir;
 use tracing::{info, warn};
 
+#[cfg(feature = "lock-profiling")]
+use thermostat_common::lock_profile::{LockProfile, ProfiledGuard};
 use thermostat_common::{
     config::{IrHardwareConfig, NetworkConfig},
-    DayOfWeek, EngineAction, RuntimeConfig, Schedule, ScheduleAction, ScheduleEntry,
-    ThermostatEngine, ThermostatMode, TOPIC_CMD_HOLD, TOPIC_CMD_MODE, TOPIC_CMD_POWER,
-    TOPIC_CMD_SCHEDULE, TOPIC_CMD_TARGET, TOPIC_CONTROLLER_SCHEDULE_STATE, TOPIC_CONTROLLER_STATE,
-    TOPIC_SENSOR_HUMIDITY, TOPIC_SENSOR_TEMP,
+    contention_report, in_subsystem, memory_report, metrics, route_zone_topic, schedule_transfer,
+    sensor_probe_id,
+    trace::wall_clock_ms,
+    wire, zone_scoped_topic, zone_topic, ControllerMetrics, ControllerStatePayload, DayOfWeek,
+    DeciDegrees, EngineAction, EnqueueOutcome, HeapStats, HistoryBatch, HistoryPoint, HistoryStats,
+    HistoryStore, MemoryPlatform, OutboundMessage, Outbox, OutboxStats, ProfiledMutex, PublishQos,
+    RuntimeConfig, Schedule, ScheduleAssembler, ScheduleEntry, ScheduleParser, SensorSample,
+    SettingsUpdate, SourceStatus, SourceUpdate, StageLatencies, Subsystem, ThermostatEngine,
+    ThermostatMode, TopicClass, TraceContext, Zone, ZoneConfig, ZoneError, ZoneRegistry,
+    DEFAULT_SENSOR_SOURCE, DEFAULT_ZONE_ID, TOPIC_CMD_HOLD, TOPIC_CMD_MODE, TOPIC_CMD_POWER,
+    TOPIC_CMD_SCHEDULE, TOPIC_CMD_SCHEDULE_CHUNK, TOPIC_CMD_SENSOR_BURST, TOPIC_CMD_SETTINGS,
+    TOPIC_CMD_TARGET, TOPIC_CONTROLLER_DIAGNOSTICS, TOPIC_CONTROLLER_SCHEDULE_STATE,
+    TOPIC_CONTROLLER_SCHEDULE_STATE_BIN, TOPIC_CONTROLLER_STATE, TOPIC_CONTROLLER_STATE_BIN,
+    TOPIC_CONTROLLER_STATE_DELTA, TOPIC_SENSOR_HISTORY, TOPIC_SENSOR_HUMIDITY,
+    TOPIC_SENSOR_PROBE_TEMP_FILTER, TOPIC_SENSOR_TEMP,
 };
 
+// Allocation accounting hooks for the counting allocator installed by the
+// controller binary. tokio tasks move between workers, so the spawned loops
+// and HTTP handlers are charged through `in_subsystem` rather than by thread.
+pub struct HostMemory;
+
+impl MemoryPlatform for HostMemory {
+    fn thread_key(&self) -> usize {
+        thread_local! {
+            static ANCHOR: u8 = const { 0 };
+        }
+        ANCHOR.with(|anchor| anchor as *const u8 as usize)
+    }
+
+    fn heap(&self) -> HeapStats {
+        HeapStats {
+            resident_bytes: resident_memory_bytes(),
+            ..HeapStats::default()
+        }
+    }
+}
+
+// tokio counterpart of `ProfiledMutex`: with `lock-profiling` every
+// acquisition is recorded under the lock's name, otherwise `lock` is the
+// plain tokio call.
+struct ProfiledAsyncMutex<T> {
+    inner: Mutex<T>,
+    #[cfg(feature = "lock-profiling")]
+    profile: &'static LockProfile,
+}
+
+impl<T> ProfiledAsyncMutex<T> {
+    fn new(name: &'static str, value: T) -> Self {
+        #[cfg(not(feature = "lock-profiling"))]
+        let _ = name;
+        Self {
+            inner: Mutex::new(value),
+            #[cfg(feature = "lock-profiling")]
+            profile: LockProfile::named(name),
+        }
+    }
+
+    #[cfg(not(feature = "lock-profiling"))]
+    async fn lock(&self) -> MutexGuard<'_, T> {
+        self.inner.lock().await
+    }
+
+    // Not an async fn, so the caller's location is taken before the future
+    // is polled.
+    #[cfg(feature = "lock-profiling")]
+    #[track_caller]
+    fn lock(&self) -> impl std::future::Future<Output = ProfiledGuard<MutexGuard<'_, T>>> + '_ {
+        let site = std::panic::Location::caller();
+        async move {
+            let started = Instant::now();
+            let (guard, contended) = match self.inner.try_lock() {
+                Ok(guard) => (guard, false),
+                Err(_) => (self.inner.lock().await, true),
+            };
+            ProfiledGuard::new(guard, self.profile.acquired(site, started, contended))
+        }
+    }
+}
+
 #[derive(Clone)]
 struct AppState {
-    engine: Arc<Mutex<ThermostatEngine>>,
-    schedule: Arc<Mutex<Schedule>>,
-    timezone: Arc<Mutex<String>>,
+    schedule_transfer: Arc<ProfiledAsyncMutex<ScheduleAssembler>>,
+    outbox: Arc<ProfiledMutex<Outbox>>,
+    outbox_ready: Arc<Notify>,
+    // Set on every MQTT session; the state publisher republishes retained
+    // state and schedules, which a restarted broker may have lost.
+    mqtt_session_started: Arc<AtomicBool>,
+    history: Arc<ProfiledAsyncMutex<HistoryStore>>,
+    // Every engine, including the default zone the single-zone topics and
+    // routes drive.
+    zones: Arc<ProfiledAsyncMutex<ZoneRegistry>>,
+    timezone: Arc<ProfiledAsyncMutex<String>>,
     time_synced: Arc<AtomicBool>,
+    // Indexed by IR channel; see `spawn_ir_workers`.
+    ir_queues: Arc<Vec<mpsc::UnboundedSender<IrBatch>>>,
     mqtt: AsyncClient,
     store: AppStore,
 }
@@ -48,7 +141,8 @@ struct AppState {
 struct AppStore {
     runtime_path: Arc<PathBuf>,
     schedule_path: Arc<PathBuf>,
-    lock: Arc<Mutex<()>>,
+    zones_path: Arc<PathBuf>,
+    lock: Arc<ProfiledAsyncMutex<()>>,
 }
 
 #[derive(Debug, Serialize)]
@@ -128,6 +222,52 @@ struct NetworkUpdateResponse {
 }
 
 const MAX_MQTT_PAYLOAD_BYTES: usize = 512;
+const DIAGNOSTICS_PUBLISH_INTERVAL_MS: u64 = 60_000;
+
+const CONTROL_LOOP_PERIOD: Duration = Duration::from_secs(1);
+
+// Sensor-to-IR stage latencies, shared by the MQTT, control and action paths.
+static PIPELINE_LATENCY: StageLatencies = StageLatencies::new();
+static METRICS: ControllerMetrics = ControllerMetrics::new();
+
+#[derive(Debug, Serialize)]
+struct MqttDiagnostics {
+    outbox: OutboxStats,
+}
+
+#[derive(Debug, Serialize)]
+struct SensorSourcesView {
+    #[serde(rename = "fusedTempF")]
+    fused_temp_f: DeciDegrees,
+    valid: bool,
+    sources: Vec<SourceStatus>,
+}
+
+#[derive(Debug, Serialize)]
+struct ZoneView {
+    id: String,
+    name: String,
+    #[serde(rename = "irChannel")]
+    ir_channel: u8,
+    state: ControllerStatePayload,
+}
+
+#[derive(Debug, Deserialize)]
+struct ZoneCreateRequest {
+    id: String,
+    #[serde(default)]
+    name: String,
+    #[serde(rename = "irChannel", default)]
+    ir_channel: u8,
+}
+
+#[derive(Debug, Serialize)]
+struct HistoryView {
+    #[serde(rename = "nowMs")]
+    now_ms: u64,
+    stats: HistoryStats,
+    points: Vec<HistoryPoint>,
+}
 
 #[derive(Debug, Serialize)]
 struct IrConfigView {
@@ -190,9 +330,10 @@ struct OtaStatusResponse {
 }
 
 pub async fn run() -> anyhow::Result<()> {
-    tracing_subscriber::fmt()
+    // try_init: the end-to-end tests run controller and sensor in one process.
+    let _ = tracing_subscriber::fmt()
         .with_env_filter(tracing_subscriber::EnvFilter::from_default_env())
-        .init();
+        .try_init();
 
     let store = AppStore::new();
     let mut runtime = store.load_runtime_config().await.unwrap_or_else(|err| {
@@ -207,17 +348,60 @@ pub async fn run() -> anyhow::Result<()> {
     });
     schedule.normalize();
 
-    let engine = ThermostatEngine::new(runtime.thermostat.clone(), runtime.settings.clone());
+    let mut zones = ZoneRegistry::with_default_zone(
+        runtime.thermostat.clone(),
+        runtime.settings.clone(),
+        schedule,
+    );
+    let zone_configs = store.load_zones().await.unwrap_or_else(|err| {
+        warn!("failed to load zones from store: {err:#}");
+        Vec::new()
+    });
+    for config in zone_configs {
+        let id = config.id.clone();
+        if let Err(err) = zones.add(config) {
+            warn!("skipping stored zone '{id}': {err}");
+        }
+    }
 
     let mqtt_host = std::env::var("MQTT_HOST").unwrap_or(runtime.network.mqtt_host.clone());
     let mqtt_port = std::env::var("MQTT_PORT")
         .ok()
         .and_then(|value| value.parse::<u16>().ok())
         .unwrap_or(runtime.network.mqtt_port);
-
-    let mut mqtt_options = MqttOptions::new("thermostat-controller-rust", mqtt_host, mqtt_port);
     let mqtt_user = std::env::var("MQTT_USER").unwrap_or(runtime.network.mqtt_user.clone());
     let mqtt_pass = std::env::var("MQTT_PASS").unwrap_or(runtime.network.mqtt_pass.clone());
+
+    let embedded_broker = std::env::var("MQTT_EMBEDDED_BROKER")
+        .is_ok_and(|value| value == "1" || value.eq_ignore_ascii_case("true"));
+    #[cfg(feature = "embedded-broker")]
+    let (mqtt_host, _broker) = if embedded_broker {
+        // Loopback unless MQTT_EMBEDDED_BROKER_BIND names another address
+        // (0.0.0.0 for every interface). The controller's own MQTT
+        // credentials, when set, are required of every client.
+        let bind = std::env::var("MQTT_EMBEDDED_BROKER_BIND")
+            .ok()
+            .and_then(|value| value.parse::<std::net::IpAddr>().ok())
+            .unwrap_or(std::net::Ipv4Addr::LOCALHOST.into());
+        let credentials = (!mqtt_user.is_empty()).then(|| (mqtt_user.clone(), mqtt_pass.clone()));
+        if !bind.is_loopback() && credentials.is_none() {
+            warn!("embedded mqtt broker on {bind} accepts any client; set MQTT_USER and MQTT_PASS");
+        }
+        let listen = SocketAddr::from((bind, mqtt_port));
+        let broker = thermostat_broker::EmbeddedBroker::start(listen, credentials)
+            .context("failed to start embedded mqtt broker")?;
+        (broker.addr().ip().to_string(), Some(broker))
+    } else {
+        (mqtt_host, None)
+    };
+    #[cfg(not(feature = "embedded-broker"))]
+    if embedded_broker {
+        warn!(
+            "MQTT_EMBEDDED_BROKER needs the embedded-broker feature; using {mqtt_host}:{mqtt_port}"
+        );
+    }
+
+    let mut mqtt_options = MqttOptions::new("thermostat-controller-rust", mqtt_host, mqtt_port);
     if !mqtt_user.is_empty() {
         mqtt_options.set_credentials(mqtt_user, mqtt_pass);
     }
@@ -225,18 +409,26 @@ pub async fn run() -> anyhow::Result<()> {
     let (mqtt, eventloop) = AsyncClient::new(mqtt_options, 64);
 
     let app_state = AppState {
-        engine: Arc::new(Mutex::new(engine)),
-        schedule: Arc::new(Mutex::new(schedule)),
-        timezone: Arc::new(Mutex::new(runtime.timezone)),
+        schedule_transfer: Arc::new(ProfiledAsyncMutex::new(
+            "schedule_transfer",
+            ScheduleAssembler::new(),
+        )),
+        outbox: Arc::new(ProfiledMutex::new("outbox", Outbox::default())),
+        outbox_ready: Arc::new(Notify::new()),
+        mqtt_session_started: Arc::new(AtomicBool::new(false)),
+        history: Arc::new(ProfiledAsyncMutex::new("history", HistoryStore::default())),
+        zones: Arc::new(ProfiledAsyncMutex::new("zones", zones)),
+        timezone: Arc::new(ProfiledAsyncMutex::new("timezone", runtime.timezone)),
         time_synced: Arc::new(AtomicBool::new(false)),
+        ir_queues: Arc::new(spawn_ir_workers()),
         mqtt,
         store,
     };
 
-    subscribe_topics(&app_state.mqtt).await?;
     spawn_mqtt_loop(app_state.clone(), eventloop);
     spawn_control_loop(app_state.clone());
     spawn_state_publish_loop(app_state.clone());
+    spawn_mqtt_publish_loop(app_state.clone());
 
     let web_root = format!("{}/web", env!("CARGO_MANIFEST_DIR"));
     let app = Router::new()
@@ -245,6 +437,7 @@ pub async fn run() -> anyhow::Result<()> {
         .route("/api/mode", post(handle_set_mode))
         .route("/api/hysteresis", post(handle_set_hysteresis))
         .route("/api/offset", post(handle_set_offset))
+        .route("/api/settings", patch(handle_patch_settings))
         .route("/api/ir/on", post(handle_ir_on))
         .route("/api/ir/off", post(handle_ir_off))
         .route("/api/ir/heat/on", post(handle_ir_heat_on))
@@ -258,6 +451,23 @@ pub async fn run() -> anyhow::Result<()> {
             get(handle_get_ir_config).put(handle_put_ir_config),
         )
         .route("/api/ir/diagnostics", get(handle_get_ir_diagnostics))
+        .route("/api/mqtt/diagnostics", get(handle_get_mqtt_diagnostics))
+        .route("/api/trace/latency", get(handle_get_trace_latency))
+        .route("/metrics", get(handle_get_metrics))
+        .route("/api/diagnostics/locks", get(handle_get_lock_contention))
+        .route("/api/diagnostics/memory", get(handle_get_memory))
+        .route("/api/history", get(handle_get_history))
+        .route("/api/sensors", get(handle_get_sensors))
+        .route("/api/zones", get(handle_get_zones).post(handle_post_zone))
+        .route("/api/zones/{id}", delete(handle_delete_zone))
+        .route("/api/zones/{id}/status", get(handle_get_zone_status))
+        .route("/api/zones/{id}/target", post(handle_set_zone_target))
+        .route("/api/zones/{id}/mode", post(handle_set_zone_mode))
+        .route("/api/zones/{id}/sensors", get(handle_get_zone_sensors))
+        .route(
+            "/api/zones/{id}/schedule",
+            get(handle_get_zone_schedule).put(handle_put_zone_schedule),
+        )
         .route("/api/hold/enter", post(handle_hold_enter))
         .route("/api/hold/exit", post(handle_hold_exit))
         .route("/api/safety/reset", post(handle_safety_reset))
@@ -265,6 +475,10 @@ pub async fn run() -> anyhow::Result<()> {
             "/api/schedule",
             get(handle_get_schedule).put(handle_put_schedule),
         )
+        .route(
+            "/api/schedule/compact",
+            get(handle_get_schedule_compact).put(handle_put_schedule_compact),
+        )
         .route("/api/time", get(handle_get_time))
         .route("/api/timezone", put(handle_put_timezone))
         .route(
@@ -273,6 +487,7 @@ pub async fn run() -> anyhow::Result<()> {
         )
         .route("/api/ota/status", get(handle_get_ota_status))
         .route("/api/ota/apply", post(handle_post_ota_apply))
+        .route_layer(middleware::from_fn(track_http_latency))
         .fallback_service(ServeDir::new(web_root))
         .with_state(app_state);
 
@@ -293,34 +508,68 @@ pub async fn run() -> anyhow::Result<()> {
 async fn subscribe_topics(mqtt: &AsyncClient) -> anyhow::Result<()> {
     let topics = [
         TOPIC_SENSOR_TEMP,
+        TOPIC_SENSOR_PROBE_TEMP_FILTER,
         TOPIC_SENSOR_HUMIDITY,
+        TOPIC_SENSOR_HISTORY,
         TOPIC_CMD_POWER,
         TOPIC_CMD_TARGET,
         TOPIC_CMD_MODE,
         TOPIC_CMD_HOLD,
+        TOPIC_CMD_SETTINGS,
         TOPIC_CMD_SCHEDULE,
+        TOPIC_CMD_SCHEDULE_CHUNK,
     ];
 
     for topic in topics {
         mqtt.subscribe(topic, QoS::AtMostOnce).await?;
     }
+
+    let zone_topics = [
+        TOPIC_SENSOR_TEMP,
+        TOPIC_SENSOR_PROBE_TEMP_FILTER,
+        TOPIC_SENSOR_HUMIDITY,
+        TOPIC_CMD_POWER,
+        TOPIC_CMD_TARGET,
+        TOPIC_CMD_MODE,
+        TOPIC_CMD_HOLD,
+        TOPIC_CMD_SETTINGS,
+        TOPIC_CMD_SCHEDULE,
+    ];
+    for topic in zone_topics {
+        mqtt.subscribe(zone_topic("+", topic), QoS::AtMostOnce)
+            .await?;
+    }
     Ok(())
 }
 
 fn spawn_mqtt_loop(app_state: AppState, mut eventloop: rumqttc::EventLoop) {
-    tokio::spawn(async move {
+    tokio::spawn(in_subsystem(&HostMemory, Subsystem::Mqtt, async move {
         loop {
             match eventloop.poll().await {
                 Ok(Event::Incoming(Incoming::Publish(message))) => {
+                    METRICS.mqtt_received.inc();
                     if let Err(err) =
                         handle_mqtt_message(&app_state, message.topic, message.payload.to_vec())
                             .await
                     {
+                        METRICS.mqtt_errors.inc();
                         warn!("mqtt message handling error: {err:#}");
                     }
                 }
                 Ok(Event::Incoming(Incoming::ConnAck(_))) => {
                     info!("mqtt connected");
+                    // Clean sessions drop subscriptions. Subscribing from its
+                    // own task keeps a full request queue from stalling the
+                    // event loop that drains it.
+                    let mqtt = app_state.mqtt.clone();
+                    tokio::spawn(in_subsystem(&HostMemory, Subsystem::Mqtt, async move {
+                        if let Err(err) = subscribe_topics(&mqtt).await {
+                            warn!("mqtt subscribe failed: {err:#}");
+                        }
+                    }));
+                    app_state
+                        .mqtt_session_started
+                        .store(true, Ordering::Release);
                 }
                 Ok(_) => {}
                 Err(err) => {
@@ -329,15 +578,20 @@ fn spawn_mqtt_loop(app_state: AppState, mut eventloop: rumqttc::EventLoop) {
                 }
             }
         }
-    });
+    }));
 }
 
 fn spawn_control_loop(app_state: AppState) {
-    tokio::spawn(async move {
-        let mut interval = tokio::time::interval(Duration::from_secs(1));
+    tokio::spawn(in_subsystem(&HostMemory, Subsystem::Control, async move {
+        let mut interval = tokio::time::interval(CONTROL_LOOP_PERIOD);
+        let mut last_tick: Option<Instant> = None;
 
         loop {
             interval.tick().await;
+            let tick_started = Instant::now();
+            if let Some(last) = last_tick.replace(tick_started) {
+                METRICS.record_loop_period(tick_started - last, CONTROL_LOOP_PERIOD);
+            }
             let now_ms = monotonic_ms();
 
             let timezone = { app_state.timezone.lock().await.clone() };
@@ -345,95 +599,230 @@ fn spawn_control_loop(app_state: AppState) {
             app_state
                 .time_synced
                 .store(now_in_tz.is_some(), Ordering::Relaxed);
-
-            if let Some(now) = now_in_tz {
-                let schedule_action = {
-                    let schedule = app_state.schedule.lock().await;
-                    schedule.current_action(now)
-                };
-
-                if let Some(ScheduleAction {
-                    mode,
-                    target_temp_f,
-                }) = schedule_action
-                {
-                    let schedule_actions = {
-                        let mut engine = app_state.engine.lock().await;
-                        let (_, schedule_actions) =
-                            engine.apply_schedule_action(mode, target_temp_f, now_ms);
-                        schedule_actions
-                    };
-
-                    if !schedule_actions.is_empty() {
-                        execute_engine_actions(schedule_actions).await;
-                    }
-                }
+            if app_state.schedule_transfer.lock().await.expire(now_ms) {
+                warn!("abandoned schedule transfer expired");
             }
 
-            let actions = {
-                let mut engine = app_state.engine.lock().await;
-                engine.tick(now_ms)
+            // Every zone shares this tick; IR sequences are queued on their
+            // channel's worker so delays in one do not hold up the others.
+            let zone_ticks = {
+                let lock_started = Instant::now();
+                let mut zones = app_state.zones.lock().await;
+                METRICS.engine_lock_wait.record(lock_started.elapsed());
+                zones.tick_all(now_ms, now_in_tz)
             };
-
-            if !actions.is_empty() {
-                execute_engine_actions(actions).await;
+            for tick in zone_ticks {
+                if let Some(burst) = tick.burst {
+                    // Not retained: a stale burst must not restart when the
+                    // sensor reconnects. Latest request wins in the command
+                    // class.
+                    match serde_json::to_vec(&burst) {
+                        Ok(payload) => enqueue_publish(
+                            &app_state,
+                            TopicClass::Command,
+                            zone_scoped_topic(&tick.zone_id, TOPIC_CMD_SENSOR_BURST),
+                            false,
+                            payload,
+                        ),
+                        Err(err) => warn!("failed to encode sensor burst request: {err}"),
+                    }
+                }
+                if !tick.actions.is_empty() {
+                    PIPELINE_LATENCY.record_decision(&tick.trace);
+                    // Not awaited: the worker reports when it is done.
+                    drop(queue_zone_actions(
+                        &app_state,
+                        tick.zone_id,
+                        tick.ir_channel,
+                        tick.actions,
+                        tick.trace,
+                    ));
+                }
             }
+            METRICS.tick_duration.record(tick_started.elapsed());
         }
-    });
+    }));
 }
 
 fn spawn_state_publish_loop(app_state: AppState) {
-    tokio::spawn(async move {
-        let mut interval = tokio::time::interval(Duration::from_secs(10));
+    tokio::spawn(in_subsystem(&HostMemory, Subsystem::Mqtt, async move {
+        let mut interval = tokio::time::interval(Duration::from_millis(250));
+        let mut last_diagnostics_ms = 0_u64;
         loop {
             interval.tick().await;
 
-            let now_ms = monotonic_ms();
-            let payload = {
-                let engine = app_state.engine.lock().await;
-                serde_json::to_vec(&engine.state_payload(now_ms))
-            };
+            if app_state.mqtt_session_started.swap(false, Ordering::AcqRel) {
+                for zone in app_state.zones.lock().await.iter_mut() {
+                    zone.publisher.force();
+                }
+            }
 
-            match payload {
-                Ok(body) => {
-                    if let Err(err) = app_state
-                        .mqtt
-                        .publish(TOPIC_CONTROLLER_STATE, QoS::AtLeastOnce, true, body)
-                        .await
-                    {
-                        warn!("controller state publish failed: {err}");
-                    }
+            let now_ms = monotonic_ms();
+            if now_ms.saturating_sub(last_diagnostics_ms) >= DIAGNOSTICS_PUBLISH_INTERVAL_MS {
+                last_diagnostics_ms = now_ms;
+                let stats = app_state.outbox.lock().unwrap().stats();
+                match serde_json::to_vec(&MqttDiagnostics { outbox: stats }) {
+                    Ok(body) => enqueue_publish(
+                        &app_state,
+                        TopicClass::Diagnostics,
+                        TOPIC_CONTROLLER_DIAGNOSTICS,
+                        false,
+                        body,
+                    ),
+                    Err(err) => warn!("diagnostics serialization failed: {err}"),
                 }
-                Err(err) => warn!("controller state serialization failed: {err}"),
             }
 
-            let schedule_payload = {
-                let schedule = app_state.schedule.lock().await;
-                serde_json::to_vec(&*schedule)
+            publish_zone_states(&app_state, now_ms).await;
+        }
+    }));
+}
+
+// Producers never await the broker; they drop snapshots into the bounded
+// outbox and this task is the only one that waits on the MQTT client.
+fn spawn_mqtt_publish_loop(app_state: AppState) {
+    tokio::spawn(in_subsystem(&HostMemory, Subsystem::Mqtt, async move {
+        loop {
+            let next = app_state.outbox.lock().unwrap().pop();
+            let Some(message) = next else {
+                app_state.outbox_ready.notified().await;
+                continue;
             };
 
-            match schedule_payload {
-                Ok(body) => {
-                    if let Err(err) = app_state
-                        .mqtt
-                        .publish(
-                            TOPIC_CONTROLLER_SCHEDULE_STATE,
-                            QoS::AtLeastOnce,
-                            true,
-                            body,
-                        )
-                        .await
-                    {
-                        warn!("schedule state publish failed: {err}");
-                    }
+            let qos = match message.qos {
+                PublishQos::AtMostOnce => QoS::AtMostOnce,
+                PublishQos::AtLeastOnce => QoS::AtLeastOnce,
+            };
+            let result = app_state
+                .mqtt
+                .publish(
+                    message.topic.as_ref(),
+                    qos,
+                    message.retain,
+                    message.payload.clone(),
+                )
+                .await;
+
+            match result {
+                Ok(()) => {
+                    let mut outbox = app_state.outbox.lock().unwrap();
+                    outbox.record_published(message.class);
+                }
+                Err(err) => {
+                    warn!("mqtt publish to {} failed: {err}", message.topic);
+                    app_state.outbox.lock().unwrap().retry(message);
+                    tokio::time::sleep(Duration::from_secs(1)).await;
                 }
-                Err(err) => warn!("schedule serialization failed: {err}"),
             }
         }
-    });
+    }));
+}
+
+fn enqueue_publish(
+    app_state: &AppState,
+    class: TopicClass,
+    topic: impl Into<Cow<'static, str>>,
+    retain: bool,
+    payload: Vec<u8>,
+) {
+    let qos = if retain {
+        PublishQos::AtLeastOnce
+    } else {
+        PublishQos::AtMostOnce
+    };
+    let outcome = app_state
+        .outbox
+        .lock()
+        .unwrap()
+        .enqueue(OutboundMessage::new(class, topic, qos, retain, payload));
+    if outcome == EnqueueOutcome::DroppedOldest {
+        warn!("mqtt outbox full, dropped oldest {class:?} message");
+    }
+    app_state.outbox_ready.notify_one();
 }
 
-async fn execute_engine_actions(actions: Vec<EngineAction>) {
+const IR_CHANNEL_COUNT: u8 = 8;
+
+struct IrBatch {
+    zone_id: String,
+    actions: Vec<EngineAction>,
+    trace: TraceContext,
+    sent: oneshot::Sender<()>,
+}
+
+// One worker per IR channel sends batches in the order they were queued. A
+// PowerOn batch spans about 1.5 s of delays, so a later PowerOff sent
+// alongside it would interleave and could leave the fireplace on while the
+// engine believes it is off.
+fn spawn_ir_workers() -> Vec<mpsc::UnboundedSender<IrBatch>> {
+    (0..IR_CHANNEL_COUNT)
+        .map(|ir_channel| {
+            let (queue, batches) = mpsc::unbounded_channel();
+            tokio::spawn(in_subsystem(
+                &HostMemory,
+                Subsystem::Ir,
+                run_ir_channel(ir_channel, batches),
+            ));
+            queue
+        })
+        .collect()
+}
+
+async fn run_ir_channel(ir_channel: u8, mut batches: mpsc::UnboundedReceiver<IrBatch>) {
+    while let Some(batch) = batches.recv().await {
+        send_zone_actions(&batch.zone_id, ir_channel, batch.actions, &batch.trace).await;
+        // Nobody is waiting for batches queued by the control loop.
+        let _ = batch.sent.send(());
+    }
+}
+
+// Queues the batch behind any other on the same IR channel. The receiver
+// resolves once it has been sent, or errors if it was dropped.
+fn queue_zone_actions(
+    app_state: &AppState,
+    zone_id: String,
+    ir_channel: u8,
+    actions: Vec<EngineAction>,
+    trace: TraceContext,
+) -> oneshot::Receiver<()> {
+    let (sent, done) = oneshot::channel();
+    let Some(queue) = app_state.ir_queues.get(usize::from(ir_channel)) else {
+        warn!("zone {zone_id} uses unsupported IR channel {ir_channel}; dropping {actions:?}");
+        return done;
+    };
+    let batch = IrBatch {
+        zone_id,
+        actions,
+        trace,
+        sent,
+    };
+    if let Err(mpsc::error::SendError(batch)) = queue.send(batch) {
+        warn!(
+            "IR channel {ir_channel} worker stopped; dropping {:?} for zone {}",
+            batch.actions, batch.zone_id
+        );
+    }
+    done
+}
+
+// For the HTTP and MQTT handlers, which answer once the sequence is sent.
+async fn execute_zone_actions(
+    app_state: &AppState,
+    zone_id: String,
+    ir_channel: u8,
+    actions: Vec<EngineAction>,
+    trace: TraceContext,
+) {
+    let _ = queue_zone_actions(app_state, zone_id, ir_channel, actions, trace).await;
+}
+
+async fn send_zone_actions(
+    zone_id: &str,
+    ir_channel: u8,
+    actions: Vec<EngineAction>,
+    trace: &TraceContext,
+) {
+    let mut recorded = false;
     for action in actions {
         if let EngineAction::Delay(ms) = action {
             tokio::time::sleep(Duration::from_millis(ms)).await;
@@ -441,7 +830,78 @@ async fn execute_engine_actions(actions: Vec<EngineAction>) {
         }
 
         // This preserves behavior sequencing in one place; ESP32 IR transport hooks in here.
-        info!("engine action: {action:?}");
+        // The host has no IR hardware, so the log line counts as the transmit.
+        // Like the ESP build, the trace covers the batch's first frame only.
+        if !recorded {
+            recorded = true;
+            let sent_ms = monotonic_ms();
+            PIPELINE_LATENCY.record_ir(trace, sent_ms, sent_ms, wall_clock_ms());
+        }
+        info!(
+            "zone {zone_id} engine action on IR channel {ir_channel}: {action:?} (seq {:?})",
+            trace.seq
+        );
+    }
+}
+
+// Serializes each zone's update in full before enqueueing any of it, and
+// commits the publisher only then, so a failed update is offered again on the
+// next poll. The outbox never blocks, so enqueueing under the registry lock is
+// cheap.
+async fn publish_zone_states(app_state: &AppState, now_ms: u64) {
+    let mut zones = app_state.zones.lock().await;
+    for zone in zones.iter_mut() {
+        let binary_enabled = zone.engine.config.state_binary_enabled;
+        let payload = zone.engine.state_payload(now_ms);
+        if let Some(update) = zone.publisher.poll(payload, now_ms, &zone.engine.config) {
+            let encoded = update
+                .full
+                .as_ref()
+                .map(serde_json::to_vec)
+                .transpose()
+                .and_then(|full| {
+                    let delta = update.delta.as_ref().map(serde_json::to_vec).transpose()?;
+                    Ok((full, delta))
+                });
+            match encoded {
+                Ok((full, delta)) => {
+                    if let Some(body) = full {
+                        let topic = zone.topic(TOPIC_CONTROLLER_STATE);
+                        enqueue_publish(app_state, TopicClass::State, topic, true, body);
+                    }
+                    if let Some(body) = delta {
+                        let topic = zone.topic(TOPIC_CONTROLLER_STATE_DELTA);
+                        enqueue_publish(app_state, TopicClass::StateDelta, topic, false, body);
+                    }
+                    if binary_enabled {
+                        let mut body = Vec::with_capacity(32);
+                        wire::encode_state(&update.snapshot, &mut body);
+                        let topic = zone.topic(TOPIC_CONTROLLER_STATE_BIN);
+                        enqueue_publish(app_state, TopicClass::State, topic, true, body);
+                    }
+                    zone.publisher.commit(&update, now_ms);
+                }
+                Err(err) => warn!("zone {} state serialization failed: {err}", zone.id),
+            }
+        }
+
+        let schedule_version = zone.schedule_version();
+        if zone.publisher.schedule_due(schedule_version) {
+            match serde_json::to_vec(zone.schedule()) {
+                Ok(body) => {
+                    if binary_enabled {
+                        let mut binary = Vec::new();
+                        wire::encode_schedule(zone.schedule(), &mut binary);
+                        let topic = zone.topic(TOPIC_CONTROLLER_SCHEDULE_STATE_BIN);
+                        enqueue_publish(app_state, TopicClass::Schedule, topic, true, binary);
+                    }
+                    let topic = zone.topic(TOPIC_CONTROLLER_SCHEDULE_STATE);
+                    enqueue_publish(app_state, TopicClass::Schedule, topic, true, body);
+                    zone.publisher.mark_schedule_published(schedule_version);
+                }
+                Err(err) => warn!("zone {} schedule serialization failed: {err}", zone.id),
+            }
+        }
     }
 }
 
@@ -463,186 +923,210 @@ async fn handle_mqtt_message(
     let now_ms = monotonic_ms();
 
     match topic.as_str() {
-        TOPIC_SENSOR_TEMP => {
-            if let Ok(temp) = message.parse::<f32>() {
-                if temp.is_finite() && (-40.0..=150.0).contains(&temp) {
-                    let mut engine = app_state.engine.lock().await;
-                    let humidity = engine.current_humidity();
-                    engine.update_sensor_data(temp, humidity, now_ms);
+        // Installation-wide topics: one sensor history, one schedule transfer
+        // for the default zone.
+        TOPIC_SENSOR_HISTORY => match serde_json::from_str::<HistoryBatch>(&message) {
+            Ok(batch) => {
+                let accepted = app_state.history.lock().await.ingest_batch(&batch, now_ms);
+                info!(
+                    "ingested {accepted}/{} replayed sensor readings",
+                    batch.readings.len()
+                );
+            }
+            Err(err) => warn!("invalid sensor history payload: {err}"),
+        },
+        TOPIC_CMD_SCHEDULE_CHUNK => {
+            let committed = app_state
+                .schedule_transfer
+                .lock()
+                .await
+                .accept(message.as_bytes(), now_ms);
+            match committed {
+                Ok(Some(schedule)) => {
+                    info!(
+                        "schedule transfer committed ({} entries)",
+                        schedule.entries.len()
+                    );
+                    commit_schedule(app_state, schedule).await?;
                 }
+                Ok(None) => {}
+                Err(err) => warn!("schedule chunk rejected: {err}"),
             }
         }
-        TOPIC_SENSOR_HUMIDITY => {
-            if let Ok(humidity) = message.parse::<f32>() {
-                if humidity.is_finite() && (0.0..=100.0).contains(&humidity) {
-                    let mut engine = app_state.engine.lock().await;
-                    let temp = engine.current_temp_f();
-                    engine.update_sensor_data(temp, humidity, now_ms);
+        _ => {
+            let (zone_id, zone_base) = route_zone_topic(&topic);
+            handle_zone_mqtt_message(app_state, zone_id, &zone_base, &message, now_ms).await?;
+        }
+    }
+
+    Ok(())
+}
+
+// Every per-zone topic lands here, the default zone's single-zone topics
+// included.
+async fn handle_zone_mqtt_message(
+    app_state: &AppState,
+    zone_id: &str,
+    topic: &str,
+    message: &str,
+    now_ms: u64,
+) -> anyhow::Result<()> {
+    let mut changed = false;
+    let mut schedule_changed = false;
+    let mut actions = Vec::new();
+    let mut live = None;
+    let ir_channel = {
+        let mut zones = app_state.zones.lock().await;
+        let Some(zone) = zones.get_mut(zone_id) else {
+            return Ok(());
+        };
+
+        if let Some(probe_id) = sensor_probe_id(topic) {
+            if let Some(SensorSample { value: temp, trace }) = SensorSample::parse(message) {
+                if !temp.is_finite() || !(-40.0..=150.0).contains(&temp) {
+                    return Ok(());
+                }
+                match zone.engine.update_source_temperature(
+                    probe_id,
+                    DeciDegrees::from_f32(temp),
+                    now_ms,
+                ) {
+                    SourceUpdate::Accepted => zone.engine.note_sample_trace(trace, now_ms),
+                    SourceUpdate::Outlier => {
+                        info!("ignoring {temp:.1} F from zone {zone_id} probe {probe_id} (outlier)")
+                    }
+                    SourceUpdate::TableFull => warn!(
+                        "ignoring zone {zone_id} probe {probe_id}: every source slot is in use"
+                    ),
                 }
             }
+            return Ok(());
         }
-        TOPIC_CMD_POWER => {
-            let lower = message.to_ascii_lowercase();
-            let actions = {
-                let mut engine = app_state.engine.lock().await;
-                if lower == "on" {
-                    engine.manual_on(now_ms)
-                } else if lower == "off" {
-                    engine.manual_off(now_ms)
-                } else {
-                    Vec::new()
+
+        match topic {
+            TOPIC_SENSOR_TEMP => {
+                if let Some(SensorSample { value: temp, trace }) = SensorSample::parse(message) {
+                    if temp.is_finite() && (-40.0..=150.0).contains(&temp) {
+                        if let Some(trace) = &trace {
+                            PIPELINE_LATENCY.record_receive(trace, wall_clock_ms());
+                        }
+                        let temp = DeciDegrees::from_f32(temp);
+                        zone.engine
+                            .update_source_temperature(DEFAULT_SENSOR_SOURCE, temp, now_ms);
+                        zone.engine.note_sample_trace(trace, now_ms);
+                        live = Some((Some(temp), None));
+                    }
                 }
-            };
-            execute_engine_actions(actions).await;
-        }
-        TOPIC_CMD_TARGET => {
-            if let Ok(target) = message.parse::<f32>() {
-                let changed = {
-                    let mut engine = app_state.engine.lock().await;
-                    engine.set_target_temp(target)
+            }
+            TOPIC_SENSOR_HUMIDITY => {
+                if let Ok(humidity) = message.parse::<f32>() {
+                    if humidity.is_finite() && (0.0..=100.0).contains(&humidity) {
+                        zone.engine.update_humidity(humidity);
+                        live = Some((None, Some(humidity)));
+                    }
+                }
+            }
+            TOPIC_CMD_POWER => {
+                actions = match message.to_ascii_lowercase().as_str() {
+                    "on" => zone.engine.manual_on(now_ms),
+                    "off" => zone.engine.manual_off(now_ms),
+                    _ => Vec::new(),
                 };
-                if changed {
-                    persist_runtime_from_state(app_state).await?;
+            }
+            TOPIC_CMD_TARGET => {
+                if let Ok(target) = message.parse::<f32>() {
+                    changed = zone.engine.set_target_temp(DeciDegrees::from_f32(target));
                 }
             }
-        }
-        TOPIC_CMD_MODE => {
-            let upper = message.to_ascii_uppercase();
-            let (changed, actions) = {
-                let mut engine = app_state.engine.lock().await;
-                if upper == "HEAT" {
-                    engine.set_mode_with_actions(ThermostatMode::Heat, now_ms)
-                } else if upper == "OFF" {
-                    engine.set_mode_with_actions(ThermostatMode::Off, now_ms)
-                } else {
-                    (false, Vec::new())
+            TOPIC_CMD_MODE => {
+                let mode = match message.to_ascii_uppercase().as_str() {
+                    "HEAT" => Some(ThermostatMode::Heat),
+                    "OFF" => Some(ThermostatMode::Off),
+                    _ => None,
+                };
+                if let Some(mode) = mode {
+                    (changed, actions) = zone.engine.set_mode_with_actions(mode, now_ms);
                 }
-            };
-            if !actions.is_empty() {
-                execute_engine_actions(actions).await;
             }
-            if changed {
-                persist_runtime_from_state(app_state).await?;
+            TOPIC_CMD_SETTINGS => {
+                match serde_json::from_str::<SettingsUpdate>(message)
+                    .map_err(|_| "invalid JSON")
+                    .and_then(|update| zone.engine.apply_settings(&update, now_ms))
+                {
+                    Ok(applied) => (changed, actions) = applied,
+                    Err(message) => {
+                        warn!("ignoring settings command for zone {zone_id}: {message}")
+                    }
+                }
             }
-        }
-        TOPIC_CMD_HOLD => {
-            let lower = message.to_ascii_lowercase();
-            let mut engine = app_state.engine.lock().await;
-            if lower == "on" || lower == "enter" {
-                engine.enter_hold(None, now_ms);
-            } else if lower == "off" || lower == "exit" {
-                engine.exit_hold();
-            } else if let Ok(minutes) = lower.parse::<u64>() {
-                if minutes > 0 && minutes <= engine.config.max_hold_minutes as u64 {
-                    engine.enter_hold(Some(minutes * 60_000), now_ms);
+            TOPIC_CMD_HOLD => {
+                let lower = message.to_ascii_lowercase();
+                if lower == "on" || lower == "enter" {
+                    zone.engine.enter_hold(None, now_ms);
+                } else if lower == "off" || lower == "exit" {
+                    zone.engine.exit_hold();
+                } else if let Ok(minutes) = lower.parse::<u64>() {
+                    if minutes > 0 && minutes <= zone.engine.config.max_hold_minutes as u64 {
+                        zone.engine.enter_hold(Some(minutes * 60_000), now_ms);
+                    }
                 }
             }
-        }
-        TOPIC_CMD_SCHEDULE => {
-            if let Ok(mut schedule) = serde_json::from_str::<Schedule>(&message) {
-                schedule.normalize();
-                {
-                    let mut active = app_state.schedule.lock().await;
-                    *active = schedule.clone();
+            TOPIC_CMD_SCHEDULE => {
+                if let Ok(schedule) = serde_json::from_str::<Schedule>(message) {
+                    zone.set_schedule(schedule);
+                    schedule_changed = true;
                 }
-                app_state.store.save_schedule(&schedule).await?;
             }
+            _ => {}
         }
-        _ => {}
-    }
+        zone.ir_channel
+    };
 
+    // The sensor history covers the installation's own sensor, which feeds
+    // the default zone.
+    if let Some((temp, humidity)) = live.filter(|_| zone_id == DEFAULT_ZONE_ID) {
+        app_state
+            .history
+            .lock()
+            .await
+            .record_live(now_ms, temp, humidity);
+    }
+    if !actions.is_empty() {
+        execute_zone_actions(
+            app_state,
+            zone_id.to_string(),
+            ir_channel,
+            actions,
+            TraceContext::untraced(monotonic_ms()),
+        )
+        .await;
+    }
+    if changed {
+        persist_zone(app_state, zone_id).await?;
+    }
+    if schedule_changed {
+        persist_zone_schedule(app_state, zone_id).await?;
+    }
     Ok(())
 }
 
+// The single-zone routes are the default zone's.
 async fn handle_get_status(State(state): State<AppState>) -> impl IntoResponse {
-    let now_ms = monotonic_ms();
-    let timezone = state.timezone.lock().await.clone();
-
-    let next_schedule = {
-        let schedule = state.schedule.lock().await;
-        now_in_timezone(&timezone).and_then(|now| schedule.next_event_epoch(now))
-    };
-
-    let schedule_enabled = state.schedule.lock().await.enabled;
-    let time_synced = state.time_synced.load(Ordering::Relaxed);
-
-    let status = {
-        let engine = state.engine.lock().await;
-        engine.status(
-            now_ms,
-            schedule_enabled,
-            next_schedule,
-            time_synced,
-            &timezone,
-        )
-    };
-
-    Json(status)
+    handle_get_zone_status(State(state), Path(DEFAULT_ZONE_ID.to_string())).await
 }
 
 async fn handle_set_target(
     State(state): State<AppState>,
-    Query(params): Query<HashMap<String, String>>,
+    params: Query<HashMap<String, String>>,
 ) -> impl IntoResponse {
-    let Some(value) = params.get("value") else {
-        return error_response(StatusCode::BAD_REQUEST, "Missing 'value' parameter");
-    };
-    let Ok(target) = value.parse::<f32>() else {
-        return error_response(StatusCode::BAD_REQUEST, "Invalid temperature value");
-    };
-
-    let changed = {
-        let mut engine = state.engine.lock().await;
-        engine.set_target_temp(target)
-    };
-
-    if changed {
-        if let Err(err) = persist_runtime_from_state(&state).await {
-            warn!("failed to persist target update: {err:#}");
-            return error_response(
-                StatusCode::INTERNAL_SERVER_ERROR,
-                "Failed to persist runtime settings",
-            );
-        }
-    }
-
-    handle_get_status(State(state)).await.into_response()
+    handle_set_zone_target(State(state), Path(DEFAULT_ZONE_ID.to_string()), params).await
 }
 
 async fn handle_set_mode(
     State(state): State<AppState>,
-    Query(params): Query<HashMap<String, String>>,
+    params: Query<HashMap<String, String>>,
 ) -> impl IntoResponse {
-    let Some(value) = params.get("value") else {
-        return error_response(StatusCode::BAD_REQUEST, "Missing 'value' parameter");
-    };
-
-    let mode = match value.to_ascii_uppercase().as_str() {
-        "HEAT" => ThermostatMode::Heat,
-        "OFF" => ThermostatMode::Off,
-        _ => return error_response(StatusCode::BAD_REQUEST, "Invalid mode. Use 'HEAT' or 'OFF'"),
-    };
-
-    let now_ms = monotonic_ms();
-    let (changed, actions) = {
-        let mut engine = state.engine.lock().await;
-        engine.set_mode_with_actions(mode, now_ms)
-    };
-    if !actions.is_empty() {
-        execute_engine_actions(actions).await;
-    }
-
-    if changed {
-        if let Err(err) = persist_runtime_from_state(&state).await {
-            warn!("failed to persist mode update: {err:#}");
-            return error_response(
-                StatusCode::INTERNAL_SERVER_ERROR,
-                "Failed to persist runtime settings",
-            );
-        }
-    }
-
-    handle_get_status(State(state)).await.into_response()
+    handle_set_zone_mode(State(state), Path(DEFAULT_ZONE_ID.to_string()), params).await
 }
 
 async fn handle_set_hysteresis(
@@ -667,8 +1151,9 @@ async fn handle_set_hysteresis(
     }
 
     let changed = {
-        let mut engine = state.engine.lock().await;
-        engine.set_hysteresis(hysteresis)
+        let mut zones = state.zones.lock().await;
+        let engine = &mut zones.default_zone_mut().engine;
+        engine.set_hysteresis(DeciDegrees::from_f32(hysteresis))
     };
 
     if changed {
@@ -706,7 +1191,8 @@ async fn handle_set_offset(
     }
 
     let changed = {
-        let mut engine = state.engine.lock().await;
+        let mut zones = state.zones.lock().await;
+        let engine = &mut zones.default_zone_mut().engine;
         engine.set_fireplace_offset(offset)
     };
 
@@ -723,76 +1209,101 @@ async fn handle_set_offset(
     handle_get_status(State(state)).await.into_response()
 }
 
-async fn handle_ir_on(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_on(monotonic_ms())
+// Applies every field in one engine critical section and persists once, so a
+// batch of edits from the UI costs one write instead of one per field.
+async fn handle_patch_settings(
+    State(state): State<AppState>,
+    Json(update): Json<SettingsUpdate>,
+) -> impl IntoResponse {
+    let result = {
+        let mut zones = state.zones.lock().await;
+        let zone = zones.default_zone_mut();
+        zone.engine
+            .apply_settings(&update, monotonic_ms())
+            .map(|(changed, actions)| (changed, actions, zone.ir_channel))
     };
-    execute_engine_actions(actions).await;
+    let (changed, actions, ir_channel) = match result {
+        Ok(applied) => applied,
+        Err(message) => return error_response(StatusCode::BAD_REQUEST, message),
+    };
+    if !actions.is_empty() {
+        execute_zone_actions(
+            &state,
+            DEFAULT_ZONE_ID.to_string(),
+            ir_channel,
+            actions,
+            TraceContext::untraced(monotonic_ms()),
+        )
+        .await;
+    }
+
+    if changed {
+        if let Err(err) = persist_runtime_from_state(&state).await {
+            warn!("failed to persist settings update: {err:#}");
+            return error_response(
+                StatusCode::INTERNAL_SERVER_ERROR,
+                "Failed to persist runtime settings",
+            );
+        }
+    }
+
     handle_get_status(State(state)).await.into_response()
 }
 
-async fn handle_ir_off(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_off(monotonic_ms())
+// Runs one manual command on the default zone's engine, sends the IR
+// sequence it produces and answers with the updated status.
+async fn run_default_zone_command(
+    state: AppState,
+    command: impl FnOnce(&mut ThermostatEngine, u64) -> Vec<EngineAction>,
+) -> axum::response::Response {
+    let (actions, ir_channel) = {
+        let mut zones = state.zones.lock().await;
+        let zone = zones.default_zone_mut();
+        (command(&mut zone.engine, monotonic_ms()), zone.ir_channel)
     };
-    execute_engine_actions(actions).await;
+    if !actions.is_empty() {
+        execute_zone_actions(
+            &state,
+            DEFAULT_ZONE_ID.to_string(),
+            ir_channel,
+            actions,
+            TraceContext::untraced(monotonic_ms()),
+        )
+        .await;
+    }
     handle_get_status(State(state)).await.into_response()
 }
 
+async fn handle_ir_on(State(state): State<AppState>) -> impl IntoResponse {
+    run_default_zone_command(state, |engine, now_ms| engine.manual_on(now_ms)).await
+}
+
+async fn handle_ir_off(State(state): State<AppState>) -> impl IntoResponse {
+    run_default_zone_command(state, |engine, now_ms| engine.manual_off(now_ms)).await
+}
+
 async fn handle_ir_heat_on(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_heat_on(monotonic_ms())
-    };
-    execute_engine_actions(actions).await;
-    handle_get_status(State(state)).await.into_response()
+    run_default_zone_command(state, |engine, now_ms| engine.manual_heat_on(now_ms)).await
 }
 
 async fn handle_ir_heat_off(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_heat_off(monotonic_ms())
-    };
-    execute_engine_actions(actions).await;
-    handle_get_status(State(state)).await.into_response()
+    run_default_zone_command(state, |engine, now_ms| engine.manual_heat_off(now_ms)).await
 }
 
 async fn handle_ir_heat_up(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_heat_up()
-    };
-    execute_engine_actions(actions).await;
-    handle_get_status(State(state)).await.into_response()
+    run_default_zone_command(state, |engine, _| engine.manual_heat_up()).await
 }
 
 async fn handle_ir_heat_down(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_heat_down()
-    };
-    execute_engine_actions(actions).await;
-    handle_get_status(State(state)).await.into_response()
+    run_default_zone_command(state, |engine, _| engine.manual_heat_down()).await
 }
 
 async fn handle_ir_light_toggle(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_light_toggle()
-    };
-    execute_engine_actions(actions).await;
-    handle_get_status(State(state)).await.into_response()
+    run_default_zone_command(state, |engine, _| engine.manual_light_toggle()).await
 }
 
 async fn handle_ir_timer_toggle(State(state): State<AppState>) -> impl IntoResponse {
-    let actions = {
-        let mut engine = state.engine.lock().await;
-        engine.manual_timer_toggle()
-    };
-    execute_engine_actions(actions).await;
-    handle_get_status(State(state)).await.into_response()
+    run_default_zone_command(state, |engine, _| engine.manual_timer_toggle()).await
 }
 
 async fn handle_hold_enter(
@@ -805,46 +1316,71 @@ async fn handle_hold_enter(
         .filter(|minutes| *minutes > 0)
         .map(|minutes| minutes * 60_000);
 
-    {
-        let mut engine = state.engine.lock().await;
-        engine.enter_hold(duration_ms, monotonic_ms());
-    }
-
-    handle_get_status(State(state)).await.into_response()
+    run_default_zone_command(state, |engine, now_ms| {
+        engine.enter_hold(duration_ms, now_ms);
+        Vec::new()
+    })
+    .await
 }
 
 async fn handle_hold_exit(State(state): State<AppState>) -> impl IntoResponse {
-    {
-        let mut engine = state.engine.lock().await;
+    run_default_zone_command(state, |engine, _| {
         engine.exit_hold();
-    }
-    handle_get_status(State(state)).await.into_response()
+        Vec::new()
+    })
+    .await
 }
 
 async fn handle_safety_reset(State(state): State<AppState>) -> impl IntoResponse {
-    {
-        let mut engine = state.engine.lock().await;
+    run_default_zone_command(state, |engine, _| {
         engine.reset_safety();
-    }
-    handle_get_status(State(state)).await.into_response()
+        Vec::new()
+    })
+    .await
 }
 
 async fn handle_get_schedule(State(state): State<AppState>) -> impl IntoResponse {
-    let schedule = state.schedule.lock().await.clone();
-    Json(schedule)
+    handle_get_zone_schedule(State(state), Path(DEFAULT_ZONE_ID.to_string())).await
 }
 
 async fn handle_put_schedule(
     State(state): State<AppState>,
-    Json(mut schedule): Json<Schedule>,
+    schedule: Json<Schedule>,
 ) -> impl IntoResponse {
-    schedule.normalize();
-    {
-        let mut active = state.schedule.lock().await;
-        *active = schedule.clone();
+    handle_put_zone_schedule(State(state), Path(DEFAULT_ZONE_ID.to_string()), schedule).await
+}
+
+async fn handle_get_schedule_compact(State(state): State<AppState>) -> impl IntoResponse {
+    let mut body = String::new();
+    schedule_transfer::write_compact(
+        state.zones.lock().await.default_zone().schedule(),
+        &mut body,
+    );
+    ([(header::CONTENT_TYPE, "text/plain; charset=utf-8")], body)
+}
+
+// Parses the upload frame by frame as it arrives, so a large schedule never
+// sits in memory as text alongside the parsed entries.
+async fn handle_put_schedule_compact(
+    State(state): State<AppState>,
+    body: Body,
+) -> impl IntoResponse {
+    let mut parser = ScheduleParser::new();
+    let mut frames = body.into_data_stream();
+    while let Some(frame) = std::future::poll_fn(|cx| Pin::new(&mut frames).poll_frame(cx)).await {
+        let Some(chunk) = frame.ok().and_then(|frame| frame.into_data().ok()) else {
+            return error_response(StatusCode::BAD_REQUEST, "Failed to read request body");
+        };
+        if let Err(err) = parser.feed(&chunk) {
+            return error_response(StatusCode::BAD_REQUEST, &err.to_string());
+        }
     }
+    let schedule = match parser.finish() {
+        Ok(schedule) => schedule,
+        Err(err) => return error_response(StatusCode::BAD_REQUEST, &err.to_string()),
+    };
 
-    if let Err(err) = state.store.save_schedule(&schedule).await {
+    if let Err(err) = commit_schedule(&state, schedule).await {
         warn!("failed to persist schedule update: {err:#}");
         return error_response(
             StatusCode::INTERNAL_SERVER_ERROR,
@@ -855,6 +1391,18 @@ async fn handle_put_schedule(
     handle_get_schedule(State(state)).await.into_response()
 }
 
+// Installs a schedule on the default zone, from a full upload or a completed
+// chunked transfer.
+async fn commit_schedule(state: &AppState, schedule: Schedule) -> anyhow::Result<()> {
+    state
+        .zones
+        .lock()
+        .await
+        .default_zone_mut()
+        .set_schedule(schedule);
+    persist_zone_schedule(state, DEFAULT_ZONE_ID).await
+}
+
 async fn handle_get_time(State(state): State<AppState>) -> impl IntoResponse {
     let timezone = state.timezone.lock().await.clone();
     Json(TimeStatus {
@@ -1019,6 +1567,335 @@ async fn handle_put_ir_config(
     Json(payload).into_response()
 }
 
+async fn handle_get_mqtt_diagnostics(State(state): State<AppState>) -> impl IntoResponse {
+    let outbox = state.outbox.lock().unwrap().stats();
+    Json(MqttDiagnostics { outbox })
+}
+
+async fn handle_get_trace_latency() -> impl IntoResponse {
+    Json(PIPELINE_LATENCY.views())
+}
+
+async fn handle_get_lock_contention() -> impl IntoResponse {
+    Json(contention_report())
+}
+
+async fn handle_get_memory() -> impl IntoResponse {
+    Json(memory_report(&HostMemory))
+}
+
+async fn handle_get_metrics(State(state): State<AppState>) -> impl IntoResponse {
+    let outbox = state.outbox.lock().unwrap().stats();
+    let mut body = String::with_capacity(16 * 1024);
+    METRICS.render(&outbox, &PIPELINE_LATENCY, &mut body);
+    if let Some(resident_bytes) = resident_memory_bytes() {
+        metrics::write_gauge(
+            &mut body,
+            "thermostat_resident_memory_bytes",
+            "Resident set size of the controller process.",
+            resident_bytes,
+        );
+    }
+    (
+        [(
+            header::CONTENT_TYPE,
+            "text/plain; version=0.0.4; charset=utf-8",
+        )],
+        body,
+    )
+}
+
+// Only matched routes pass through here, so the label is the route template
+// (`/api/zones/{id}`) rather than the raw path.
+async fn track_http_latency(
+    path: MatchedPath,
+    request: Request,
+    next: Next,
+) -> axum::response::Response {
+    let started = Instant::now();
+    let response = in_subsystem(&HostMemory, Subsystem::Http, next.run(request)).await;
+    METRICS.http.record(path.as_str(), started.elapsed());
+    response
+}
+
+// The host has no heap introspection like the ESP32's; the kernel's resident
+// set size is the closest stand-in.
+fn resident_memory_bytes() -> Option<u64> {
+    let status = std::fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|line| line.starts_with("VmRSS:"))?;
+    let kib: u64 = line.split_whitespace().nth(1)?.parse().ok()?;
+    Some(kib * 1024)
+}
+
+async fn handle_get_sensors(State(state): State<AppState>) -> impl IntoResponse {
+    handle_get_zone_sensors(State(state), Path(DEFAULT_ZONE_ID.to_string())).await
+}
+
+fn build_zone_view(zone: &Zone, now_ms: u64) -> ZoneView {
+    ZoneView {
+        id: zone.id.clone(),
+        name: zone.name.clone(),
+        ir_channel: zone.ir_channel,
+        state: zone.engine.state_payload(now_ms),
+    }
+}
+
+fn zone_not_found() -> axum::response::Response {
+    error_response(StatusCode::NOT_FOUND, "Unknown zone")
+}
+
+async fn handle_get_zones(State(state): State<AppState>) -> impl IntoResponse {
+    let now_ms = monotonic_ms();
+    let zones = state.zones.lock().await;
+    let views: Vec<ZoneView> = zones
+        .iter()
+        .map(|zone| build_zone_view(zone, now_ms))
+        .collect();
+    Json(views)
+}
+
+async fn handle_post_zone(
+    State(state): State<AppState>,
+    Json(request): Json<ZoneCreateRequest>,
+) -> impl IntoResponse {
+    if !is_supported_rmt_channel(request.ir_channel) {
+        return error_response(StatusCode::BAD_REQUEST, "Invalid IR channel (0-7)");
+    }
+
+    let id = request.id.clone();
+    let view = {
+        let mut zones = state.zones.lock().await;
+        let added = zones.add(ZoneConfig {
+            id: request.id,
+            name: request.name,
+            ir_channel: request.ir_channel,
+            ..ZoneConfig::default()
+        });
+        match added {
+            Ok(zone) => build_zone_view(zone, monotonic_ms()),
+            Err(err @ ZoneError::Duplicate(_)) => {
+                return error_response(StatusCode::CONFLICT, &err.to_string())
+            }
+            Err(err) => return error_response(StatusCode::BAD_REQUEST, &err.to_string()),
+        }
+    };
+
+    if let Err(err) = persist_zones(&state).await {
+        warn!("failed to persist zones: {err:#}");
+        // Not created unless it is stored, so a restart brings back exactly
+        // the zones the API reported.
+        state.zones.lock().await.remove(&id);
+        return error_response(StatusCode::INTERNAL_SERVER_ERROR, "Failed to persist zones");
+    }
+    (StatusCode::CREATED, Json(view)).into_response()
+}
+
+async fn handle_delete_zone(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+) -> impl IntoResponse {
+    if id == DEFAULT_ZONE_ID {
+        return error_response(
+            StatusCode::BAD_REQUEST,
+            "The default zone cannot be removed",
+        );
+    }
+    if state.zones.lock().await.remove(&id).is_none() {
+        return zone_not_found();
+    }
+    if let Err(err) = persist_zones(&state).await {
+        warn!("failed to persist zones: {err:#}");
+        return error_response(StatusCode::INTERNAL_SERVER_ERROR, "Failed to persist zones");
+    }
+    StatusCode::NO_CONTENT.into_response()
+}
+
+async fn handle_get_zone_status(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+) -> impl IntoResponse {
+    let now_ms = monotonic_ms();
+    let timezone = state.timezone.lock().await.clone();
+    let time_synced = state.time_synced.load(Ordering::Relaxed);
+
+    let zones = state.zones.lock().await;
+    let Some(zone) = zones.get(&id) else {
+        return zone_not_found();
+    };
+    let next_schedule =
+        now_in_timezone(&timezone).and_then(|now| zone.schedule().next_event_epoch(now));
+    Json(zone.engine.status(
+        now_ms,
+        zone.schedule().enabled,
+        next_schedule,
+        time_synced,
+        &timezone,
+    ))
+    .into_response()
+}
+
+async fn handle_set_zone_target(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+    Query(params): Query<HashMap<String, String>>,
+) -> impl IntoResponse {
+    let Some(value) = params.get("value") else {
+        return error_response(StatusCode::BAD_REQUEST, "Missing 'value' parameter");
+    };
+    let Ok(target) = value.parse::<f32>() else {
+        return error_response(StatusCode::BAD_REQUEST, "Invalid temperature value");
+    };
+
+    let changed = {
+        let mut zones = state.zones.lock().await;
+        let Some(zone) = zones.get_mut(&id) else {
+            return zone_not_found();
+        };
+        zone.engine.set_target_temp(DeciDegrees::from_f32(target))
+    };
+
+    if changed {
+        if let Err(err) = persist_zone(&state, &id).await {
+            warn!("failed to persist zone target update: {err:#}");
+            return error_response(
+                StatusCode::INTERNAL_SERVER_ERROR,
+                "Failed to persist zone settings",
+            );
+        }
+    }
+
+    handle_get_zone_status(State(state), Path(id))
+        .await
+        .into_response()
+}
+
+async fn handle_set_zone_mode(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+    Query(params): Query<HashMap<String, String>>,
+) -> impl IntoResponse {
+    let Some(value) = params.get("value") else {
+        return error_response(StatusCode::BAD_REQUEST, "Missing 'value' parameter");
+    };
+
+    let mode = match value.to_ascii_uppercase().as_str() {
+        "HEAT" => ThermostatMode::Heat,
+        "OFF" => ThermostatMode::Off,
+        _ => return error_response(StatusCode::BAD_REQUEST, "Invalid mode. Use 'HEAT' or 'OFF'"),
+    };
+
+    let (changed, actions, ir_channel) = {
+        let mut zones = state.zones.lock().await;
+        let Some(zone) = zones.get_mut(&id) else {
+            return zone_not_found();
+        };
+        let (changed, actions) = zone.engine.set_mode_with_actions(mode, monotonic_ms());
+        (changed, actions, zone.ir_channel)
+    };
+    if !actions.is_empty() {
+        execute_zone_actions(
+            &state,
+            id.clone(),
+            ir_channel,
+            actions,
+            TraceContext::untraced(monotonic_ms()),
+        )
+        .await;
+    }
+
+    if changed {
+        if let Err(err) = persist_zone(&state, &id).await {
+            warn!("failed to persist zone mode update: {err:#}");
+            return error_response(
+                StatusCode::INTERNAL_SERVER_ERROR,
+                "Failed to persist zone settings",
+            );
+        }
+    }
+
+    handle_get_zone_status(State(state), Path(id))
+        .await
+        .into_response()
+}
+
+async fn handle_get_zone_sensors(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+) -> impl IntoResponse {
+    let now_ms = monotonic_ms();
+    let zones = state.zones.lock().await;
+    let Some(zone) = zones.get(&id) else {
+        return zone_not_found();
+    };
+    Json(SensorSourcesView {
+        fused_temp_f: zone.engine.current_temp_f(),
+        valid: zone.engine.is_sensor_data_valid(now_ms),
+        sources: zone.engine.sensor_sources(now_ms),
+    })
+    .into_response()
+}
+
+async fn handle_get_zone_schedule(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+) -> impl IntoResponse {
+    let zones = state.zones.lock().await;
+    match zones.get(&id) {
+        Some(zone) => Json(zone.schedule().clone()).into_response(),
+        None => zone_not_found(),
+    }
+}
+
+async fn handle_put_zone_schedule(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+    Json(schedule): Json<Schedule>,
+) -> impl IntoResponse {
+    {
+        let mut zones = state.zones.lock().await;
+        let Some(zone) = zones.get_mut(&id) else {
+            return zone_not_found();
+        };
+        zone.set_schedule(schedule);
+    }
+
+    if let Err(err) = persist_zone_schedule(&state, &id).await {
+        warn!("failed to persist zone schedule update: {err:#}");
+        return error_response(
+            StatusCode::INTERNAL_SERVER_ERROR,
+            "Failed to persist schedule",
+        );
+    }
+
+    handle_get_zone_schedule(State(state), Path(id))
+        .await
+        .into_response()
+}
+
+async fn handle_get_history(
+    State(state): State<AppState>,
+    Query(params): Query<HashMap<String, String>>,
+) -> impl IntoResponse {
+    let since_ms = match params.get("since").map(|value| value.parse::<u64>()) {
+        None => 0,
+        Some(Ok(since_ms)) => since_ms,
+        Some(Err(_)) => {
+            return error_response(StatusCode::BAD_REQUEST, "Invalid 'since' parameter");
+        }
+    };
+
+    let history = state.history.lock().await;
+    Json(HistoryView {
+        now_ms: monotonic_ms(),
+        stats: history.stats(),
+        points: history
+            .points()
+            .filter(|point| point.at_ms >= since_ms)
+            .collect(),
+    })
+    .into_response()
+}
+
 async fn handle_get_ir_diagnostics(State(state): State<AppState>) -> impl IntoResponse {
     let runtime = state
         .store
@@ -1066,7 +1943,8 @@ impl AppStore {
         Self {
             runtime_path: Arc::new(data_dir.join("runtime.json")),
             schedule_path: Arc::new(data_dir.join("schedule.json")),
-            lock: Arc::new(Mutex::new(())),
+            zones_path: Arc::new(data_dir.join("zones.json")),
+            lock: Arc::new(ProfiledAsyncMutex::new("store", ())),
         }
     }
 
@@ -1081,13 +1959,8 @@ impl AppStore {
 
     async fn save_runtime_config(&self, runtime: &RuntimeConfig) -> anyhow::Result<()> {
         let _guard = self.lock.lock().await;
-        let path = self.runtime_path.as_ref().clone();
-        if let Some(parent) = path.parent() {
-            tokio::fs::create_dir_all(parent).await?;
-        }
         let payload = serde_json::to_vec_pretty(runtime)?;
-        tokio::fs::write(path, payload).await?;
-        Ok(())
+        write_file(&self.runtime_path, payload).await
     }
 
     async fn load_schedule(&self) -> anyhow::Result<Schedule> {
@@ -1101,18 +1974,50 @@ impl AppStore {
 
     async fn save_schedule(&self, schedule: &Schedule) -> anyhow::Result<()> {
         let _guard = self.lock.lock().await;
-        let path = self.schedule_path.as_ref().clone();
+        let payload = serde_json::to_vec_pretty(schedule)?;
+        write_file(&self.schedule_path, payload).await
+    }
+
+    async fn load_zones(&self) -> anyhow::Result<Vec<ZoneConfig>> {
+        let _guard = self.lock.lock().await;
+        match tokio::fs::read(self.zones_path.as_ref()).await {
+            Ok(raw) => Ok(serde_json::from_slice::<Vec<ZoneConfig>>(&raw)?),
+            Err(err) if err.kind() == ErrorKind::NotFound => Ok(Vec::new()),
+            Err(err) => Err(err.into()),
+        }
+    }
+
+    async fn save_zones(&self, zones: &[ZoneConfig]) -> anyhow::Result<()> {
+        let _guard = self.lock.lock().await;
+        let payload = serde_json::to_vec_pretty(zones)?;
+        write_file(&self.zones_path, payload).await
+    }
+}
+
+// Every settings, schedule and zone write goes through here so /metrics sees
+// them all.
+async fn write_file(path: &std::path::Path, payload: Vec<u8>) -> anyhow::Result<()> {
+    let started = Instant::now();
+    let result = in_subsystem(&HostMemory, Subsystem::Storage, async {
         if let Some(parent) = path.parent() {
             tokio::fs::create_dir_all(parent).await?;
         }
-        let payload = serde_json::to_vec_pretty(schedule)?;
-        tokio::fs::write(path, payload).await?;
-        Ok(())
-    }
+        tokio::fs::write(path, payload).await
+    })
+    .await;
+    METRICS.record_storage_write(started.elapsed(), &result);
+    Ok(result?)
 }
 
 async fn persist_runtime_from_state(state: &AppState) -> anyhow::Result<()> {
-    let settings = state.engine.lock().await.settings().clone();
+    let settings = state
+        .zones
+        .lock()
+        .await
+        .default_zone()
+        .engine
+        .settings()
+        .clone();
     let timezone = state.timezone.lock().await.clone();
 
     let mut runtime = state.store.load_runtime_config().await?;
@@ -1121,6 +2026,29 @@ async fn persist_runtime_from_state(state: &AppState) -> anyhow::Result<()> {
     state.store.save_runtime_config(&runtime).await
 }
 
+async fn persist_zones(state: &AppState) -> anyhow::Result<()> {
+    let configs = state.zones.lock().await.configs();
+    state.store.save_zones(&configs).await
+}
+
+// The default zone keeps the single-zone files: settings in runtime.json and
+// the schedule in schedule.json. Added zones live in zones.json.
+async fn persist_zone(state: &AppState, zone_id: &str) -> anyhow::Result<()> {
+    if zone_id == DEFAULT_ZONE_ID {
+        persist_runtime_from_state(state).await
+    } else {
+        persist_zones(state).await
+    }
+}
+
+async fn persist_zone_schedule(state: &AppState, zone_id: &str) -> anyhow::Result<()> {
+    if zone_id != DEFAULT_ZONE_ID {
+        return persist_zones(state).await;
+    }
+    let schedule = state.zones.lock().await.default_zone().schedule().clone();
+    state.store.save_schedule(&schedule).await
+}
+
 fn build_network_config_view(network: &NetworkConfig) -> NetworkConfigView {
     NetworkConfigView {
         wifi_ssid: network.wifi_ssid.clone(),
@@ -1214,13 +2142,13 @@ fn _schedule_examples() -> Vec<ScheduleEntry> {
             day: DayOfWeek::Mon,
             start_minutes: 6 * 60,
             mode: ThermostatMode::Heat,
-            target_temp_f: 71.0,
+            target_temp_f: DeciDegrees::from_degrees(71),
         },
         ScheduleEntry {
             day: DayOfWeek::Mon,
             start_minutes: 22 * 60,
             mode: ThermostatMode::Off,
-            target_temp_f: 68.0,
+            target_temp_f: DeciDegrees::from_degrees(68),
         },
     ]
 }
@@ -1,5 +1,4 @@
 use std::{
-    sync::OnceLock,
     thread,
     time::{Duration, Instant},
 };
@@ -19,7 +18,10 @@ use serde::Serialize;
 
 use thermostat_common::EngineAction;
 
-use crate::ir_codes;
+use crate::{
+    esp::{monotonic_ms, METRICS},
+    ir_codes,
+};
 
 const IR_TICK_DIVIDER: u8 = 80;
 const IR_CARRIER_FREQ_KHZ: u32 = 36;
@@ -54,12 +56,21 @@ pub struct IrTransmitter {
     backend: IrBackend,
     state: IrRuntimeState,
     last_send_ms: Option<u64>,
+    // Start of the first frame of the action in progress, for tracing.
+    action_started_ms: Option<u64>,
     carrier_khz: u32,
     sent_frames: u64,
     failed_actions: u64,
     last_error: Option<String>,
 }
 
+// Monotonic milliseconds of one action's first frame and last repeat.
+#[derive(Debug, Clone, Copy)]
+pub struct IrSend {
+    pub started_ms: u64,
+    pub finished_ms: u64,
+}
+
 #[derive(Debug, Clone, Serialize)]
 pub struct IrDiagnostics {
     pub enabled: bool,
@@ -113,6 +124,7 @@ impl IrTransmitter {
             backend: IrBackend::Rmt(tx),
             state: IrRuntimeState::default(),
             last_send_ms: None,
+            action_started_ms: None,
             carrier_khz,
             sent_frames: 0,
             failed_actions: 0,
@@ -125,6 +137,7 @@ impl IrTransmitter {
             backend: IrBackend::Disabled,
             state: IrRuntimeState::default(),
             last_send_ms: None,
+            action_started_ms: None,
             carrier_khz: IR_CARRIER_FREQ_KHZ,
             sent_frames: 0,
             failed_actions: 0,
@@ -132,7 +145,10 @@ impl IrTransmitter {
         }
     }
 
-    pub fn execute_action(&mut self, action: EngineAction) -> anyhow::Result<()> {
+    // Returns when the action's first frame went out and when its last repeat
+    // finished, or None if it sent nothing (IR disabled, already at the limit).
+    pub fn execute_action(&mut self, action: EngineAction) -> anyhow::Result<Option<IrSend>> {
+        self.action_started_ms = None;
         let result = (|| -> anyhow::Result<()> {
             match action {
                 EngineAction::PowerOn => {
@@ -179,7 +195,12 @@ impl IrTransmitter {
             self.last_error = None;
         }
 
-        result
+        result.map(|()| {
+            self.action_started_ms.map(|started_ms| IrSend {
+                started_ms,
+                finished_ms: monotonic_ms(),
+            })
+        })
     }
 
     pub fn diagnostics(&self) -> IrDiagnostics {
@@ -301,6 +322,7 @@ impl IrTransmitter {
         );
 
         self.rate_limit();
+        self.action_started_ms.get_or_insert_with(monotonic_ms);
 
         let mut pulses = [Pulse::zero(); MAX_IR_PULSES];
         for (index, duration) in raw.iter().enumerate() {
@@ -323,13 +345,17 @@ impl IrTransmitter {
             .context("failed to convert IR timings to RMT signal")?;
 
         if let IrBackend::Rmt(tx) = &mut self.backend {
+            let frame_started = Instant::now();
             for repeat in 0..IR_REPEAT_COUNT {
-                tx.start_blocking(&signal)
-                    .context("failed to transmit IR frame over RMT")?;
+                if let Err(err) = tx.start_blocking(&signal) {
+                    METRICS.ir_frame_failures.inc();
+                    return Err(err).context("failed to transmit IR frame over RMT");
+                }
                 if repeat + 1 < IR_REPEAT_COUNT {
                     thread::sleep(Duration::from_millis(IR_REPEAT_GAP_MS));
                 }
             }
+            METRICS.ir_frame_duration.record(frame_started.elapsed());
         }
 
         self.last_send_ms = Some(monotonic_ms());
@@ -387,13 +413,3 @@ fn normalize_temp(temp_f: i32) -> i32 {
     }
     normalized
 }
-
-fn monotonic_ms() -> u64 {
-    static START: OnceLock<Instant> = OnceLock::new();
-    START
-        .get_or_init(Instant::now)
-        .elapsed()
-        .as_millis()
-        .try_into()
-        .unwrap_or(u64::MAX)
-}
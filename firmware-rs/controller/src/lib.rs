@@ -0,0 +1,4 @@
+// The host build is also a library so integration tests can run the
+// controller in-process next to the sensor and an embedded broker.
+#[cfg(not(feature = "esp32"))]
+pub mod host;
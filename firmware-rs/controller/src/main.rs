@@ -1,16 +1,26 @@
 #[cfg(feature = "esp32")]
 mod esp;
-#[cfg(not(feature = "esp32"))]
-mod host;
 #[cfg(feature = "esp32")]
 mod ir;
 #[cfg(feature = "esp32")]
 mod ir_codes;
 
+#[cfg(not(feature = "esp32"))]
+#[global_allocator]
+static ALLOCATOR: thermostat_common::CountingAllocator = thermostat_common::CountingAllocator::new(
+    std::alloc::System,
+    &thermostat_controller::host::HostMemory,
+);
+
+#[cfg(feature = "esp32")]
+#[global_allocator]
+static ALLOCATOR: thermostat_common::CountingAllocator =
+    thermostat_common::CountingAllocator::new(std::alloc::System, &thermostat_common::EspMemory);
+
 #[cfg(not(feature = "esp32"))]
 #[tokio::main]
 async fn main() -> anyhow::Result<()> {
-    host::run().await
+    thermostat_controller::host::run().await
 }
 
 #[cfg(feature = "esp32")]
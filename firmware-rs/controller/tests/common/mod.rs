@@ -0,0 +1,90 @@
+use std::{
+    net::{SocketAddr, TcpListener},
+    path::PathBuf,
+};
+
+use rumqttc::{AsyncClient, EventLoop, MqttOptions};
+use thermostat_broker::EmbeddedBroker;
+use tokio::task::{JoinError, JoinHandle};
+
+// Broker, controller and optionally the sensor in one tokio runtime. Both
+// hosts read their configuration from the environment, which is
+// process-wide, so each test binary starts at most one harness.
+pub struct Harness {
+    broker: EmbeddedBroker,
+    controller: JoinHandle<anyhow::Result<()>>,
+    sensor: Option<JoinHandle<anyhow::Result<()>>>,
+    data_dir: PathBuf,
+}
+
+impl Harness {
+    pub fn start(with_sensor: bool) -> Self {
+        let broker = EmbeddedBroker::start(SocketAddr::from(([127, 0, 0, 1], free_port())), None)
+            .expect("start embedded broker");
+        let data_dir = std::env::temp_dir().join(format!("thermostat-e2e-{}", std::process::id()));
+
+        std::env::set_var("MQTT_HOST", broker.addr().ip().to_string());
+        std::env::set_var("MQTT_PORT", broker.addr().port().to_string());
+        std::env::remove_var("MQTT_USER");
+        std::env::set_var("CONTROLLER_HTTP_PORT", free_port().to_string());
+        std::env::set_var("THERMOSTAT_DATA_DIR", &data_dir);
+
+        Self {
+            broker,
+            controller: tokio::spawn(thermostat_controller::host::run()),
+            sensor: with_sensor.then(|| tokio::spawn(thermostat_sensor::host::run())),
+            data_dir,
+        }
+    }
+
+    // The hosts serve until the runtime shuts down, so this only resolves
+    // when one of them returned an error or panicked.
+    pub async fn stopped(&mut self) -> String {
+        let Self {
+            controller, sensor, ..
+        } = self;
+        let sensor = async {
+            match sensor {
+                Some(sensor) => describe_exit("sensor", sensor.await),
+                None => std::future::pending().await,
+            }
+        };
+        tokio::select! {
+            result = controller => describe_exit("controller", result),
+            stopped = sensor => stopped,
+        }
+    }
+
+    pub fn client(&self, client_id: &str) -> (AsyncClient, EventLoop) {
+        let addr = self.broker.addr();
+        AsyncClient::new(
+            MqttOptions::new(client_id, addr.ip().to_string(), addr.port()),
+            64,
+        )
+    }
+}
+
+impl Drop for Harness {
+    fn drop(&mut self) {
+        self.controller.abort();
+        if let Some(sensor) = &self.sensor {
+            sensor.abort();
+        }
+        let _ = std::fs::remove_dir_all(&self.data_dir);
+    }
+}
+
+fn describe_exit(host: &str, result: Result<anyhow::Result<()>, JoinError>) -> String {
+    match result {
+        Ok(Ok(())) => format!("{host} stopped"),
+        Ok(Err(err)) => format!("{host} stopped: {err:#}"),
+        Err(err) => format!("{host} task failed: {err}"),
+    }
+}
+
+fn free_port() -> u16 {
+    TcpListener::bind("127.0.0.1:0")
+        .and_then(|listener| listener.local_addr())
+        .map(|addr| addr.port())
+        .expect("free local port")
+}
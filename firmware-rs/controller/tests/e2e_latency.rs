@@ -0,0 +1,103 @@
+#![cfg(not(feature = "esp32"))]
+
+mod common;
+
+use std::time::{Duration, Instant};
+
+use common::Harness;
+use rumqttc::{Event, Incoming, QoS};
+use thermostat_common::{
+    ControllerStatePayload, DeciDegrees, Histogram, TOPIC_CONTROLLER_STATE, TOPIC_SENSOR_TEMP,
+};
+use tokio::sync::mpsc;
+
+const SAMPLES: u32 = 200;
+const SAMPLE_TIMEOUT: Duration = Duration::from_secs(5);
+
+// Reading-to-state latency through the embedded broker: publish a sensor
+// reading, then time the controller state that carries it. The harness runs
+// without the simulated sensor so every reading is the bench's own.
+// Ignored by default; run with
+// `cargo test -p thermostat-controller --test e2e_latency -- --ignored --nocapture`.
+#[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+#[ignore = "benchmark"]
+async fn reading_to_state_latency() {
+    let mut harness = Harness::start(false);
+    let (client, mut eventloop) = harness.client("thermostat-e2e-latency");
+    client
+        .subscribe(TOPIC_CONTROLLER_STATE, QoS::AtMostOnce)
+        .await
+        .unwrap();
+
+    let (states, mut arrivals) = mpsc::unbounded_channel();
+    tokio::spawn(async move {
+        loop {
+            match eventloop.poll().await {
+                Ok(Event::Incoming(Incoming::Publish(message))) => {
+                    let received = Instant::now();
+                    if let Ok(state) =
+                        serde_json::from_slice::<ControllerStatePayload>(&message.payload)
+                    {
+                        if states.send((state.temp, received)).is_err() {
+                            return;
+                        }
+                    }
+                }
+                Ok(_) => {}
+                Err(err) => panic!("bench mqtt error: {err}"),
+            }
+        }
+    });
+
+    let latency_us = Histogram::new();
+    let run = async {
+        // Sample 0 warms up: it is resent until the controller has subscribed
+        // and is not recorded.
+        for sample in 0..=SAMPLES {
+            // Every reading differs from the one before, so each one changes
+            // the published state.
+            let temp = 60.0 + (sample % 100) as f32 / 10.0;
+            let expected = DeciDegrees::from_f32(temp);
+            let sent = Instant::now();
+            loop {
+                client
+                    .publish(
+                        TOPIC_SENSOR_TEMP,
+                        QoS::AtMostOnce,
+                        false,
+                        format!("{temp:.1}"),
+                    )
+                    .await
+                    .unwrap();
+                let arrived = tokio::time::timeout(SAMPLE_TIMEOUT, async {
+                    while let Some((state_temp, received)) = arrivals.recv().await {
+                        if state_temp == expected {
+                            return Some(received);
+                        }
+                    }
+                    None
+                })
+                .await;
+                match arrived {
+                    Ok(Some(received)) => {
+                        if sample > 0 {
+                            latency_us.record(received.duration_since(sent).as_micros() as u64);
+                        }
+                        break;
+                    }
+                    Ok(None) => panic!("bench observer stopped"),
+                    Err(_) if sample == 0 => continue,
+                    Err(_) => panic!("no controller state for reading {temp:.1}"),
+                }
+            }
+        }
+    };
+    tokio::select! {
+        () = run => {}
+        stopped = harness.stopped() => panic!("{stopped}"),
+    }
+
+    let summary = latency_us.snapshot().summary();
+    println!("{}", serde_json::to_string(&summary).unwrap());
+    assert_eq!(summary.count, u64::from(SAMPLES));
+}
@@ -0,0 +1,47 @@
+#![cfg(not(feature = "esp32"))]
+
+mod common;
+
+use std::time::Duration;
+
+use common::Harness;
+use rumqttc::{Event, Incoming, QoS};
+use thermostat_common::{ControllerStatePayload, DeciDegrees, TOPIC_CONTROLLER_STATE};
+
+#[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+async fn sensor_reading_reaches_controller_state() {
+    let mut harness = Harness::start(true);
+    let (observer, mut eventloop) = harness.client("thermostat-e2e-observer");
+    observer
+        .subscribe(TOPIC_CONTROLLER_STATE, QoS::AtMostOnce)
+        .await
+        .unwrap();
+
+    let observe = tokio::time::timeout(Duration::from_secs(20), async {
+        loop {
+            match eventloop.poll().await {
+                Ok(Event::Incoming(Incoming::Publish(message))) => {
+                    let Ok(state) =
+                        serde_json::from_slice::<ControllerStatePayload>(&message.payload)
+                    else {
+                        continue;
+                    };
+                    // The controller publishes 0 F until the first reading.
+                    if state.temp > DeciDegrees::default() {
+                        return state;
+                    }
+                }
+                Ok(_) => {}
+                Err(err) => panic!("observer mqtt error: {err}"),
+            }
+        }
+    });
+    let state = tokio::select! {
+        state = observe => state.expect("controller state with a sensor reading"),
+        stopped = harness.stopped() => panic!("{stopped}"),
+    };
+
+    // The simulated sensor reads 66.5-70.4 F across its two probes.
+    let expected = DeciDegrees::from_degrees(60)..DeciDegrees::from_degrees(75);
+    assert!(expected.contains(&state.temp), "temp {}", state.temp);
+}
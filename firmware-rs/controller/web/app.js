@@ -30,7 +30,7 @@ function $(id) { return document.getElementById(id); }
 
 var _pending = {};
 function api(path, options) {
-  var key = (options && options.method || 'GET') + ' ' + path;
+  var key = (options && options.method || 'GET') + ' ' + path + (options && options.body || '');
   if (_pending[key]) return _pending[key];
   var p = fetch(path, options || {}).then(function (r) {
     if (!r.ok) return r.json().catch(function () { return {}; }).then(function (b) {
@@ -42,6 +42,53 @@ function api(path, options) {
   return p;
 }
 
+/* Settings edits made within SETTINGS_BATCH_MS of each other are merged and
+   sent as one PATCH /api/settings, so the controller applies and saves once. */
+const SETTINGS_BATCH_MS = 600;
+var _settingsEdits = null;
+var _settingsWaiters = [];
+var _settingsTimer = null;
+
+function editSettings(fields) {
+  _settingsEdits = Object.assign(_settingsEdits || {}, fields);
+  clearTimeout(_settingsTimer);
+  _settingsTimer = setTimeout(flushSettings, SETTINGS_BATCH_MS);
+  showPendingSettings();
+  return new Promise(function (resolve, reject) {
+    _settingsWaiters.push({ resolve: resolve, reject: reject });
+  });
+}
+
+function flushSettings() {
+  var edits = _settingsEdits;
+  var waiters = _settingsWaiters;
+  _settingsEdits = null;
+  _settingsWaiters = [];
+  _settingsTimer = null;
+  api('/api/settings', {
+    method: 'PATCH',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify(edits),
+  }).then(function (s) {
+    updateStatus(s);
+    waiters.forEach(function (w) { w.resolve(s); });
+  }).catch(function (e) {
+    if (state.status) updateStatus(state.status);
+    waiters.forEach(function (w) { w.reject(e); });
+  });
+}
+
+function pendingSetting(key, fallback) {
+  return _settingsEdits && _settingsEdits[key] != null ? _settingsEdits[key] : fallback;
+}
+
+/* Show queued edits over the last status until the batch is sent */
+function showPendingSettings() {
+  if (!_settingsEdits) return;
+  if (_settingsEdits.targetTemp != null) $('target-temp').textContent = _settingsEdits.targetTemp.toFixed(0);
+  if (_settingsEdits.mode) applyMode(_settingsEdits.mode === 'OFF' ? 'OFF' : 'HEATING');
+}
+
 /* Debounce button taps (500ms lockout) */
 function guardBtn(el, fn) {
   var locked = false;
@@ -170,6 +217,7 @@ function updateStatus(s) {
 
   applyMode(mode === 'OFF' ? 'OFF' : 'HEATING');
   updateRings();
+  showPendingSettings();
 }
 
 function setDisconnected() {
@@ -290,6 +338,16 @@ async function refreshStatus() {
   }
 }
 
+/* Compact text form (one entry per line) is not capped by the JSON body limit */
+function scheduleToCompact(schedule) {
+  var lines = [schedule.enabled ? 'ENABLED' : 'DISABLED'];
+  schedule.entries.forEach(function (entry) {
+    lines.push(entry.day + ' ' + minutesToHHMM(entry.startMinutes) + ' ' +
+      entry.mode + ' ' + entry.targetTemp);
+  });
+  return lines.join('\n') + '\n';
+}
+
 async function refreshSchedule() {
   try {
     state.schedule = await api('/api/schedule');
@@ -334,22 +392,22 @@ function initStaticIpToggle() {
 /* ── Bind all controls ── */
 
 function bindControls() {
-  /* Target temp +/- */
-  guardBtn($('target-up'), function () {
-    var t = (state.status ? state.status.targetTemp : 70) + 1;
-    api('/api/target?value=' + t, { method: 'POST' }).then(updateStatus);
+  /* Target temp +/- and mode, batched with any other pending edits */
+  function reportError(e) { showToast(e.message, 'err'); }
+  $('target-up').addEventListener('click', function () {
+    var t = pendingSetting('targetTemp', state.status ? state.status.targetTemp : 70) + 1;
+    editSettings({ targetTemp: t }).catch(reportError);
   });
-  guardBtn($('target-down'), function () {
-    var t = (state.status ? state.status.targetTemp : 70) - 1;
-    api('/api/target?value=' + t, { method: 'POST' }).then(updateStatus);
+  $('target-down').addEventListener('click', function () {
+    var t = pendingSetting('targetTemp', state.status ? state.status.targetTemp : 70) - 1;
+    editSettings({ targetTemp: t }).catch(reportError);
   });
 
-  /* Mode */
   guardBtn($('mode-off'), function () {
-    api('/api/mode?value=OFF', { method: 'POST' }).then(updateStatus);
+    editSettings({ mode: 'OFF' }).catch(reportError);
   });
   guardBtn($('mode-heat'), function () {
-    api('/api/mode?value=HEAT', { method: 'POST' }).then(updateStatus);
+    editSettings({ mode: 'HEAT' }).catch(reportError);
   });
 
   /* IR + hold + safety commands */
@@ -374,22 +432,18 @@ function bindControls() {
 
   /* Hysteresis */
   guardBtn($('save-hysteresis'), function () {
-    api('/api/hysteresis?value=' + Number($('hysteresis').value), { method: 'POST' }).then(function (s) {
-      updateStatus(s); updateSettingsInputs(s);
+    editSettings({ hysteresis: Number($('hysteresis').value) }).then(function (s) {
+      updateSettingsInputs(s);
       showToast('Saved');
-    }).catch(function (e) {
-      showToast(e.message, 'err');
-    });
+    }).catch(reportError);
   });
 
   /* Offset */
   guardBtn($('save-offset'), function () {
-    api('/api/offset?value=' + Number($('offset').value), { method: 'POST' }).then(function (s) {
-      updateStatus(s); updateSettingsInputs(s);
+    editSettings({ fireplaceOffset: Number($('offset').value) }).then(function (s) {
+      updateSettingsInputs(s);
       showToast('Saved');
-    }).catch(function (e) {
-      showToast(e.message, 'err');
-    });
+    }).catch(reportError);
   });
 
   /* Schedule form */
@@ -412,10 +466,10 @@ function bindControls() {
   guardBtn($('schedule-save'), async function () {
     try {
       state.schedule.enabled = $('schedule-enabled').checked;
-      await api('/api/schedule', {
+      await api('/api/schedule/compact', {
         method: 'PUT',
-        headers: { 'content-type': 'application/json' },
-        body: JSON.stringify(state.schedule),
+        headers: { 'content-type': 'text/plain' },
+        body: scheduleToCompact(state.schedule),
       });
       await refreshSchedule();
       await refreshStatus();
@@ -0,0 +1,256 @@
+use std::{
+    net::SocketAddr,
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc, OnceLock,
+    },
+    time::{Duration, Instant},
+};
+
+use anyhow::Context;
+use axum::{
+    body::Bytes,
+    extract::{Path, State},
+    http::StatusCode,
+    response::IntoResponse,
+    routing::get,
+    Json, Router,
+};
+use rumqttc::{AsyncClient, Event, Incoming, MqttOptions, QoS};
+use serde::Serialize;
+use tokio::{net::TcpListener, sync::mpsc};
+use tracing::{info, warn};
+
+use thermostat_common::{
+    decode_fleet_message,
+    ingest::{shard_for, split_device_topic, FLEET_TOPIC_FILTERS},
+    DeviceSnapshot, FleetStore, FleetSummary,
+};
+
+// Per-worker queue depth. A message for a full queue is dropped and counted in
+// queueFull, so a slow worker never stalls MQTT polling and keepalive.
+const WORKER_QUEUE_DEPTH: usize = 4_096;
+
+#[derive(Clone)]
+struct AppState {
+    store: Arc<FleetStore>,
+    stats: Arc<IngestStats>,
+}
+
+#[derive(Debug, Default)]
+struct IngestStats {
+    received: AtomicU64,
+    applied: AtomicU64,
+    rejected: AtomicU64,
+    queue_full: AtomicU64,
+}
+
+#[derive(Debug, Serialize)]
+struct IngestStatsView {
+    received: u64,
+    applied: u64,
+    rejected: u64,
+    #[serde(rename = "queueFull")]
+    queue_full: u64,
+    workers: usize,
+}
+
+#[derive(Debug, Serialize)]
+struct FleetView {
+    summary: FleetSummary,
+    ingest: IngestStatsView,
+}
+
+#[derive(Debug, Serialize)]
+struct DeviceView {
+    id: String,
+    #[serde(flatten)]
+    snapshot: DeviceSnapshot,
+}
+
+#[derive(Debug, Serialize)]
+struct ErrorBody {
+    error: String,
+}
+
+#[tokio::main]
+async fn main() -> anyhow::Result<()> {
+    tracing_subscriber::fmt()
+        .with_env_filter(tracing_subscriber::EnvFilter::from_default_env())
+        .init();
+
+    let workers = std::env::var("FLEET_WORKERS")
+        .ok()
+        .and_then(|value| value.parse::<usize>().ok())
+        .filter(|&workers| workers > 0)
+        .unwrap_or_else(|| std::thread::available_parallelism().map_or(4, |n| n.get()));
+
+    let mqtt_host = std::env::var("MQTT_HOST").unwrap_or_else(|_| "127.0.0.1".to_string());
+    let mqtt_port = std::env::var("MQTT_PORT")
+        .ok()
+        .and_then(|value| value.parse::<u16>().ok())
+        .unwrap_or(1883);
+
+    let mut mqtt_options = MqttOptions::new("thermostat-fleet-ingest", mqtt_host, mqtt_port);
+    if let Ok(user) = std::env::var("MQTT_USER") {
+        let pass = std::env::var("MQTT_PASS").unwrap_or_default();
+        mqtt_options.set_credentials(user, pass);
+    }
+    mqtt_options.set_keep_alive(Duration::from_secs(30));
+
+    let (mqtt, eventloop) = AsyncClient::new(mqtt_options, 64);
+
+    let app_state = AppState {
+        store: Arc::new(FleetStore::new(workers)),
+        stats: Arc::new(IngestStats::default()),
+    };
+
+    let queues = (0..workers)
+        .map(|_| {
+            let (tx, rx) = mpsc::channel(WORKER_QUEUE_DEPTH);
+            spawn_worker(app_state.clone(), rx);
+            tx
+        })
+        .collect();
+    spawn_mqtt_loop(app_state.clone(), mqtt, eventloop, queues);
+
+    let app = Router::new()
+        .route("/api/fleet", get(handle_get_fleet))
+        .route("/api/fleet/devices", get(handle_get_devices))
+        // Zone device ids carry their controller prefix, e.g. thermostat/zones/den.
+        .route("/api/fleet/devices/{*id}", get(handle_get_device))
+        .with_state(app_state);
+
+    let port = std::env::var("FLEET_HTTP_PORT")
+        .ok()
+        .and_then(|value| value.parse::<u16>().ok())
+        .unwrap_or(8090);
+    let addr: SocketAddr = format!("0.0.0.0:{port}").parse().unwrap();
+    let listener = TcpListener::bind(addr)
+        .await
+        .with_context(|| format!("failed to bind fleet server at {addr}"))?;
+
+    info!("fleet ingest listening on http://{addr} with {workers} workers");
+    axum::serve(listener, app).await?;
+    Ok(())
+}
+
+// The event loop only routes: it reads the device id off the topic and hands
+// the raw payload to the worker that owns that device, so per-device order is
+// kept and decoding runs in parallel.
+fn spawn_mqtt_loop(
+    app_state: AppState,
+    mqtt: AsyncClient,
+    mut eventloop: rumqttc::EventLoop,
+    queues: Vec<mpsc::Sender<(String, Bytes)>>,
+) {
+    tokio::spawn(async move {
+        loop {
+            match eventloop.poll().await {
+                Ok(Event::Incoming(Incoming::ConnAck(_))) => {
+                    info!("mqtt connected");
+                    // Subscribing waits on the request channel the event loop
+                    // drains, so it runs beside the loop rather than in it.
+                    let mqtt = mqtt.clone();
+                    tokio::spawn(async move {
+                        for topic in FLEET_TOPIC_FILTERS {
+                            if let Err(err) = mqtt.subscribe(topic, QoS::AtMostOnce).await {
+                                warn!("failed to subscribe to {topic}: {err}");
+                            }
+                        }
+                    });
+                }
+                Ok(Event::Incoming(Incoming::Publish(message))) => {
+                    app_state.stats.received.fetch_add(1, Ordering::Relaxed);
+                    let Some((device_id, _)) = split_device_topic(&message.topic) else {
+                        app_state.stats.rejected.fetch_add(1, Ordering::Relaxed);
+                        continue;
+                    };
+                    let queue = &queues[shard_for(device_id, queues.len())];
+                    let item = (message.topic, message.payload);
+                    match queue.try_send(item) {
+                        Ok(()) => {}
+                        Err(mpsc::error::TrySendError::Full(_)) => {
+                            app_state.stats.queue_full.fetch_add(1, Ordering::Relaxed);
+                        }
+                        Err(mpsc::error::TrySendError::Closed(_)) => {
+                            warn!("fleet worker stopped");
+                        }
+                    }
+                }
+                Ok(_) => {}
+                Err(err) => {
+                    warn!("mqtt poll error: {err}");
+                    tokio::time::sleep(Duration::from_secs(2)).await;
+                }
+            }
+        }
+    });
+}
+
+fn spawn_worker(app_state: AppState, mut queue: mpsc::Receiver<(String, Bytes)>) {
+    tokio::spawn(async move {
+        while let Some((topic, payload)) = queue.recv().await {
+            match decode_fleet_message(&topic, &payload) {
+                Ok((device_id, update)) => {
+                    app_state.store.apply(device_id, update, monotonic_ms());
+                    app_state.stats.applied.fetch_add(1, Ordering::Relaxed);
+                }
+                Err(err) => {
+                    app_state.stats.rejected.fetch_add(1, Ordering::Relaxed);
+                    warn!("dropping fleet message on {topic}: {err}");
+                }
+            }
+        }
+    });
+}
+
+async fn handle_get_fleet(State(state): State<AppState>) -> impl IntoResponse {
+    let stats = &state.stats;
+    Json(FleetView {
+        summary: state.store.summary(),
+        ingest: IngestStatsView {
+            received: stats.received.load(Ordering::Relaxed),
+            applied: stats.applied.load(Ordering::Relaxed),
+            rejected: stats.rejected.load(Ordering::Relaxed),
+            queue_full: stats.queue_full.load(Ordering::Relaxed),
+            workers: state.store.shard_count(),
+        },
+    })
+}
+
+async fn handle_get_devices(State(state): State<AppState>) -> impl IntoResponse {
+    let devices: Vec<DeviceView> = state
+        .store
+        .devices()
+        .into_iter()
+        .map(|(id, snapshot)| DeviceView { id, snapshot })
+        .collect();
+    Json(devices)
+}
+
+async fn handle_get_device(
+    State(state): State<AppState>,
+    Path(id): Path<String>,
+) -> impl IntoResponse {
+    match state.store.get(&id) {
+        Some(snapshot) => Json(DeviceView { id, snapshot }).into_response(),
+        None => (
+            StatusCode::NOT_FOUND,
+            Json(ErrorBody {
+                error: "Unknown device".to_string(),
+            }),
+        )
+            .into_response(),
+    }
+}
+
+fn monotonic_ms() -> u64 {
+    static START: OnceLock<Instant> = OnceLock::new();
+    START
+        .get_or_init(Instant::now)
+        .elapsed()
+        .as_millis()
+        .try_into()
+        .unwrap_or(u64::MAX)
+}
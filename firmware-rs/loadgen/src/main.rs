@@ -0,0 +1,424 @@
+use std::{
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc,
+    },
+    time::Duration,
+};
+
+use anyhow::Context;
+use rumqttc::{AsyncClient, Event, EventLoop, Incoming, MqttOptions, QoS};
+use serde::Serialize;
+use tokio::{
+    sync::oneshot,
+    time::{Instant, MissedTickBehavior},
+};
+use tracing::{info, warn};
+
+use thermostat_common::{
+    loadgen::{
+        controller_payload, decode_seq, device_id, parse_device_id, sensor_payload, LoadKind,
+        PayloadMix, SendLog, TopicLayout,
+    },
+    Histogram, HistogramSummary,
+};
+
+// A small request queue per virtual client, so a slow broker shows up as
+// time blocked in publish() rather than as an ever-growing client buffer.
+const CLIENT_QUEUE_DEPTH: usize = 16;
+// The observer receives every message, so it gets a deep queue of its own.
+const OBSERVER_QUEUE_DEPTH: usize = 1_024;
+// Publishes that wait longer than this for queue space count as stalled.
+const STALL_THRESHOLD_US: u64 = 1_000;
+// Time after the last publish to let in-flight messages arrive.
+const DRAIN: Duration = Duration::from_secs(3);
+
+#[derive(Debug, Clone)]
+struct Config {
+    mqtt_host: String,
+    mqtt_port: u16,
+    mqtt_credentials: Option<(String, String)>,
+    prefix: String,
+    sensors: usize,
+    controllers: usize,
+    sensor_hz: f64,
+    controller_hz: f64,
+    payload: PayloadMix,
+    layout: TopicLayout,
+    qos: QoS,
+    duration: Duration,
+}
+
+impl Config {
+    fn from_env() -> anyhow::Result<Self> {
+        fn parsed<T: std::str::FromStr>(name: &str, default: T) -> anyhow::Result<T> {
+            match std::env::var(name) {
+                Ok(value) => value
+                    .trim()
+                    .parse()
+                    .ok()
+                    .with_context(|| format!("invalid {name}: {value}")),
+                Err(_) => Ok(default),
+            }
+        }
+
+        let payload = std::env::var("LOADGEN_PAYLOAD").unwrap_or_else(|_| "mixed".to_string());
+        let layout = std::env::var("LOADGEN_LAYOUT").unwrap_or_else(|_| "fleet".to_string());
+        let qos = match parsed("LOADGEN_QOS", 0_u8)? {
+            0 => QoS::AtMostOnce,
+            1 => QoS::AtLeastOnce,
+            2 => QoS::ExactlyOnce,
+            other => anyhow::bail!("invalid LOADGEN_QOS: {other}"),
+        };
+
+        let config = Self {
+            mqtt_host: std::env::var("MQTT_HOST").unwrap_or_else(|_| "127.0.0.1".to_string()),
+            mqtt_port: parsed("MQTT_PORT", 1883)?,
+            mqtt_credentials: std::env::var("MQTT_USER")
+                .ok()
+                .map(|user| (user, std::env::var("MQTT_PASS").unwrap_or_default())),
+            prefix: std::env::var("LOADGEN_PREFIX").unwrap_or_else(|_| "lg".to_string()),
+            sensors: parsed("LOADGEN_SENSORS", 100)?,
+            controllers: parsed("LOADGEN_CONTROLLERS", 100)?,
+            sensor_hz: parsed("LOADGEN_SENSOR_HZ", 1.0)?,
+            controller_hz: parsed("LOADGEN_CONTROLLER_HZ", 0.2)?,
+            payload: PayloadMix::parse(&payload)
+                .with_context(|| format!("invalid LOADGEN_PAYLOAD: {payload}"))?,
+            layout: TopicLayout::parse(&layout)
+                .with_context(|| format!("invalid LOADGEN_LAYOUT: {layout}"))?,
+            qos,
+            duration: Duration::from_secs(parsed("LOADGEN_DURATION_S", 60)?),
+        };
+        anyhow::ensure!(
+            config.sensor_hz > 0.0 && config.controller_hz > 0.0,
+            "publish rates must be positive"
+        );
+        Ok(config)
+    }
+
+    fn mqtt_options(&self, client_id: &str) -> MqttOptions {
+        let mut options = MqttOptions::new(client_id, &self.mqtt_host, self.mqtt_port);
+        if let Some((user, pass)) = &self.mqtt_credentials {
+            options.set_credentials(user, pass);
+        }
+        options.set_keep_alive(Duration::from_secs(30));
+        options
+    }
+}
+
+struct Run {
+    config: Config,
+    started: Instant,
+    sensor_logs: Vec<SendLog>,
+    controller_logs: Vec<SendLog>,
+    stats: LoadStats,
+}
+
+impl Run {
+    fn elapsed_us(&self) -> u64 {
+        self.started
+            .elapsed()
+            .as_micros()
+            .try_into()
+            .unwrap_or(u64::MAX)
+    }
+}
+
+#[derive(Default)]
+struct LoadStats {
+    sent: AtomicU64,
+    received: AtomicU64,
+    acked: AtomicU64,
+    unmatched: AtomicU64,
+    stalled: AtomicU64,
+    publish_errors: AtomicU64,
+    connection_errors: AtomicU64,
+    sensor_latency_us: Histogram,
+    controller_latency_us: Histogram,
+    publish_wait_us: Histogram,
+}
+
+#[derive(Debug, Serialize)]
+struct LoadReport {
+    sensors: usize,
+    controllers: usize,
+    #[serde(rename = "offeredRate")]
+    offered_rate: f64,
+    #[serde(rename = "durationS")]
+    duration_s: f64,
+    sent: u64,
+    received: u64,
+    lost: u64,
+    acked: u64,
+    unmatched: u64,
+    #[serde(rename = "sendRate")]
+    send_rate: f64,
+    #[serde(rename = "receiveRate")]
+    receive_rate: f64,
+    #[serde(rename = "stalledPublishes")]
+    stalled_publishes: u64,
+    #[serde(rename = "publishErrors")]
+    publish_errors: u64,
+    #[serde(rename = "connectionErrors")]
+    connection_errors: u64,
+    #[serde(rename = "sensorLatencyUs")]
+    sensor_latency_us: HistogramSummary,
+    #[serde(rename = "controllerLatencyUs")]
+    controller_latency_us: HistogramSummary,
+    #[serde(rename = "publishWaitUs")]
+    publish_wait_us: HistogramSummary,
+}
+
+#[tokio::main]
+async fn main() -> anyhow::Result<()> {
+    tracing_subscriber::fmt()
+        .with_env_filter(tracing_subscriber::EnvFilter::from_default_env())
+        .with_writer(std::io::stderr)
+        .init();
+
+    let config = Config::from_env()?;
+    let run = Arc::new(Run {
+        sensor_logs: (0..config.sensors).map(|_| SendLog::new()).collect(),
+        controller_logs: (0..config.controllers).map(|_| SendLog::new()).collect(),
+        started: Instant::now(),
+        stats: LoadStats::default(),
+        config,
+    });
+
+    let (subscribed_tx, subscribed_rx) = oneshot::channel();
+    spawn_observer(run.clone(), subscribed_tx);
+    tokio::time::timeout(Duration::from_secs(10), subscribed_rx)
+        .await
+        .context("observer did not subscribe within 10 s")?
+        .context("observer stopped")?;
+
+    let config = &run.config;
+    info!(
+        "publishing from {} sensors at {} Hz and {} controllers at {} Hz for {:?}",
+        config.sensors, config.sensor_hz, config.controllers, config.controller_hz, config.duration
+    );
+
+    let deadline = Instant::now() + config.duration;
+    let mut publishers = Vec::new();
+    for index in 0..config.sensors {
+        publishers.push(spawn_client(run.clone(), LoadKind::Sensor, index, deadline));
+    }
+    for index in 0..config.controllers {
+        publishers.push(spawn_client(
+            run.clone(),
+            LoadKind::Controller,
+            index,
+            deadline,
+        ));
+    }
+    let progress = spawn_progress(run.clone());
+
+    for publisher in publishers {
+        let _ = publisher.await;
+    }
+    tokio::time::sleep(DRAIN).await;
+    progress.abort();
+
+    let report = build_report(&run);
+    println!("{}", serde_json::to_string_pretty(&report)?);
+    Ok(())
+}
+
+// One subscriber sees every virtual device's messages and matches each to
+// its send time through the sequence number carried in the payload.
+fn spawn_observer(run: Arc<Run>, subscribed: oneshot::Sender<()>) {
+    let client_id = format!("{}-observer", run.config.prefix);
+    let (mqtt, mut eventloop) =
+        AsyncClient::new(run.config.mqtt_options(&client_id), OBSERVER_QUEUE_DEPTH);
+    let mut subscribed = Some(subscribed);
+
+    tokio::spawn(async move {
+        let filters = run.config.layout.filters();
+        loop {
+            match eventloop.poll().await {
+                Ok(Event::Incoming(Incoming::ConnAck(_))) => {
+                    for filter in &filters {
+                        if let Err(err) = mqtt.subscribe(filter, run.config.qos).await {
+                            warn!("failed to subscribe to {filter}: {err}");
+                        }
+                    }
+                }
+                Ok(Event::Incoming(Incoming::SubAck(_))) => {
+                    if let Some(subscribed) = subscribed.take() {
+                        let _ = subscribed.send(());
+                    }
+                }
+                Ok(Event::Incoming(Incoming::Publish(message))) => {
+                    let received_us = run.elapsed_us();
+                    if !record_arrival(&run, &message.topic, &message.payload, received_us) {
+                        run.stats.unmatched.fetch_add(1, Ordering::Relaxed);
+                    }
+                }
+                Ok(_) => {}
+                Err(err) => {
+                    run.stats.connection_errors.fetch_add(1, Ordering::Relaxed);
+                    warn!("observer mqtt error: {err}");
+                    tokio::time::sleep(Duration::from_secs(1)).await;
+                }
+            }
+        }
+    });
+}
+
+fn record_arrival(run: &Run, topic: &str, payload: &[u8], received_us: u64) -> bool {
+    let Some((device_id, binary)) = run.config.layout.split(topic) else {
+        return false;
+    };
+    let Some((kind, index)) = parse_device_id(&run.config.prefix, device_id) else {
+        return false;
+    };
+    let (logs, histogram) = match kind {
+        LoadKind::Sensor => (&run.sensor_logs, &run.stats.sensor_latency_us),
+        LoadKind::Controller => (&run.controller_logs, &run.stats.controller_latency_us),
+    };
+    let latency = logs.get(index).zip(decode_seq(kind, binary, payload));
+    let Some(latency_us) = latency.and_then(|(log, seq)| log.latency_us(seq, received_us)) else {
+        return false;
+    };
+    run.stats.received.fetch_add(1, Ordering::Relaxed);
+    histogram.record(latency_us);
+    true
+}
+
+// Every virtual device is its own MQTT connection with its own event loop.
+// Start times are spread across one period so the offered load is smooth
+// instead of arriving in synchronized bursts.
+fn spawn_client(
+    run: Arc<Run>,
+    kind: LoadKind,
+    index: usize,
+    deadline: Instant,
+) -> tokio::task::JoinHandle<()> {
+    let config = &run.config;
+    let id = device_id(&config.prefix, kind, index);
+    let (count, hz) = match kind {
+        LoadKind::Sensor => (config.sensors, config.sensor_hz),
+        LoadKind::Controller => (config.controllers, config.controller_hz),
+    };
+    let period = Duration::from_secs_f64(1.0 / hz);
+    let phase = period.mul_f64(index as f64 / count.max(1) as f64);
+    let (mqtt, eventloop) = AsyncClient::new(config.mqtt_options(&id), CLIENT_QUEUE_DEPTH);
+    let driver = tokio::spawn(drive_client(run.clone(), eventloop));
+
+    tokio::spawn(async move {
+        let config = &run.config;
+        let mut interval = tokio::time::interval_at(Instant::now() + phase, period);
+        interval.set_missed_tick_behavior(MissedTickBehavior::Delay);
+        let mut payload = Vec::new();
+        let mut seq = 0_u64;
+
+        loop {
+            interval.tick().await;
+            if Instant::now() >= deadline {
+                break;
+            }
+            seq += 1;
+            let (topic, body) = match kind {
+                LoadKind::Sensor => (
+                    config.layout.sensor_topic(&id),
+                    sensor_payload(seq).into_bytes(),
+                ),
+                LoadKind::Controller => {
+                    let binary = config.payload.binary_for(seq);
+                    controller_payload(seq, binary, &mut payload);
+                    (config.layout.controller_topic(&id, binary), payload.clone())
+                }
+            };
+
+            let log = match kind {
+                LoadKind::Sensor => &run.sensor_logs[index],
+                LoadKind::Controller => &run.controller_logs[index],
+            };
+            let sent_us = run.elapsed_us();
+            log.record(seq, sent_us);
+            // publish() only waits when the request queue is full, i.e. when
+            // the connection cannot keep up with the offered rate.
+            if let Err(err) = mqtt.publish(topic, config.qos, false, body).await {
+                run.stats.publish_errors.fetch_add(1, Ordering::Relaxed);
+                warn!("{id}: publish failed: {err}");
+                continue;
+            }
+            let wait_us = run.elapsed_us().saturating_sub(sent_us);
+            run.stats.publish_wait_us.record(wait_us);
+            if wait_us > STALL_THRESHOLD_US {
+                run.stats.stalled.fetch_add(1, Ordering::Relaxed);
+            }
+            run.stats.sent.fetch_add(1, Ordering::Relaxed);
+        }
+
+        let _ = mqtt.disconnect().await;
+        // Give the event loop a moment to flush the queue and disconnect.
+        let _ = tokio::time::timeout(DRAIN, driver).await;
+    })
+}
+
+async fn drive_client(run: Arc<Run>, mut eventloop: EventLoop) {
+    loop {
+        match eventloop.poll().await {
+            Ok(Event::Incoming(Incoming::PubAck(_) | Incoming::PubComp(_))) => {
+                run.stats.acked.fetch_add(1, Ordering::Relaxed);
+            }
+            Ok(Event::Outgoing(rumqttc::Outgoing::Disconnect)) => break,
+            Ok(_) => {}
+            Err(err) => {
+                run.stats.connection_errors.fetch_add(1, Ordering::Relaxed);
+                warn!("client mqtt error: {err}");
+                tokio::time::sleep(Duration::from_secs(1)).await;
+            }
+        }
+    }
+}
+
+fn spawn_progress(run: Arc<Run>) -> tokio::task::JoinHandle<()> {
+    tokio::spawn(async move {
+        let mut interval = tokio::time::interval(Duration::from_secs(1));
+        interval.tick().await;
+        let (mut last_sent, mut last_received) = (0, 0);
+        loop {
+            interval.tick().await;
+            let sent = run.stats.sent.load(Ordering::Relaxed);
+            let received = run.stats.received.load(Ordering::Relaxed);
+            info!(
+                "sent {}/s, received {}/s, in flight {}, stalled publishes {}",
+                sent - last_sent,
+                received - last_received,
+                sent.saturating_sub(received),
+                run.stats.stalled.load(Ordering::Relaxed)
+            );
+            (last_sent, last_received) = (sent, received);
+        }
+    })
+}
+
+fn build_report(run: &Run) -> LoadReport {
+    let config = &run.config;
+    let stats = &run.stats;
+    let seconds = config.duration.as_secs_f64().max(f64::EPSILON);
+    let sent = stats.sent.load(Ordering::Relaxed);
+    let received = stats.received.load(Ordering::Relaxed);
+    LoadReport {
+        sensors: config.sensors,
+        controllers: config.controllers,
+        offered_rate: config.sensors as f64 * config.sensor_hz
+            + config.controllers as f64 * config.controller_hz,
+        duration_s: seconds,
+        sent,
+        received,
+        lost: sent.saturating_sub(received),
+        acked: stats.acked.load(Ordering::Relaxed),
+        unmatched: stats.unmatched.load(Ordering::Relaxed),
+        send_rate: sent as f64 / seconds,
+        receive_rate: received as f64 / seconds,
+        stalled_publishes: stats.stalled.load(Ordering::Relaxed),
+        publish_errors: stats.publish_errors.load(Ordering::Relaxed),
+        connection_errors: stats.connection_errors.load(Ordering::Relaxed),
+        sensor_latency_us: stats.sensor_latency_us.snapshot().summary(),
+        controller_latency_us: stats.controller_latency_us.snapshot().summary(),
+        publish_wait_us: stats.publish_wait_us.snapshot().summary(),
+    }
+}
@@ -1,8 +1,8 @@
 use std::{
     net::Ipv4Addr,
     sync::{
-        atomic::{AtomicBool, Ordering},
-        Arc, Mutex,
+        atomic::{AtomicBool, AtomicU32, Ordering},
+        Arc, Mutex, Once, OnceLock,
     },
     thread,
     time::{Duration, Instant},
@@ -14,7 +14,7 @@ use ds18b20::{Ds18b20, Resolution};
 use embedded_svc::{
     http::{client::Client as HttpClient, Headers, Method},
     io::{Read, Write},
-    mqtt::client::{EventPayload, QoS},
+    mqtt::client::{Details, EventPayload, QoS},
     wifi::{AccessPointConfiguration, AuthMethod, ClientConfiguration, Configuration},
 };
 use esp_idf_hal::{
@@ -45,12 +45,18 @@ use serde::{Deserialize, Serialize};
 use sha2::{Digest, Sha256};
 
 use thermostat_common::{
-    config::NetworkConfig, RuntimeConfig, TOPIC_SENSOR_HUMIDITY, TOPIC_SENSOR_STATUS,
+    acquisition::celsius_to_fahrenheit, config::NetworkConfig, memory_report, register_thread,
+    sensor_probe_temperature_topic, trace::wall_clock_ms, Acquisition, AcquisitionStats,
+    BurstRequest, DeciDegrees, EspMemory, ProbeAddress, ProbeResolution, PublishGate,
+    ReadingBuffer, RuntimeConfig, SampleTrace, SensorBus, SensorPolicyUpdate, SensorPublishPolicy,
+    SensorSample, Subsystem, SubsystemScope, TOPIC_CMD_SENSOR_BURST, TOPIC_CMD_SENSOR_POLICY,
+    TOPIC_SENSOR_HISTORY, TOPIC_SENSOR_HUMIDITY, TOPIC_SENSOR_POLICY, TOPIC_SENSOR_STATUS,
     TOPIC_SENSOR_TEMP,
 };
 
 const NVS_NAMESPACE: &str = "thermostat";
 const NVS_RUNTIME_KEY: &str = "runtime_json";
+const NVS_PROBES_KEY: &str = "ds18_probes";
 
 const DS18B20_PIN: i32 = 4;
 const DHT11_PIN: i32 = 16;
@@ -64,6 +70,14 @@ const WIFI_RESTART_GRACE_MS: u64 = 300_000;
 const WIFI_RECONNECT_INTERVAL_MS: u64 = 30_000;
 const WIFI_CONNECT_ATTEMPTS: u32 = 5;
 const WIFI_RETRY_DELAY_MS: u64 = 3_000;
+const MAX_MQTT_PAYLOAD_BYTES: usize = 512;
+// Task stacks, reported with their high-water marks at
+// /api/diagnostics/memory. The main task, which runs acquisition, is sized by
+// CONFIG_ESP_MAIN_TASK_STACK_SIZE in sdkconfig.defaults.
+const MAIN_TASK_STACK_SIZE: usize = 24 * 1024;
+const HTTP_STACK_SIZE: usize = 16 * 1024;
+const MQTT_POLL_STACK_SIZE: usize = 8 * 1024;
+const OTA_STACK_SIZE: usize = 16 * 1024;
 
 const SENSOR_PORTAL_HTML: &str = r#"<!doctype html>
 <html lang="en">
@@ -219,14 +233,10 @@ enum WifiStartup {
     Provisioning(EspWifi<'static>),
 }
 
-struct SensorReadings {
-    temperature_f: Option<f32>,
-    humidity: Option<f32>,
-}
-
-struct SensorSuite {
+// One-wire and DHT11 drivers behind the common `SensorBus`, so the pipelined
+// acquisition cycle is shared with the host build and its tests.
+struct EspSensorBus {
     one_wire: OneWire<PinDriver<'static, AnyIOPin, InputOutput>>,
-    ds18_address: Option<Address>,
     dht_pin: PinDriver<'static, AnyIOPin, InputOutput>,
     delay: Ets,
 }
@@ -351,7 +361,7 @@ struct OtaStatusResponse {
     update_slot: Option<String>,
 }
 
-impl SensorSuite {
+impl EspSensorBus {
     fn new(ds18_pin: AnyIOPin, dht_pin: AnyIOPin) -> anyhow::Result<Self> {
         let mut one_wire_pin = PinDriver::input_output_od(ds18_pin)?;
         one_wire_pin.set_pull(Pull::Up)?;
@@ -364,34 +374,42 @@ impl SensorSuite {
         let one_wire = OneWire::new(one_wire_pin)
             .map_err(|err| anyhow!("failed to initialize one-wire bus: {err:?}"))?;
 
-        let mut suite = Self {
+        Ok(Self {
             one_wire,
-            ds18_address: None,
             dht_pin,
             delay: Ets,
-        };
+        })
+    }
 
-        suite.refresh_ds18_address();
-        Ok(suite)
+    fn probe(probe: ProbeAddress) -> anyhow::Result<Ds18b20> {
+        Ds18b20::new::<core::convert::Infallible>(Address(probe.0))
+            .map_err(|err| anyhow!("invalid DS18B20 address {probe}: {err:?}"))
     }
+}
 
-    fn read(&mut self) -> SensorReadings {
-        SensorReadings {
-            temperature_f: self.read_temperature_f(),
-            humidity: self.read_humidity(),
-        }
+impl SensorBus for EspSensorBus {
+    type Error = anyhow::Error;
+
+    fn now_ms(&mut self) -> u64 {
+        monotonic_ms()
     }
 
-    fn refresh_ds18_address(&mut self) {
-        let mut first_ds18: Option<Address> = None;
+    fn delay_ms(&mut self, ms: u64) {
+        // Sleep rather than busy-wait so the MQTT and HTTP tasks can run
+        // while the probe converts.
+        thread::sleep(Duration::from_millis(ms));
+    }
+
+    fn scan_probes(&mut self) -> anyhow::Result<Vec<ProbeAddress>> {
+        let mut probes = Vec::new();
         let mut device_count = 0_u32;
 
         for addr in self.one_wire.devices(false, &mut self.delay) {
             match addr {
                 Ok(address) => {
                     device_count = device_count.saturating_add(1);
-                    if first_ds18.is_none() && address.family_code() == ds18b20::FAMILY_CODE {
-                        first_ds18 = Some(address);
+                    if address.family_code() == ds18b20::FAMILY_CODE {
+                        probes.push(ProbeAddress(address.0));
                     }
                 }
                 Err(err) => {
@@ -401,12 +419,14 @@ impl SensorSuite {
             }
         }
 
-        self.ds18_address = first_ds18;
-
-        if let Some(address) = self.ds18_address {
+        if !probes.is_empty() {
+            for probe in &probes {
+                info!("DS18B20 {probe} ready on GPIO{DS18B20_PIN}");
+            }
             info!(
-                "DS18B20 ready on GPIO{} ({} one-wire device(s), using {:?})",
-                DS18B20_PIN, device_count, address
+                "{} DS18B20 probe(s) among {} one-wire device(s)",
+                probes.len(),
+                device_count
             );
         } else {
             warn!(
@@ -414,128 +434,71 @@ impl SensorSuite {
                 DS18B20_PIN, device_count
             );
         }
+        Ok(probes)
     }
 
-    fn read_temperature_f(&mut self) -> Option<f32> {
-        for attempt in 0..3 {
-            if self.ds18_address.is_none() {
-                self.refresh_ds18_address();
-            }
-
-            let address = match self.ds18_address {
-                Some(addr) => addr,
-                None => {
-                    if attempt < 2 {
-                        warn!("DS18B20 read attempt {} failed (no address), retrying...", attempt + 1);
-                        thread::sleep(Duration::from_millis(500));
-                        continue;
-                    } else {
-                        log::error!("DS18B20 read failed after 3 attempts (no address)");
-                        return None;
-                    }
-                }
-            };
-
-            let sensor = match Ds18b20::new::<core::convert::Infallible>(address) {
-                Ok(sensor) => sensor,
-                Err(err) => {
-                    warn!("invalid DS18B20 address {:?}: {err:?}", address);
-                    self.ds18_address = None;
-                    if attempt < 2 {
-                        warn!("DS18B20 read attempt {} failed, retrying...", attempt + 1);
-                        thread::sleep(Duration::from_millis(500));
-                        continue;
-                    } else {
-                        log::error!("DS18B20 read failed after 3 attempts");
-                        return None;
-                    }
-                }
-            };
-
-            if let Err(err) =
-                ds18b20::start_simultaneous_temp_measurement(&mut self.one_wire, &mut self.delay)
-            {
-                warn!("failed to start DS18B20 conversion: {err:?}");
-                self.ds18_address = None;
-                if attempt < 2 {
-                    warn!("DS18B20 read attempt {} failed, retrying...", attempt + 1);
-                    thread::sleep(Duration::from_millis(500));
-                    continue;
-                } else {
-                    log::error!("DS18B20 read failed after 3 attempts");
-                    return None;
-                }
-            }
-
-            Resolution::Bits12.delay_for_measurement_time(&mut self.delay);
-
-            match sensor.read_data(&mut self.one_wire, &mut self.delay) {
-                Ok(data) => {
-                    let temp_f = celsius_to_fahrenheit(data.temperature);
-                    info!(
-                        "[DS18B20] Temperature: {:.1}°F ({:.1}°C)",
-                        temp_f, data.temperature
-                    );
-                    return Some(temp_f);
-                }
-                Err(err) => {
-                    warn!("failed to read DS18B20 data: {err:?}");
-                    self.ds18_address = None;
-                    if attempt < 2 {
-                        warn!("DS18B20 read attempt {} failed, retrying...", attempt + 1);
-                        thread::sleep(Duration::from_millis(500));
-                    } else {
-                        log::error!("DS18B20 read failed after 3 attempts");
-                    }
-                }
-            }
-        }
-
-        None
+    fn set_resolution(
+        &mut self,
+        probe: ProbeAddress,
+        resolution: ProbeResolution,
+    ) -> anyhow::Result<()> {
+        let sensor = Self::probe(probe)?;
+        let bits = resolution.bits();
+        let resolution = match resolution {
+            ProbeResolution::Bits9 => Resolution::Bits9,
+            ProbeResolution::Bits10 => Resolution::Bits10,
+            ProbeResolution::Bits11 => Resolution::Bits11,
+            ProbeResolution::Bits12 => Resolution::Bits12,
+        };
+        // Alarm thresholds are unused; keep the power-on defaults.
+        sensor
+            .set_config(-55, 125, resolution, &mut self.one_wire, &mut self.delay)
+            .map_err(|err| anyhow!("{err:?}"))?;
+        info!("DS18B20 {probe} resolution set to {bits} bits");
+        Ok(())
     }
 
-    fn read_humidity(&mut self) -> Option<f32> {
-        for attempt in 0..3 {
-            if let Err(err) = self.dht_pin.set_high() {
-                warn!("failed to set DHT11 line high before read: {err:?}");
-                if attempt < 2 {
-                    warn!("DHT11 read attempt {} failed, retrying...", attempt + 1);
-                    thread::sleep(Duration::from_millis(500));
-                    continue;
-                } else {
-                    log::error!("DHT11 read failed after 3 attempts");
-                    return None;
-                }
-            }
+    fn start_conversion(&mut self) -> anyhow::Result<()> {
+        ds18b20::start_simultaneous_temp_measurement(&mut self.one_wire, &mut self.delay)
+            .map_err(|err| anyhow!("{err:?}"))
+    }
 
-            match dht11::blocking::read(&mut self.delay, &mut self.dht_pin) {
-                Ok(reading) => {
-                    let humidity = reading.relative_humidity as f32;
-                    info!("[DHT11] Humidity: {:.1}%", humidity);
-                    return Some(humidity);
-                }
-                Err(err) => {
-                    warn!(
-                        "failed to read DHT11 humidity on GPIO{}: {err:?}",
-                        DHT11_PIN
-                    );
-                    if attempt < 2 {
-                        warn!("DHT11 read attempt {} failed, retrying...", attempt + 1);
-                        thread::sleep(Duration::from_millis(500));
-                    } else {
-                        log::error!("DHT11 read failed after 3 attempts");
-                    }
-                }
-            }
-        }
+    fn read_temperature_c(&mut self, probe: ProbeAddress) -> anyhow::Result<f32> {
+        let sensor = Self::probe(probe)?;
+        let data = sensor
+            .read_data(&mut self.one_wire, &mut self.delay)
+            .map_err(|err| anyhow!("{err:?}"))?;
+        info!(
+            "[DS18B20 {}] Temperature: {:.1}°F ({:.1}°C)",
+            probe,
+            celsius_to_fahrenheit(data.temperature),
+            data.temperature
+        );
+        Ok(data.temperature)
+    }
 
-        None
+    fn read_humidity(&mut self) -> anyhow::Result<f32> {
+        self.dht_pin
+            .set_high()
+            .map_err(|err| anyhow!("failed to set DHT11 line high: {err:?}"))?;
+        let reading = dht11::blocking::read(&mut self.delay, &mut self.dht_pin)
+            .map_err(|err| anyhow!("GPIO{DHT11_PIN}: {err:?}"))?;
+        let humidity = reading.relative_humidity as f32;
+        info!("[DHT11] Humidity: {:.1}%", humidity);
+        Ok(humidity)
     }
 }
 
 pub fn run() -> anyhow::Result<()> {
     esp_idf_svc::sys::link_patches();
     EspLogger::initialize_default();
+    register_thread(
+        &EspMemory,
+        "main",
+        Subsystem::Acquisition,
+        Some(MAIN_TASK_STACK_SIZE),
+    )
+    .keep();
 
     let sys_loop = EspSystemEventLoop::take()?;
     let nvs_partition = EspDefaultNvsPartition::take()?;
@@ -553,8 +516,18 @@ pub fn run() -> anyhow::Result<()> {
 
     let Peripherals { modem, pins, .. } = Peripherals::take()?;
 
-    let mut sensors = SensorSuite::new(pins.gpio4.downgrade(), pins.gpio16.downgrade())
-        .context("failed to initialize sensor suite")?;
+    let sensor_bus = EspSensorBus::new(pins.gpio4.downgrade(), pins.gpio16.downgrade())
+        .context("failed to initialize sensor bus")?;
+    let cached_probes = nvs_store.load_probe_cache().unwrap_or_else(|err| {
+        warn!("failed to load DS18B20 address cache: {err:#}");
+        Vec::new()
+    });
+    let mut acquisition = Acquisition::new(
+        sensor_bus,
+        ProbeResolution::from_bits(runtime.sensor_policy.resolution_bits),
+    )
+    .with_cached_probes(&cached_probes);
+    let acquisition_stats = Arc::new(Mutex::new(acquisition.stats()));
 
     let wifi = match connect_wifi(modem, sys_loop.clone(), nvs_partition, &runtime.network)
         .context("wifi startup failed")?
@@ -589,16 +562,38 @@ pub fn run() -> anyhow::Result<()> {
     add_current_task_to_watchdog()?;
 
     let ota_state = Arc::new(Mutex::new(OtaRuntimeState::default()));
-    let server = create_http_server(nvs_store.clone(), ota_state.clone())?;
+    let server = create_http_server(
+        nvs_store.clone(),
+        ota_state.clone(),
+        acquisition_stats.clone(),
+    )?;
 
     let (mut mqtt, mut conn) = create_mqtt_client(&runtime)?;
 
+    let mut policy = runtime.sensor_policy;
+    policy.sanitize();
+    let policy = Arc::new(Mutex::new(policy));
+    let policy_changed = Arc::new(AtomicBool::new(true));
+    let pending_burst: Arc<Mutex<Option<BurstRequest>>> = Arc::new(Mutex::new(None));
+    let mqtt_subscribe_gen = Arc::new(AtomicU32::new(1));
+
     let mqtt_connected = Arc::new(AtomicBool::new(false));
     let mqtt_connected_for_thread = mqtt_connected.clone();
+    let policy_for_thread = policy.clone();
+    let policy_changed_for_thread = policy_changed.clone();
+    let pending_burst_for_thread = pending_burst.clone();
+    let mqtt_subscribe_gen_for_thread = mqtt_subscribe_gen.clone();
+    let nvs_store_for_thread = nvs_store.clone();
     thread::Builder::new()
         .name("mqtt-poll".to_string())
-        .stack_size(8192)
+        .stack_size(MQTT_POLL_STACK_SIZE)
         .spawn(move || {
+            let _memory = register_thread(
+                &EspMemory,
+                "mqtt-poll",
+                Subsystem::Mqtt,
+                Some(MQTT_POLL_STACK_SIZE),
+            );
             // Don't register with watchdog — conn.next() legitimately blocks
             // waiting for MQTT events, which can take longer than WDT timeout.
             loop {
@@ -607,11 +602,43 @@ pub fn run() -> anyhow::Result<()> {
                         EventPayload::Connected(_) => {
                             info!("sensor mqtt connected");
                             mqtt_connected_for_thread.store(true, Ordering::Relaxed);
+                            mqtt_subscribe_gen_for_thread.fetch_add(1, Ordering::Relaxed);
                         }
                         EventPayload::Disconnected => {
                             warn!("sensor mqtt disconnected");
                             mqtt_connected_for_thread.store(false, Ordering::Relaxed);
                         }
+                        EventPayload::Received {
+                            topic: Some(TOPIC_CMD_SENSOR_POLICY),
+                            data,
+                            details: Details::Complete,
+                            ..
+                        } if data.len() <= MAX_MQTT_PAYLOAD_BYTES => {
+                            match serde_json::from_slice::<SensorPolicyUpdate>(data) {
+                                Ok(update) => {
+                                    if let Err(err) = apply_policy_update(
+                                        &nvs_store_for_thread,
+                                        &policy_for_thread,
+                                        &update,
+                                    ) {
+                                        warn!("failed to persist sensor policy: {err:#}");
+                                    }
+                                    policy_changed_for_thread.store(true, Ordering::Relaxed);
+                                }
+                                Err(err) => warn!("invalid sensor policy payload: {err}"),
+                            }
+                        }
+                        EventPayload::Received {
+                            topic: Some(TOPIC_CMD_SENSOR_BURST),
+                            data,
+                            details: Details::Complete,
+                            ..
+                        } => match serde_json::from_slice::<BurstRequest>(data) {
+                            Ok(request) => {
+                                *pending_burst_for_thread.lock().unwrap() = Some(request);
+                            }
+                            Err(err) => warn!("invalid sensor burst payload: {err}"),
+                        },
                         _ => {}
                     },
                     Err(err) => {
@@ -633,45 +660,151 @@ pub fn run() -> anyhow::Result<()> {
     let _server = server;
     let mut wifi_disconnected_since: Option<Instant> = None;
     let mut last_reconnect_attempt: Option<Instant> = None;
+    let mut backlog = ReadingBuffer::default();
+    let mut gate = PublishGate::new();
+    let mut trace_seq: u32 = 0;
+    let mut last_subscribed_gen = 0_u32;
 
     loop {
         feed_watchdog();
         maintain_wifi_health(&mut wifi_disconnected_since, &mut last_reconnect_attempt);
 
-        let readings = sensors.read();
-
-        if !mqtt_connected.load(Ordering::Relaxed) {
-            warn!("mqtt disconnected, publish may fail");
+        let connected = mqtt_connected.load(Ordering::Relaxed);
+        let current_gen = mqtt_subscribe_gen.load(Ordering::Relaxed);
+        if connected && current_gen != last_subscribed_gen {
+            let subscribed = mqtt
+                .subscribe(TOPIC_CMD_SENSOR_POLICY, QoS::AtLeastOnce)
+                .and_then(|_| mqtt.subscribe(TOPIC_CMD_SENSOR_BURST, QoS::AtLeastOnce));
+            match subscribed {
+                Ok(_) => {
+                    last_subscribed_gen = current_gen;
+                    // The controller may have marked us stale while we were
+                    // away, so report right away instead of waiting for a
+                    // deadband crossing or the heartbeat.
+                    gate.force();
+                    policy_changed.store(true, Ordering::Relaxed);
+                }
+                Err(err) => warn!("failed to subscribe to sensor command topics: {err:?}"),
+            }
         }
 
-        if let Some(temp_f) = readings.temperature_f {
-            let temp_payload = format!("{temp_f:.1}");
-            if let Err(err) = mqtt.publish(
-                TOPIC_SENSOR_TEMP,
-                QoS::AtLeastOnce,
-                false,
-                temp_payload.as_bytes(),
-            ) {
-                warn!("failed to publish temperature: {err:?}");
+        let policy = *policy.lock().unwrap();
+        acquisition.set_resolution(ProbeResolution::from_bits(policy.resolution_bits));
+        // The DHT11 read and the MQTT housekeeping below run while the
+        // DS18B20 converts, instead of after a blind 750 ms wait.
+        let readings = acquisition.acquire(|| {
+            if connected && policy_changed.swap(false, Ordering::Relaxed) {
+                publish_policy(&mut mqtt, &policy, &policy_changed);
+            }
+            if connected {
+                // Replay first so the controller sees buffered readings
+                // before the live ones that follow them.
+                replay_backlog(&mut mqtt, &mut backlog, monotonic_ms());
+            }
+        });
+        if let Some(err) = acquisition.take_error() {
+            warn!("sensor acquisition: {err}");
+        }
+        *acquisition_stats.lock().unwrap() = acquisition.stats();
+        if let Some(probes) = acquisition.take_probe_change() {
+            info!(
+                "DS18B20 probe set changed; caching {} address(es)",
+                probes.len()
+            );
+            if let Err(err) = nvs_store.save_probe_cache(&probes) {
+                warn!("failed to persist DS18B20 address cache: {err:#}");
             }
         }
+        let now_ms = monotonic_ms();
+        let captured_epoch_ms = wall_clock_ms();
+
+        if let Some(request) = pending_burst.lock().unwrap().take() {
+            info!(
+                "burst sampling every {} ms for {} ms",
+                request.interval_ms, request.duration_ms
+            );
+            gate.start_burst(now_ms, &request);
+        }
+
+        let trigger = gate.evaluate(&policy, now_ms, readings.temperature_f, readings.humidity);
+        let mut unsent_temp = None;
+        let mut unsent_humidity = None;
+        if trigger.is_some() {
+            gate.mark_published(now_ms, readings.temperature_f, readings.humidity);
+            unsent_temp = readings.temperature_f.map(DeciDegrees::from_f32);
+            unsent_humidity = readings.humidity;
+        }
+
+        if connected && trigger.is_some() {
+            if let Some(temp_f) = readings.temperature_f {
+                let trace = policy.trace_readings.then(|| {
+                    trace_seq = trace_seq.wrapping_add(1);
+                    SampleTrace {
+                        seq: trace_seq,
+                        captured_epoch_ms,
+                    }
+                });
+                let temp_payload = SensorSample {
+                    value: temp_f,
+                    trace,
+                }
+                .format();
+                match mqtt.publish(
+                    TOPIC_SENSOR_TEMP,
+                    QoS::AtLeastOnce,
+                    false,
+                    temp_payload.as_bytes(),
+                ) {
+                    Ok(_) => unsent_temp = None,
+                    Err(err) => warn!("failed to publish temperature: {err:?}"),
+                }
+            }
+
+            if let Some(humidity) = readings.humidity {
+                let humidity_payload = format!("{humidity:.1}");
+                match mqtt.publish(
+                    TOPIC_SENSOR_HUMIDITY,
+                    QoS::AtLeastOnce,
+                    false,
+                    humidity_payload.as_bytes(),
+                ) {
+                    Ok(_) => unsent_humidity = None,
+                    Err(err) => warn!("failed to publish humidity: {err:?}"),
+                }
+            }
 
-        if let Some(humidity) = readings.humidity {
-            let humidity_payload = format!("{humidity:.1}");
-            if let Err(err) = mqtt.publish(
-                TOPIC_SENSOR_HUMIDITY,
-                QoS::AtLeastOnce,
-                false,
-                humidity_payload.as_bytes(),
-            ) {
-                warn!("failed to publish humidity: {err:?}");
+            // Per-probe topics are live-only; the backlog keeps the primary
+            // reading that the controller acts on.
+            for probe in &readings.probes {
+                let Some(temp_f) = probe.temperature_f else {
+                    continue;
+                };
+                let topic = sensor_probe_temperature_topic(&probe.address.to_string());
+                let payload = format!("{temp_f:.1}");
+                if let Err(err) = mqtt.publish(&topic, QoS::AtLeastOnce, false, payload.as_bytes())
+                {
+                    warn!("failed to publish {topic}: {err:?}");
+                }
             }
         }
 
-        for _ in 0..30 {
+        if unsent_temp.is_some() || unsent_humidity.is_some() {
+            backlog.push(now_ms, unsent_temp, unsent_humidity);
+            warn!(
+                "mqtt unavailable; buffered reading ({} pending replay)",
+                backlog.len()
+            );
+        }
+
+        let sample_interval_ms = gate.sample_interval_ms(&policy, monotonic_ms());
+        for _ in 0..(sample_interval_ms / 1_000).max(1) {
             feed_watchdog();
             maintain_wifi_health(&mut wifi_disconnected_since, &mut last_reconnect_attempt);
             thread::sleep(Duration::from_secs(1));
+            // Start a requested burst now rather than after a long idle sleep.
+            if pending_burst.lock().unwrap().is_some() {
+                break;
+            }
         }
     }
 }
@@ -679,9 +812,10 @@ pub fn run() -> anyhow::Result<()> {
 fn create_http_server(
     nvs_store: NvsStore,
     ota_state: Arc<Mutex<OtaRuntimeState>>,
+    acquisition_stats: Arc<Mutex<AcquisitionStats>>,
 ) -> anyhow::Result<EspHttpServer<'static>> {
     let conf = HttpConfiguration {
-        stack_size: 16 * 1024,
+        stack_size: HTTP_STACK_SIZE,
         max_open_sockets: 4,
         lru_purge_enable: true,
         ..Default::default()
@@ -693,6 +827,22 @@ fn create_http_server(
         write_json(req, &serde_json::json!({"status": "ok"}))
     })?;
 
+    server.fn_handler("/api/acquisition", Method::Get, move |req| {
+        let stats = *acquisition_stats.lock().unwrap();
+        write_json(req, &stats)
+    })?;
+
+    server.fn_handler("/api/diagnostics/memory", Method::Get, move |req| {
+        // Handlers run on the HTTP server's task, which ESP-IDF creates. Its
+        // high-water mark covers every request since boot, but allocations
+        // only count as http from the first report on.
+        static HTTP_TASK: Once = Once::new();
+        HTTP_TASK.call_once(|| {
+            register_thread(&EspMemory, "httpd", Subsystem::Http, Some(HTTP_STACK_SIZE)).keep();
+        });
+        write_json(req, &memory_report(&EspMemory))
+    })?;
+
     server.fn_handler::<anyhow::Error, _>("/", Method::Get, move |req| {
         req.into_response(200, Some("OK"), &[("Content-Type", "text/html; charset=utf-8")])?
             .write_all(SENSOR_PORTAL_HTML.as_bytes())?;
@@ -1249,8 +1399,14 @@ fn apply_ota_update(
     let ota_state_for_thread = ota_state.clone();
     let spawn_result = thread::Builder::new()
         .name("ota-apply".into())
-        .stack_size(16 * 1024)
+        .stack_size(OTA_STACK_SIZE)
         .spawn(move || {
+            let _memory = register_thread(
+                &EspMemory,
+                "ota-apply",
+                Subsystem::Ota,
+                Some(OTA_STACK_SIZE),
+            );
             let reboot_after_apply = update.reboot.unwrap_or(true);
             let expected_sha = update
                 .sha256
@@ -1468,12 +1624,41 @@ impl NvsStore {
     }
 
     fn save_runtime_config(&self, runtime: &RuntimeConfig) -> anyhow::Result<()> {
+        let _memory = SubsystemScope::enter(&EspMemory, Subsystem::Storage);
         let _guard = self.lock.lock().unwrap();
         let mut nvs = EspNvs::new(self.partition.clone(), NVS_NAMESPACE, true)?;
         let payload = serde_json::to_string(runtime)?;
         nvs.set_str(NVS_RUNTIME_KEY, &payload)?;
         Ok(())
     }
+
+    // Probe ROM codes as little-endian u64s, primary first, so boot can skip
+    // the search and keep the same primary probe.
+    fn load_probe_cache(&self) -> anyhow::Result<Vec<ProbeAddress>> {
+        let _memory = SubsystemScope::enter(&EspMemory, Subsystem::Storage);
+        let _guard = self.lock.lock().unwrap();
+        let nvs = EspNvs::new(self.partition.clone(), NVS_NAMESPACE, true)?;
+        let mut buffer = [0_u8; thermostat_common::acquisition::MAX_PROBES * 8];
+
+        Ok(nvs
+            .get_blob(NVS_PROBES_KEY, &mut buffer)?
+            .unwrap_or_default()
+            .chunks_exact(8)
+            .map(|chunk| ProbeAddress(u64::from_le_bytes(chunk.try_into().unwrap())))
+            .collect())
+    }
+
+    fn save_probe_cache(&self, probes: &[ProbeAddress]) -> anyhow::Result<()> {
+        let _memory = SubsystemScope::enter(&EspMemory, Subsystem::Storage);
+        let _guard = self.lock.lock().unwrap();
+        let mut nvs = EspNvs::new(self.partition.clone(), NVS_NAMESPACE, true)?;
+        let payload: Vec<u8> = probes
+            .iter()
+            .flat_map(|probe| probe.0.to_le_bytes())
+            .collect();
+        nvs.set_blob(NVS_PROBES_KEY, &payload)?;
+        Ok(())
+    }
 }
 
 fn init_watchdog(timeout_sec: u32) -> anyhow::Result<()> {
@@ -1579,6 +1764,69 @@ fn maintain_wifi_health(
     }
 }
 
-fn celsius_to_fahrenheit(temp_c: f32) -> f32 {
-    temp_c * 9.0 / 5.0 + 32.0
+fn apply_policy_update(
+    nvs_store: &NvsStore,
+    policy: &Arc<Mutex<SensorPublishPolicy>>,
+    update: &SensorPolicyUpdate,
+) -> anyhow::Result<()> {
+    let updated = {
+        let mut policy = policy.lock().unwrap();
+        policy.apply(update);
+        *policy
+    };
+    info!("sensor publish policy updated: {updated:?}");
+
+    let mut runtime = nvs_store.load_runtime_config()?;
+    runtime.sensor_policy = updated;
+    nvs_store.save_runtime_config(&runtime)
+}
+
+fn publish_policy(
+    mqtt: &mut EspMqttClient<'static>,
+    policy: &SensorPublishPolicy,
+    policy_changed: &AtomicBool,
+) {
+    let payload = match serde_json::to_vec(&SensorPolicyUpdate::from(policy)) {
+        Ok(payload) => payload,
+        Err(err) => {
+            warn!("failed to encode sensor policy: {err}");
+            return;
+        }
+    };
+    if let Err(err) = mqtt.publish(TOPIC_SENSOR_POLICY, QoS::AtLeastOnce, true, &payload) {
+        warn!("failed to publish sensor policy: {err:?}");
+        policy_changed.store(true, Ordering::Relaxed);
+    }
+}
+
+fn replay_backlog(mqtt: &mut EspMqttClient<'static>, backlog: &mut ReadingBuffer, now_ms: u64) {
+    let pending = backlog.len();
+    while let Some(batch) = backlog.next_batch(now_ms) {
+        let payload = match serde_json::to_vec(&batch) {
+            Ok(payload) => payload,
+            Err(err) => {
+                warn!("failed to encode sensor history batch: {err}");
+                return;
+            }
+        };
+        if let Err(err) = mqtt.publish(TOPIC_SENSOR_HISTORY, QoS::AtLeastOnce, false, &payload) {
+            warn!("failed to replay buffered readings: {err:?}");
+            return;
+        }
+        backlog.commit(&batch);
+        feed_watchdog();
+    }
+    if pending > 0 {
+        info!("replayed {pending} buffered sensor readings");
+    }
+}
+
+fn monotonic_ms() -> u64 {
+    static START: OnceLock<Instant> = OnceLock::new();
+    START
+        .get_or_init(Instant::now)
+        .elapsed()
+        .as_millis()
+        .try_into()
+        .unwrap_or(u64::MAX)
 }
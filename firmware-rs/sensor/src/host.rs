@@ -1,15 +1,22 @@
-use std::time::Duration;
+use std::{sync::Arc, time::Duration};
 
 use anyhow::Context;
-use rumqttc::{AsyncClient, MqttOptions, QoS};
+use rumqttc::{AsyncClient, Event, Incoming, MqttOptions, QoS};
+use tokio::sync::Mutex;
 use tracing::{info, warn};
 
-use thermostat_common::{TOPIC_SENSOR_HUMIDITY, TOPIC_SENSOR_STATUS, TOPIC_SENSOR_TEMP};
+use thermostat_common::{
+    sensor_probe_temperature_topic, trace::wall_clock_ms, Acquisition, BurstRequest, MockSensorBus,
+    ProbeResolution, PublishGate, SampleTrace, SensorPolicyUpdate, SensorPublishPolicy,
+    SensorSample, TOPIC_CMD_SENSOR_BURST, TOPIC_CMD_SENSOR_POLICY, TOPIC_SENSOR_HUMIDITY,
+    TOPIC_SENSOR_POLICY, TOPIC_SENSOR_STATUS, TOPIC_SENSOR_TEMP,
+};
 
 pub async fn run() -> anyhow::Result<()> {
-    tracing_subscriber::fmt()
+    // try_init: the end-to-end tests run controller and sensor in one process.
+    let _ = tracing_subscriber::fmt()
         .with_env_filter(tracing_subscriber::EnvFilter::from_default_env())
-        .init();
+        .try_init();
 
     let mqtt_host = std::env::var("MQTT_HOST").unwrap_or_else(|_| "127.0.0.1".to_string());
     let mqtt_port = std::env::var("MQTT_PORT")
@@ -30,42 +37,165 @@ pub async fn run() -> anyhow::Result<()> {
         .await
         .context("failed to publish sensor online status")?;
 
+    let policy = Arc::new(Mutex::new(SensorPublishPolicy::default()));
+    let policy_for_loop = policy.clone();
+    let pending_burst: Arc<Mutex<Option<BurstRequest>>> = Arc::new(Mutex::new(None));
+    let pending_burst_for_loop = pending_burst.clone();
+    let mqtt_for_loop = mqtt.clone();
     tokio::spawn(async move {
         loop {
-            if let Err(err) = eventloop.poll().await {
-                warn!("sensor mqtt poll error: {err}");
-                tokio::time::sleep(Duration::from_secs(2)).await;
+            match eventloop.poll().await {
+                Ok(Event::Incoming(Incoming::ConnAck(_))) => {
+                    // Requests go through the client's bounded queue, which
+                    // only this poll loop drains; awaiting them here would
+                    // deadlock once it fills.
+                    let mqtt = mqtt_for_loop.clone();
+                    tokio::spawn(async move {
+                        for topic in [TOPIC_CMD_SENSOR_POLICY, TOPIC_CMD_SENSOR_BURST] {
+                            if let Err(err) = mqtt.subscribe(topic, QoS::AtLeastOnce).await {
+                                warn!("failed to subscribe to {topic}: {err}");
+                            }
+                        }
+                    });
+                }
+                Ok(Event::Incoming(Incoming::Publish(publish)))
+                    if publish.topic == TOPIC_CMD_SENSOR_POLICY =>
+                {
+                    match serde_json::from_slice::<SensorPolicyUpdate>(&publish.payload) {
+                        Ok(update) => {
+                            let updated = {
+                                let mut policy = policy_for_loop.lock().await;
+                                policy.apply(&update);
+                                *policy
+                            };
+                            info!("sensor publish policy updated: {updated:?}");
+                            let mqtt = mqtt_for_loop.clone();
+                            tokio::spawn(async move { publish_policy(&mqtt, &updated).await });
+                        }
+                        Err(err) => warn!("invalid sensor policy payload: {err}"),
+                    }
+                }
+                Ok(Event::Incoming(Incoming::Publish(publish)))
+                    if publish.topic == TOPIC_CMD_SENSOR_BURST =>
+                {
+                    match serde_json::from_slice::<BurstRequest>(&publish.payload) {
+                        Ok(request) => *pending_burst_for_loop.lock().await = Some(request),
+                        Err(err) => warn!("invalid sensor burst payload: {err}"),
+                    }
+                }
+                Ok(_) => {}
+                Err(err) => {
+                    warn!("sensor mqtt poll error: {err}");
+                    tokio::time::sleep(Duration::from_secs(2)).await;
+                }
             }
         }
     });
 
+    publish_policy(&mqtt, &*policy.lock().await).await;
     info!("sensor publisher started");
 
     let mut tick: u64 = 0;
-    let mut interval = tokio::time::interval(Duration::from_secs(30));
+    let mut trace_seq: u32 = 0;
+    let mut gate = PublishGate::new();
+    // Two simulated probes and a DHT11 running through the same pipelined
+    // cycle as the ESP build; the mock bus advances a virtual clock instead
+    // of waiting.
+    let mut acquisition = Acquisition::new(
+        MockSensorBus::with_probes(&[20.0, 19.0], 42.0),
+        ProbeResolution::from_bits(policy.lock().await.resolution_bits),
+    );
+    let started = tokio::time::Instant::now();
 
     loop {
-        interval.tick().await;
+        let policy = *policy.lock().await;
         tick = tick.saturating_add(1);
 
-        // Hardware integration point:
-        // replace these simulated readings with DS18B20 + DHT11 drivers on ESP target.
-        let temperature_f = 68.0 + ((tick % 8) as f32 * 0.2);
-        let humidity = 42.0 + ((tick % 6) as f32 * 0.5);
+        let simulated_f = 68.0 + ((tick % 48) as f32 * 0.05);
+        // The second probe sits on the cold side of the room.
+        for (index, offset_f) in [0.0, -1.5].into_iter().enumerate() {
+            acquisition.bus_mut().probes[index].temperature_c =
+                (simulated_f + offset_f - 32.0) * 5.0 / 9.0;
+        }
+        acquisition.bus_mut().humidity = 42.0 + ((tick % 36) as f32 * 0.1);
+        acquisition.set_resolution(ProbeResolution::from_bits(policy.resolution_bits));
+        let readings = acquisition.acquire(|| {});
+        let (Some(temperature_f), Some(humidity)) = (readings.temperature_f, readings.humidity)
+        else {
+            tokio::time::sleep(Duration::from_millis(policy.sample_interval_ms)).await;
+            continue;
+        };
+        tracing::debug!("acquisition cycle: {:?}", acquisition.stats().last);
+
+        let now_ms = started.elapsed().as_millis() as u64;
+        let captured_epoch_ms = wall_clock_ms();
+        if let Some(request) = pending_burst.lock().await.take() {
+            info!("burst sampling requested: {request:?}");
+            gate.start_burst(now_ms, &request);
+        }
+        if let Some(trigger) = gate.evaluate(&policy, now_ms, Some(temperature_f), Some(humidity)) {
+            gate.mark_published(now_ms, Some(temperature_f), Some(humidity));
+            info!("publishing sensor reading ({trigger:?})");
 
-        let temp_payload = format!("{temperature_f:.1}");
-        let humidity_payload = format!("{humidity:.1}");
+            let trace = policy.trace_readings.then(|| {
+                trace_seq = trace_seq.wrapping_add(1);
+                SampleTrace {
+                    seq: trace_seq,
+                    captured_epoch_ms,
+                }
+            });
+            let temp_payload = SensorSample {
+                value: temperature_f,
+                trace,
+            }
+            .format();
+            let humidity_payload = format!("{humidity:.1}");
 
-        mqtt.publish(TOPIC_SENSOR_TEMP, QoS::AtLeastOnce, true, temp_payload)
+            mqtt.publish(TOPIC_SENSOR_TEMP, QoS::AtLeastOnce, true, temp_payload)
+                .await
+                .context("failed to publish sensor temperature")?;
+            mqtt.publish(
+                TOPIC_SENSOR_HUMIDITY,
+                QoS::AtLeastOnce,
+                true,
+                humidity_payload,
+            )
             .await
-            .context("failed to publish sensor temperature")?;
-        mqtt.publish(
-            TOPIC_SENSOR_HUMIDITY,
-            QoS::AtLeastOnce,
-            true,
-            humidity_payload,
-        )
+            .context("failed to publish sensor humidity")?;
+
+            // Live-only and not retained, as on the ESP: a removed probe's
+            // last value must not linger on the broker.
+            for probe in &readings.probes {
+                if let Some(temp_f) = probe.temperature_f {
+                    mqtt.publish(
+                        sensor_probe_temperature_topic(&probe.address.to_string()),
+                        QoS::AtLeastOnce,
+                        false,
+                        format!("{temp_f:.1}"),
+                    )
+                    .await
+                    .context("failed to publish probe temperature")?;
+                }
+            }
+        }
+
+        let sample_interval_ms = gate.sample_interval_ms(&policy, now_ms);
+        tokio::time::sleep(Duration::from_millis(sample_interval_ms)).await;
+    }
+}
+
+async fn publish_policy(mqtt: &AsyncClient, policy: &SensorPublishPolicy) {
+    let payload = match serde_json::to_vec(&SensorPolicyUpdate::from(policy)) {
+        Ok(payload) => payload,
+        Err(err) => {
+            warn!("failed to encode sensor policy: {err}");
+            return;
+        }
+    };
+    if let Err(err) = mqtt
+        .publish(TOPIC_SENSOR_POLICY, QoS::AtLeastOnce, true, payload)
         .await
-        .context("failed to publish sensor humidity")?;
+    {
+        warn!("failed to publish sensor policy: {err}");
     }
 }
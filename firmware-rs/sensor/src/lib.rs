@@ -0,0 +1,4 @@
+// The host build is also a library so integration tests can run the sensor
+// in-process next to the controller and an embedded broker.
+#[cfg(not(feature = "esp32"))]
+pub mod host;
@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Saves or compares Criterion baselines for the engine benches. Baselines live
+# in target/criterion/<group>/<name>/<baseline>/, so save one on the main
+# branch and compare each engine change against it on the same machine.
+#
+#   tools/bench_baseline.sh save [baseline]
+#   tools/bench_baseline.sh compare [baseline]
+#
+# compare exits non-zero when Criterion reports a regression. Changes within
+# THERMOSTAT_BENCH_NOISE (a fraction, Criterion's default 0.01) count as noise;
+# the pull request workflow raises it for shared runners. THERMOSTAT_BENCH_WORKSPACE
+# points a copy of this script at another checkout's firmware-rs directory.
+
+ACTION="${1:-compare}"
+BASELINE="${2:-${THERMOSTAT_BENCH_BASELINE:-main}}"
+BENCH="${THERMOSTAT_BENCH:-engine}"
+NOISE="${THERMOSTAT_BENCH_NOISE:-0.01}"
+
+log() {
+  printf '[bench] %s\n' "$*"
+}
+
+cd "${THERMOSTAT_BENCH_WORKSPACE:-$(dirname "$0")/..}"
+
+case "${ACTION}" in
+  save)
+    log "Saving baseline '${BASELINE}' for bench '${BENCH}'"
+    cargo bench -p thermostat-common --bench "${BENCH}" -- --save-baseline "${BASELINE}"
+    ;;
+  compare)
+    log "Comparing bench '${BENCH}' against baseline '${BASELINE}'"
+    output="$(mktemp)"
+    trap 'rm -f "${output}"' EXIT
+    cargo bench -p thermostat-common --bench "${BENCH}" -- \
+      --baseline "${BASELINE}" --noise-threshold "${NOISE}" | tee "${output}"
+    if grep -q "Performance has regressed" "${output}"; then
+      log "Regressions against '${BASELINE}':"
+      grep -B 3 "Performance has regressed" "${output}" | grep -E '^[a-z_]+/' || true
+      exit 1
+    fi
+    log "No regressions against '${BASELINE}'"
+    ;;
+  *)
+    echo "usage: $0 save|compare [baseline]" >&2
+    exit 2
+    ;;
+esac